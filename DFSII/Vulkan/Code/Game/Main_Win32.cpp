@@ -19,6 +19,7 @@
 #include "Engine/Renderer/ShaderStorageBlock.hpp"
 #include "Engine/Network/NetworkSystem.hpp"
 #include "Engine/Core/EventSystem.hpp"
+#include "Engine/Core/DeferredEvents.hpp"
 #include "Quantum/Core/EventSystem.h"
 #include "Quantum/FileSystem/FileUtils.h"
 #include "Quantum/FileSystem/Path.h"
@@ -425,8 +426,9 @@ void Tick()
 	++frameNumber;
 	TickEvent te;
 	te.deltaSeconds = deltaSeconds;
-	g_eventSystem->TriggerEvent("Tick", &te);
-	QuEvent::Fire("Tick", QuNamedProperties("DeltaSeconds", "Hello", "DooltaSooconds", deltaSeconds / 2.f, "DailtaSaiconds", deltaSeconds * 2.f));
+	DeferredEvents::DispatchAll();
+	g_eventSystem->TriggerEvent(EVENT_ID("Tick"), &te);
+	QuEvent::Fire("Tick", "DeltaSeconds", deltaSeconds);
 	//g_theGame->Tick(deltaSeconds);
 	The.Input->Tick();
 //	The.Audio->Tick(deltaSeconds);
@@ -482,6 +484,7 @@ void Render()
 //-----------------------------------------------------------------------------------------------
 void RunFrame()
 {
+	The.BeginFrame();
 	RunMessagePump();
 	Tick();
 	Render();
@@ -518,6 +521,7 @@ void Shutdown()
 	BitmapFont::DestroyFonts();
 	SpriteResource::UnloadDatabase();
 	ShaderStorageBlock::DestroyShaderStorageBlocks();
+	DeferredEvents::DiscardAll();
 	QuEventSystem::DestroySystem();
 	delete g_theGame;
 	delete g_eventSystem;
@@ -88,8 +88,7 @@ TheGame::TheGame()
 
 	proj.MakePerspective(120.f, 16.f / 9.f, .1f, 1000.f);
 	UniformBlock::SetMat4("GlobalMatrices", "gProj", proj);
-	ConsolePrint = GConsolePrint;
-	ConsolePrintf = GConsolePrintf;
+	SetConsoleOutput(GConsolePrint);
 
 	g_spriteRenderer = new SpriteRenderer();
 	g_spriteRenderer->SetClearColor(BLACK);
@@ -160,6 +159,7 @@ static ParticleSystem* myParticleSystem = nullptr;
 //-----------------------------------------------------------------------------------------------
 void TheGame::Update(QuNamedProperties& props)
 {
+	ScopedMemoryTag memoryTag(MEMTAG_GAME);
 	float deltaSeconds;
 	props.Get("DeltaSeconds", deltaSeconds);
 	Tick(deltaSeconds);
@@ -502,6 +502,7 @@ extern Actor* loadedActor;
 //-----------------------------------------------------------------------------------------------
 void TheGame::Render(float deltaSeconds)
 {
+	ScopedMemoryTag memoryTag(MEMTAG_GAME);
 	glViewport(350, 0, 900, 900);
 	g_spriteRenderer->Render();
 
@@ -723,21 +724,24 @@ void TheGame::MemoryRender(float deltaSeconds)
 {
 	static float secondsSinceLastMemoryUpdate = 0.f;
 	const float k_timeBetweenMemoryUpdates = 1.f;
-	static unsigned int allocatedBytesOverLastUpdate = 0;
-	static unsigned int freedBytesOverLastUpdate = 0;
+	static uint64_t totalAllocatedBytesAtLastUpdate = 0;
+	static uint64_t totalFreedBytesAtLastUpdate = 0;
+	static uint64_t allocatedBytesOverLastUpdate = 0;
+	static uint64_t freedBytesOverLastUpdate = 0;
 #ifdef MEMORY_DETECTION_MODE
 	if (!g_isDebuggingMemory)
 	{
 		secondsSinceLastMemoryUpdate = 0.f;
 		return;
 	}
+	MemoryStats stats = MemoryTracker::GetStats();
 	secondsSinceLastMemoryUpdate += deltaSeconds;
 	if (secondsSinceLastMemoryUpdate >= k_timeBetweenMemoryUpdates)
 	{
-		allocatedBytesOverLastUpdate = g_bytesAllocatedSinceLastUpdate;
-		freedBytesOverLastUpdate = g_bytesFreedSinceLastUpdate;
-		g_bytesFreedSinceLastUpdate = 0;
-		g_bytesAllocatedSinceLastUpdate = 0;
+		allocatedBytesOverLastUpdate = stats.totalBytesAllocated - totalAllocatedBytesAtLastUpdate;
+		freedBytesOverLastUpdate = stats.totalBytesFreed - totalFreedBytesAtLastUpdate;
+		totalAllocatedBytesAtLastUpdate = stats.totalBytesAllocated;
+		totalFreedBytesAtLastUpdate = stats.totalBytesFreed;
 		secondsSinceLastMemoryUpdate = 0.f;
 	}
 	BitmapFont* arial = BitmapFont::CreateOrGetFont("arial");
@@ -746,17 +750,17 @@ void TheGame::MemoryRender(float deltaSeconds)
 	float startHeight = 450.f;
 	float startWidth = 30.f;
 
-	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Current allocations: %u", g_numAllocations), cellHeight, WHITE, arial);
+	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Current allocations: %llu", stats.numLiveAllocations), cellHeight, WHITE, arial);
 	startHeight -= lineSpacing;
-	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Current allocated bytes: %u", g_totalAllocatedBytes), cellHeight, WHITE, arial);
+	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Current allocated bytes: %llu", stats.liveBytes), cellHeight, WHITE, arial);
 	startHeight -= lineSpacing;
-	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Highwater bytes: %u", g_currentHighwaterBytes), cellHeight, WHITE, arial);
+	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Highwater bytes: %llu", stats.highWaterBytes), cellHeight, WHITE, arial);
 	startHeight -= lineSpacing;
-	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Bytes allocated in the last second: %u", allocatedBytesOverLastUpdate), cellHeight, WHITE, arial);
+	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Bytes allocated in the last second: %llu", allocatedBytesOverLastUpdate), cellHeight, WHITE, arial);
 	startHeight -= lineSpacing;
-	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Bytes freed in the last second: %u", freedBytesOverLastUpdate), cellHeight, WHITE, arial);
+	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Bytes freed in the last second: %llu", freedBytesOverLastUpdate), cellHeight, WHITE, arial);
 	startHeight -= lineSpacing;
-	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Delta allocations in the last second: %i", (int)allocatedBytesOverLastUpdate - (int)freedBytesOverLastUpdate), cellHeight, WHITE, arial);
+	The.Renderer->DrawText2D(Vector2(startWidth, startHeight), Stringf("Delta allocations in the last second: %lli", (long long)allocatedBytesOverLastUpdate - (long long)freedBytesOverLastUpdate), cellHeight, WHITE, arial);
 
 #endif
 }
@@ -907,21 +911,6 @@ void TheGame::GConsolePrint(const std::string& toPrint, const Rgba& color)
 		g_theGame->m_consoleLog.pop_back();
 	}
 }
-#include <stdarg.h>
-const int STRINGF_STACK_LOCAL_TEMP_LENGTH = 2048;
-
-//-----------------------------------------------------------------------------------------------
-void TheGame::GConsolePrintf(const Rgba& color, const char* format, ...)
-{
-	char textLiteral[STRINGF_STACK_LOCAL_TEMP_LENGTH];
-	va_list variableArgumentList;
-	va_start(variableArgumentList, format);
-	vsnprintf_s(textLiteral, STRINGF_STACK_LOCAL_TEMP_LENGTH, _TRUNCATE, format, variableArgumentList);
-	va_end(variableArgumentList);
-	textLiteral[STRINGF_STACK_LOCAL_TEMP_LENGTH - 1] = '\0'; // In case vsnprintf overran (doesn't auto-terminate)
-
-	ConsolePrint(std::string(textLiteral), color);
-}
 
 
 //-----------------------------------------------------------------------------------------------
@@ -1049,7 +1038,7 @@ CONSOLE_COMMAND(NSCreateConnection, args)
 	
 	ConnectionChangeEvent cce;
 	cce.connection = thisConn;
-	g_eventSystem->TriggerEvent("OnConnectionJoin", &cce);
+	g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionJoin"), &cce);
 }
 
 
@@ -1071,11 +1060,13 @@ CONSOLE_COMMAND(NSDestroyConnection, args)
 	}
 	byte index = (byte)intdex;
 
+	//Held from the lookup through the destroy, so the network thread can't time the connection out in between
+	LockedConnections connections = g_netSession->GetConnections();
 	NetConnection* toDestroy = g_netSession->GetConnectionAtIndex(index);
 	ConnectionChangeEvent cce;
 	cce.connection = toDestroy;
 
-	g_eventSystem->TriggerEvent("OnConnectionLeave", &cce);
+	g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionLeave"), &cce);
 	
 	g_netSession->DestroyConnection(index);
 }
@@ -1107,7 +1098,7 @@ CONSOLE_COMMAND(NSSendReliables, args)
 		NetMessage message(NETMESSAGE_PING);
 		message.SetFlag(NETMESSAGEFLAG_RELIABLE);
 		message.Write<std::string>(Stringf("%i", i));
-		std::vector<NetConnection*>& conns = g_netSession->GetConnections();
+		LockedConnections conns = g_netSession->GetConnections();
 		for (NetConnection* conn : conns)
 		{
 			conn->AddMessage(message);
@@ -1143,7 +1134,7 @@ CONSOLE_COMMAND(NSSendOOOO, args)
 		message.SetFlag(NETMESSAGEFLAG_RELIABLE);
 		message.SetFlag(NETMESSAGEFLAG_ORDERED);
 		message.Write<std::string>(Stringf("%i", i));
-		std::vector<NetConnection*>& conns = g_netSession->GetConnections();
+		LockedConnections conns = g_netSession->GetConnections();
 		for (NetConnection* conn : conns)
 		{
 			conn->AddMessage(message);
@@ -1179,7 +1170,7 @@ CONSOLE_COMMAND(NSHost, args)
 	ConsolePrint("Successfully hosted", WHITE);
 	ConnectionChangeEvent cce;
 	cce.connection = g_netSession->GetOwnConnection();
-	g_eventSystem->TriggerEvent("OnConnectionJoin", &cce);
+	g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionJoin"), &cce);
 }
 
 
@@ -68,7 +68,6 @@ public:
 	void DebugDrawAABB3(const Vector3& mins, const Vector3& maxs, bool canTimeout, float timeToLive = 0.f, EDepthTestType dtt = DEPTHTEST, const Rgba& edgeColor = WHITE, const Rgba& faceColor = WHITE);
 	void DebugDrawSphere(const Vector3& position, float radius, bool canTimeout, float timeToLive = 0.f, EDepthTestType dtt = DEPTHTEST, const Rgba& color = WHITE);
 	static void GConsolePrint(const std::string& toPrint, const Rgba& color);
-	static void GConsolePrintf(const Rgba& color, const char* format, ...);
 	void DebugRender(float deltaSeconds);
 	void DebugRenderInput();
 	void CallCommand(const std::string& m_workingString);
@@ -0,0 +1,261 @@
+#include "Engine/Core/ArenaAllocator.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+#include <atomic>
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------------------------
+ArenaAllocator::ArenaAllocator(size_t chunkBytes, bool isGrowable /*= false*/)
+	: m_firstChunk(nullptr)
+	, m_currChunk(nullptr)
+	, m_offset(0)
+	, m_bytesInPreviousChunks(0)
+	, m_chunkBytes(chunkBytes)
+	, m_totalCapacity(0)
+	, m_highWaterBytes(0)
+	, m_numChunks(0)
+	, m_isGrowable(isGrowable)
+{
+	ASSERT_OR_DIE(chunkBytes > 0, "Cannot make an empty arena");
+	m_firstChunk = CreateChunk(chunkBytes);
+	m_currChunk = m_firstChunk;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ArenaAllocator::~ArenaAllocator()
+{
+	Chunk* currChunk = m_firstChunk;
+	while (currChunk)
+	{
+		Chunk* nextChunk = currChunk->next;
+		free(currChunk);
+		currChunk = nextChunk;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ArenaAllocator::RewindTo(const Marker& marker)
+{
+	ASSERT_OR_DIE(marker.bytesInPreviousChunks + marker.offset <= GetUsedBytes(), "Arena rewound to a marker past its fill point");
+
+	m_currChunk = marker.chunk;
+	m_offset = marker.offset;
+	m_bytesInPreviousChunks = marker.bytesInPreviousChunks;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ArenaAllocator::Reset()
+{
+	m_currChunk = m_firstChunk;
+	m_offset = 0;
+	m_bytesInPreviousChunks = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* ArenaAllocator::AllocFromNextChunk(size_t numBytes, size_t alignment)
+{
+	ASSERT_OR_DIE(m_isGrowable, "Ran out of space in arena allocator!");
+
+	//Reuse the chunk we grew into last time if the allocation fits, otherwise splice a new one in ahead of it
+	size_t worstCaseBytes = numBytes + alignment - 1;
+	Chunk* nextChunk = m_currChunk->next;
+	if (!nextChunk || nextChunk->capacity < worstCaseBytes)
+	{
+		Chunk* newChunk = CreateChunk((worstCaseBytes > m_chunkBytes) ? worstCaseBytes : m_chunkBytes);
+		newChunk->next = nextChunk;
+		m_currChunk->next = newChunk;
+		nextChunk = newChunk;
+	}
+
+	//Whatever was left at the end of the old chunk is counted as used until the next rewind
+	m_bytesInPreviousChunks += m_currChunk->capacity;
+	m_currChunk = nextChunk;
+	m_offset = 0;
+
+	return Alloc(numBytes, alignment);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ArenaAllocator::Chunk* ArenaAllocator::CreateChunk(size_t capacity)
+{
+	Chunk* result = (Chunk*)malloc(sizeof(Chunk) + capacity);
+	ASSERT_OR_DIE(result, "Failed to allocate arena chunk");
+	result->next = nullptr;
+	result->capacity = capacity;
+
+	m_totalCapacity += capacity;
+	m_numChunks++;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// FRAME ARENAS
+//-----------------------------------------------------------------------------------------------
+static std::atomic<unsigned int> s_frameNumber(0);
+
+
+//-----------------------------------------------------------------------------------------------
+struct ThreadFrameArenas
+{
+	ThreadFrameArenas()
+		: evenFrameArena(FrameArena::CHUNK_BYTES, true)
+		, oddFrameArena(FrameArena::CHUNK_BYTES, true)
+		, lastUsedFrameNumber(0)
+	{
+	}
+
+	ArenaAllocator& GetArenaForFrame(unsigned int frameNumber) { return (frameNumber & 1) ? oddFrameArena : evenFrameArena; }
+
+	ArenaAllocator evenFrameArena;
+	ArenaAllocator oddFrameArena;
+	unsigned int lastUsedFrameNumber;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static ThreadFrameArenas& GetThreadFrameArenas()
+{
+	static thread_local ThreadFrameArenas s_threadFrameArenas;
+	return s_threadFrameArenas;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void FrameArena::BeginFrame()
+{
+	s_frameNumber.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+unsigned int FrameArena::GetFrameNumber()
+{
+	return s_frameNumber.load(std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ArenaAllocator& FrameArena::Get()
+{
+	ThreadFrameArenas& threadArenas = GetThreadFrameArenas();
+	unsigned int frameNumber = GetFrameNumber();
+	ArenaAllocator& result = threadArenas.GetArenaForFrame(frameNumber);
+
+	//First use on this thread since the flip.  Whatever is in here is at least two frames old
+	if (threadArenas.lastUsedFrameNumber != frameNumber)
+	{
+		result.Reset();
+		threadArenas.lastUsedFrameNumber = frameNumber;
+	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ArenaAllocator& FrameArena::GetPrevious()
+{
+	return GetThreadFrameArenas().GetArenaForFrame(GetFrameNumber() - 1);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(FrameArenaStats, args)
+{
+	UNUSED(args);
+
+	ArenaAllocator& arena = FrameArena::Get();
+	ConsolePrintf(WHITE, "Frame arena (frame %u, this thread): %u bytes used, %u high water, %u capacity in %i chunks", FrameArena::GetFrameNumber(),
+		(unsigned int)arena.GetUsedBytes(), (unsigned int)arena.GetHighWaterBytes(), (unsigned int)arena.GetCapacity(), arena.GetNumChunks());
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// ALLOCATION BENCHMARK
+//	Lots of small, short-lived, mixed-size allocations - the per-frame scratch pattern the frame
+//	arenas are for - first through malloc/free, then through a rewound arena
+//-----------------------------------------------------------------------------------------------
+static const int BENCHMARK_ALLOCATIONS_PER_BATCH = 256;
+
+
+//-----------------------------------------------------------------------------------------------
+static size_t GetBenchmarkAllocationSize(int index)
+{
+	return 16 + (index * 37) % 240;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(ArenaBenchmark, args)
+{
+	int numBatches = 10000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numBatches = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: arenabenchmark [numBatches]", RED);
+		return;
+	}
+
+	if (numBatches < 1)
+	{
+		ConsolePrint("Need at least one batch", RED);
+		return;
+	}
+
+	void* allocations[BENCHMARK_ALLOCATIONS_PER_BATCH];
+	size_t checksum = 0;
+
+	double startSeconds = GetCurrentTimeSeconds();
+	for (int batch = 0; batch < numBatches; batch++)
+	{
+		for (int i = 0; i < BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			allocations[i] = malloc(GetBenchmarkAllocationSize(i));
+			*(int*)allocations[i] = i;
+		}
+		for (int i = 0; i < BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			checksum += *(int*)allocations[i];
+			free(allocations[i]);
+		}
+	}
+	double mallocSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	ArenaAllocator arena(64 * 1024, true);
+	startSeconds = GetCurrentTimeSeconds();
+	for (int batch = 0; batch < numBatches; batch++)
+	{
+		ScopedArenaRewind rewind(arena);
+		for (int i = 0; i < BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			allocations[i] = arena.Alloc(GetBenchmarkAllocationSize(i));
+			*(int*)allocations[i] = i;
+		}
+		for (int i = 0; i < BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			checksum += *(int*)allocations[i];
+		}
+	}
+	double arenaSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	size_t expectedChecksum = 2 * (size_t)numBatches * (BENCHMARK_ALLOCATIONS_PER_BATCH * (BENCHMARK_ALLOCATIONS_PER_BATCH - 1) / 2);
+	double numAllocations = (double)numBatches * BENCHMARK_ALLOCATIONS_PER_BATCH;
+	ConsolePrintf(checksum == expectedChecksum ? WHITE : RED, "%i batches of %i allocations: malloc/free %.1f ns each, arena %.1f ns each (%i chunks)", numBatches,
+		BENCHMARK_ALLOCATIONS_PER_BATCH, mallocSeconds * 1.0e9 / numAllocations, arenaSeconds * 1.0e9 / numAllocations, arena.GetNumChunks());
+}
\ No newline at end of file
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+// Bump allocator over one or more chunks.  Allocation is a pointer bump, and memory is only ever
+// given back all at once (Reset) or back to a Marker (RewindTo).  Destructors are never run, so
+// only put things in here that don't own other memory, or clean them up yourself.
+//
+// A fixed arena dies when it runs out of space.  A growable arena chains on another chunk, and
+// keeps every chunk it ever made so the next pass through the same work doesn't hit malloc.
+//
+// Not thread-safe.  Give each thread its own (see FrameArena).
+//-----------------------------------------------------------------------------------------------
+class ArenaAllocator
+{
+private:
+	struct Chunk
+	{
+		Chunk* next;
+		size_t capacity;
+
+		char* GetBase() { return (char*)(this + 1); }
+	};
+
+public:
+	static const size_t DEFAULT_ALIGNMENT = alignof(std::max_align_t);
+
+	//Captures the arena's fill point.  Rewinding to it frees everything allocated after it was taken
+	struct Marker
+	{
+		Chunk* chunk;
+		size_t offset;
+		size_t bytesInPreviousChunks;
+	};
+
+public:
+	ArenaAllocator(size_t chunkBytes, bool isGrowable = false);
+	~ArenaAllocator();
+
+	void* Alloc(size_t numBytes, size_t alignment = DEFAULT_ALIGNMENT);
+	template<typename T> T* Alloc(size_t count = 1);
+	template<typename T, typename... Args> T* New(Args&&... args);
+
+	Marker GetMarker() const;
+	void RewindTo(const Marker& marker);
+	void Reset();
+
+	bool IsGrowable() const { return m_isGrowable; }
+	size_t GetUsedBytes() const { return m_bytesInPreviousChunks + m_offset; }
+	size_t GetCapacity() const { return m_totalCapacity; }
+	size_t GetHighWaterBytes() const { return m_highWaterBytes; }
+	int GetNumChunks() const { return m_numChunks; }
+
+private:
+	ArenaAllocator(const ArenaAllocator&) = delete;
+	void operator=(const ArenaAllocator&) = delete;
+
+	void* AllocFromNextChunk(size_t numBytes, size_t alignment);
+	Chunk* CreateChunk(size_t capacity);
+
+private:
+	Chunk* m_firstChunk;
+	Chunk* m_currChunk;
+	size_t m_offset;
+	size_t m_bytesInPreviousChunks;
+	size_t m_chunkBytes;
+	size_t m_totalCapacity;
+	size_t m_highWaterBytes;
+	int m_numChunks;
+	bool m_isGrowable;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+inline void* ArenaAllocator::Alloc(size_t numBytes, size_t alignment /*= DEFAULT_ALIGNMENT*/)
+{
+	ASSERT_OR_DIE(alignment != 0 && (alignment & (alignment - 1)) == 0, "Arena alignment must be a power of two");
+
+	char* base = m_currChunk->GetBase();
+	size_t alignedAddress = ((size_t)(base + m_offset) + alignment - 1) & ~(alignment - 1);
+	size_t alignedOffset = alignedAddress - (size_t)base;
+	if (alignedOffset + numBytes > m_currChunk->capacity)
+	{
+		return AllocFromNextChunk(numBytes, alignment);
+	}
+
+	m_offset = alignedOffset + numBytes;
+	if (GetUsedBytes() > m_highWaterBytes)
+	{
+		m_highWaterBytes = GetUsedBytes();
+	}
+	return base + alignedOffset;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Uninitialized storage for count Ts
+template<typename T>
+T* ArenaAllocator::Alloc(size_t count /*= 1*/)
+{
+	return (T*)Alloc(sizeof(T) * count, alignof(T));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T, typename... Args>
+T* ArenaAllocator::New(Args&&... args)
+{
+	return new (Alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+inline ArenaAllocator::Marker ArenaAllocator::GetMarker() const
+{
+	Marker result;
+	result.chunk = m_currChunk;
+	result.offset = m_offset;
+	result.bytesInPreviousChunks = m_bytesInPreviousChunks;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Rewinds to wherever the arena was when constructed, so scratch work can't leak out of a scope
+class ScopedArenaRewind
+{
+public:
+	ScopedArenaRewind(ArenaAllocator& arena)
+		: m_arena(arena)
+		, m_marker(arena.GetMarker())
+	{
+	}
+	~ScopedArenaRewind()
+	{
+		m_arena.RewindTo(m_marker);
+	}
+
+private:
+	ScopedArenaRewind(const ScopedArenaRewind&) = delete;
+	void operator=(const ScopedArenaRewind&) = delete;
+
+private:
+	ArenaAllocator& m_arena;
+	ArenaAllocator::Marker m_marker;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// FRAME ARENAS
+//	Each thread gets two growable arenas and alternates between them every frame, so anything
+//	allocated this frame stays valid through the next one (long enough to hand to another system
+//	for a frame) and is then reclaimed without anyone freeing it.
+//	EngineSystemManager::BeginFrame flips the frame once, from the main thread; every other thread
+//	notices the flip lazily the first time it asks for its arena
+//-----------------------------------------------------------------------------------------------
+namespace FrameArena
+{
+	static const size_t CHUNK_BYTES = 256 * 1024;
+
+	void BeginFrame();
+	unsigned int GetFrameNumber();
+
+	//This thread's arena for the current frame, and the one from the frame before it
+	ArenaAllocator& Get();
+	ArenaAllocator& GetPrevious();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Lets STL containers live in an arena.  Frees are ignored; the arena gets it all back at once.
+//Default constructed, it uses the calling thread's frame arena, so reserve() up front where you
+//can - every regrowth strands the old buffer until the arena resets
+template<typename T>
+class ArenaSTLAllocator
+{
+	template<typename U> friend class ArenaSTLAllocator;
+public:
+	typedef T value_type;
+
+	ArenaSTLAllocator() : m_arena(&FrameArena::Get()) {}
+	ArenaSTLAllocator(ArenaAllocator& arena) : m_arena(&arena) {}
+	template<typename U> ArenaSTLAllocator(const ArenaSTLAllocator<U>& other) : m_arena(other.m_arena) {}
+
+	T* allocate(size_t count) { return m_arena->Alloc<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U> bool operator==(const ArenaSTLAllocator<U>& other) const { return m_arena == other.m_arena; }
+	template<typename U> bool operator!=(const ArenaSTLAllocator<U>& other) const { return m_arena != other.m_arena; }
+
+private:
+	ArenaAllocator* m_arena;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Per-frame scratch array.  Don't keep one past the end of the next frame
+template<typename T>
+using FrameVector = std::vector<T, ArenaSTLAllocator<T>>;
\ No newline at end of file
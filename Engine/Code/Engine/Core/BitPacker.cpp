@@ -0,0 +1,127 @@
+#include "Engine/Core/BitPacker.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+void BitPacker::WriteBits(uint32_t value, int numBits, void** destPtr, uint8_t* spareBits)
+{
+	uint8_t* workingPtr = (uint8_t*)*destPtr;
+	while (numBits > 0)
+	{
+		if (*spareBits == 0)
+		{
+			*workingPtr = 0;
+			workingPtr++;
+			*spareBits = 8;
+		}
+
+		int usedBits = 8 - *spareBits;
+		int chunkBits = (numBits < *spareBits) ? numBits : *spareBits;
+		workingPtr[-1] |= (uint8_t)((value & ((1U << chunkBits) - 1)) << usedBits);
+
+		value >>= chunkBits;
+		numBits -= chunkBits;
+		*spareBits -= (uint8_t)chunkBits;
+	}
+	*destPtr = workingPtr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint32_t BitPacker::ReadBits(int numBits, void** srcPtr, uint8_t* spareBits)
+{
+	const uint8_t* workingPtr = (const uint8_t*)*srcPtr;
+	uint32_t result = 0;
+	int shift = 0;
+	while (numBits > 0)
+	{
+		if (*spareBits == 0)
+		{
+			workingPtr++;
+			*spareBits = 8;
+		}
+
+		int usedBits = 8 - *spareBits;
+		int chunkBits = (numBits < *spareBits) ? numBits : *spareBits;
+		result |= (uint32_t)((workingPtr[-1] >> usedBits) & ((1U << chunkBits) - 1)) << shift;
+
+		shift += chunkBits;
+		numBits -= chunkBits;
+		*spareBits -= (uint8_t)chunkBits;
+	}
+	*srcPtr = (void*)workingPtr;
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void BitPacker::WriteVarUInt(uint32_t value, void** destPtr, uint8_t* spareBits)
+{
+	while (value >= 0x80)
+	{
+		WriteBits((value & 0x7F) | 0x80, 8, destPtr, spareBits);
+		value >>= 7;
+	}
+	WriteBits(value, 8, destPtr, spareBits);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint32_t BitPacker::ReadVarUInt(void** srcPtr, uint8_t* spareBits)
+{
+	uint32_t result = 0;
+	for (int shift = 0; shift < 32; shift += 7)
+	{
+		uint32_t group = ReadBits(8, srcPtr, spareBits);
+		result |= (group & 0x7F) << shift;
+		if ((group & 0x80) == 0)
+		{
+			break;
+		}
+	}
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int BitPacker::GetVarUIntBits(uint32_t value)
+{
+	int numBits = 8;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		numBits += 8;
+	}
+
+	return numBits;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint32_t BitPacker::QuantizeFloat(float value, const FloatQuantization& quantization)
+{
+	uint32_t maxStep = (quantization.numBits >= 32) ? 0xFFFFFFFF : (1U << quantization.numBits) - 1;
+	float normalized = (value - quantization.minValue) / (quantization.maxValue - quantization.minValue);
+	if (!(normalized > 0.f))
+	{
+		//Also catches NaN
+		return 0;
+	}
+	if (normalized >= 1.f)
+	{
+		return maxStep;
+	}
+
+	return (uint32_t)((double)normalized * (double)maxStep + .5);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+float BitPacker::DequantizeFloat(uint32_t quantized, const FloatQuantization& quantization)
+{
+	uint32_t maxStep = (quantization.numBits >= 32) ? 0xFFFFFFFF : (1U << quantization.numBits) - 1;
+	double normalized = (double)quantized / (double)maxStep;
+
+	return quantization.minValue + (float)(normalized * (double)(quantization.maxValue - quantization.minValue));
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+
+//-----------------------------------------------------------------------------------------------
+//Floats are sent as an integer step between minValue and maxValue, numBits wide
+struct FloatQuantization
+{
+	float minValue;
+	float maxValue;
+	int numBits;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Bits fill each byte from its low end, so streams read the same on any host.  spareBits counts
+// the bits left unwritten (or unread) in the byte just behind the pointer; a fresh byte is only
+// claimed once those run out.  Nothing here bounds checks, so callers reserve the bytes first.
+//-----------------------------------------------------------------------------------------------
+namespace BitPacker
+{
+	void WriteBits(uint32_t value, int numBits, void** destPtr, uint8_t* spareBits);
+	uint32_t ReadBits(int numBits, void** srcPtr, uint8_t* spareBits);
+
+	//Bytes a write of numBits will claim past the pointer
+	inline int GetNumNewBytes(int numBits, uint8_t spareBits) { return (numBits > spareBits) ? (numBits - spareBits + 7) / 8 : 0; }
+
+	//7 bits per group plus a continue bit, so values under 128 cost a byte
+	void WriteVarUInt(uint32_t value, void** destPtr, uint8_t* spareBits);
+	uint32_t ReadVarUInt(void** srcPtr, uint8_t* spareBits);
+	int GetVarUIntBits(uint32_t value);
+
+	//Folds the sign into the low bit so small negative numbers stay small
+	inline uint32_t ZigZagEncode(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+	inline int32_t ZigZagDecode(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+	uint32_t QuantizeFloat(float value, const FloatQuantization& quantization);
+	float DequantizeFloat(uint32_t quantized, const FloatQuantization& quantization);
+}
\ No newline at end of file
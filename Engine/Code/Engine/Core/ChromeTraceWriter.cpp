@@ -0,0 +1,198 @@
+#include "Engine/Core/ChromeTraceWriter.hpp"
+#include "Engine/Core/Profiler.hpp"
+#include "Engine/Core/Memory.hpp"
+#include "Engine/Core/Platform.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+static const int TRACE_PROCESS_ID = 1;
+static const size_t TRACE_FILE_BUFFER_BYTES = 1024 * 1024;
+
+
+//-----------------------------------------------------------------------------------------------
+ChromeTraceWriter::ChromeTraceWriter()
+	: m_file(nullptr)
+	, m_baseCounter(0)
+	, m_hasWrittenEvent(false)
+	, m_numFramesWritten(0)
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ChromeTraceWriter::~ChromeTraceWriter()
+{
+	Close();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool ChromeTraceWriter::Open(const std::string& filePath)
+{
+	Close();
+
+#if defined(PLATFORM_WINDOWS)
+	fopen_s(&m_file, filePath.c_str(), "w");
+#else
+	m_file = fopen(filePath.c_str(), "w");
+#endif
+	if (!m_file)
+	{
+		return false;
+	}
+
+	setvbuf(m_file, nullptr, _IOFBF, TRACE_FILE_BUFFER_BYTES);
+	m_filePath = filePath;
+	m_baseCounter = 0;
+	m_hasWrittenEvent = false;
+	m_numFramesWritten = 0;
+	m_isThreadNamed.clear();
+
+	fprintf(m_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	BeginEvent();
+	fprintf(m_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":0,\"args\":{\"name\":\"Engine\"}}", TRACE_PROCESS_ID);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ChromeTraceWriter::WriteFrame(const ProfileFrame& frame, const MemoryStats& memoryStats)
+{
+	if (!m_file || frame.threads.empty())
+	{
+		return;
+	}
+
+	//Timestamps are relative to the first frame, which keeps them small enough to stay exact as doubles
+	if (m_numFramesWritten == 0)
+	{
+		m_baseCounter = frame.startCounter;
+	}
+	double frameStartMicroseconds = CounterToMicroseconds(frame.startCounter);
+
+	for (const ProfileFrameThread& thread : frame.threads)
+	{
+		WriteThreadNameIfNew(thread.threadID, thread.threadName);
+	}
+
+	BeginEvent();
+	fprintf(m_file, "{\"name\":\"Frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":%i,\"tid\":%i,\"args\":{\"droppedSamples\":%llu}}",
+		(unsigned long long)frame.frameNumber, frameStartMicroseconds, TRACE_PROCESS_ID, frame.threads[0].threadID, (unsigned long long)frame.numDroppedSamples);
+
+	uint64_t bytesAllocatedInSamples = 0;
+	uint64_t bytesFreedInSamples = 0;
+	for (const ProfileSample& sample : frame.samples)
+	{
+		BeginEvent();
+		fprintf(m_file, "{\"name\":");
+		WriteEscapedString(sample.tag);
+		fprintf(m_file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%i,\"tid\":%i,\"args\":{\"bytesAllocated\":%llu,\"bytesFreed\":%llu}}",
+			CounterToMicroseconds(sample.startCounter), CounterToMicroseconds(sample.endCounter) - CounterToMicroseconds(sample.startCounter),
+			TRACE_PROCESS_ID, sample.threadID, (unsigned long long)sample.bytesAllocated, (unsigned long long)sample.bytesFreed);
+
+		bytesAllocatedInSamples += sample.bytesAllocated;
+		bytesFreedInSamples += sample.bytesFreed;
+	}
+
+	BeginEvent();
+	fprintf(m_file, "{\"name\":\"Frame allocations\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%i,\"args\":{\"allocated\":%llu,\"freed\":%llu}}",
+		frameStartMicroseconds, TRACE_PROCESS_ID, (unsigned long long)bytesAllocatedInSamples, (unsigned long long)bytesFreedInSamples);
+
+	BeginEvent();
+	fprintf(m_file, "{\"name\":\"Heap\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%i,\"args\":{\"liveBytes\":%llu,\"liveAllocations\":%llu}}",
+		frameStartMicroseconds, TRACE_PROCESS_ID, (unsigned long long)memoryStats.liveBytes, (unsigned long long)memoryStats.numLiveAllocations);
+
+	BeginEvent();
+	fprintf(m_file, "{\"name\":\"Live bytes by tag\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%i,\"args\":{", frameStartMicroseconds, TRACE_PROCESS_ID);
+	for (int tag = 0; tag < NUM_MEMORY_TAGS; tag++)
+	{
+		fprintf(m_file, "%s\"%s\":%llu", (tag == 0) ? "" : ",", MemoryTracker::GetTagName((EMemoryTag)tag), (unsigned long long)memoryStats.tags[tag].liveBytes);
+	}
+	fprintf(m_file, "}}");
+
+	m_numFramesWritten++;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ChromeTraceWriter::Close()
+{
+	if (!m_file)
+	{
+		return;
+	}
+
+	fprintf(m_file, "\n]}\n");
+	fclose(m_file);
+	m_file = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ChromeTraceWriter::BeginEvent()
+{
+	if (m_hasWrittenEvent)
+	{
+		fprintf(m_file, ",\n");
+	}
+	m_hasWrittenEvent = true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ChromeTraceWriter::WriteEscapedString(const char* str)
+{
+	fputc('"', m_file);
+	for (const char* currChar = str; *currChar; currChar++)
+	{
+		unsigned char ch = (unsigned char)*currChar;
+		if (ch == '"' || ch == '\\')
+		{
+			fputc('\\', m_file);
+			fputc(ch, m_file);
+		}
+		else if (ch < 0x20)
+		{
+			fprintf(m_file, "\\u%04x", ch);
+		}
+		else
+		{
+			fputc(ch, m_file);
+		}
+	}
+	fputc('"', m_file);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ChromeTraceWriter::WriteThreadNameIfNew(int threadID, const char* threadName)
+{
+	if ((size_t)threadID < m_isThreadNamed.size() && m_isThreadNamed[threadID])
+	{
+		return;
+	}
+	if ((size_t)threadID >= m_isThreadNamed.size())
+	{
+		m_isThreadNamed.resize(threadID + 1, false);
+	}
+	m_isThreadNamed[threadID] = true;
+
+	BeginEvent();
+	fprintf(m_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%i,\"args\":{\"name\":", TRACE_PROCESS_ID, threadID);
+	WriteEscapedString(threadName);
+	fprintf(m_file, "}}");
+
+	//Keep lanes in the order threads first showed up in the profiler
+	BeginEvent();
+	fprintf(m_file, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%i,\"tid\":%i,\"args\":{\"sort_index\":%i}}", TRACE_PROCESS_ID, threadID, threadID);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Samples from worker threads can start before the first frame does, so this has to handle going negative
+double ChromeTraceWriter::CounterToMicroseconds(uint64_t counter) const
+{
+	int64_t countsFromBase = (int64_t)(counter - m_baseCounter);
+	double seconds = ProfilerHelper::PerformanceCountToSeconds((uint64_t)(countsFromBase < 0 ? -countsFromBase : countsFromBase));
+	return ((countsFromBase < 0) ? -seconds : seconds) * 1000000.;
+}
\ No newline at end of file
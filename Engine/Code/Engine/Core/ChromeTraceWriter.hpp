@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileFrame;
+struct MemoryStats;
+
+
+//-----------------------------------------------------------------------------------------------
+// Streams profile frames to disk in the Chrome Trace Event JSON format, which chrome://tracing
+// and ui.perfetto.dev both open.  Each profiler thread gets its own lane, every sample becomes a
+// complete ("X") event, frames get a global instant marker, and heap numbers are written as
+// counter tracks.  Frames go straight to the file, so captures can be as long as the disk allows.
+//-----------------------------------------------------------------------------------------------
+class ChromeTraceWriter
+{
+public:
+	ChromeTraceWriter();
+	~ChromeTraceWriter();
+
+	bool Open(const std::string& filePath);
+	void WriteFrame(const ProfileFrame& frame, const MemoryStats& memoryStats);
+	void Close();
+
+	bool IsOpen() const { return m_file != nullptr; }
+	const std::string& GetFilePath() const { return m_filePath; }
+	int GetNumFramesWritten() const { return m_numFramesWritten; }
+
+private:
+	ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+	void operator=(const ChromeTraceWriter&) = delete;
+
+	void BeginEvent();
+	void WriteEscapedString(const char* str);
+	void WriteThreadNameIfNew(int threadID, const char* threadName);
+	double CounterToMicroseconds(uint64_t counter) const;
+
+private:
+	FILE* m_file;
+	std::string m_filePath;
+	uint64_t m_baseCounter;
+	bool m_hasWrittenEvent;
+	int m_numFramesWritten;
+	std::vector<bool> m_isThreadNamed;
+};
\ No newline at end of file
@@ -1,11 +1,74 @@
 #include "Engine/Core/ConsoleCommand.hpp"
 
+#include <atomic>
 #include <sstream>
+#include <stdarg.h>
+#include <stdio.h>
 
 
 //-----------------------------------------------------------------------------------------------
-ConsolePrintFunc ConsolePrint = nullptr;
-ConsolePrintfFunc ConsolePrintf = nullptr;
+static std::atomic<ConsolePrintFunc> s_consoleOutput(nullptr);
+static thread_local ConsoleEchoFunc s_consoleEcho = nullptr;
+static thread_local void* s_consoleEchoData = nullptr;
+
+
+//-----------------------------------------------------------------------------------------------
+static void RouteConsolePrint(const std::string& toPrint, const Rgba& color)
+{
+	if (s_consoleEcho)
+	{
+		s_consoleEcho(toPrint, color, s_consoleEchoData);
+	}
+
+	ConsolePrintFunc output = s_consoleOutput.load(std::memory_order_acquire);
+	if (output)
+	{
+		output(toPrint, color);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void RouteConsolePrintf(const Rgba& color, const char* format, ...)
+{
+	char buffer[2 KB];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	RouteConsolePrint(buffer, color);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+const ConsolePrintFunc ConsolePrint = RouteConsolePrint;
+const ConsolePrintfFunc ConsolePrintf = RouteConsolePrintf;
+
+
+//-----------------------------------------------------------------------------------------------
+void SetConsoleOutput(ConsolePrintFunc output)
+{
+	s_consoleOutput.store(output, std::memory_order_release);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ScopedConsoleEcho::ScopedConsoleEcho(ConsoleEchoFunc echo, void* echoData)
+	: m_previousEcho(s_consoleEcho)
+	, m_previousEchoData(s_consoleEchoData)
+{
+	s_consoleEcho = echo;
+	s_consoleEchoData = echoData;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ScopedConsoleEcho::~ScopedConsoleEcho()
+{
+	s_consoleEcho = m_previousEcho;
+	s_consoleEchoData = m_previousEchoData;
+}
 
 
 //-----------------------------------------------------------------------------------------------
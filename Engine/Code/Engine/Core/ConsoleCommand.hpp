@@ -22,8 +22,30 @@ typedef void(*ConsolePrintfFunc)(const Rgba& color, const char* format, ...);
 
 
 //-----------------------------------------------------------------------------------------------
-extern ConsolePrintFunc ConsolePrint;
-extern ConsolePrintfFunc ConsolePrintf;
+//All console output goes through these.  Where it ends up is set once, at startup
+extern const ConsolePrintFunc ConsolePrint;
+extern const ConsolePrintfFunc ConsolePrintf;
+void SetConsoleOutput(ConsolePrintFunc output);
+
+
+//-----------------------------------------------------------------------------------------------
+//While one is alive, console output from this thread is echoed to it as well, so a command run on
+//someone else's behalf can answer them.  Output from other threads meanwhile is left alone
+typedef void(*ConsoleEchoFunc)(const std::string& toPrint, const Rgba& color, void* echoData);
+class ScopedConsoleEcho
+{
+public:
+	ScopedConsoleEcho(ConsoleEchoFunc echo, void* echoData);
+	~ScopedConsoleEcho();
+
+private:
+	ScopedConsoleEcho(const ScopedConsoleEcho&) = delete;
+	void operator=(const ScopedConsoleEcho&) = delete;
+
+private:
+	ConsoleEchoFunc m_previousEcho;
+	void* m_previousEchoData;
+};
 
 
 //-----------------------------------------------------------------------------------------------
@@ -60,9 +82,9 @@ public:
 
 
 //Register a command with the console------------------------------------------------------------
-#define CONSOLE_COMMAND(name, args) void CommandFunc_ ## name ## (ConsoleCommand&); \
-static CommandRegisterHelper CommandHelper_ ## name ## (#name, CommandFunc_ ## name); \
-void CommandFunc_ ## name ## (ConsoleCommand& args)
+#define CONSOLE_COMMAND(name, args) void CommandFunc_ ## name(ConsoleCommand&); \
+static CommandRegisterHelper CommandHelper_ ## name(#name, CommandFunc_ ## name); \
+void CommandFunc_ ## name(ConsoleCommand& args)
 //-----------------------------------------------------------------------------------------------
 
 
@@ -0,0 +1,317 @@
+#include "Engine/Core/DeferredEvents.hpp"
+#include "Engine/Core/Platform.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Memory/SpinLock.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+static const size_t DEFERRED_EVENT_CHUNK_BYTES = 64 KB;
+static const int MAX_FREE_CHUNKS_PER_THREAD = 4;
+
+
+//-----------------------------------------------------------------------------------------------
+//The payload follows, PAYLOAD_ALIGNMENT aligned
+struct DeferredEventRecord
+{
+	uint64_t timestamp;
+	uint64_t coalesceKey;
+	DeferredEvents::PayloadFunc dispatchFunc;
+	DeferredEvents::PayloadFunc destroyFunc;
+	size_t numBytes;
+	size_t padding;
+};
+static_assert(sizeof(DeferredEventRecord) % DeferredEvents::PAYLOAD_ALIGNMENT == 0, "Payloads after a record would be misaligned");
+
+
+//-----------------------------------------------------------------------------------------------
+struct DeferredEventThreadBuffer;
+
+
+//-----------------------------------------------------------------------------------------------
+//Records never move once written, so payloads don't have to be trivially copyable
+struct DeferredEventChunk
+{
+	DeferredEventThreadBuffer* owner;
+	DeferredEventChunk* next;
+	size_t numBytesUsed;
+	size_t padding;
+	uint8_t bytes[DEFERRED_EVENT_CHUNK_BYTES];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//The lock is only ever contended by DispatchAll taking the chunks away.  Buffers are never freed,
+//since DispatchAll walks them without a lock; a thread gives its buffer up when it exits and the
+//next thread to post adopts it, so there are only ever as many as threads posting at once
+struct DeferredEventThreadBuffer
+{
+	SpinLock lock;
+	DeferredEventChunk* firstChunk;
+	DeferredEventChunk* lastChunk;
+	DeferredEventChunk* freeChunks;
+	int numFreeChunks;
+	std::atomic<bool> isInUse;
+	DeferredEventThreadBuffer* next;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct DeferredEventDispatchEntry
+{
+	uint64_t timestamp;
+	DeferredEventRecord* record;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic<DeferredEventThreadBuffer*> s_threadBuffers(nullptr);
+static thread_local DeferredEventThreadBuffer* t_threadBuffer = nullptr;
+
+//Only touched by the thread in DispatchAll
+static std::vector<DeferredEventChunk*> s_takenChunks;
+static std::vector<DeferredEventDispatchEntry> s_dispatchEntries;
+static std::unordered_map<uint64_t, DeferredEventRecord*> s_newestCoalesced;
+static std::atomic<bool> s_isDispatching(false);
+
+
+//-----------------------------------------------------------------------------------------------
+//Gives the thread's buffer back on exit.  Anything it posted stays put until the next DispatchAll
+struct DeferredEventThreadRelease
+{
+	~DeferredEventThreadRelease()
+	{
+		if (t_threadBuffer)
+		{
+			t_threadBuffer->isInUse.store(false, std::memory_order_release);
+			t_threadBuffer = nullptr;
+		}
+	}
+};
+static thread_local DeferredEventThreadRelease t_threadRelease;
+
+
+//-----------------------------------------------------------------------------------------------
+static DeferredEventThreadBuffer* RegisterThreadBuffer()
+{
+	//Touching it is what gets its destructor run when this thread exits
+	(void)&t_threadRelease;
+
+	for (DeferredEventThreadBuffer* buffer = s_threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+	{
+		bool isInUse = false;
+		if (!buffer->isInUse.load(std::memory_order_relaxed) && buffer->isInUse.compare_exchange_strong(isInUse, true, std::memory_order_acquire))
+		{
+			t_threadBuffer = buffer;
+			return buffer;
+		}
+	}
+
+	DeferredEventThreadBuffer* result = new DeferredEventThreadBuffer;
+	result->firstChunk = nullptr;
+	result->lastChunk = nullptr;
+	result->freeChunks = nullptr;
+	result->numFreeChunks = 0;
+	result->isInUse.store(true, std::memory_order_relaxed);
+
+	result->next = s_threadBuffers.load(std::memory_order_relaxed);
+	while (!s_threadBuffers.compare_exchange_weak(result->next, result, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+
+	t_threadBuffer = result;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Caller holds the buffer's lock
+static DeferredEventChunk* AppendChunk(DeferredEventThreadBuffer* buffer)
+{
+	DeferredEventChunk* chunk = buffer->freeChunks;
+	if (chunk)
+	{
+		buffer->freeChunks = chunk->next;
+		buffer->numFreeChunks--;
+	}
+	else
+	{
+		chunk = new DeferredEventChunk;
+		chunk->owner = buffer;
+	}
+
+	chunk->next = nullptr;
+	chunk->numBytesUsed = 0;
+	if (buffer->lastChunk)
+	{
+		buffer->lastChunk->next = chunk;
+	}
+	else
+	{
+		buffer->firstChunk = chunk;
+	}
+	buffer->lastChunk = chunk;
+	return chunk;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Leaves the buffer locked until EndPost, so the payload can be constructed in place.  Payload
+//constructors must not post
+void* DeferredEvents::BeginPost(size_t payloadBytes, PayloadFunc dispatchFunc, PayloadFunc destroyFunc, uint64_t coalesceKey)
+{
+	DeferredEventThreadBuffer* buffer = t_threadBuffer ? t_threadBuffer : RegisterThreadBuffer();
+	size_t numBytes = (sizeof(DeferredEventRecord) + payloadBytes + PAYLOAD_ALIGNMENT - 1) & ~(PAYLOAD_ALIGNMENT - 1);
+
+	buffer->lock.Enter();
+	DeferredEventChunk* chunk = buffer->lastChunk;
+	if (!chunk || chunk->numBytesUsed + numBytes > DEFERRED_EVENT_CHUNK_BYTES)
+	{
+		chunk = AppendChunk(buffer);
+	}
+
+	DeferredEventRecord* record = (DeferredEventRecord*)&chunk->bytes[chunk->numBytesUsed];
+	record->timestamp = Platform::GetTimestampCounter();
+	record->coalesceKey = coalesceKey;
+	record->dispatchFunc = dispatchFunc;
+	record->destroyFunc = destroyFunc;
+	record->numBytes = numBytes;
+	chunk->numBytesUsed += numBytes;
+
+	return record + 1;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void DeferredEvents::EndPost()
+{
+	t_threadBuffer->lock.Leave();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void TakeAllChunks()
+{
+	for (DeferredEventThreadBuffer* buffer = s_threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+	{
+		SpinLockGuard guard(&buffer->lock);
+		for (DeferredEventChunk* chunk = buffer->firstChunk; chunk; chunk = chunk->next)
+		{
+			s_takenChunks.push_back(chunk);
+		}
+		buffer->firstChunk = nullptr;
+		buffer->lastChunk = nullptr;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void DestroyAndReturnTakenChunks()
+{
+	for (DeferredEventChunk* chunk : s_takenChunks)
+	{
+		for (size_t offset = 0; offset < chunk->numBytesUsed;)
+		{
+			DeferredEventRecord* record = (DeferredEventRecord*)&chunk->bytes[offset];
+			record->destroyFunc(record + 1);
+			offset += record->numBytes;
+		}
+
+		DeferredEventThreadBuffer* owner = chunk->owner;
+		SpinLockGuard guard(&owner->lock);
+		if (owner->numFreeChunks < MAX_FREE_CHUNKS_PER_THREAD)
+		{
+			chunk->next = owner->freeChunks;
+			owner->freeChunks = chunk;
+			owner->numFreeChunks++;
+		}
+		else
+		{
+			delete chunk;
+		}
+	}
+	s_takenChunks.clear();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int DeferredEvents::DispatchAll()
+{
+	ASSERT_OR_DIE(!s_isDispatching.exchange(true, std::memory_order_acquire), "DeferredEvents::DispatchAll can't be called from inside a dispatch, or from two threads at once!");
+
+	TakeAllChunks();
+
+	for (DeferredEventChunk* chunk : s_takenChunks)
+	{
+		for (size_t offset = 0; offset < chunk->numBytesUsed;)
+		{
+			DeferredEventRecord* record = (DeferredEventRecord*)&chunk->bytes[offset];
+			DeferredEventDispatchEntry entry = { record->timestamp, record };
+			s_dispatchEntries.push_back(entry);
+
+			if (record->coalesceKey != 0)
+			{
+				DeferredEventRecord*& newest = s_newestCoalesced[record->coalesceKey];
+				if (!newest || newest->timestamp <= record->timestamp)
+				{
+					newest = record;
+				}
+			}
+			offset += record->numBytes;
+		}
+	}
+
+	//Each thread's records are already in order, and a stable sort keeps ties that way
+	std::stable_sort(s_dispatchEntries.begin(), s_dispatchEntries.end(), [](const DeferredEventDispatchEntry& first, const DeferredEventDispatchEntry& second)
+	{
+		return first.timestamp < second.timestamp;
+	});
+
+	int numDispatched = 0;
+	for (const DeferredEventDispatchEntry& entry : s_dispatchEntries)
+	{
+		DeferredEventRecord* record = entry.record;
+		if (record->coalesceKey != 0 && s_newestCoalesced[record->coalesceKey] != record)
+		{
+			continue;
+		}
+
+		record->dispatchFunc(record + 1);
+		numDispatched++;
+	}
+
+	s_dispatchEntries.clear();
+	s_newestCoalesced.clear();
+	DestroyAndReturnTakenChunks();
+
+	s_isDispatching.store(false, std::memory_order_release);
+	return numDispatched;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void DeferredEvents::DiscardAll()
+{
+	ASSERT_OR_DIE(!s_isDispatching.exchange(true, std::memory_order_acquire), "DeferredEvents::DiscardAll can't be called from inside a dispatch!");
+
+	TakeAllChunks();
+	DestroyAndReturnTakenChunks();
+
+	s_isDispatching.store(false, std::memory_order_release);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int DeferredEvents::GetNumThreadBuffers()
+{
+	int numBuffers = 0;
+	for (DeferredEventThreadBuffer* buffer = s_threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+	{
+		numBuffers++;
+	}
+	return numBuffers;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+
+//-----------------------------------------------------------------------------------------------
+// Cross-thread event bus.  Any thread can post; posts are copied into that thread's own chunked
+// buffer, so producers never contend with each other.  Nothing runs until DispatchAll, which
+// takes everything posted so far, puts it in timestamp order and calls each payload's Dispatch()
+// on the calling thread.  Events posted from inside a dispatch wait for the next DispatchAll.
+//
+// Coalesced posts replace each other: of all the events in a batch with the same key, only the
+// newest is dispatched.  Good for state that only matters as of now, like transforms.
+//-----------------------------------------------------------------------------------------------
+namespace DeferredEvents
+{
+	typedef void(*PayloadFunc)(void* payload);
+
+	static const size_t MAX_PAYLOAD_BYTES = 16 * 1024;
+	static const size_t PAYLOAD_ALIGNMENT = 16;
+
+	//T needs a void Dispatch() and a move or copy constructor.  A coalesceKey of 0 never coalesces
+	template<typename T>
+	void Post(T&& payload, uint64_t coalesceKey = 0);
+
+	//One thread at a time.  Returns how many events were dispatched
+	int DispatchAll();
+
+	//Destroys everything pending without dispatching it, for shutdown
+	void DiscardAll();
+
+	//How many per-thread buffers exist, in use or waiting to be adopted
+	int GetNumThreadBuffers();
+
+	//Mixes an event's ID with something identifying the thing it's about, e.g. an object pointer
+	inline uint64_t MakeCoalesceKey(uint64_t eventID, uint64_t instanceKey)
+	{
+		uint64_t key = eventID ^ (instanceKey + 0x9E3779B97F4A7C15ULL + (eventID << 6) + (eventID >> 2));
+		return (key != 0) ? key : 1;
+	}
+
+	void* BeginPost(size_t payloadBytes, PayloadFunc dispatchFunc, PayloadFunc destroyFunc, uint64_t coalesceKey);
+	void EndPost();
+
+	template<typename T>
+	void DispatchPayload(void* payload)
+	{
+		((T*)payload)->Dispatch();
+	}
+
+	template<typename T>
+	void DestroyPayload(void* payload)
+	{
+		((T*)payload)->~T();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void DeferredEvents::Post(T&& payload, uint64_t coalesceKey /*= 0*/)
+{
+	typedef typename std::decay<T>::type PayloadType;
+	static_assert(sizeof(PayloadType) <= MAX_PAYLOAD_BYTES, "Deferred event payload is too big");
+	static_assert(alignof(PayloadType) <= PAYLOAD_ALIGNMENT, "Deferred event payload is over-aligned");
+
+	void* memory = BeginPost(sizeof(PayloadType), DispatchPayload<PayloadType>, DestroyPayload<PayloadType>, coalesceKey);
+	new (memory) PayloadType(std::forward<T>(payload));
+	EndPost();
+}
\ No newline at end of file
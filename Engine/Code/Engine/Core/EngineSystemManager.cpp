@@ -1,5 +1,6 @@
 #include "Engine/Core/EngineSystemManager.hpp"
 #include "Engine/Core/Audio.hpp"
+#include "Engine/Core/ArenaAllocator.hpp"
 #include "Engine/Input/TheInput.hpp"
 #include "Engine/Renderer/DXRenderer.hpp"
 #include "Engine/Renderer/GLRenderer.hpp"
@@ -32,4 +33,12 @@ EngineSystemManager::~EngineSystemManager()
 		delete Input;
 	if (Audio)
 		delete Audio;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void EngineSystemManager::BeginFrame()
+{
+	//Last frame's scratch stays readable for one more frame; the frame before that gets recycled
+	FrameArena::BeginFrame();
 }
\ No newline at end of file
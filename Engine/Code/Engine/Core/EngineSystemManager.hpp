@@ -21,4 +21,7 @@ public:
 public:
 	EngineSystemManager();
 	~EngineSystemManager();
+
+	//Call once at the top of every frame, from the main thread
+	void BeginFrame();
 };
\ No newline at end of file
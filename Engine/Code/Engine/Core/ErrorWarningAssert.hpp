@@ -32,7 +32,7 @@ enum ESeverityLevel
 //-----------------------------------------------------------------------------------------------
 void DebuggerPrintf( const char* messageFormat, ... );
 bool IsDebuggerAvailable();
-__declspec( noreturn ) void FatalError( const char* filePath, const char* functionName, int lineNum, const std::string& reasonForError, const char* conditionText=nullptr );
+[[noreturn]] void FatalError( const char* filePath, const char* functionName, int lineNum, const std::string& reasonForError, const char* conditionText=nullptr );
 void RecoverableWarning( const char* filePath, const char* functionName, int lineNum, const std::string& reasonForWarning, const char* conditionText=nullptr );
 void SystemDialogue_Okay( const std::string& messageTitle, const std::string& messageText, ESeverityLevel severity );
 bool SystemDialogue_OkayCancel( const std::string& messageTitle, const std::string& messageText, ESeverityLevel severity );
@@ -204,8 +204,8 @@ public:
 "//-----------------------------------------------------------------------------------------------\n" \
 __FILE__ "(%i)\n\n", __LINE__)
 
-#define TODO(messageText) static void ToDo ## __LINE__ ## () \
+#define TODO(messageText) static void ToDo ## __LINE__ () \
 { \
 	SCOPED_TODO(messageText); \
 } \
-UnscopedExecutor executor ## __LINE__ ## (ToDo ## __LINE__ ## );
\ No newline at end of file
+UnscopedExecutor executor ## __LINE__ (ToDo ## __LINE__);
\ No newline at end of file
@@ -1,132 +1,477 @@
 #include "Engine/Core/EventSystem.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+#include <thread>
 
 
 //-----------------------------------------------------------------------------------------------
 EventSystem* g_eventSystem = nullptr;
 
 
+//-----------------------------------------------------------------------------------------------
+static const size_t INITIAL_EVENT_SLOTS = 64;
+
+
+//-----------------------------------------------------------------------------------------------
+//A name that really hashes to 0 shares a key with one that hashes to 1.  Close enough to never
+static EventID GetSlotKey(EventID eventID)
+{
+	return (eventID != 0) ? eventID : 1;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+EventSystem::EventSystem()
+	: m_numEvents(0)
+	, m_dispatchDepth(0)
+	, m_hasRemovedSubscribers(false)
+{
+	EventSlot emptySlot = { 0, nullptr, false };
+	m_slots.resize(INITIAL_EVENT_SLOTS, emptySlot);
+}
+
+
 //-----------------------------------------------------------------------------------------------
 EventSystem::~EventSystem()
 {
-	for (EventPair& p : m_events)
+	for (EventSlot& slot : m_slots)
 	{
-		delete p.second;
+		delete slot.subscribers;
 	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void EventSystem::TriggerEvent(const std::string& eventName, Event* eventData)
+void EventSystem::TriggerEvent(EventID eventID, Event* eventData)
 {
-	EventSubscribers* subscribers = FindEvent(eventName);
+	EventSlot* slot = FindSlot(eventID);
+	if (!slot)
+	{
+		return;
+	}
+
+	//The vector can reallocate if a callback registers, so index it fresh every time.  Subscribers
+	//added past the count taken here wait for the next trigger
+	EventSubscribers* subscribers = slot->subscribers;
+	size_t numSubscribers = subscribers->size();
 
-	if (subscribers)
+	m_dispatchDepth++;
+	for (size_t subscriberIndex = 0; subscriberIndex < numSubscribers; subscriberIndex++)
 	{
-		size_t numElements = subscribers->size();
-		for (size_t i = 0; i < numElements; i++)
+		EventSubscriber sub = (*subscribers)[subscriberIndex];
+		if (sub.eventFunc)
 		{
-			EventSubscriber& sub = subscribers->at(i);
 			sub.eventFunc(eventData, sub.subscriber);
-			while (numElements > subscribers->size())
-			{
-				numElements--;
-			}
 		}
 	}
+	m_dispatchDepth--;
+
+	if (m_dispatchDepth == 0 && m_hasRemovedSubscribers)
+	{
+		CompactRemovedSubscribers();
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void EventSystem::UnregisterFromEvent(void* subscriber, const std::string& eventName)
+void EventSystem::UnregisterFromEvent(void* subscriber, EventID eventID)
 {
-	EventSubscribers* subscribers = FindEvent(eventName);
+	EventSlot* slot = FindSlot(eventID);
+	if (slot)
+	{
+		RemoveSubscriber(*slot, subscriber, false);
+	}
+}
+
 
-	if (subscribers)
+//-----------------------------------------------------------------------------------------------
+void EventSystem::UnregisterFromAllEvents(void* subscriber)
+{
+	for (EventSlot& slot : m_slots)
 	{
-		std::vector<EventSubscriber>::iterator iter = subscribers->begin();
-		while (iter != subscribers->end())
+		if (slot.eventID != 0)
 		{
-			if (iter->subscriber == subscriber)
-			{
-				iter = subscribers->erase(iter);
-				break;
-			}
-			else
-			{
-				iter++;
-			}
+			RemoveSubscriber(slot, subscriber, true);
 		}
 	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void EventSystem::UnregisterFromAllEvents(void* subscriber)
+void EventSystem::RegisterEvent(EventID eventID, EventCallback* eventFunc, void* subscriber)
+{
+	EventSlot* slot = FindOrCreateSlot(eventID);
+
+	EventSubscriber newSub = { eventFunc, subscriber };
+	slot->subscribers->push_back(newSub);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+EventSystem::EventSlot* EventSystem::FindSlot(EventID eventID)
+{
+	EventID key = GetSlotKey(eventID);
+	size_t mask = m_slots.size() - 1;
+
+	for (size_t slotIndex = (size_t)key & mask; m_slots[slotIndex].eventID != 0; slotIndex = (slotIndex + 1) & mask)
+	{
+		if (m_slots[slotIndex].eventID == key)
+		{
+			return &m_slots[slotIndex];
+		}
+	}
+	return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+EventSystem::EventSlot* EventSystem::FindOrCreateSlot(EventID eventID)
+{
+	EventSlot* result = FindSlot(eventID);
+	if (result)
+	{
+		return result;
+	}
+
+	//Keep the load under 3/4 so misses stay short
+	if ((m_numEvents + 1) * 4 > m_slots.size() * 3)
+	{
+		Grow();
+	}
+
+	EventID key = GetSlotKey(eventID);
+	size_t mask = m_slots.size() - 1;
+	size_t slotIndex = (size_t)key & mask;
+	while (m_slots[slotIndex].eventID != 0)
+	{
+		slotIndex = (slotIndex + 1) & mask;
+	}
+
+	result = &m_slots[slotIndex];
+	result->eventID = key;
+	result->subscribers = new EventSubscribers();
+	result->hasRemovedSubscribers = false;
+	m_numEvents++;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Subscriber lists are held by pointer, so a trigger in progress doesn't notice the table moving
+void EventSystem::Grow()
+{
+	std::vector<EventSlot> oldSlots;
+	oldSlots.swap(m_slots);
+
+	EventSlot emptySlot = { 0, nullptr, false };
+	m_slots.resize(oldSlots.size() * 2, emptySlot);
+	size_t mask = m_slots.size() - 1;
+
+	for (const EventSlot& oldSlot : oldSlots)
+	{
+		if (oldSlot.eventID == 0)
+		{
+			continue;
+		}
+
+		size_t slotIndex = (size_t)oldSlot.eventID & mask;
+		while (m_slots[slotIndex].eventID != 0)
+		{
+			slotIndex = (slotIndex + 1) & mask;
+		}
+		m_slots[slotIndex] = oldSlot;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void EventSystem::RemoveSubscriber(EventSlot& slot, void* subscriber, bool removeAll)
+{
+	EventSubscribers& subscribers = *slot.subscribers;
+	for (size_t subscriberIndex = 0; subscriberIndex < subscribers.size(); subscriberIndex++)
+	{
+		EventSubscriber& sub = subscribers[subscriberIndex];
+		if (sub.subscriber != subscriber || !sub.eventFunc)
+		{
+			continue;
+		}
+
+		if (m_dispatchDepth > 0)
+		{
+			//Something may be iterating this list, so leave a hole for now
+			sub.eventFunc = nullptr;
+			slot.hasRemovedSubscribers = true;
+			m_hasRemovedSubscribers = true;
+		}
+		else
+		{
+			subscribers.erase(subscribers.begin() + subscriberIndex);
+			subscriberIndex--;
+		}
+
+		if (!removeAll)
+		{
+			return;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void EventSystem::CompactRemovedSubscribers()
 {
-	for (EventPair& p : m_events)
+	for (EventSlot& slot : m_slots)
 	{
-		EventSubscribers* subscribers = p.second;
+		if (!slot.hasRemovedSubscribers)
+		{
+			continue;
+		}
 
-		if (subscribers)
+		EventSubscribers& subscribers = *slot.subscribers;
+		size_t numKept = 0;
+		for (const EventSubscriber& sub : subscribers)
 		{
-			std::vector<EventSubscriber>::iterator iter = subscribers->begin();
-			while (iter != subscribers->end())
+			if (sub.eventFunc)
 			{
-				if (iter->subscriber == subscriber)
-				{
-					iter = subscribers->erase(iter);
-					break;
-				}
-				else
-				{
-					iter++;
-				}
+				subscribers[numKept++] = sub;
 			}
 		}
+		subscribers.resize(numKept);
+		slot.hasRemovedSubscribers = false;
 	}
+	m_hasRemovedSubscribers = false;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void EventSystem::RegisterEvent(const std::string& eventName, EventCallback* eventFunc, void* subscriber)
+static void CountEventBenchmarkCall(Event* eventData, void* subArg)
 {
-	EventSubscribers* subscribers = FindOrCreateEvent(eventName);
+	(void)eventData;
+	(*(volatile uint64_t*)subArg)++;
+}
 
-	EventSubscriber newSub = { eventFunc, subscriber };
-	subscribers->push_back(newSub);
+
+//-----------------------------------------------------------------------------------------------
+//Runs on its own EventSystem, so nothing registered in the game gets called
+CONSOLE_COMMAND(EventBenchmark, args)
+{
+	int numCallbacks = 10000000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numCallbacks = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: eventbenchmark [numCallbacksPerRun]", RED);
+		return;
+	}
+
+	const int subscriberCounts[] = { 1, 10, 100 };
+	volatile uint64_t numCalls = 0;
+	TickEvent tickEvent;
+	tickEvent.deltaSeconds = 0.f;
+
+	for (int numSubscribers : subscriberCounts)
+	{
+		EventSystem eventSystem;
+
+		//Some other events to share the table with, like a real game would have
+		for (int otherEvent = 0; otherEvent < 32; otherEvent++)
+		{
+			eventSystem.RegisterEvent(HashEventName(std::to_string(otherEvent).c_str()), CountEventBenchmarkCall, (void*)&numCalls);
+		}
+		for (int subscriber = 0; subscriber < numSubscribers; subscriber++)
+		{
+			eventSystem.RegisterEvent(EVENT_ID("BenchmarkTick"), CountEventBenchmarkCall, (void*)&numCalls);
+		}
+
+		int numTriggers = (numCallbacks / numSubscribers > 1) ? numCallbacks / numSubscribers : 1;
+		double startSeconds = GetCurrentTimeSeconds();
+		for (int trigger = 0; trigger < numTriggers; trigger++)
+		{
+			eventSystem.TriggerEvent(EVENT_ID("BenchmarkTick"), &tickEvent);
+		}
+		double idSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+		startSeconds = GetCurrentTimeSeconds();
+		for (int trigger = 0; trigger < numTriggers; trigger++)
+		{
+			eventSystem.TriggerEvent("BenchmarkTick", &tickEvent);
+		}
+		double nameSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+		ConsolePrintf(WHITE, "%3i subscribers: %.2fM triggers/sec by EVENT_ID, %.2fM by name (%.1fns per callback)", numSubscribers,
+			(double)numTriggers / idSeconds * 1.e-6, (double)numTriggers / nameSeconds * 1.e-6, idSeconds * 1.e9 / ((double)numTriggers * (double)numSubscribers));
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
-EventSubscribers* EventSystem::FindOrCreateEvent(const std::string& eventName)
+struct DeferredTestEvent : public Event
 {
-	EventSubscribers* result = FindEvent(eventName);
+	int threadIndex;
+	int sequence;
+};
 
-	if (result)
+
+//-----------------------------------------------------------------------------------------------
+//Only touched on the thread calling DispatchAll
+struct DeferredTestResults
+{
+	std::vector<int> nextSequences;
+	std::vector<int> coalescedSequences;
+	std::vector<int> numCoalescedDispatches;
+	int numOutOfOrder;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static void CheckDeferredTestEvent(Event* eventData, void* subArg)
+{
+	DeferredTestEvent* testEvent = (DeferredTestEvent*)eventData;
+	DeferredTestResults* results = (DeferredTestResults*)subArg;
+
+	int& nextSequence = results->nextSequences[testEvent->threadIndex];
+	if (testEvent->sequence != nextSequence)
 	{
-		return result;
+		results->numOutOfOrder++;
 	}
+	nextSequence = testEvent->sequence + 1;
+}
 
-	size_t newHash = std::hash<std::string>()(eventName);
 
-	EventSubscribers* subs = new EventSubscribers();
-	m_events.insert(std::make_pair(newHash, subs));
+//-----------------------------------------------------------------------------------------------
+static void CheckCoalescedTestEvent(Event* eventData, void* subArg)
+{
+	DeferredTestEvent* testEvent = (DeferredTestEvent*)eventData;
+	DeferredTestResults* results = (DeferredTestResults*)subArg;
 
-	return subs;
+	results->coalescedSequences[testEvent->threadIndex] = testEvent->sequence;
+	results->numCoalescedDispatches[testEvent->threadIndex]++;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-EventSubscribers* EventSystem::FindEvent(const std::string& eventName)
+static void PostDeferredTestEvents(EventSystem* eventSystem, int threadIndex, int numPosts)
 {
-	size_t eventHash = std::hash<std::string>()(eventName);
+	DeferredTestEvent testEvent;
+	testEvent.threadIndex = threadIndex;
+	for (int sequence = 0; sequence < numPosts; sequence++)
+	{
+		testEvent.sequence = sequence;
+		eventSystem->PostEvent(EVENT_ID("DeferredTest"), testEvent);
+		eventSystem->PostCoalescedEvent(EVENT_ID("DeferredTestCoalesced"), (uint64_t)threadIndex, testEvent);
+	}
+}
 
-	EventMapIter iter = m_events.find(eventHash);
 
-	if (iter == m_events.end())
+//-----------------------------------------------------------------------------------------------
+//Rounds of short-lived threads post at once, then get dispatched.  Every plain post has to arrive
+//once and in order, only the newest coalesced post per thread may arrive, and the threads of later
+//rounds have to reuse the buffers of earlier ones.  Dispatches anything the game has pending, too
+CONSOLE_COMMAND(DeferredEventTest, args)
+{
+	int numRounds = 8;
+	int threadsPerRound = 10;
+	int postsPerThread = 1000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numRounds = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			threadsPerRound = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			postsPerThread = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: deferredeventtest [numRounds] [threadsPerRound] [postsPerThread]", RED);
+		return;
+	}
+
+	if (numRounds < 1 || threadsPerRound < 1 || postsPerThread < 1)
 	{
-		return nullptr;
+		ConsolePrint("Usage: deferredeventtest [numRounds] [threadsPerRound] [postsPerThread]", RED);
+		return;
 	}
 
-	return iter->second;
+	int numThreads = numRounds * threadsPerRound;
+	DeferredTestResults results;
+	results.nextSequences.resize(numThreads, 0);
+	results.coalescedSequences.resize(numThreads, -1);
+	results.numCoalescedDispatches.resize(numThreads, 0);
+	results.numOutOfOrder = 0;
+
+	EventSystem eventSystem;
+	eventSystem.RegisterEvent(EVENT_ID("DeferredTest"), CheckDeferredTestEvent, &results);
+	eventSystem.RegisterEvent(EVENT_ID("DeferredTestCoalesced"), CheckCoalescedTestEvent, &results);
+
+	int numBuffersBefore = DeferredEvents::GetNumThreadBuffers();
+	double startSeconds = GetCurrentTimeSeconds();
+	for (int round = 0; round < numRounds; round++)
+	{
+		std::vector<std::thread> threads;
+		for (int thread = 0; thread < threadsPerRound; thread++)
+		{
+			threads.emplace_back(PostDeferredTestEvents, &eventSystem, round * threadsPerRound + thread, postsPerThread);
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		DeferredEvents::DispatchAll();
+	}
+	double elapsedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	int numMissing = 0;
+	int numBadCoalesced = 0;
+	for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		if (results.nextSequences[threadIndex] != postsPerThread)
+		{
+			numMissing++;
+		}
+		if (results.numCoalescedDispatches[threadIndex] != 1 || results.coalescedSequences[threadIndex] != postsPerThread - 1)
+		{
+			numBadCoalesced++;
+		}
+	}
+
+	bool isOrderPassing = (numMissing == 0 && results.numOutOfOrder == 0);
+	ConsolePrintf(isOrderPassing ? WHITE : RED, "%i threads, %i posts each: %i threads short, %i posts out of order: %s",
+		numThreads, postsPerThread, numMissing, results.numOutOfOrder, isOrderPassing ? "passed" : "FAILED");
+
+	bool isCoalescePassing = (numBadCoalesced == 0);
+	ConsolePrintf(isCoalescePassing ? WHITE : RED, "Coalesced posts: %i threads without exactly their newest one: %s",
+		numBadCoalesced, isCoalescePassing ? "passed" : "FAILED");
+
+	//Buffers other threads hold may be adopted, so there can be fewer new ones than one round's worth
+	int numNewBuffers = DeferredEvents::GetNumThreadBuffers() - numBuffersBefore;
+	bool isBufferPassing = (numNewBuffers <= threadsPerRound);
+	ConsolePrintf(isBufferPassing ? WHITE : RED, "Thread buffers: %i new for %i threads, %i at once: %s",
+		numNewBuffers, numThreads, threadsPerRound, isBufferPassing ? "passed" : "FAILED");
+
+	ConsolePrintf(WHITE, "%.2fms, %.1fns per post", elapsedSeconds * 1000.0, elapsedSeconds * 1.e9 / ((double)numThreads * (double)postsPerThread * 2.0));
+
+	if (!isOrderPassing || !isCoalescePassing || !isBufferPassing)
+	{
+		ConsolePrint("Deferred event tests FAILED", RED);
+	}
 }
\ No newline at end of file
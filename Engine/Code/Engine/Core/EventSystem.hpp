@@ -4,8 +4,11 @@
 // LOVINGLY TRANSCRIBED FROM NICK'S EVENT SYSTEM
 //-----------------------------------------------------------------------------------------------
 
+#include "Engine/Core/DeferredEvents.hpp"
+
+#include <stdint.h>
 #include <string>
-#include <map>
+#include <type_traits>
 #include <vector>
 
 
@@ -32,11 +35,26 @@ struct TickEvent : public Event
 //-----------------------------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------------------------
+// Events are keyed by a 64-bit FNV-1a hash of their name.  EVENT_ID("Name") hashes at compile
+// time; names passed as strings are hashed on the spot, which never allocates.
+//-----------------------------------------------------------------------------------------------
+typedef uint64_t EventID;
+
+constexpr EventID HashEventName(const char* eventName, EventID hash = 14695981039346656037ULL)
+{
+	return (*eventName == '\0') ? hash : HashEventName(eventName + 1, (hash ^ (uint8_t)*eventName) * 1099511628211ULL);
+}
+
+#define EVENT_ID(eventName) (std::integral_constant<EventID, HashEventName(eventName)>::value)
+
+
 //-----------------------------------------------------------------------------------------------
 typedef void EventCallback(Event* eventData, void* subArg);
 
 
 //-----------------------------------------------------------------------------------------------
+//A null eventFunc marks a subscriber removed during dispatch, waiting to be compacted away
 struct EventSubscriber
 {
 	EventCallback* eventFunc;
@@ -45,12 +63,6 @@ struct EventSubscriber
 typedef std::vector<EventSubscriber> EventSubscribers;
 
 
-//-----------------------------------------------------------------------------------------------
-typedef std::pair<const size_t, EventSubscribers*> EventPair;
-typedef std::map<size_t, EventSubscribers*> EventMap;
-typedef EventMap::iterator EventMapIter;
-
-
 //-----------------------------------------------------------------------------------------------
 template <class Subscriber, void(Subscriber::*Func)(Event*)>
 void MethodEventStub(Event* eventData, void* subArg)
@@ -60,28 +72,92 @@ void MethodEventStub(Event* eventData, void* subArg)
 }
 
 
+//-----------------------------------------------------------------------------------------------
+// Subscribers can register and unregister from inside a callback.  Ones added during a trigger
+// are first called on the next one; ones removed are skipped at once, and compacted out when the
+// outermost trigger returns.
 //-----------------------------------------------------------------------------------------------
 class EventSystem
 {
 public:
+	EventSystem();
 	~EventSystem();
 
 	template <class Subscriber, void(Subscriber::*Func)(Event*)>
-	void RegisterEvent(const std::string& eventName, Subscriber* sub)
+	void RegisterEvent(EventID eventID, Subscriber* sub)
+	{
+		RegisterEvent(eventID, MethodEventStub<Subscriber, Func>, sub);
+	}
+	template <class Subscriber, void(Subscriber::*Func)(Event*)>
+	void RegisterEvent(const char* eventName, Subscriber* sub)
 	{
-		RegisterEvent(eventName, MethodEventStub<Subscriber, Func>, sub);
+		RegisterEvent(HashEventName(eventName), MethodEventStub<Subscriber, Func>, sub);
 	}
+	void RegisterEvent(EventID eventID, EventCallback* eventFunc, void* subscriber);
 
-	void TriggerEvent(const std::string& eventName, Event* eventData);
+	void TriggerEvent(EventID eventID, Event* eventData);
+	void TriggerEvent(const char* eventName, Event* eventData) { TriggerEvent(HashEventName(eventName), eventData); }
+	void TriggerEvent(const std::string& eventName, Event* eventData) { TriggerEvent(HashEventName(eventName.c_str()), eventData); }
 
-	void UnregisterFromEvent(void* subscriber, const std::string& eventName);
+	//Safe from any thread.  Triggered on whichever thread calls DeferredEvents::DispatchAll
+	template<typename T>
+	void PostEvent(EventID eventID, const T& eventData);
+
+	//Of all the posts with the same event and instanceKey in a batch, only the newest is triggered
+	template<typename T>
+	void PostCoalescedEvent(EventID eventID, uint64_t instanceKey, const T& eventData);
+
+	void UnregisterFromEvent(void* subscriber, EventID eventID);
+	void UnregisterFromEvent(void* subscriber, const std::string& eventName) { UnregisterFromEvent(subscriber, HashEventName(eventName.c_str())); }
 	void UnregisterFromAllEvents(void* subscriber);
 
 private:
-	void RegisterEvent(const std::string& eventName, EventCallback* eventFunc, void* subscriber);
+	struct EventSlot
+	{
+		EventID eventID; //0 is an empty slot
+		EventSubscribers* subscribers;
+		bool hasRemovedSubscribers;
+	};
+
+	EventSlot* FindSlot(EventID eventID);
+	EventSlot* FindOrCreateSlot(EventID eventID);
+	void Grow();
+	void RemoveSubscriber(EventSlot& slot, void* subscriber, bool removeAll);
+	void CompactRemovedSubscribers();
+
+	//Open-addressed, linear probing.  Events are never removed, so there are no tombstones
+	std::vector<EventSlot> m_slots;
+	size_t m_numEvents;
+	int m_dispatchDepth;
+	bool m_hasRemovedSubscribers;
+};
 
-	EventSubscribers* FindOrCreateEvent(const std::string& eventName);
-	EventSubscribers* FindEvent(const std::string& eventName);
 
-	EventMap m_events;
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+struct DeferredEventSystemEvent
+{
+	EventSystem* eventSystem;
+	EventID eventID;
+	T eventData;
+
+	void Dispatch() { eventSystem->TriggerEvent(eventID, &eventData); }
 };
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void EventSystem::PostEvent(EventID eventID, const T& eventData)
+{
+	DeferredEventSystemEvent<T> deferredEvent = { this, eventID, eventData };
+	DeferredEvents::Post(std::move(deferredEvent));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void EventSystem::PostCoalescedEvent(EventID eventID, uint64_t instanceKey, const T& eventData)
+{
+	DeferredEventSystemEvent<T> deferredEvent = { this, eventID, eventData };
+	DeferredEvents::Post(std::move(deferredEvent), DeferredEvents::MakeCoalesceKey(eventID, instanceKey));
+}
\ No newline at end of file
@@ -1,44 +1,229 @@
 #include "Engine/Core/JobSystem.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/ReferenceCount.hpp"
+#include "Engine/Core/ObjectPool.hpp"
+#include "Engine/Core/Memory.hpp"
+#include "Engine/Core/Profiler.hpp"
+#include "Engine/Core/Platform.hpp"
+#include "Engine/Core/StringUtils.hpp"
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
 
 
 //-----------------------------------------------------------------------------------------------
 std::vector<std::thread*> JobSystem::g_threadHandles;
-bool JobSystem::g_shouldShutDown = false;
-std::map<EJobCategory, ThreadSafeQueue<Job*>> JobSystem::g_jobQueues;
+std::atomic<bool> JobSystem::g_shouldShutDown(false);
+JobQueueSlot* JobSystem::g_queueSlots = nullptr;
+std::atomic<int> JobSystem::g_numQueueSlots(0);
 
 
 //-----------------------------------------------------------------------------------------------
-void JobSystem::Startup(unsigned int categoryMask, int numThreads)
+//Bumped every startup so threads know their cached slot index is stale
+static std::atomic<unsigned int> s_slotGeneration(0);
+static thread_local int t_queueSlotIndex = -1;
+static thread_local unsigned int t_queueSlotGeneration = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+//Gives the thread's slot back on exit.  Slots are never taken out of the steal range, so jobs
+//left behind still get stolen until the slot is adopted
+struct JobQueueSlotRelease
+{
+	~JobQueueSlotRelease()
+	{
+		if (t_queueSlotIndex >= 0 && JobSystem::g_queueSlots && t_queueSlotGeneration == s_slotGeneration.load(std::memory_order_relaxed))
+		{
+			JobSystem::g_queueSlots[t_queueSlotIndex].isReleased.store(true, std::memory_order_release);
+		}
+		t_queueSlotIndex = -1;
+	}
+};
+static thread_local JobQueueSlotRelease t_queueSlotRelease;
+
+//Remembered so the benchmark can restore the original configuration
+static unsigned int s_startupCategoryMask = 0;
+static int s_startupNumThreads = 0;
+static bool s_startupPinsWorkers = false;
+
+
+//-----------------------------------------------------------------------------------------------
+//Idle workers spin (yielding) for a little while, then park until a dispatch wakes them
+static const int WORKER_SPINS_BEFORE_PARKING = 256;
+
+//Eventcount: a worker snapshots the epoch, announces itself as parked, rechecks for work, then
+//sleeps until the epoch moves.  Dispatchers only touch the mutex when someone is actually parked
+static std::mutex s_parkMutex;
+static std::condition_variable s_parkCondition;
+static std::atomic<unsigned int> s_wakeEpoch(0);
+static std::atomic<int> s_numParkedWorkers(0);
+static std::atomic<uint64_t> s_lastWakeRequestCounter(0);
+
+
+//-----------------------------------------------------------------------------------------------
+//Written only by the owning worker; read by whoever asks for stats
+struct JobWorkerCounters
+{
+	std::atomic<uint64_t> idleCounts;
+	std::atomic<uint64_t> totalWakeLatencyCounts;
+	std::atomic<uint64_t> maxWakeLatencyCounts;
+	std::atomic<uint64_t> numParks;
+	std::atomic<uint64_t> numJobsExecuted;
+
+	JobWorkerCounters() : idleCounts(0), totalWakeLatencyCounts(0), maxWakeLatencyCounts(0), numParks(0), numJobsExecuted(0) {}
+};
+static JobWorkerCounters* s_workerCounters = nullptr;
+static size_t s_numWorkers = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+//Intrusive list node linking a predecessor to a job waiting on it
+struct JobContinuation
+{
+	Job* successor;
+	JobContinuation* next;
+};
+
+//Swapped in as the list head once a job finishes, so late additions know not to wait
+static JobContinuation* const CLOSED_CONTINUATIONS = (JobContinuation*)1;
+
+
+//-----------------------------------------------------------------------------------------------
+// JOB ALLOCATION
+//	Jobs are fixed size, so they come out of a block pool.  Jobs are usually freed on a different
+//	thread than they were created on, which the pool's per-thread caches and batched return list
+//	are built for
+//-----------------------------------------------------------------------------------------------
+static const size_t JOB_BLOCK_BYTES = RefCount::GetBlockSize<Job>();
+
+
+//-----------------------------------------------------------------------------------------------
+static BlockPool& GetJobBlockPool()
+{
+	//Never destroyed; worker threads can still be releasing jobs while statics tear down
+	static BlockPool* s_jobBlockPool = new BlockPool(JOB_BLOCK_BYTES, alignof(std::max_align_t), 0, "Jobs");
+	return *s_jobBlockPool;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void* AllocateJobBlock()
+{
+	return GetJobBlockPool().Allocate();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void FreeJobBlockMemory(void* memory)
+{
+	GetJobBlockPool().Free(memory);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Continuations are linked and freed as often as jobs (every ParallelFor split), so they get a pool too
+static BlockPool& GetContinuationBlockPool()
+{
+	static BlockPool* s_continuationBlockPool = new BlockPool(sizeof(JobContinuation), alignof(JobContinuation), 0, "JobContinuations");
+	return *s_continuationBlockPool;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static JobContinuation* AllocateContinuation()
+{
+	return (JobContinuation*)GetContinuationBlockPool().Allocate();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void FreeContinuation(JobContinuation* continuation)
+{
+	GetContinuationBlockPool().Free(continuation);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void ReleaseJob(Job* toRelease)
+{
+	RefCount::Release<Job>(toRelease);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void WakeParkedWorker()
+{
+	//Pairs with the fence in ParkWorker: either the worker sees the new job or we see it parked
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (s_numParkedWorkers.load(std::memory_order_relaxed) == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_parkMutex);
+		s_lastWakeRequestCounter = ProfilerHelper::GetCurrentPerformanceCounter();
+		++s_wakeEpoch;
+	}
+	s_parkCondition.notify_one();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void WakeAllParkedWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_parkMutex);
+		++s_wakeEpoch;
+	}
+	s_parkCondition.notify_all();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void JobSystem::Startup(unsigned int categoryMask, int numThreads, bool pinWorkersToCores)
 {
 	ASSERT_OR_DIE(categoryMask != 0, "Cannot specify no categories");
+	s_startupCategoryMask = categoryMask;
+	s_startupNumThreads = numThreads;
+	s_startupPinsWorkers = pinWorkersToCores;
+
+	int numCores = Platform::GetNumLogicalCores();
 	int threadsToSpawn = numThreads;
 	if (numThreads < 0)
 	{
-		SYSTEM_INFO si;
-		GetSystemInfo(&si);
-		threadsToSpawn = (int)si.dwNumberOfProcessors + numThreads;
+		threadsToSpawn = numCores + numThreads;
 	}
 	if (threadsToSpawn <= 0)
 	{
 		threadsToSpawn = 1;
 	}
+
+	g_shouldShutDown = false;
+	g_queueSlots = new JobQueueSlot[MAX_JOB_QUEUE_SLOTS];
+	g_numQueueSlots = 0;
+	++s_slotGeneration;
+	s_workerCounters = new JobWorkerCounters[threadsToSpawn];
+	s_numWorkers = (size_t)threadsToSpawn;
+
 	int currentCategoryCount = 0;
-	for (int i = 0; i < NUM_JOB_CATEGORIES; i++)
-	{
-		EJobCategory category = (EJobCategory)(1 << i);
-		g_jobQueues.insert(std::make_pair(category, ThreadSafeQueue<Job*>()));
-	}
 	for (int i = 0; i < threadsToSpawn; i++)
 	{
 		unsigned int thisCategory = 1 << currentCategoryCount;
 		//Always support generic and generic slow, but don't necessarily prioritize
 		unsigned int allConsumerCategories = thisCategory | GENERIC | GENERIC_SLOW;
-		std::thread* currThread = new std::thread(JobWorkerExecute, (EJobCategory)thisCategory, allConsumerCategories);
+
+		//Core 0 is left to the main thread; workers wrap around if there are more of them than cores
+		int coreIndex = -1;
+		if (pinWorkersToCores && numCores > 1)
+		{
+			coreIndex = 1 + (i % (numCores - 1));
+		}
+		std::thread* currThread = Platform::StartThread(Stringf("Job Worker %i", i), coreIndex, [thisCategory, allConsumerCategories, i]()
+		{
+			JobWorkerExecute((EJobCategory)thisCategory, allConsumerCategories, i);
+		});
 		g_threadHandles.push_back(currThread);
 		for (;;)
 		{
@@ -47,7 +232,7 @@ void JobSystem::Startup(unsigned int categoryMask, int numThreads)
 			{
 				currentCategoryCount = 0;
 			}
-			
+
 			if (((1 << currentCategoryCount) & categoryMask) != 0)
 			{
 				break;
@@ -61,6 +246,7 @@ void JobSystem::Startup(unsigned int categoryMask, int numThreads)
 void JobSystem::Shutdown()
 {
 	g_shouldShutDown = true;
+	WakeAllParkedWorkers();
 	for (std::thread* t : g_threadHandles)
 	{
 		t->join();
@@ -69,23 +255,92 @@ void JobSystem::Shutdown()
 	g_threadHandles.clear();
 	g_threadHandles.shrink_to_fit();
 
-	//Clean up any remaining jobs, just in case
+	//Clean up any remaining jobs, just in case.  Workers are joined, so this thread can steal everything
 	unsigned int allCategories = ~0U;
 	JobConsumer consumer(GENERIC, allCategories);
 	consumer.ConsumeAllJobs();
-	g_jobQueues.clear();
+
+	delete[] g_queueSlots;
+	g_queueSlots = nullptr;
+	g_numQueueSlots = 0;
+	delete[] s_workerCounters;
+	s_workerCounters = nullptr;
+	s_numWorkers = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Returns true if a job was consumed instead of sleeping
+static bool ParkWorker(JobConsumer& consumer, JobWorkerCounters& counters)
+{
+	unsigned int epoch = s_wakeEpoch.load(std::memory_order_acquire);
+	s_numParkedWorkers.fetch_add(1, std::memory_order_seq_cst);
+
+	//A dispatch may have landed between our last failed attempt and announcing ourselves
+	if (consumer.ConsumeJob())
+	{
+		s_numParkedWorkers.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	uint64_t parkStartCounter = ProfilerHelper::GetCurrentPerformanceCounter();
+	bool wasWokenForWork = false;
+	{
+		std::unique_lock<std::mutex> lock(s_parkMutex);
+		s_parkCondition.wait(lock, [epoch]() { return s_wakeEpoch.load(std::memory_order_relaxed) != epoch || JobSystem::g_shouldShutDown; });
+		wasWokenForWork = !JobSystem::g_shouldShutDown;
+	}
+	s_numParkedWorkers.fetch_sub(1, std::memory_order_relaxed);
+
+	uint64_t wakeCounter = ProfilerHelper::GetCurrentPerformanceCounter();
+	counters.idleCounts = counters.idleCounts + (wakeCounter - parkStartCounter);
+	counters.numParks = counters.numParks + 1;
+
+	uint64_t requestCounter = s_lastWakeRequestCounter.load(std::memory_order_relaxed);
+	if (wasWokenForWork && requestCounter >= parkStartCounter && wakeCounter >= requestCounter)
+	{
+		uint64_t latency = wakeCounter - requestCounter;
+		counters.totalWakeLatencyCounts = counters.totalWakeLatencyCounts + latency;
+		if (latency > counters.maxWakeLatencyCounts)
+		{
+			counters.maxWakeLatencyCounts = latency;
+		}
+	}
+
+	return false;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void JobSystem::JobWorkerExecute(EJobCategory priority, unsigned int allSupportedCategories)
+void JobSystem::JobWorkerExecute(EJobCategory priority, unsigned int allSupportedCategories, int workerIndex)
 {
+	MemoryTracker::SetThreadTag(MEMTAG_JOBS);
+
 	JobConsumer consumer(priority, allSupportedCategories);
+	JobWorkerCounters& counters = s_workerCounters[workerIndex];
 
+	int idleSpins = 0;
 	while (!g_shouldShutDown)
 	{
-		consumer.ConsumeAllJobs();
-		std::this_thread::yield();
+		if (consumer.ConsumeJob())
+		{
+			counters.numJobsExecuted = counters.numJobsExecuted + 1;
+			idleSpins = 0;
+			continue;
+		}
+
+		if (idleSpins < WORKER_SPINS_BEFORE_PARKING)
+		{
+			++idleSpins;
+			std::this_thread::yield();
+			continue;
+		}
+
+		if (ParkWorker(consumer, counters))
+		{
+			counters.numJobsExecuted = counters.numJobsExecuted + 1;
+		}
+		idleSpins = 0;
 	}
 
 	//Consume remaining jobs
@@ -93,6 +348,89 @@ void JobSystem::JobWorkerExecute(EJobCategory priority, unsigned int allSupporte
 }
 
 
+//-----------------------------------------------------------------------------------------------
+size_t JobSystem::GetNumWorkers()
+{
+	return s_numWorkers;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobWorkerStats JobSystem::GetWorkerStats(size_t workerIndex)
+{
+	ASSERT_OR_DIE(workerIndex < s_numWorkers, "Invalid job worker index");
+	JobWorkerCounters& counters = s_workerCounters[workerIndex];
+
+	JobWorkerStats result;
+	result.idleCounts = counters.idleCounts;
+	result.totalWakeLatencyCounts = counters.totalWakeLatencyCounts;
+	result.maxWakeLatencyCounts = counters.maxWakeLatencyCounts;
+	result.numParks = counters.numParks;
+	result.numJobsExecuted = counters.numJobsExecuted;
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobQueueSlot* JobSystem::GetQueueSlotForThisThread()
+{
+	ASSERT_OR_DIE(g_queueSlots, "Job system has not been started");
+
+	unsigned int generation = s_slotGeneration.load(std::memory_order_relaxed);
+	if (t_queueSlotIndex >= 0 && t_queueSlotGeneration == generation)
+	{
+		return &g_queueSlots[t_queueSlotIndex];
+	}
+
+	//Touching it is what gets its destructor run when this thread exits
+	(void)&t_queueSlotRelease;
+	t_queueSlotGeneration = generation;
+
+	//A slot handed out by the counter is never released, so only one thread can adopt it
+	int numSlots = g_numQueueSlots.load(std::memory_order_acquire);
+	for (int slotIndex = 0; slotIndex < numSlots && slotIndex < MAX_JOB_QUEUE_SLOTS; slotIndex++)
+	{
+		std::atomic<bool>& isReleased = g_queueSlots[slotIndex].isReleased;
+		bool wasReleased = true;
+		if (isReleased.load(std::memory_order_relaxed) && isReleased.compare_exchange_strong(wasReleased, false, std::memory_order_acquire))
+		{
+			t_queueSlotIndex = slotIndex;
+			return &g_queueSlots[slotIndex];
+		}
+	}
+
+	t_queueSlotIndex = g_numQueueSlots.fetch_add(1);
+	ASSERT_OR_DIE(t_queueSlotIndex < MAX_JOB_QUEUE_SLOTS, "Too many threads are using the job system at once");
+	return &g_queueSlots[t_queueSlotIndex];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int JobSystem::GetCategoryIndex(EJobCategory category)
+{
+	int result = 0;
+	while (result < NUM_JOB_CATEGORIES && (1U << result) != (unsigned int)category)
+	{
+		++result;
+	}
+
+	ASSERT_OR_DIE(result < NUM_JOB_CATEGORIES, "Invalid job category");
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+JobConsumer::JobConsumer(EJobCategory priority, unsigned int categoryMask)
+	: m_priority(priority)
+	, m_categoryMask(categoryMask)
+	, m_slot(JobSystem::GetQueueSlotForThisThread())
+	, m_randomState((unsigned int)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1U)
+{
+
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void JobConsumer::ConsumeAllJobs()
 {
@@ -101,20 +439,61 @@ void JobConsumer::ConsumeAllJobs()
 
 
 //-----------------------------------------------------------------------------------------------
-static bool FinishJob(Job* toFinish)
+static void FinishJob(Job* toFinish)
 {
-	//Try to grab the job.  If success, do the work.  Otherwise, someone else got it, so give up
-	if ((EJobCategory)InterlockedCompareExchange((volatile unsigned int*)&toFinish->m_currState, JOB_STATE_IN_PROGRESS, JOB_STATE_ENQUEUED) == JOB_STATE_ENQUEUED)
+	//Whoever pops the job off a deque is its only consumer, so no need to race for it
+	toFinish->m_currState = JOB_STATE_IN_PROGRESS;
 	{
+		PROFILE_LOG_SECTION(job);
 		toFinish->DoWork(toFinish);
-		toFinish->m_currState = JOB_STATE_COMPLETE;
+	}
+	toFinish->ReleaseContinuations();
+	toFinish->m_currState = JOB_STATE_COMPLETE;
+
+	//Releases the original reference, making the consumer the de facto owner
+	ReleaseJob(toFinish);
+}
 
-		//Releases the original reference, making the consumer the de facto owner
-		RefCount::Release<Job>(toFinish);
 
+//-----------------------------------------------------------------------------------------------
+bool JobConsumer::PopOrStealJob(int categoryIndex, Job** outJob)
+{
+	//Own work first; it is LIFO and likely still in cache
+	if (m_slot->queues[categoryIndex].Pop(outJob))
+	{
 		return true;
 	}
 
+	int numSlots = JobSystem::g_numQueueSlots.load(std::memory_order_acquire);
+	if (numSlots > MAX_JOB_QUEUE_SLOTS)
+	{
+		numSlots = MAX_JOB_QUEUE_SLOTS;
+	}
+	if (numSlots <= 1)
+	{
+		return false;
+	}
+
+	//Xorshift to pick a starting victim, so thieves don't all pile onto the same slot
+	m_randomState ^= m_randomState << 13;
+	m_randomState ^= m_randomState >> 17;
+	m_randomState ^= m_randomState << 5;
+	int firstVictim = (int)(m_randomState % (unsigned int)numSlots);
+
+	for (int i = 0; i < numSlots; i++)
+	{
+		JobQueueSlot* victim = &JobSystem::g_queueSlots[(firstVictim + i) % numSlots];
+		if (victim == m_slot)
+		{
+			continue;
+		}
+
+		if (victim->queues[categoryIndex].Steal(outJob))
+		{
+			return true;
+		}
+	}
+
 	return false;
 }
 
@@ -123,25 +502,10 @@ static bool FinishJob(Job* toFinish)
 bool JobConsumer::ConsumeJob()
 {
 	Job* currJob = nullptr;
-	for (;;)
+	if (PopOrStealJob(JobSystem::GetCategoryIndex(m_priority), &currJob))
 	{
-		if (JobSystem::g_jobQueues.at(m_priority).Dequeue(&currJob))
-		{
-			if (FinishJob(currJob))
-			{
-				return true;
-			}
-			else
-			{
-				//The dispatcher got this job.  Get another from the queue
-				continue;
-			}
-		}
-		else
-		{
-			//This queue was empty.  Stop trying
-			break;
-		}
+		FinishJob(currJob);
+		return true;
 	}
 
 	for (int i = 0; i < NUM_JOB_CATEGORIES; i++)
@@ -149,24 +513,10 @@ bool JobConsumer::ConsumeJob()
 		unsigned int currMask = (1 << i);
 		if ((currMask & m_categoryMask) != 0)
 		{
-			EJobCategory currCategory = (EJobCategory)currMask;
-			for (;;)
+			if (PopOrStealJob(i, &currJob))
 			{
-				if (JobSystem::g_jobQueues.at(currCategory).Dequeue(&currJob))
-				{
-					if (FinishJob(currJob))
-					{
-						return true;
-					}
-					else
-					{
-						continue;
-					}
-				}
-				else
-				{
-					break;
-				}
+				FinishJob(currJob);
+				return true;
 			}
 		}
 	}
@@ -175,10 +525,21 @@ bool JobConsumer::ConsumeJob()
 }
 
 
+//-----------------------------------------------------------------------------------------------
+static void EnqueueJob(Job* toEnqueue)
+{
+	toEnqueue->m_currState = JOB_STATE_ENQUEUED;
+	JobQueueSlot* slot = JobSystem::GetQueueSlotForThisThread();
+	slot->queues[JobSystem::GetCategoryIndex(toEnqueue->GetCategory())].Push(toEnqueue);
+
+	WakeParkedWorker();
+}
+
+
 //-----------------------------------------------------------------------------------------------
 Job* Job::Create(EJobCategory type, JobWorkFunc workFunc)
 {
-	Job* result = RefCount::CreateAndAcquire<Job>();
+	Job* result = RefCount::ConstructAndAcquire<Job>(AllocateJobBlock(), FreeJobBlockMemory);
 	result->DoWork = workFunc;
 	result->m_category = type;
 
@@ -191,11 +552,69 @@ void Job::Dispatch(Job* toDispatch)
 {
 	RefCount::Acquire(toDispatch);
 
-	//Reset offset into allocator to rewind and read in the same order we wrote
-	toDispatch->m_currentOffset = 0;
+	//Drop the dispatch token.  If predecessors are still running, the last one to finish enqueues us
+	toDispatch->m_currState = JOB_STATE_WAITING_ON_DEPENDENCIES;
+	if (toDispatch->m_numUnfinishedDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		EnqueueJob(toDispatch);
+	}
+}
+
 
-	toDispatch->m_currState = JOB_STATE_ENQUEUED;
-	JobSystem::g_jobQueues.at(toDispatch->m_category).Enqueue(toDispatch);
+//-----------------------------------------------------------------------------------------------
+void Job::AddDependency(Job* predecessor)
+{
+	ASSERT_OR_DIE(m_currState == JOB_STATE_SPAWNED, "Dependencies must be added before a job is dispatched");
+	LinkDependency(predecessor);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Also used after dispatch, but only by a running predecessor (its own token keeps the count above zero)
+void Job::LinkDependency(Job* predecessor)
+{
+	m_numUnfinishedDependencies.fetch_add(1, std::memory_order_relaxed);
+
+	JobContinuation* continuation = AllocateContinuation();
+	continuation->successor = this;
+
+	JobContinuation* head = predecessor->m_continuations.load(std::memory_order_acquire);
+	for (;;)
+	{
+		if (head == CLOSED_CONTINUATIONS)
+		{
+			//Predecessor already finished, so there is nothing to wait on
+			FreeContinuation(continuation);
+			m_numUnfinishedDependencies.fetch_sub(1, std::memory_order_relaxed);
+			return;
+		}
+
+		continuation->next = head;
+		if (predecessor->m_continuations.compare_exchange_weak(head, continuation, std::memory_order_release, std::memory_order_acquire))
+		{
+			return;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Job::ReleaseContinuations()
+{
+	JobContinuation* continuation = m_continuations.exchange(CLOSED_CONTINUATIONS, std::memory_order_acq_rel);
+	while (continuation)
+	{
+		JobContinuation* next = continuation->next;
+		Job* successor = continuation->successor;
+		FreeContinuation(continuation);
+
+		if (successor->m_numUnfinishedDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			EnqueueJob(successor);
+		}
+
+		continuation = next;
+	}
 }
 
 
@@ -210,16 +629,14 @@ void JobSystem::WaitOnJobs(Job** toWait, size_t numJobs)
 		Job* currJob = toWait[i];
 		while (currJob->m_currState != JOB_STATE_COMPLETE)
 		{
-			//Try to do this job.  If you fail, someone else is doing it, so consume another job
-			if (FinishJob(currJob))
+			//Help out instead of idling.  Our own deque is popped first, so recently dispatched jobs come back to us
+			if (!consumer.ConsumeJob())
 			{
-				break;
+				std::this_thread::yield();
 			}
-
-			consumer.ConsumeJob();
 		}
 
-		RefCount::Release<Job>(currJob);
+		ReleaseJob(currJob);
 	}
 }
 
@@ -229,6 +646,367 @@ void JobSystem::DetachJobs(Job** toDetach, size_t numJobs)
 {
 	for (size_t i = 0; i < numJobs; i++)
 	{
-		RefCount::Release<Job>(toDetach[i]);
+		ReleaseJob(toDetach[i]);
 	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// PARALLEL FOR
+//-----------------------------------------------------------------------------------------------
+static void ParallelForFinishWork(Job*)
+{
+	//Nothing to do; only exists to complete once every range has
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Captured inline in each range job
+struct ParallelForRange
+{
+	ParallelForFunc func;
+	void* userData;
+	size_t startIndex;
+	size_t endIndex;
+	size_t batchSize;
+	Job* finishJob;
+	EJobCategory category;
+
+	void operator()();
+};
+
+
+//-----------------------------------------------------------------------------------------------
+void ParallelForRange::operator()()
+{
+	WorkStealingDeque<Job*>& ownQueue = JobSystem::GetQueueSlotForThisThread()->queues[JobSystem::GetCategoryIndex(category)];
+
+	while (startIndex < endIndex)
+	{
+		size_t remaining = endIndex - startIndex;
+
+		//Lazy binary splitting: only hand off half the range once the last half we handed off has been stolen
+		if (remaining > batchSize && ownQueue.IsEmpty())
+		{
+			ParallelForRange childRange = *this;
+			childRange.startIndex = startIndex + remaining / 2;
+			endIndex = childRange.startIndex;
+
+			Job* child = Job::Create(category, childRange);
+			finishJob->LinkDependency(child);
+			Job::Dispatch(child);
+			JobSystem::DetachJobs(&child);
+			continue;
+		}
+
+		size_t batchEnd = startIndex + ((remaining < batchSize) ? remaining : batchSize);
+		func(startIndex, batchEnd, userData);
+		startIndex = batchEnd;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+Job* JobSystem::ParallelFor(EJobCategory category, size_t count, ParallelForFunc func, void* userData, size_t minBatchSize, Job* predecessor)
+{
+	//Aim for several batches per worker so late stealers still find something
+	size_t batchSize = count / ((GetNumWorkers() + 1) * 8);
+	if (batchSize < minBatchSize)
+	{
+		batchSize = minBatchSize;
+	}
+	if (batchSize < 1)
+	{
+		batchSize = 1;
+	}
+
+	Job* finishJob = Job::Create(category, ParallelForFinishWork);
+	ParallelForRange range = { func, userData, 0, count, batchSize, finishJob, category };
+	Job* rootRange = Job::Create(category, range);
+
+	if (predecessor)
+	{
+		rootRange->AddDependency(predecessor);
+	}
+	finishJob->AddDependency(rootRange);
+
+	Job::Dispatch(finishJob);
+	Job::Dispatch(rootRange);
+	DetachJobs(&rootRange);
+
+	return finishJob;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// BENCHMARK
+//-----------------------------------------------------------------------------------------------
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Memory/ThreadSafeSTL.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+static int s_benchmarkWorkPerJob = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+static void BenchmarkJobWork(Job*)
+{
+	volatile float accumulator = 0.f;
+	for (int i = 0; i < s_benchmarkWorkPerJob; i++)
+	{
+		accumulator = accumulator + (float)i;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Replicates the old scheduler: a single critical-section queue that every worker polls
+static double RunLockedQueueBenchmark(int numWorkers, int numJobs)
+{
+	LockedQueue<Job*> queue;
+	std::atomic<int> jobsDone(0);
+	std::atomic<bool> isDone(false);
+
+	auto drainQueue = [&]()
+	{
+		Job* currJob = nullptr;
+		if (queue.Dequeue(&currJob))
+		{
+			currJob->DoWork(currJob);
+			currJob->m_currState = JOB_STATE_COMPLETE;
+			++jobsDone;
+			return true;
+		}
+		return false;
+	};
+
+	std::vector<std::thread*> workers;
+	for (int i = 0; i < numWorkers; i++)
+	{
+		workers.push_back(new std::thread([&]()
+		{
+			while (!isDone)
+			{
+				if (!drainQueue())
+				{
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	std::vector<Job*> jobs(numJobs);
+	double startSeconds = GetCurrentTimeSeconds();
+	for (int i = 0; i < numJobs; i++)
+	{
+		jobs[i] = Job::Create(GENERIC, BenchmarkJobWork);
+		jobs[i]->m_currState = JOB_STATE_ENQUEUED;
+		queue.Enqueue(jobs[i]);
+	}
+	while (jobsDone < numJobs)
+	{
+		if (!drainQueue())
+		{
+			std::this_thread::yield();
+		}
+	}
+	double elapsedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	isDone = true;
+	for (std::thread* t : workers)
+	{
+		t->join();
+		delete t;
+	}
+	JobSystem::DetachJobs(jobs.data(), jobs.size());
+
+	return (double)numJobs / elapsedSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static double RunWorkStealingBenchmark(int numWorkers, int numJobs)
+{
+	JobSystem::Shutdown();
+	JobSystem::Startup(GENERIC | GENERIC_SLOW, numWorkers);
+
+	std::vector<Job*> jobs(numJobs);
+	double startSeconds = GetCurrentTimeSeconds();
+	for (int i = 0; i < numJobs; i++)
+	{
+		jobs[i] = Job::Create((i & 1) ? GENERIC : GENERIC_SLOW, BenchmarkJobWork);
+		Job::Dispatch(jobs[i]);
+	}
+	JobSystem::WaitOnJobs(jobs.data(), jobs.size());
+	double elapsedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	return (double)numJobs / elapsedSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Usage: jobbenchmark [maxWorkers] [numJobs] [workPerJob]
+CONSOLE_COMMAND(JobBenchmark, args)
+{
+	int maxWorkers = Platform::GetNumLogicalCores();
+	int numJobs = 100000;
+	s_benchmarkWorkPerJob = 100;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			maxWorkers = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numJobs = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			s_benchmarkWorkPerJob = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: jobbenchmark [maxWorkers] [numJobs] [workPerJob]", RED);
+		return;
+	}
+
+	if (maxWorkers < 1 || numJobs < 1)
+	{
+		ConsolePrint("Need at least one worker and one job", RED);
+		return;
+	}
+
+	unsigned int originalCategoryMask = s_startupCategoryMask;
+	int originalNumThreads = s_startupNumThreads;
+	bool originalPinsWorkers = s_startupPinsWorkers;
+	bool wasRunning = (JobSystem::g_queueSlots != nullptr);
+	if (!wasRunning)
+	{
+		JobSystem::Startup(GENERIC | GENERIC_SLOW, 1);
+	}
+
+	ConsolePrintf(WHITE, "Job benchmark: %i jobs, %i work per job", numJobs, s_benchmarkWorkPerJob);
+	for (int numWorkers = 1; numWorkers <= maxWorkers; numWorkers++)
+	{
+		double lockedJobsPerSecond = RunLockedQueueBenchmark(numWorkers, numJobs);
+		double stealingJobsPerSecond = RunWorkStealingBenchmark(numWorkers, numJobs);
+		ConsolePrintf(WHITE, "%2i workers: work stealing %.0f jobs/sec, locked queue %.0f jobs/sec (%.2fx)",
+			numWorkers, stealingJobsPerSecond, lockedJobsPerSecond, stealingJobsPerSecond / lockedJobsPerSecond);
+	}
+
+	JobSystem::Shutdown();
+	if (wasRunning)
+	{
+		JobSystem::Startup(originalCategoryMask, originalNumThreads, originalPinsWorkers);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(JobStats, args)
+{
+	UNUSED(args);
+	size_t numWorkers = JobSystem::GetNumWorkers();
+	if (numWorkers == 0)
+	{
+		ConsolePrint("Job system is not running", RED);
+		return;
+	}
+
+	for (size_t i = 0; i < numWorkers; i++)
+	{
+		JobWorkerStats stats = JobSystem::GetWorkerStats(i);
+		double idleMs = ProfilerHelper::PerformanceCountToSeconds(stats.idleCounts) * 1000.;
+		double averageWakeUs = 0.;
+		if (stats.numParks > 0)
+		{
+			averageWakeUs = ProfilerHelper::PerformanceCountToSeconds(stats.totalWakeLatencyCounts) * 1000000. / (double)stats.numParks;
+		}
+		double maxWakeUs = ProfilerHelper::PerformanceCountToSeconds(stats.maxWakeLatencyCounts) * 1000000.;
+		ConsolePrintf(WHITE, "Worker %u: %llu jobs, idle %.2fms over %llu parks, wake latency avg %.1fus max %.1fus",
+			(unsigned int)i, stats.numJobsExecuted, idleMs, stats.numParks, averageWakeUs, maxWakeUs);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//What creating a job used to cost: a malloc'd ref counted Job plus a separately malloc'd parameter buffer
+struct LegacyJobLayout
+{
+	JobWorkFunc workFunc;
+	void* parameterMemory;
+
+	LegacyJobLayout() : workFunc(nullptr), parameterMemory(malloc(JOB_PAYLOAD_BYTES)) {}
+	~LegacyJobLayout() { free(parameterMemory); }
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Usage: joballocbenchmark [numJobs]
+CONSOLE_COMMAND(JobAllocBenchmark, args)
+{
+	int numJobs = 100000;
+	std::string arg = args.GetNextArg();
+	if (arg != "")
+	{
+		try
+		{
+			numJobs = std::stoi(arg);
+		}
+		catch (const std::exception&)
+		{
+			ConsolePrintf(RED, "Bad argument: %s", arg.c_str());
+			return;
+		}
+	}
+	if (numJobs < 1)
+	{
+		ConsolePrint("Need at least one job", RED);
+		return;
+	}
+
+	//Allocate everything, then free everything, like a frame's worth of jobs would
+	std::vector<LegacyJobLayout*> legacyJobs(numJobs);
+	double startSeconds = GetCurrentTimeSeconds();
+	for (int i = 0; i < numJobs; i++)
+	{
+		legacyJobs[i] = RefCount::CreateAndAcquire<LegacyJobLayout>();
+		legacyJobs[i]->workFunc = BenchmarkJobWork;
+	}
+	for (int i = 0; i < numJobs; i++)
+	{
+		RefCount::Release<LegacyJobLayout>(legacyJobs[i]);
+	}
+	double legacySeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	std::vector<Job*> jobs(numJobs);
+	startSeconds = GetCurrentTimeSeconds();
+	for (int i = 0; i < numJobs; i++)
+	{
+		jobs[i] = Job::Create(GENERIC, BenchmarkJobWork);
+	}
+	JobSystem::DetachJobs(jobs.data(), jobs.size());
+	double pooledSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	startSeconds = GetCurrentTimeSeconds();
+	for (int i = 0; i < numJobs; i++)
+	{
+		Job** capturedSlot = &jobs[i];
+		jobs[i] = Job::Create(GENERIC, [capturedSlot, i]() { *capturedSlot = nullptr; UNUSED(i); });
+	}
+	JobSystem::DetachJobs(jobs.data(), jobs.size());
+	double captureSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	double nanosecondsPerJob = 1000000000. / (double)numJobs;
+	ConsolePrintf(WHITE, "Job alloc+free, %i jobs: legacy %.1fns/job, pooled %.1fns/job, pooled with capture %.1fns/job",
+		numJobs, legacySeconds * nanosecondsPerJob, pooledSeconds * nanosecondsPerJob, captureSeconds * nanosecondsPerJob);
 }
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
 
-#include "Engine/Memory/ThreadSafeSTL.hpp"
-#include "Engine/Core/LinearAllocator.hpp"
+#include "Engine/Core/WorkStealingDeque.hpp"
 
 #include <vector>
 #include <thread>
-#include <map>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
 
 
 //-----------------------------------------------------------------------------------------------
@@ -17,13 +19,22 @@ enum EJobCategory
 #define NUM_JOB_CATEGORIES 2
 //IMPORTANT!!!! UPDATE DEFINE WHENEVER THE CATEGORY NUM CHANGES!!!!!
 
+//Every thread that dispatches or consumes jobs claims one of these (workers, main thread, etc.)
+#define MAX_JOB_QUEUE_SLOTS 64
+
+//Captured state is stored inside the job itself; capture a pointer if you need more than this
+#define JOB_PAYLOAD_BYTES 64
+
 
 //-----------------------------------------------------------------------------------------------
 typedef void(*JobWorkFunc)(class Job*);
+typedef void(*ParallelForFunc)(size_t startIndex, size_t endIndex, void* userData);
+typedef void(*JobPayloadDestructor)(void* payload);
 
 enum EJobState
 {
 	JOB_STATE_SPAWNED,
+	JOB_STATE_WAITING_ON_DEPENDENCIES,
 	JOB_STATE_ENQUEUED,
 	JOB_STATE_IN_PROGRESS,
 	JOB_STATE_COMPLETE
@@ -33,38 +44,103 @@ enum EJobState
 //-----------------------------------------------------------------------------------------------
 class Job
 {
-	const size_t ALLOCATOR_BYTES = 64;
-
 public:
 	static Job* Create(EJobCategory type, JobWorkFunc workFunc);
 
-	//Don't call this explicitly
-	Job() : m_jobMemory(ALLOCATOR_BYTES), m_currentOffset(0), m_currState(JOB_STATE_SPAWNED) {}
+	//Func is any callable taking no arguments (e.g. a lambda).  Its captures live inline in the job
+	template<typename Func>
+	static Job* Create(EJobCategory type, Func&& func);
+
+	//Don't call these explicitly
+	Job() : m_currState(JOB_STATE_SPAWNED), m_destroyPayload(nullptr), m_numUnfinishedDependencies(1), m_continuations(nullptr) {}
+	~Job() { if (m_destroyPayload) m_destroyPayload(m_payload); }
 	
+	//A job with unfinished dependencies is held back and enqueued by whichever predecessor finishes last
 	static void Dispatch(Job* toDispatch);
 
-	template<typename T>
-	void Read(T& outVal)
-	{
-		memcpy(&outVal, m_jobMemory.Get(m_currentOffset), sizeof(T));
-		m_currentOffset += sizeof(T);
-	}
+	//Must be called before this job is dispatched.  A job that has dependencies must eventually be dispatched
+	void AddDependency(Job* predecessor);
+	bool IsComplete() const { return m_currState == JOB_STATE_COMPLETE; }
+	EJobCategory GetCategory() const { return m_category; }
 
-	template<typename T>
-	void Write(const T& inVal)
-	{
-		memcpy(m_jobMemory.Get(m_currentOffset), &inVal, sizeof(T));
-		m_currentOffset += sizeof(T);
-	}
+	//Don't call these explicitly; used by the job system
+	void LinkDependency(Job* predecessor);
+	void ReleaseContinuations();
 
 public:
 	JobWorkFunc DoWork;
-	EJobState m_currState;
+	std::atomic<EJobState> m_currState;
 
 private:
-	LinearAllocator m_jobMemory;
-	size_t m_currentOffset;
+	template<typename Func> static void InvokeCapturedWork(Job* job);
+	template<typename Func> static void DestroyCapturedWork(void* payload);
+
+private:
+	alignas(8) unsigned char m_payload[JOB_PAYLOAD_BYTES];
+	JobPayloadDestructor m_destroyPayload;
 	EJobCategory m_category;
+
+	//Starts at 1 so the job can't be enqueued until it is dispatched
+	std::atomic<int> m_numUnfinishedDependencies;
+
+	//Jobs waiting on this one.  Closed off once this job finishes
+	std::atomic<struct JobContinuation*> m_continuations;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename Func>
+Job* Job::Create(EJobCategory type, Func&& func)
+{
+	typedef typename std::decay<Func>::type FuncType;
+	static_assert(sizeof(FuncType) <= JOB_PAYLOAD_BYTES, "Job capture is too large; capture a pointer instead");
+	static_assert(alignof(FuncType) <= 8, "Job capture is over-aligned");
+
+	Job* result = Create(type, &InvokeCapturedWork<FuncType>);
+	new (result->m_payload) FuncType(std::forward<Func>(func));
+	result->m_destroyPayload = &DestroyCapturedWork<FuncType>;
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename Func>
+void Job::InvokeCapturedWork(Job* job)
+{
+	(*(Func*)job->m_payload)();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename Func>
+void Job::DestroyCapturedWork(void* payload)
+{
+	((Func*)payload)->~Func();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//One deque per category, owned by a single thread.  Other threads steal from the top.  When the
+//owner exits the slot is released, and the next new thread adopts it, along with any jobs left in it
+struct JobQueueSlot
+{
+	JobQueueSlot() : isReleased(false) {}
+
+	WorkStealingDeque<Job*> queues[NUM_JOB_CATEGORIES];
+	std::atomic<bool> isReleased;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Snapshot of one worker's idle behavior.  Times are in performance counter ticks
+struct JobWorkerStats
+{
+	uint64_t idleCounts;
+	uint64_t totalWakeLatencyCounts;
+	uint64_t maxWakeLatencyCounts;
+	uint64_t numParks;
+	uint64_t numJobsExecuted;
 };
 
 
@@ -72,27 +148,43 @@ private:
 class JobConsumer
 {
 public:
-	JobConsumer(EJobCategory priority, unsigned int categoryMask) : m_priority(priority), m_categoryMask(categoryMask) {}
+	//Must be constructed on the thread that will consume
+	JobConsumer(EJobCategory priority, unsigned int categoryMask);
 	void ConsumeAllJobs();
 	bool ConsumeJob();
 
+private:
+	bool PopOrStealJob(int categoryIndex, Job** outJob);
+
 private:
 	EJobCategory m_priority;
 	unsigned int m_categoryMask;
+	JobQueueSlot* m_slot;
+	unsigned int m_randomState;
 };
 
 
 //-----------------------------------------------------------------------------------------------
 namespace JobSystem
 {
-	//Pass in categories using a bitwise OR (e.g. GENERIC | GENERIC_SLOW)
-	void Startup(unsigned int categoryMask, int numThreads);
+	//Pass in categories using a bitwise OR (e.g. GENERIC | GENERIC_SLOW).  Negative numThreads means "all cores but this many".
+	//Pinning gives each worker its own core (skipping core 0, which is left for the main thread)
+	void Startup(unsigned int categoryMask, int numThreads, bool pinWorkersToCores = false);
 	void Shutdown();
-	void JobWorkerExecute(EJobCategory priority, unsigned int allSupportedCategories);
+	void JobWorkerExecute(EJobCategory priority, unsigned int allSupportedCategories, int workerIndex);
 	void WaitOnJobs(Job** toWait, size_t numJobs = 1);
 	void DetachJobs(Job** toDetach, size_t numJobs = 1);
+	JobQueueSlot* GetQueueSlotForThisThread();
+	int GetCategoryIndex(EJobCategory category);
+	size_t GetNumWorkers();
+	JobWorkerStats GetWorkerStats(size_t workerIndex);
+
+	//Splits [0, count) into ranges that are handed to idle workers as they steal.  Never blocks; the
+	//returned job completes once every index is processed, so it can be waited on or used as a dependency
+	Job* ParallelFor(EJobCategory category, size_t count, ParallelForFunc func, void* userData, size_t minBatchSize = 1, Job* predecessor = nullptr);
 
 	extern std::vector<std::thread*> g_threadHandles;
-	extern bool g_shouldShutDown;
-	extern std::map<EJobCategory, ThreadSafeQueue<Job*>> g_jobQueues;
+	extern std::atomic<bool> g_shouldShutDown;
+	extern JobQueueSlot* g_queueSlots;
+	extern std::atomic<int> g_numQueueSlots;
 };
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 
 //-----------------------------------------------------------------------------------------------
+//Single fixed block with an untyped offset lookup.  For anything that needs rewinding or growth, use ArenaAllocator
 class LinearAllocator
 {
 public:
@@ -18,13 +19,17 @@ public:
 	template<typename T>
 	T* Alloc()
 	{
-		T* result = (T*)m_currPtr;
-		char* bytePtr = (char*)m_currPtr;
-		bytePtr += sizeof(T);
-		ASSERT_OR_DIE(bytePtr - m_startPtr < m_maxAllocatedBytes, "Ran out of space in linear allocator!");
+		size_t alignedAddress = ((size_t)m_currPtr + alignof(T) - 1) & ~(alignof(T) - 1);
+		char* bytePtr = (char*)alignedAddress + sizeof(T);
+		ASSERT_OR_DIE((size_t)(bytePtr - (char*)m_startPtr) <= m_maxAllocatedBytes, "Ran out of space in linear allocator!");
 		m_currPtr = bytePtr;
 
-		return result;
+		return (T*)alignedAddress;
+	}
+
+	void Reset()
+	{
+		m_currPtr = m_startPtr;
 	}
 
 	void* Get(size_t offset)
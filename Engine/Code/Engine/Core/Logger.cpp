@@ -1,30 +1,249 @@
 #include "Engine/Core/Logger.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Platform.hpp"
+#include "Engine/Core/Memory.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Memory/SpinLock.hpp"
+#include "Engine/Renderer/Rgba.hpp"
 
 #include <stdarg.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 
 //-----------------------------------------------------------------------------------------------
-ThreadSafeQueue<std::string> Logger::s_messageQueue;
 FILE* Logger::s_file;
 std::string Logger::s_logName;
 std::thread Logger::s_slaveLogger;
-bool Logger::s_isRunning = false;
-CriticalSection Logger::s_flushRequestCS;
-bool Logger::s_needsFlush = false;
-bool Logger::s_hasFlushed = false;
+std::atomic<bool> Logger::s_isRunning(false);
 
 
 //-----------------------------------------------------------------------------------------------
-void Logger::Printvf(const char* format, va_list& vargs)
+// PER-THREAD RECORD RINGS
+//-----------------------------------------------------------------------------------------------
+static const size_t LOG_BUFFER_BYTES = 128 KB;
+static const size_t MAX_LOG_RECORD_BYTES = LOG_BUFFER_BYTES / 8;
+static const int MAX_LOG_SITES = 4096;
+static const int MAX_LOG_THREAD_NAME_LENGTH = 32;
+static const int MESSAGE_MAX_LENGTH = 1024;
+static const size_t WRITE_BUFFER_FLUSH_BYTES = 256 KB;
+
+//Site IDs start at 1.  Text records hold an already formatted message
+static const uint32_t TEXT_RECORD_ID = 0;
+static const uint32_t WRAP_RECORD_ID = 0xFFFFFFFF;
+
+
+//-----------------------------------------------------------------------------------------------
+struct LogRecordHeader
+{
+	uint32_t siteID;
+	uint32_t numBytes;
+	uint64_t timestamp;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Single producer (the owning thread), single consumer (the logger thread).  Positions only ever
+//grow; a record never straddles the end, so the producer pads to the start when it has to.
+//The two sides are padded apart rather than alignas'd, since buffers are allocated with new
+struct LogThreadBuffer
+{
+	uint8_t bytes[LOG_BUFFER_BYTES];
+	char producerPadding[64];
+	std::atomic<uint64_t> writePos;
+	uint64_t pendingWritePos;
+	uint64_t cachedReadPos;
+	char consumerPadding[64];
+	std::atomic<uint64_t> readPos;
+	std::atomic<uint64_t> numDropped;
+	char threadName[MAX_LOG_THREAD_NAME_LENGTH];
+	LogThreadBuffer* next;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic<LogThreadBuffer*> s_logBuffers(nullptr);
+static std::atomic<int> s_numLogBuffers(0);
+static thread_local LogThreadBuffer* t_logBuffer = nullptr;
+
+static LogSite* s_logSites[MAX_LOG_SITES];
+static uint32_t s_numLogSites = 0;
+static SpinLock s_logSiteLock;
+
+
+//-----------------------------------------------------------------------------------------------
+static void WakeLogWriter();
+
+
+//-----------------------------------------------------------------------------------------------
+static LogThreadBuffer* RegisterLogThread()
+{
+	ScopedMemoryTag memoryTag(MEMTAG_LOGGING);
+	LogThreadBuffer* result = new LogThreadBuffer;
+	result->writePos.store(0, std::memory_order_relaxed);
+	result->pendingWritePos = 0;
+	result->cachedReadPos = 0;
+	result->readPos.store(0, std::memory_order_relaxed);
+	result->numDropped.store(0, std::memory_order_relaxed);
+
+	int bufferIndex = s_numLogBuffers.fetch_add(1, std::memory_order_relaxed);
+	const char* threadName = Platform::GetCurrentThreadName();
+	if (threadName[0] != '\0')
+	{
+		strncpy(result->threadName, threadName, MAX_LOG_THREAD_NAME_LENGTH - 1);
+		result->threadName[MAX_LOG_THREAD_NAME_LENGTH - 1] = '\0';
+	}
+	else
+	{
+		snprintf(result->threadName, MAX_LOG_THREAD_NAME_LENGTH, "Thread %i", bufferIndex);
+	}
+
+	result->next = s_logBuffers.load(std::memory_order_relaxed);
+	while (!s_logBuffers.compare_exchange_weak(result->next, result, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+
+	t_logBuffer = result;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint32_t Logger::RegisterSite(LogSite& site, const ELogArgType* argTypes, int numArgs)
+{
+	SpinLockGuard guard(&s_logSiteLock);
+
+	//Another thread may have gotten here first
+	uint32_t siteID = site.id.load(std::memory_order_relaxed);
+	if (siteID != 0)
+	{
+		return siteID;
+	}
+
+	ASSERT_OR_DIE(s_numLogSites < MAX_LOG_SITES - 1, "Too many binary log sites!");
+	siteID = ++s_numLogSites;
+	site.argTypes = argTypes;
+	site.numArgs = numArgs;
+	s_logSites[siteID] = &site;
+	site.id.store(siteID, std::memory_order_release);
+	return siteID;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Returns where the arguments go, or nullptr if the record was dropped because the ring is full
+uint8_t* Logger::BeginRecord(uint32_t siteID, size_t numArgBytes)
+{
+	LogThreadBuffer* buffer = t_logBuffer ? t_logBuffer : RegisterLogThread();
+
+	size_t numBytes = sizeof(LogRecordHeader) + ((numArgBytes + 7) & ~(size_t)7);
+	if (numBytes > MAX_LOG_RECORD_BYTES)
+	{
+		buffer->numDropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	uint64_t writePos = buffer->writePos.load(std::memory_order_relaxed);
+	size_t offset = (size_t)(writePos & (LOG_BUFFER_BYTES - 1));
+	size_t numPaddingBytes = (offset + numBytes > LOG_BUFFER_BYTES) ? LOG_BUFFER_BYTES - offset : 0;
+	uint64_t endPos = writePos + numPaddingBytes + numBytes;
+
+	if (endPos - buffer->cachedReadPos > LOG_BUFFER_BYTES)
+	{
+		buffer->cachedReadPos = buffer->readPos.load(std::memory_order_acquire);
+		if (endPos - buffer->cachedReadPos > LOG_BUFFER_BYTES)
+		{
+			buffer->numDropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+	}
+
+	//Past half full, don't leave it to the writer's next timed wake
+	if (endPos - buffer->cachedReadPos > LOG_BUFFER_BYTES / 2)
+	{
+		buffer->cachedReadPos = buffer->readPos.load(std::memory_order_acquire);
+		if (endPos - buffer->cachedReadPos > LOG_BUFFER_BYTES / 2)
+		{
+			WakeLogWriter();
+		}
+	}
+
+	//Padding too small for a header is skipped by the reader on its own
+	if (numPaddingBytes >= sizeof(LogRecordHeader))
+	{
+		LogRecordHeader* wrapHeader = (LogRecordHeader*)&buffer->bytes[offset];
+		wrapHeader->siteID = WRAP_RECORD_ID;
+		wrapHeader->numBytes = (uint32_t)numPaddingBytes;
+		wrapHeader->timestamp = 0;
+	}
+
+	LogRecordHeader* header = (LogRecordHeader*)&buffer->bytes[(offset + numPaddingBytes) & (LOG_BUFFER_BYTES - 1)];
+	header->siteID = siteID;
+	header->numBytes = (uint32_t)numBytes;
+	header->timestamp = Platform::GetTimestampCounter();
+
+	buffer->pendingWritePos = endPos;
+	return (uint8_t*)(header + 1);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Logger::CommitRecord()
 {
-	const int MESSAGE_MAX_LENGTH = 1024;
+	t_logBuffer->writePos.store(t_logBuffer->pendingWritePos, std::memory_order_release);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static int FormatLogPrefix(char* destination, size_t destinationSize, int warningLevel, const char* tag)
+{
+	int length = 0;
+	if (warningLevel >= 0 && tag)
+	{
+		length = snprintf(destination, destinationSize, "[W%i] %s: ", warningLevel, tag);
+	}
+	else if (warningLevel >= 0)
+	{
+		length = snprintf(destination, destinationSize, "[W%i] ", warningLevel);
+	}
+	else if (tag)
+	{
+		length = snprintf(destination, destinationSize, "%s: ", tag);
+	}
+	else
+	{
+		destination[0] = '\0';
+	}
+	return (length < (int)destinationSize) ? length : (int)destinationSize - 1;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Logger::Printvf(int warningLevel, const char* tag, const char* format, va_list& vargs)
+{
+	if (!s_isRunning.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
 	char message[MESSAGE_MAX_LENGTH];
-	vsnprintf_s(message, MESSAGE_MAX_LENGTH, format, vargs);
+	int prefixLength = FormatLogPrefix(message, MESSAGE_MAX_LENGTH, warningLevel, tag);
+	vsnprintf(message + prefixLength, MESSAGE_MAX_LENGTH - prefixLength, format, vargs);
 	message[MESSAGE_MAX_LENGTH - 1] = '\0';
-	s_messageQueue.Enqueue(message);
+
+	uint8_t* cursor = BeginRecord(TEXT_RECORD_ID, LogStringArgTraits::GetSize(message));
+	if (cursor)
+	{
+		LogStringArgTraits::Write(cursor, message);
+		CommitRecord();
+	}
 }
 
 
@@ -33,7 +252,7 @@ void Logger::Printf(const char* format, ...)
 {
 	va_list vargs;
 	va_start(vargs, format);
-	Printvf(format, vargs);
+	Printvf(-1, nullptr, format, vargs);
 	va_end(vargs);
 }
 
@@ -41,10 +260,9 @@ void Logger::Printf(const char* format, ...)
 //-----------------------------------------------------------------------------------------------
 void Logger::Printf(EWarningLevel warningLevel, const char* format, ...)
 {
-	std::string newFormat = Stringf("[W%i] %s", warningLevel, format);
 	va_list vargs;
 	va_start(vargs, format);
-	Printvf(newFormat.c_str(), vargs);
+	Printvf(warningLevel, nullptr, format, vargs);
 	va_end(vargs);
 }
 
@@ -52,10 +270,9 @@ void Logger::Printf(EWarningLevel warningLevel, const char* format, ...)
 //-----------------------------------------------------------------------------------------------
 void Logger::TagPrintf(const char* tag, const char* format, ...)
 {
-	std::string newFormat = Stringf("%s: %s", tag, format);
 	va_list vargs;
 	va_start(vargs, format);
-	Printvf(newFormat.c_str(), vargs);
+	Printvf(-1, tag, format, vargs);
 	va_end(vargs);
 }
 
@@ -63,92 +280,184 @@ void Logger::TagPrintf(const char* tag, const char* format, ...)
 //-----------------------------------------------------------------------------------------------
 void Logger::TagPrintf(EWarningLevel warningLevel, const char* tag, const char* format, ...)
 {
-	std::string newFormat = Stringf("[W%i] %s: %s", warningLevel, tag, format);
 	va_list vargs;
 	va_start(vargs, format);
-	Printvf(newFormat.c_str(), vargs);
+	Printvf(warningLevel, tag, format, vargs);
 	va_end(vargs);
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void Logger::Flush()
+// WRITER THREAD HANDSHAKES
+//-----------------------------------------------------------------------------------------------
+static const int WRITER_SLEEP_MILLISECONDS = 10;
+
+
+//-----------------------------------------------------------------------------------------------
+static std::mutex s_writerMutex;
+static std::condition_variable s_writerWakeCV;
+static std::condition_variable s_flushedCV;
+static std::atomic<bool> s_isWriterWakeRequested(false);
+static std::atomic<uint64_t> s_numFlushesRequested(0);
+static uint64_t s_numFlushesCompleted = 0;
+
+//Guarded by s_writerMutex
+static uint64_t s_rotateAtBytes = 0;
+static double s_rotateAfterSeconds = 0.;
+
+
+//-----------------------------------------------------------------------------------------------
+//Producers don't take the mutex to ask, so a wake can be missed; the writer's timed sleep covers it
+static void WakeLogWriter()
 {
-	for (;;)
+	if (!s_isWriterWakeRequested.load(std::memory_order_relaxed) && !s_isWriterWakeRequested.exchange(true, std::memory_order_acq_rel))
 	{
-		//Don't want to pump too often
-		std::this_thread::yield();
-		//Scope lock so I don't repeat myself
-		CriticalSectionGuard csg(&s_flushRequestCS);
-		if (!s_hasFlushed && !s_needsFlush)
-		{
-			s_needsFlush = true;
-			break;
-		}
+		s_writerWakeCV.notify_one();
 	}
+}
 
-	for (;;)
+
+//-----------------------------------------------------------------------------------------------
+uint64_t Logger::RequestFlush()
+{
+	uint64_t flushTicket;
 	{
-		std::this_thread::yield();
-		CriticalSectionGuard csg(&s_flushRequestCS);
-		if (s_hasFlushed)
-		{
-			s_hasFlushed = false;
-			break;
-		}
+		std::lock_guard<std::mutex> lock(s_writerMutex);
+		flushTicket = s_numFlushesRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
+		s_isWriterWakeRequested.store(true, std::memory_order_relaxed);
 	}
+	s_writerWakeCV.notify_one();
+	return flushTicket;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-static std::string GetLogName(const std::string& logPrefix)
+void Logger::WaitForFlush(uint64_t flushTicket)
 {
-	time_t currTime = time(NULL);
-	tm currTimeStruct;
-	localtime_s(&currTimeStruct, &currTime);
+	std::unique_lock<std::mutex> lock(s_writerMutex);
+	s_flushedCV.wait(lock, [flushTicket]() { return s_numFlushesCompleted >= flushTicket; });
+}
+
 
-	std::string logName = "Data/Logs/" + logPrefix + "_";
-	logName += std::to_string(currTimeStruct.tm_year + 1900);
-	if (currTimeStruct.tm_mon < 10)
+//-----------------------------------------------------------------------------------------------
+void Logger::Flush()
+{
+	if (!s_isRunning.load(std::memory_order_relaxed))
 	{
-		logName.push_back('0');
+		return;
 	}
-	logName += std::to_string(currTimeStruct.tm_mon);
-	if (currTimeStruct.tm_mday < 10)
+	WaitForFlush(RequestFlush());
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Logger::SetRotation(uint64_t maxFileBytes, double maxFileSeconds)
+{
+	std::lock_guard<std::mutex> lock(s_writerMutex);
+	s_rotateAtBytes = maxFileBytes;
+	s_rotateAfterSeconds = maxFileSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// LOG FILES
+//-----------------------------------------------------------------------------------------------
+static FILE* OpenLogFile(const std::string& fileName, const char* mode)
+{
+	FILE* result = nullptr;
+#if defined(PLATFORM_WINDOWS)
+	fopen_s(&result, fileName.c_str(), mode);
+#else
+	result = fopen(fileName.c_str(), mode);
+#endif
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static std::string GetLivePath(const std::string& logPrefix)
+{
+	return "Data/Logs/" + logPrefix + ".log";
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool GetFileModifiedTime(const std::string& filePath, time_t* outModifiedTime)
+{
+#if defined(PLATFORM_WINDOWS)
+	struct _stat64 fileInfo;
+	if (_stat64(filePath.c_str(), &fileInfo) != 0)
+#else
+	struct stat fileInfo;
+	if (stat(filePath.c_str(), &fileInfo) != 0)
+#endif
 	{
-		logName.push_back('0');
+		return false;
 	}
-	logName += std::to_string(currTimeStruct.tm_mday);
-	logName += "_";
-	if (currTimeStruct.tm_hour < 10)
+	*outModifiedTime = (time_t)fileInfo.st_mtime;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static std::string GetArchivePath(const std::string& logPrefix, time_t closeTime)
+{
+	tm timeStruct;
+#if defined(PLATFORM_WINDOWS)
+	localtime_s(&timeStruct, &closeTime);
+#else
+	localtime_r(&closeTime, &timeStruct);
+#endif
+
+	std::string archivePath = Stringf("Data/Logs/%s_%04i%02i%02i_%02i%02i%02i", logPrefix.c_str(), timeStruct.tm_year + 1900, timeStruct.tm_mon + 1,
+		timeStruct.tm_mday, timeStruct.tm_hour, timeStruct.tm_min, timeStruct.tm_sec);
+
+	//Several rotations can happen in one second
+	time_t unused;
+	std::string result = archivePath + ".log";
+	for (int suffix = 2; GetFileModifiedTime(result, &unused); suffix++)
 	{
-		logName.push_back('0');
+		result = Stringf("%s_%i.log", archivePath.c_str(), suffix);
 	}
-	logName += std::to_string(currTimeStruct.tm_hour);
-	if (currTimeStruct.tm_min < 10)
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//The live file is always Data/Logs/<prefix>.log.  Older ones are renamed after the time they were
+//last written to, which costs the same however big they got
+static void ArchiveLiveLogFile(const std::string& logPrefix)
+{
+	std::string livePath = GetLivePath(logPrefix);
+	time_t modifiedTime;
+	if (GetFileModifiedTime(livePath, &modifiedTime))
 	{
-		logName.push_back('0');
+		rename(livePath.c_str(), GetArchivePath(logPrefix, modifiedTime).c_str());
 	}
-	logName += std::to_string(currTimeStruct.tm_min);
-	if (currTimeStruct.tm_sec < 10)
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Writes go out in big batches, so stdio buffering would only add a copy
+static FILE* OpenLiveLogFile(const std::string& logPrefix)
+{
+	ArchiveLiveLogFile(logPrefix);
+	FILE* result = OpenLogFile(GetLivePath(logPrefix), "wb");
+	if (result)
 	{
-		logName.push_back('0');
+		setvbuf(result, nullptr, _IONBF, 0);
 	}
-	logName += std::to_string(currTimeStruct.tm_sec);
-	logName += ".log";
-
-	return logName;
+	return result;
 }
 
+
 //-----------------------------------------------------------------------------------------------
 void Logger::StartLogging(const std::string& logPrefix)
 {
 	s_logName = logPrefix;
+	s_file = OpenLiveLogFile(logPrefix);
+	ASSERT_OR_DIE(s_file, Stringf("Couldn't open the log file for %s!", logPrefix.c_str()));
 
-	std::string logName = GetLogName(logPrefix);
-
-
-	fopen_s(&s_file, logName.c_str(), "w+");
 	s_isRunning = true;
 	s_slaveLogger = std::thread(SlavePumpLogging);
 }
@@ -158,58 +467,484 @@ void Logger::StartLogging(const std::string& logPrefix)
 void Logger::StopLogging()
 {
 	s_isRunning = false;
-
+	WakeLogWriter();
 	s_slaveLogger.join();
 
-	fflush(s_file);
-	unsigned int length = ftell(s_file);
-	rewind(s_file);
-	FILE* copyFile;
-	fopen_s(&copyFile, ("Data/Logs/" + s_logName + ".log").c_str(), "w");
-	void* buffer = new unsigned char[length];
-	fread(buffer, 1, length, s_file);
-	//Why -6?  I don't know.  But it was copying 6 grave accent Is to the copy file
-	fwrite(buffer, 1, length - 6, copyFile);
 	fclose(s_file);
-	fclose(copyFile);
-	delete[] buffer;
-	s_messageQueue.clear();
+	s_file = nullptr;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void Logger::SlavePumpLogging()
+// DEFERRED FORMATTING (logger thread only)
+//-----------------------------------------------------------------------------------------------
+struct LogFormatPiece
+{
+	std::string literal;
+
+	//Flags, width and precision of the conversion that follows the literal, without its length
+	//modifier.  No conversion means this is the trailing literal
+	std::string spec;
+	char conversion;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct LogDrainCursor
+{
+	LogThreadBuffer* buffer;
+	uint64_t readPos;
+	uint64_t endPos;
+	const LogRecordHeader* nextRecord;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::vector<std::vector<LogFormatPiece>> s_parsedFormats;
+static std::vector<LogDrainCursor> s_drainCursors;
+static std::string s_writeBuffer;
+static std::string s_specScratch;
+
+
+//-----------------------------------------------------------------------------------------------
+static std::vector<LogFormatPiece> ParseLogFormat(const char* format)
 {
-	std::string currMessage;
-	while (s_isRunning)
+	std::vector<LogFormatPiece> result;
+	LogFormatPiece piece;
+	piece.conversion = '\0';
+
+	const char* currChar = format;
+	while (*currChar)
 	{
-		while (s_messageQueue.Dequeue(&currMessage))
+		if (*currChar != '%')
 		{
-			//First, pump existing messages
-			fprintf(s_file, currMessage.c_str());
+			piece.literal.push_back(*currChar++);
+			continue;
 		}
-		s_flushRequestCS.Enter();
-		if (s_needsFlush)
+		if (currChar[1] == '%')
+		{
+			piece.literal.push_back('%');
+			currChar += 2;
+			continue;
+		}
+
+		const char* specStart = currChar++;
+		while (*currChar && strchr("-+ #0123456789.*", *currChar))
 		{
-			s_flushRequestCS.Leave();
-			while (s_messageQueue.Dequeue(&currMessage))
+			//'*' would read a width from the arguments, which aren't there to read
+			if (*currChar != '*')
 			{
-				//Pump any messages in queue before flushing
-				fprintf(s_file, currMessage.c_str());
+				piece.spec.push_back(*currChar);
 			}
-			fflush(s_file);
-			s_flushRequestCS.Enter();
-			s_needsFlush = false;
-			s_hasFlushed = true;
+			currChar++;
+		}
+		while (*currChar && strchr("hljztLI", *currChar))
+		{
+			currChar++;
+		}
+		if (!*currChar)
+		{
+			piece.literal += specStart;
+			piece.spec.clear();
+			break;
 		}
-		s_flushRequestCS.Leave();
 
-		std::this_thread::yield();
+		piece.spec.insert(piece.spec.begin(), '%');
+		piece.conversion = *currChar++;
+		result.push_back(piece);
+		piece = LogFormatPiece();
+		piece.conversion = '\0';
 	}
 
-	while (s_messageQueue.Dequeue(&currMessage))
+	if (!piece.literal.empty())
 	{
-		//One last flush of message queue
-		fprintf(s_file, currMessage.c_str());
+		result.push_back(piece);
 	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static const std::vector<LogFormatPiece>& GetParsedFormat(uint32_t siteID)
+{
+	if (siteID >= s_parsedFormats.size())
+	{
+		s_parsedFormats.resize(siteID + 1);
+	}
+	if (s_parsedFormats[siteID].empty())
+	{
+		s_parsedFormats[siteID] = ParseLogFormat(s_logSites[siteID]->format);
+	}
+	return s_parsedFormats[siteID];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AppendSnprintf(std::string& out, const char* format, ...)
+{
+	char buffer[MESSAGE_MAX_LENGTH];
+	va_list vargs;
+	va_start(vargs, format);
+	int length = vsnprintf(buffer, MESSAGE_MAX_LENGTH, format, vargs);
+	va_end(vargs);
+
+	if (length > 0)
+	{
+		out.append(buffer, (length < MESSAGE_MAX_LENGTH) ? length : MESSAGE_MAX_LENGTH - 1);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//The argument's recorded type wins over the conversion, so a mismatched format can't read garbage
+static void AppendLogArg(std::string& out, const LogFormatPiece& piece, ELogArgType argType, const uint8_t*& cursor)
+{
+	bool isIntegerConversion = strchr("diouxX", piece.conversion) != nullptr;
+	bool isFloatConversion = strchr("eEfFgGaA", piece.conversion) != nullptr;
+	bool isSignedConversion = (piece.conversion == 'd' || piece.conversion == 'i');
+
+	if (argType == LOG_ARG_STRING)
+	{
+		uint64_t length;
+		memcpy(&length, cursor, sizeof(length));
+		char str[MAX_LOG_STRING_ARG_LENGTH + 1];
+		memcpy(str, cursor + sizeof(length), (size_t)length);
+		str[length] = '\0';
+		cursor += (sizeof(length) + (size_t)length + 7) & ~(size_t)7;
+
+		s_specScratch = (piece.conversion == 's') ? piece.spec : "%";
+		s_specScratch.push_back('s');
+		AppendSnprintf(out, s_specScratch.c_str(), str);
+		return;
+	}
+
+	uint64_t bits;
+	memcpy(&bits, cursor, sizeof(bits));
+	cursor += sizeof(bits);
+
+	double doubleValue;
+	memcpy(&doubleValue, &bits, sizeof(doubleValue));
+	if (argType == LOG_ARG_INT64)
+	{
+		doubleValue = (double)(int64_t)bits;
+	}
+	else if (argType == LOG_ARG_UINT64 || argType == LOG_ARG_POINTER)
+	{
+		doubleValue = (double)bits;
+	}
+	else
+	{
+		bits = (uint64_t)(int64_t)doubleValue;
+	}
+
+	s_specScratch = piece.spec;
+	if (argType == LOG_ARG_POINTER && piece.conversion == 'p')
+	{
+		s_specScratch.push_back('p');
+		AppendSnprintf(out, s_specScratch.c_str(), (void*)(uintptr_t)bits);
+	}
+	else if (argType != LOG_ARG_DOUBLE && piece.conversion == 'c')
+	{
+		s_specScratch.push_back('c');
+		AppendSnprintf(out, s_specScratch.c_str(), (int)bits);
+	}
+	else if (isFloatConversion)
+	{
+		s_specScratch.push_back(piece.conversion);
+		AppendSnprintf(out, s_specScratch.c_str(), doubleValue);
+	}
+	else if (isIntegerConversion)
+	{
+		s_specScratch += "ll";
+		s_specScratch.push_back(piece.conversion);
+		if (isSignedConversion)
+		{
+			AppendSnprintf(out, s_specScratch.c_str(), (long long)bits);
+		}
+		else
+		{
+			AppendSnprintf(out, s_specScratch.c_str(), (unsigned long long)bits);
+		}
+	}
+	else if (argType == LOG_ARG_DOUBLE)
+	{
+		AppendSnprintf(out, "%g", doubleValue);
+	}
+	else if (argType == LOG_ARG_POINTER)
+	{
+		AppendSnprintf(out, "%p", (void*)(uintptr_t)bits);
+	}
+	else
+	{
+		AppendSnprintf(out, (argType == LOG_ARG_INT64) ? "%lld" : "%llu", bits);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AppendRecordText(std::string& out, const LogRecordHeader& header)
+{
+	const uint8_t* cursor = (const uint8_t*)(&header + 1);
+
+	if (header.siteID == TEXT_RECORD_ID)
+	{
+		uint64_t length;
+		memcpy(&length, cursor, sizeof(length));
+		out.append((const char*)cursor + sizeof(length), (size_t)length);
+		return;
+	}
+
+	const LogSite* site = s_logSites[header.siteID];
+	char prefix[MESSAGE_MAX_LENGTH];
+	out.append(prefix, FormatLogPrefix(prefix, MESSAGE_MAX_LENGTH, site->warningLevel, site->tag));
+
+	int argIndex = 0;
+	for (const LogFormatPiece& piece : GetParsedFormat(header.siteID))
+	{
+		out += piece.literal;
+		if (piece.conversion == '\0')
+		{
+			continue;
+		}
+
+		if (argIndex < site->numArgs)
+		{
+			AppendLogArg(out, piece, site->argTypes[argIndex++], cursor);
+		}
+		else
+		{
+			out += piece.spec;
+			out.push_back(piece.conversion);
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Steps over wrap padding, then points at the next unread record if there is one
+static void PeekNextRecord(LogDrainCursor& cursor)
+{
+	cursor.nextRecord = nullptr;
+	while (cursor.readPos < cursor.endPos)
+	{
+		size_t offset = (size_t)(cursor.readPos & (LOG_BUFFER_BYTES - 1));
+		if (LOG_BUFFER_BYTES - offset < sizeof(LogRecordHeader))
+		{
+			cursor.readPos += LOG_BUFFER_BYTES - offset;
+			continue;
+		}
+
+		const LogRecordHeader* header = (const LogRecordHeader*)&cursor.buffer->bytes[offset];
+		if (header->siteID == WRAP_RECORD_ID)
+		{
+			cursor.readPos += header->numBytes;
+			continue;
+		}
+
+		cursor.nextRecord = header;
+		return;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Merges every thread's records by timestamp, so the file reads in the order things happened
+static size_t DrainLogBuffers(FILE* file)
+{
+	size_t numBytesWritten = 0;
+	s_drainCursors.clear();
+	for (LogThreadBuffer* buffer = s_logBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+	{
+		LogDrainCursor cursor;
+		cursor.buffer = buffer;
+		cursor.readPos = buffer->readPos.load(std::memory_order_relaxed);
+		cursor.endPos = buffer->writePos.load(std::memory_order_acquire);
+		PeekNextRecord(cursor);
+		s_drainCursors.push_back(cursor);
+	}
+
+	for (;;)
+	{
+		LogDrainCursor* earliest = nullptr;
+		for (LogDrainCursor& cursor : s_drainCursors)
+		{
+			if (cursor.nextRecord && (!earliest || cursor.nextRecord->timestamp < earliest->nextRecord->timestamp))
+			{
+				earliest = &cursor;
+			}
+		}
+		if (!earliest)
+		{
+			break;
+		}
+
+		AppendRecordText(s_writeBuffer, *earliest->nextRecord);
+		earliest->readPos += earliest->nextRecord->numBytes;
+		earliest->buffer->readPos.store(earliest->readPos, std::memory_order_release);
+		PeekNextRecord(*earliest);
+
+		if (s_writeBuffer.size() >= WRITE_BUFFER_FLUSH_BYTES)
+		{
+			numBytesWritten += fwrite(s_writeBuffer.data(), 1, s_writeBuffer.size(), file);
+			s_writeBuffer.clear();
+		}
+	}
+
+	for (LogDrainCursor& cursor : s_drainCursors)
+	{
+		cursor.buffer->readPos.store(cursor.readPos, std::memory_order_release);
+		uint64_t numDropped = cursor.buffer->numDropped.exchange(0, std::memory_order_relaxed);
+		if (numDropped > 0)
+		{
+			AppendSnprintf(s_writeBuffer, "[W%i] Logger: dropped %llu records from %s\n", WARNING_MAJOR, (unsigned long long)numDropped, cursor.buffer->threadName);
+		}
+	}
+
+	if (!s_writeBuffer.empty())
+	{
+		numBytesWritten += fwrite(s_writeBuffer.data(), 1, s_writeBuffer.size(), file);
+		s_writeBuffer.clear();
+	}
+	return numBytesWritten;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Logger::SlavePumpLogging()
+{
+	Platform::SetCurrentThreadName("Logger");
+	MemoryTracker::SetThreadTag(MEMTAG_LOGGING);
+
+	s_writeBuffer.reserve(WRITE_BUFFER_FLUSH_BYTES + MESSAGE_MAX_LENGTH * 2);
+	uint64_t numFileBytes = 0;
+	double fileOpenSeconds = GetCurrentTimeSeconds();
+	uint64_t numFlushesCompleted = 0;
+	uint64_t rotateAtBytes = 0;
+	double rotateAfterSeconds = 0.;
+
+	for (;;)
+	{
+		//Read before draining, so everything logged before the request is in this pass
+		uint64_t numFlushesRequested = s_numFlushesRequested.load(std::memory_order_acquire);
+		bool isRunning = s_isRunning.load(std::memory_order_acquire);
+
+		numFileBytes += DrainLogBuffers(s_file);
+
+		//Rotation only ever happens between batches, so a record is never split across files
+		double currentSeconds = GetCurrentTimeSeconds();
+		bool isTooBig = (rotateAtBytes > 0 && numFileBytes >= rotateAtBytes);
+		bool isTooOld = (rotateAfterSeconds > 0. && currentSeconds - fileOpenSeconds >= rotateAfterSeconds && numFileBytes > 0);
+		if (isRunning && (isTooBig || isTooOld))
+		{
+			fclose(s_file);
+			s_file = OpenLiveLogFile(s_logName);
+			ASSERT_OR_DIE(s_file, "Couldn't reopen the log file after rotating!");
+			numFileBytes = 0;
+			fileOpenSeconds = currentSeconds;
+		}
+
+		std::unique_lock<std::mutex> lock(s_writerMutex);
+		if (numFlushesRequested > numFlushesCompleted)
+		{
+			numFlushesCompleted = numFlushesRequested;
+			s_numFlushesCompleted = numFlushesCompleted;
+			s_flushedCV.notify_all();
+		}
+		if (!isRunning)
+		{
+			//Nobody waiting on a flush should outlive the writer
+			s_numFlushesCompleted = s_numFlushesRequested.load(std::memory_order_relaxed);
+			s_flushedCV.notify_all();
+			break;
+		}
+
+		rotateAtBytes = s_rotateAtBytes;
+		rotateAfterSeconds = s_rotateAfterSeconds;
+		s_writerWakeCV.wait_for(lock, std::chrono::milliseconds(WRITER_SLEEP_MILLISECONDS), []() { return s_isWriterWakeRequested.load(std::memory_order_relaxed); });
+		s_isWriterWakeRequested.store(false, std::memory_order_relaxed);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(LogRotation, args)
+{
+	double maxMegabytes = 0.;
+	double maxMinutes = 0.;
+
+	try
+	{
+		maxMegabytes = std::stod(args.GetNextArg());
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			maxMinutes = std::stod(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: logrotation <maxMegabytes> [maxMinutes] (0 turns a limit off)", RED);
+		return;
+	}
+
+	Logger::SetRotation((uint64_t)(maxMegabytes * 1024. * 1024.), maxMinutes * 60.);
+	ConsolePrintf(WHITE, "Log files rotate at %.1fMB and after %.1f minutes (0 is never)", maxMegabytes, maxMinutes);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static const int LOG_BENCHMARK_CALLS_PER_BATCH = 1000;
+
+
+//-----------------------------------------------------------------------------------------------
+//Batches are small enough for a ring to hold, and flushed between, so drops don't flatter the numbers
+CONSOLE_COMMAND(LogBenchmark, args)
+{
+	int numBatches = 20;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numBatches = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: logbenchmark [numBatches]", RED);
+		return;
+	}
+
+	if (!Logger::IsLogging())
+	{
+		ConsolePrint("Logger isn't running", RED);
+		return;
+	}
+
+	std::string frameName = "snapshot";
+	double binarySeconds = 0.;
+	double textSeconds = 0.;
+	for (int batch = 0; batch < numBatches; batch++)
+	{
+		double startSeconds = GetCurrentTimeSeconds();
+		for (int i = 0; i < LOG_BENCHMARK_CALLS_PER_BATCH; i++)
+		{
+			BINARY_TAG_LOG(WARNING_NEGLIGIBLE, "LogBenchmark", "Sent %s %i to connection %u in %.3fms\n", frameName, i, batch, 0.25);
+		}
+		binarySeconds += GetCurrentTimeSeconds() - startSeconds;
+		Logger::Flush();
+
+		startSeconds = GetCurrentTimeSeconds();
+		for (int i = 0; i < LOG_BENCHMARK_CALLS_PER_BATCH; i++)
+		{
+			Logger::TagPrintf(WARNING_NEGLIGIBLE, "LogBenchmark", "Sent %s %i to connection %u in %.3fms\n", frameName.c_str(), i, batch, 0.25);
+		}
+		textSeconds += GetCurrentTimeSeconds() - startSeconds;
+		Logger::Flush();
+	}
+
+	double numCalls = (double)numBatches * (double)LOG_BENCHMARK_CALLS_PER_BATCH;
+	ConsolePrintf(WHITE, "BINARY_TAG_LOG: %.1fns per call", binarySeconds * 1.e9 / numCalls);
+	ConsolePrintf(WHITE, "Logger::TagPrintf: %.1fns per call", textSeconds * 1.e9 / numCalls);
 }
\ No newline at end of file
@@ -1,11 +1,14 @@
 #pragma once
 
-#include "Engine/Memory/ThreadSafeSTL.hpp"
-
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include <string>
 #include <thread>
 #include <tuple>
 #include <atomic>
+#include <type_traits>
 
 
 //-----------------------------------------------------------------------------------------------
@@ -18,6 +21,35 @@ enum EWarningLevel
 };
 
 
+//-----------------------------------------------------------------------------------------------
+enum ELogArgType : uint8_t
+{
+	LOG_ARG_NONE,
+	LOG_ARG_INT64,
+	LOG_ARG_UINT64,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_POINTER,
+	LOG_ARG_STRING
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//One per BINARY_LOG call site, with static storage.  The ID is handed out the first time the site
+//logs, and records carry only that ID and the raw arguments
+struct LogSite
+{
+	constexpr LogSite(const char* siteFormat, const char* siteTag, int siteWarningLevel)
+		: format(siteFormat), tag(siteTag), warningLevel(siteWarningLevel), argTypes(nullptr), numArgs(0), id(0) {}
+
+	const char* format;
+	const char* tag;
+	int warningLevel;
+	const ELogArgType* argTypes;
+	int numArgs;
+	std::atomic<uint32_t> id;
+};
+
+
 //-----------------------------------------------------------------------------------------------
 class Logger
 {
@@ -30,15 +62,152 @@ public:
 	static void StopLogging();
 	static void Flush();
 
+	//Flush without waiting, then wait on the ticket later (or never)
+	static uint64_t RequestFlush();
+	static void WaitForFlush(uint64_t flushTicket);
+
+	//The live file is renamed aside and a new one started once it reaches either limit.  0 turns a limit off
+	static void SetRotation(uint64_t maxFileBytes, double maxFileSeconds);
+	static bool IsLogging() { return s_isRunning.load(std::memory_order_relaxed); }
+
+	//Use through BINARY_LOG.  Only copies the arguments; the logger thread does the formatting
+	template<typename... Args>
+	static void BinaryPrintf(LogSite& site, const Args&... args);
+
 private:
 	static void SlavePumpLogging();
-	static void Printvf(const char* format, va_list& vargs);
-	static ThreadSafeQueue<std::string> s_messageQueue;
+	static void Printvf(int warningLevel, const char* tag, const char* format, va_list& vargs);
+	static uint32_t RegisterSite(LogSite& site, const ELogArgType* argTypes, int numArgs);
+	static uint8_t* BeginRecord(uint32_t siteID, size_t numArgBytes);
+	static void CommitRecord();
 	static FILE* s_file;
 	static std::string s_logName;
 	static std::thread s_slaveLogger;
-	static bool s_isRunning;
-	static CriticalSection s_flushRequestCS;
-	static bool s_needsFlush;
-	static bool s_hasFlushed;
-};
\ No newline at end of file
+	static std::atomic<bool> s_isRunning;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Binary logging.  Format strings must be string literals, since only their site is recorded.
+// Integers (of any size), enums, floats, pointers, C strings and std::strings are accepted;
+// integer conversions may use any length modifier, the logger thread widens them to match.
+//-----------------------------------------------------------------------------------------------
+#define BINARY_LOG(format, ...) \
+	do \
+	{ \
+		static LogSite s_logSite(format, nullptr, -1); \
+		Logger::BinaryPrintf(s_logSite, ##__VA_ARGS__); \
+	} while (0)
+
+#define BINARY_TAG_LOG(warningLevel, tag, format, ...) \
+	do \
+	{ \
+		static LogSite s_logSite(format, tag, (int)(warningLevel)); \
+		Logger::BinaryPrintf(s_logSite, ##__VA_ARGS__); \
+	} while (0)
+
+
+//-----------------------------------------------------------------------------------------------
+static const size_t MAX_LOG_STRING_ARG_LENGTH = 1023;
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+struct LogArgTraits
+{
+	static const ELogArgType TYPE = std::is_floating_point<T>::value ? LOG_ARG_DOUBLE
+		: std::is_pointer<T>::value ? LOG_ARG_POINTER
+		: (std::is_signed<T>::value || std::is_enum<T>::value) ? LOG_ARG_INT64
+		: LOG_ARG_UINT64;
+
+	static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value, "BINARY_LOG only takes numbers, pointers and strings");
+
+	static size_t GetSize(const T&) { return sizeof(uint64_t); }
+	static void Write(uint8_t*& cursor, const T& value)
+	{
+		typedef typename std::conditional<TYPE == LOG_ARG_DOUBLE, double, typename std::conditional<TYPE == LOG_ARG_INT64, int64_t, uint64_t>::type>::type WideType;
+		WideType wideValue = ToWide<WideType>(value, std::is_pointer<T>());
+		memcpy(cursor, &wideValue, sizeof(wideValue));
+		cursor += sizeof(wideValue);
+	}
+
+private:
+	template<typename WideType>
+	static WideType ToWide(const T& value, std::false_type) { return (WideType)value; }
+	template<typename WideType>
+	static WideType ToWide(const T& value, std::true_type) { return (WideType)(uintptr_t)value; }
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Strings go in as a length and the bytes, padded to keep the next argument 8-byte aligned
+struct LogStringArgTraits
+{
+	static const ELogArgType TYPE = LOG_ARG_STRING;
+
+	static size_t ClampLength(size_t length) { return (length < MAX_LOG_STRING_ARG_LENGTH) ? length : MAX_LOG_STRING_ARG_LENGTH; }
+	static size_t GetSizeForLength(size_t length) { return (sizeof(uint64_t) + ClampLength(length) + 7) & ~(size_t)7; }
+	static void WriteWithLength(uint8_t*& cursor, const char* str, size_t length)
+	{
+		uint64_t clampedLength = ClampLength(length);
+		memcpy(cursor, &clampedLength, sizeof(clampedLength));
+		memcpy(cursor + sizeof(clampedLength), str, (size_t)clampedLength);
+		cursor += GetSizeForLength(length);
+	}
+
+	static size_t GetSize(const char* str) { return GetSizeForLength(str ? strlen(str) : 0); }
+	static void Write(uint8_t*& cursor, const char* str) { WriteWithLength(cursor, str, str ? strlen(str) : 0); }
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template<> struct LogArgTraits<const char*> : LogStringArgTraits {};
+template<> struct LogArgTraits<char*> : LogStringArgTraits {};
+template<> struct LogArgTraits<std::string> : LogStringArgTraits
+{
+	static size_t GetSize(const std::string& str) { return GetSizeForLength(str.size()); }
+	static void Write(uint8_t*& cursor, const std::string& str) { WriteWithLength(cursor, str.data(), str.size()); }
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename... Args>
+const ELogArgType* GetLogArgTypes()
+{
+	static const ELogArgType s_argTypes[] = { LogArgTraits<typename std::decay<Args>::type>::TYPE..., LOG_ARG_NONE };
+	return s_argTypes;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename... Args>
+void Logger::BinaryPrintf(LogSite& site, const Args&... args)
+{
+	if (!s_isRunning.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	uint32_t siteID = site.id.load(std::memory_order_acquire);
+	if (siteID == 0)
+	{
+		siteID = RegisterSite(site, GetLogArgTypes<Args...>(), (int)sizeof...(Args));
+	}
+
+	size_t argSizes[] = { 0, LogArgTraits<typename std::decay<Args>::type>::GetSize(args)... };
+	size_t numArgBytes = 0;
+	for (size_t argSize : argSizes)
+	{
+		numArgBytes += argSize;
+	}
+
+	uint8_t* cursor = BeginRecord(siteID, numArgBytes);
+	if (!cursor)
+	{
+		return;
+	}
+
+	int writeAll[] = { 0, (LogArgTraits<typename std::decay<Args>::type>::Write(cursor, args), 0)... };
+	(void)writeAll;
+	CommitRecord();
+}
\ No newline at end of file
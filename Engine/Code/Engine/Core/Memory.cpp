@@ -1,139 +1,636 @@
 #include "Engine/Core/Memory.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
-#include "Engine/Core/callstack.h"
 #include "Engine/Core/Logger.hpp"
+#include "Engine/Core/Platform.hpp"
 #include "Engine/Core/Profiler.hpp"
 #include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+#if defined(PLATFORM_WINDOWS)
+#include "Engine/Core/callstack.h"
+#endif
 
-#include <map>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
 
 
 //-----------------------------------------------------------------------------------------------
-unsigned int g_numAllocations = 0;
-unsigned int g_totalAllocatedBytes = 0;
-unsigned int g_numStartupAllocations = 0;
-unsigned int g_totalAllocatedBytesStartup = 0;
-unsigned int g_currentHighwaterBytes = 0;
-unsigned int g_bytesAllocatedSinceLastUpdate = 0;
-unsigned int g_bytesFreedSinceLastUpdate = 0;
+// COUNTERS
+//	Each thread gets a block of counters only it writes, so bumping one is a plain load and store
+//	with no lock prefix.  Readers sum the blocks.  Threads past the first MAX_THREAD_COUNTER_BLOCKS
+//	share one last block and pay for a real atomic add.  Blocks aren't handed back when threads
+//	exit; their totals still count.
+//
+//	Everything in here is zero-initialized or constant-initialized, because operator new runs long
+//	before any dynamic initializer in this file would have
+//-----------------------------------------------------------------------------------------------
+static const int MAX_THREAD_COUNTER_BLOCKS = 64;
+static const int SHARED_COUNTER_BLOCK = MAX_THREAD_COUNTER_BLOCKS;
+static const int NUM_COUNTER_BLOCKS = MAX_THREAD_COUNTER_BLOCKS + 1;
 
 
 //-----------------------------------------------------------------------------------------------
-static UntrackedMap<void*, callstack_t*> g_callStackMap;
+struct alignas(64) CounterBlock
+{
+	std::atomic<uint64_t> numAllocations[NUM_MEMORY_TAGS];
+	std::atomic<uint64_t> numFrees[NUM_MEMORY_TAGS];
+	std::atomic<uint64_t> bytesAllocated[NUM_MEMORY_TAGS];
+	std::atomic<uint64_t> bytesFreed[NUM_MEMORY_TAGS];
+};
 
 
 //-----------------------------------------------------------------------------------------------
-void* operator new(size_t numBytes)
+static CounterBlock s_counterBlocks[NUM_COUNTER_BLOCKS];
+static std::atomic<int> s_nextCounterBlock(0);
+static std::atomic<uint64_t> s_highWaterBytes(0);
+
+static thread_local int s_threadCounterBlock = -1;
+static thread_local unsigned char s_threadTag = MEMTAG_UNTAGGED;
+
+#if defined(MEMORY_DETECTION_MODE) && MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
+static size_t CountLiveSamples();
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+static int GetThreadCounterBlockIndex()
 {
-	size_t* ptr = (size_t*)malloc(numBytes + sizeof(size_t));
-	//DebuggerPrintf("Alloc %p of %u bytes.\n", ptr, numBytes);
-	++g_numAllocations;
-	g_totalAllocatedBytes += numBytes;
-	g_bytesAllocatedSinceLastUpdate += numBytes;
-	if (g_totalAllocatedBytes > g_currentHighwaterBytes)
+	if (s_threadCounterBlock < 0)
 	{
-		g_currentHighwaterBytes = g_totalAllocatedBytes;
+		int blockIndex = s_nextCounterBlock.fetch_add(1, std::memory_order_relaxed);
+		s_threadCounterBlock = (blockIndex < MAX_THREAD_COUNTER_BLOCKS) ? blockIndex : SHARED_COUNTER_BLOCK;
 	}
-	*ptr = numBytes;
-	ptr++;
+	return s_threadCounterBlock;
+}
 
-	if (g_isCallstackSysInitialized)
+
+//-----------------------------------------------------------------------------------------------
+static inline void AddToCounter(std::atomic<uint64_t>& counter, uint64_t amount, int blockIndex)
+{
+	if (blockIndex == SHARED_COUNTER_BLOCK)
 	{
-		callstack_t* cStack = CallstackFetch(0);
-		cStack->bytes = numBytes;
-		g_callStackMap.insert(ptr, cStack);
+		counter.fetch_add(amount, std::memory_order_relaxed);
 	}
+	else
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+}
 
-	Profiler::AddAllocation(numBytes);
 
-	return ptr;
+//-----------------------------------------------------------------------------------------------
+static uint64_t SumCounter(std::atomic<uint64_t>(CounterBlock::*counter)[NUM_MEMORY_TAGS], int tag)
+{
+	uint64_t result = 0;
+	for (int blockIndex = 0; blockIndex < NUM_COUNTER_BLOCKS; blockIndex++)
+	{
+		result += (s_counterBlocks[blockIndex].*counter)[tag].load(std::memory_order_relaxed);
+	}
+	return result;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void operator delete(void* ptr)
+//Summing every block is too slow to do per allocation, so high water only moves when somebody looks
+//(stats queries, sampled allocations).  Spikes that come and go between looks are missed
+static uint64_t UpdateHighWater()
 {
-	//size_t* myPtr = (size_t*)ptr;
-	//myPtr--;
-	//g_totalAllocatedBytes -= *myPtr;
-	//g_bytesFreedSinceLastUpdate += *myPtr;
-	//--g_numAllocations;
-	//if (g_isCallstackSysInitialized)
-	//{
-	//	g_callStackMap.erase(ptr);
-	//}
-	//Profiler::SubtractAllocation(*myPtr);
-	//free(myPtr);
+	uint64_t liveBytes = 0;
+	for (int tag = 0; tag < NUM_MEMORY_TAGS; tag++)
+	{
+		liveBytes += SumCounter(&CounterBlock::bytesAllocated, tag) - SumCounter(&CounterBlock::bytesFreed, tag);
+	}
+
+	uint64_t highWater = s_highWaterBytes.load(std::memory_order_relaxed);
+	while (liveBytes > highWater && !s_highWaterBytes.compare_exchange_weak(highWater, liveBytes, std::memory_order_relaxed))
+	{
+	}
+	return liveBytes;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void MemoryAnalyticsStartup()
+MemoryStats MemoryTracker::GetStats()
+{
+	MemoryStats result = {};
+	result.liveBytes = UpdateHighWater();
+	result.highWaterBytes = s_highWaterBytes.load(std::memory_order_relaxed);
+
+	for (int tag = 0; tag < NUM_MEMORY_TAGS; tag++)
+	{
+		MemoryTagStats& tagStats = result.tags[tag];
+		tagStats.totalBytesAllocated = SumCounter(&CounterBlock::bytesAllocated, tag);
+		tagStats.totalBytesFreed = SumCounter(&CounterBlock::bytesFreed, tag);
+		tagStats.liveBytes = tagStats.totalBytesAllocated - tagStats.totalBytesFreed;
+		tagStats.numLiveAllocations = SumCounter(&CounterBlock::numAllocations, tag) - SumCounter(&CounterBlock::numFrees, tag);
+
+		result.numLiveAllocations += tagStats.numLiveAllocations;
+		result.totalBytesAllocated += tagStats.totalBytesAllocated;
+		result.totalBytesFreed += tagStats.totalBytesFreed;
+	}
+
+#if defined(MEMORY_DETECTION_MODE) && MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
+	result.numSampledLiveAllocations = CountLiveSamples();
+#endif
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+const char* MemoryTracker::GetTagName(EMemoryTag tag)
+{
+	static const char* s_tagNames[NUM_MEMORY_TAGS] = { "Untagged", "Core", "Jobs", "Logging", "Profiler", "Renderer", "Audio", "Network", "Game" };
+	return (tag < NUM_MEMORY_TAGS) ? s_tagNames[tag] : "Invalid";
+}
+
+
+//-----------------------------------------------------------------------------------------------
+EMemoryTag MemoryTracker::GetThreadTag()
+{
+	return (EMemoryTag)s_threadTag;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void MemoryTracker::SetThreadTag(EMemoryTag tag)
 {
-	g_numStartupAllocations = g_numAllocations;
-	g_totalAllocatedBytesStartup = g_totalAllocatedBytes;
-	Logger::StartLogging("NetSession");
-	Logger::Printf("Number of allocations at startup: %u\n", g_numStartupAllocations);
-	Logger::Printf("Number of allocated bytes at startup: %u\n", g_totalAllocatedBytesStartup);
-	DebuggerPrintf("Number of allocations at startup: %u\nNumber of allocated bytes: %u\n", g_numStartupAllocations, g_totalAllocatedBytesStartup);
+	s_threadTag = (unsigned char)tag;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-callstack_line_t* GetOriginatingCall(callstack_t* stack, callstack_line_t* linePtr)
+// SAMPLED CALLSTACKS
+//	Open-addressed table keyed on the user pointer.  A slot is claimed by CASing its key from empty
+//	(or a tombstone) to CLAIMED_KEY, filled in, then published by storing the real pointer.  Freeing
+//	just stores a tombstone back.  Nothing ever waits, and a probe that runs too long gives up and
+//	leaves the allocation unsampled rather than block the allocator
+//-----------------------------------------------------------------------------------------------
+#if defined(MEMORY_DETECTION_MODE) && MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
+static const int MAX_SAMPLE_FRAMES = 16;
+static const size_t NUM_SAMPLE_SLOTS = 16 * 1024;
+static const size_t MAX_SAMPLE_PROBES = 64;
+
+static const uintptr_t EMPTY_KEY = 0;
+static const uintptr_t TOMBSTONE_KEY = 1;
+static const uintptr_t CLAIMED_KEY = 2;
+
+
+//-----------------------------------------------------------------------------------------------
+struct AllocationSample
 {
-	for (size_t i = 1; i < stack->frame_count; i++)
+	std::atomic<uintptr_t> key;
+	uint64_t sampleIndex;
+	size_t numBytes;
+	void* frames[MAX_SAMPLE_FRAMES];
+	int numFrames;
+	unsigned char tag;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static AllocationSample s_samples[NUM_SAMPLE_SLOTS];
+static std::atomic<uint64_t> s_nextSampleIndex(0);
+static uint64_t s_startupSampleIndex = 0;
+
+static std::atomic<unsigned int> s_sampleEveryNthAllocation(1024);
+static std::atomic<size_t> s_sampleAllocationsAboveBytes(64 * 1024);
+
+static thread_local unsigned int s_allocationsUntilSample = 0;
+static thread_local bool s_isCapturingSample = false;
+
+
+//-----------------------------------------------------------------------------------------------
+static size_t GetFirstSlotForPointer(const void* ptr)
+{
+	//Heap pointers are at least 16-byte aligned, so the bottom bits carry nothing
+	uint64_t hash = ((uint64_t)(uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ull;
+	return (size_t)(hash >> 32) & (NUM_SAMPLE_SLOTS - 1);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool ShouldSample(size_t numBytes)
+{
+	size_t aboveBytes = s_sampleAllocationsAboveBytes.load(std::memory_order_relaxed);
+	if (aboveBytes != 0 && numBytes >= aboveBytes)
 	{
-		if (strstr(linePtr[i].filename, "\\code\\"))
+		return true;
+	}
+
+	unsigned int everyNth = s_sampleEveryNthAllocation.load(std::memory_order_relaxed);
+	if (everyNth == 0)
+	{
+		return false;
+	}
+	if (s_allocationsUntilSample == 0 || s_allocationsUntilSample > everyNth)
+	{
+		s_allocationsUntilSample = everyNth;
+		return true;
+	}
+	s_allocationsUntilSample--;
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool RecordSample(void* ptr, size_t numBytes, unsigned char tag)
+{
+	if (s_isCapturingSample)
+	{
+		return false;
+	}
+	s_isCapturingSample = true;
+
+	bool wasRecorded = false;
+	size_t slotIndex = GetFirstSlotForPointer(ptr);
+	for (size_t probe = 0; probe < MAX_SAMPLE_PROBES; probe++, slotIndex = (slotIndex + 1) & (NUM_SAMPLE_SLOTS - 1))
+	{
+		AllocationSample& sample = s_samples[slotIndex];
+		uintptr_t key = sample.key.load(std::memory_order_relaxed);
+		if (key != EMPTY_KEY && key != TOMBSTONE_KEY)
+		{
+			continue;
+		}
+		if (!sample.key.compare_exchange_strong(key, CLAIMED_KEY, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		sample.sampleIndex = s_nextSampleIndex.fetch_add(1, std::memory_order_relaxed);
+		sample.numBytes = numBytes;
+		sample.tag = tag;
+		sample.numFrames = Platform::CaptureCallstack(sample.frames, MAX_SAMPLE_FRAMES, 2);
+		sample.key.store((uintptr_t)ptr, std::memory_order_release);
+		wasRecorded = true;
+		break;
+	}
+
+	s_isCapturingSample = false;
+	return wasRecorded;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void EraseSample(void* ptr)
+{
+	size_t slotIndex = GetFirstSlotForPointer(ptr);
+	for (size_t probe = 0; probe < MAX_SAMPLE_PROBES; probe++, slotIndex = (slotIndex + 1) & (NUM_SAMPLE_SLOTS - 1))
+	{
+		AllocationSample& sample = s_samples[slotIndex];
+		uintptr_t key = sample.key.load(std::memory_order_relaxed);
+		if (key == (uintptr_t)ptr)
 		{
-			return &linePtr[i];
+			sample.key.store(TOMBSTONE_KEY, std::memory_order_release);
+			return;
+		}
+		if (key == EMPTY_KEY)
+		{
+			break;
 		}
 	}
 
-	return nullptr;
+	ERROR_AND_DIE("Freed a sampled allocation that isn't in the sample table");
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void FlushCallstacks()
+static size_t CountLiveSamples()
 {
-	for (int i = 0; i < g_callStackMap.get_count(); i++)
+	size_t result = 0;
+	for (size_t slotIndex = 0; slotIndex < NUM_SAMPLE_SLOTS; slotIndex++)
 	{
-		callstack_t* cStack = g_callStackMap[i];
-		DebuggerPrintf("New callstack!  Bytes leaked: %u\n", cStack->bytes);
-		callstack_line_t* linePtr = CallstackGetLines(cStack);
-		callstack_line_t* fileLine = GetOriginatingCall(cStack, linePtr);
-		DebuggerPrintf("Originating call: \n%s(%i)\n", fileLine->filename, fileLine->line);
-		DebuggerPrintf("Callstack:\n");
-		for (size_t j = 0; j < cStack->frame_count; j++)
+		if (s_samples[slotIndex].key.load(std::memory_order_relaxed) > CLAIMED_KEY)
 		{
-			DebuggerPrintf("%s(%i)\n", linePtr[j].filename, linePtr[j].line);
+			result++;
 		}
 	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Copies a slot out, retrying if it's recycled under us.  False if it doesn't hold a live sample
+static bool ReadSample(size_t slotIndex, AllocationSample& outSample, uintptr_t& outKey)
+{
+	AllocationSample& sample = s_samples[slotIndex];
+	for (;;)
+	{
+		uintptr_t key = sample.key.load(std::memory_order_acquire);
+		if (key <= CLAIMED_KEY)
+		{
+			return false;
+		}
+
+		outSample.sampleIndex = sample.sampleIndex;
+		outSample.numBytes = sample.numBytes;
+		outSample.tag = sample.tag;
+		outSample.numFrames = sample.numFrames;
+		for (int frameIndex = 0; frameIndex < sample.numFrames && frameIndex < MAX_SAMPLE_FRAMES; frameIndex++)
+		{
+			outSample.frames[frameIndex] = sample.frames[frameIndex];
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sample.key.load(std::memory_order_relaxed) == key)
+		{
+			outKey = key;
+			return true;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void PrintSample(const AllocationSample& sample, uintptr_t ptr)
+{
+	DebuggerPrintf("Live sampled allocation %p: %u bytes, tag %s\n", (void*)ptr, (unsigned int)sample.numBytes, MemoryTracker::GetTagName((EMemoryTag)sample.tag));
+
+#if defined(PLATFORM_WINDOWS)
+	if (g_isCallstackSysInitialized)
+	{
+		callstack_t callstack;
+		callstack.frames = (void**)sample.frames;
+		callstack.frame_count = (size_t)sample.numFrames;
+		callstack.bytes = sample.numBytes;
+
+		callstack_line_t* lines = CallstackGetLines(&callstack);
+		for (int frameIndex = 0; frameIndex < sample.numFrames; frameIndex++)
+		{
+			DebuggerPrintf("%s(%i)\n", lines[frameIndex].filename, (int)lines[frameIndex].line);
+		}
+		return;
+	}
+#endif
+
+	for (int frameIndex = 0; frameIndex < sample.numFrames; frameIndex++)
+	{
+		DebuggerPrintf("\t%p\n", sample.frames[frameIndex]);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static size_t ReportLiveSamplesSince(uint64_t firstSampleIndex)
+{
+	size_t numReported = 0;
+	AllocationSample sample;
+	uintptr_t ptr;
+	for (size_t slotIndex = 0; slotIndex < NUM_SAMPLE_SLOTS; slotIndex++)
+	{
+		if (ReadSample(slotIndex, sample, ptr) && sample.sampleIndex >= firstSampleIndex)
+		{
+			PrintSample(sample, ptr);
+			numReported++;
+		}
+	}
+	return numReported;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void MemoryTracker::SetSampling(unsigned int sampleEveryNthAllocation, size_t sampleAllocationsAboveBytes)
+{
+	s_sampleEveryNthAllocation.store(sampleEveryNthAllocation, std::memory_order_relaxed);
+	s_sampleAllocationsAboveBytes.store(sampleAllocationsAboveBytes, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+size_t MemoryTracker::ReportLiveSampledAllocations()
+{
+	return ReportLiveSamplesSince(0);
+}
+
+#else
+//-----------------------------------------------------------------------------------------------
+void MemoryTracker::SetSampling(unsigned int sampleEveryNthAllocation, size_t sampleAllocationsAboveBytes) { UNUSED(sampleEveryNthAllocation); UNUSED(sampleAllocationsAboveBytes); }
+size_t MemoryTracker::ReportLiveSampledAllocations() { return 0; }
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+// GLOBAL NEW/DELETE
+//	Every block carries a 16-byte header (keeps malloc's alignment for the user pointer) with its
+//	size and tag, so frees are charged back to whoever allocated
+//-----------------------------------------------------------------------------------------------
+#ifdef MEMORY_DETECTION_MODE
+static const uint32_t ALLOCATION_MAGIC = 0xA110CA7E;
+static const unsigned char ALLOCATION_FLAG_SAMPLED = 1;
+
+
+//-----------------------------------------------------------------------------------------------
+struct AllocationHeader
+{
+	size_t numBytes;
+	uint32_t magic;
+	unsigned char tag;
+	unsigned char flags;
+	unsigned short padding;
+};
+static_assert(sizeof(AllocationHeader) == 16, "Allocation header must preserve malloc alignment");
+
+
+//-----------------------------------------------------------------------------------------------
+static void* TrackedAlloc(size_t numBytes)
+{
+	AllocationHeader* header = (AllocationHeader*)malloc(sizeof(AllocationHeader) + numBytes);
+	if (!header)
+	{
+		return nullptr;
+	}
+
+	unsigned char tag = s_threadTag;
+	header->numBytes = numBytes;
+	header->magic = ALLOCATION_MAGIC;
+	header->tag = tag;
+	header->flags = 0;
+	header->padding = 0;
+
+	int blockIndex = GetThreadCounterBlockIndex();
+	AddToCounter(s_counterBlocks[blockIndex].numAllocations[tag], 1, blockIndex);
+	AddToCounter(s_counterBlocks[blockIndex].bytesAllocated[tag], numBytes, blockIndex);
+
+	void* result = header + 1;
+#if MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
+	if (ShouldSample(numBytes))
+	{
+		if (RecordSample(result, numBytes, tag))
+		{
+			header->flags |= ALLOCATION_FLAG_SAMPLED;
+		}
+		UpdateHighWater();
+	}
+#endif
+
+	//Every allocation comes through here, so skip the profiler's thread lookup unless it's recording
+	if (Profiler::IsProfiling())
+	{
+		Profiler::AddAllocation(numBytes);
+	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void TrackedFree(void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	AllocationHeader* header = (AllocationHeader*)ptr - 1;
+	ASSERT_OR_DIE(header->magic == ALLOCATION_MAGIC, "Deleted a pointer that didn't come from operator new (or deleted it twice)");
+	header->magic = 0;
+
+#if MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
+	//Has to leave the table before free, or malloc could hand the address to another thread's sample
+	if (header->flags & ALLOCATION_FLAG_SAMPLED)
+	{
+		EraseSample(ptr);
+	}
+#endif
+
+	int blockIndex = GetThreadCounterBlockIndex();
+	AddToCounter(s_counterBlocks[blockIndex].numFrees[header->tag], 1, blockIndex);
+	AddToCounter(s_counterBlocks[blockIndex].bytesFreed[header->tag], header->numBytes, blockIndex);
+
+	if (Profiler::IsProfiling())
+	{
+		Profiler::SubtractAllocation(header->numBytes);
+	}
+	free(header);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* operator new(size_t numBytes)
+{
+	void* result = TrackedAlloc(numBytes);
+	if (!result)
+	{
+		throw std::bad_alloc();
+	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* operator new[](size_t numBytes)
+{
+	return operator new(numBytes);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* operator new(size_t numBytes, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(numBytes);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* operator new[](size_t numBytes, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(numBytes);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void operator delete(void* ptr) noexcept
+{
+	TrackedFree(ptr);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void operator delete[](void* ptr) noexcept
+{
+	TrackedFree(ptr);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void operator delete(void* ptr, size_t numBytes) noexcept
+{
+	UNUSED(numBytes);
+	TrackedFree(ptr);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, size_t numBytes) noexcept
+{
+	UNUSED(numBytes);
+	TrackedFree(ptr);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	TrackedFree(ptr);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	TrackedFree(ptr);
+}
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+// STARTUP/SHUTDOWN REPORTS
+//-----------------------------------------------------------------------------------------------
+static MemoryStats s_startupStats;
+
+
+//-----------------------------------------------------------------------------------------------
+void MemoryAnalyticsStartup()
+{
+	s_startupStats = MemoryTracker::GetStats();
+#if defined(MEMORY_DETECTION_MODE) && MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
+	s_startupSampleIndex = s_nextSampleIndex.load(std::memory_order_relaxed);
+#endif
+
+	Logger::StartLogging("Memory");
+	Logger::Printf("Number of allocations at startup: %llu\n", s_startupStats.numLiveAllocations);
+	Logger::Printf("Number of allocated bytes at startup: %llu\n", s_startupStats.liveBytes);
+	DebuggerPrintf("Number of allocations at startup: %llu\nNumber of allocated bytes: %llu\n", s_startupStats.numLiveAllocations, s_startupStats.liveBytes);
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void MemoryAnalyticsShutdown()
 {
-	Logger::Printf("Number of allocations at shutdown: %u\n", g_numAllocations);
-	Logger::Printf("Number of allocated bytes at shutdown: %u\n", g_totalAllocatedBytes);
-	Logger::Printf("Number of leaked allocations: %i\n", g_numAllocations - g_numStartupAllocations);
-	Logger::Printf("Number of leaked bytes: %i\n", g_totalAllocatedBytes - g_totalAllocatedBytesStartup);
+	MemoryStats shutdownStats = MemoryTracker::GetStats();
+	Logger::Printf("Number of allocations at shutdown: %llu\n", shutdownStats.numLiveAllocations);
+	Logger::Printf("Number of allocated bytes at shutdown: %llu\n", shutdownStats.liveBytes);
+	Logger::Printf("Number of leaked allocations: %lli\n", (long long)(shutdownStats.numLiveAllocations - s_startupStats.numLiveAllocations));
+	Logger::Printf("Number of leaked bytes: %lli\n", (long long)(shutdownStats.liveBytes - s_startupStats.liveBytes));
+	Logger::Printf("High water bytes: %llu\n", shutdownStats.highWaterBytes);
 	Logger::StopLogging();
-	DebuggerPrintf("Number of allocations at shutdown: %u\nNumber of allocated bytes: %u\n", g_numAllocations, g_totalAllocatedBytes);
-	if (!g_callStackMap.empty())
-	{
-		size_t numLeaks = g_callStackMap.get_count();
-		FlushCallstacks();
+	DebuggerPrintf("Number of allocations at shutdown: %llu\nNumber of allocated bytes: %llu\n", shutdownStats.numLiveAllocations, shutdownStats.liveBytes);
 
-		//Using remaining callstacks as indicator for leaks, as I sometimes have fewer allocations on shutdown than startup
-		ERROR_AND_DIE(Stringf("%u leaks detected!", numLeaks));
+#if defined(MEMORY_DETECTION_MODE) && MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
+	//Sampled allocations made since startup that are still alive are definitely leaks; the counts alone
+	//can't say so, as some startup allocations are legitimately gone by shutdown
+	size_t numLeaks = ReportLiveSamplesSince(s_startupSampleIndex);
+	if (numLeaks > 0)
+	{
+		ERROR_AND_DIE(Stringf("%u sampled leaks detected!", (unsigned int)numLeaks));
 	}
+#endif
 }
 
-bool g_isDebuggingMemory = false;
+
 //-----------------------------------------------------------------------------------------------
+bool g_isDebuggingMemory = false;
 CONSOLE_COMMAND(MemoryDebug, args)
 {
 	UNUSED(args);
@@ -147,7 +644,132 @@ CONSOLE_COMMAND(MemoryDebug, args)
 CONSOLE_COMMAND(MemoryFlush, args)
 {
 	UNUSED(args);
-#if defined(MEMORY_DETECTION_MODE) && MEMORY_DETECTION_MODE == MEMORY_DETECTION_VERBOSE
-	FlushCallstacks();
-#endif
+	size_t numReported = MemoryTracker::ReportLiveSampledAllocations();
+	ConsolePrintf(WHITE, "%u live sampled allocations written to the debugger output", (unsigned int)numReported);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(MemStats, args)
+{
+	UNUSED(args);
+
+	MemoryStats stats = MemoryTracker::GetStats();
+	ConsolePrintf(WHITE, "%llu live allocations, %llu live bytes, %llu high water bytes, %llu sampled", stats.numLiveAllocations, stats.liveBytes,
+		stats.highWaterBytes, stats.numSampledLiveAllocations);
+	for (int tag = 0; tag < NUM_MEMORY_TAGS; tag++)
+	{
+		const MemoryTagStats& tagStats = stats.tags[tag];
+		if (tagStats.totalBytesAllocated == 0)
+		{
+			continue;
+		}
+		ConsolePrintf(WHITE, "  %-10s %8llu live, %12llu bytes live, %14llu bytes allocated total", MemoryTracker::GetTagName((EMemoryTag)tag),
+			tagStats.numLiveAllocations, tagStats.liveBytes, tagStats.totalBytesAllocated);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(MemSampling, args)
+{
+	int everyNth = 1024;
+	int aboveBytes = 64 * 1024;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			everyNth = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			aboveBytes = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: memsampling [everyNthAllocation] [aboveBytes] (0 turns a trigger off)", RED);
+		return;
+	}
+
+	if (everyNth < 0 || aboveBytes < 0)
+	{
+		ConsolePrint("Sampling rates can't be negative", RED);
+		return;
+	}
+
+	MemoryTracker::SetSampling((unsigned int)everyNth, (size_t)aboveBytes);
+	ConsolePrintf(WHITE, "Sampling every %i allocations and everything from %i bytes", everyNth, aboveBytes);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// TRACKING BENCHMARK
+//	Small new/delete pairs (tracked) against the same sizes through malloc/free (untracked), to
+//	show what the tracker costs per allocation
+//-----------------------------------------------------------------------------------------------
+static const int TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH = 256;
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(MemTrackBenchmark, args)
+{
+	int numBatches = 10000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numBatches = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: memtrackbenchmark [numBatches]", RED);
+		return;
+	}
+
+	if (numBatches < 1)
+	{
+		ConsolePrint("Need at least one batch", RED);
+		return;
+	}
+
+	void* allocations[TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH];
+
+	double startSeconds = GetCurrentTimeSeconds();
+	for (int batch = 0; batch < numBatches; batch++)
+	{
+		for (int i = 0; i < TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			allocations[i] = malloc(16 + (i * 37) % 240);
+		}
+		for (int i = 0; i < TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			free(allocations[i]);
+		}
+	}
+	double mallocSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	startSeconds = GetCurrentTimeSeconds();
+	for (int batch = 0; batch < numBatches; batch++)
+	{
+		for (int i = 0; i < TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			allocations[i] = ::operator new(16 + (i * 37) % 240);
+		}
+		for (int i = 0; i < TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH; i++)
+		{
+			::operator delete(allocations[i]);
+		}
+	}
+	double trackedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	double numAllocations = (double)numBatches * TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH;
+	ConsolePrintf(WHITE, "%i batches of %i allocations: malloc/free %.1f ns per pair, tracked new/delete %.1f ns per pair", numBatches,
+		TRACK_BENCHMARK_ALLOCATIONS_PER_BATCH, mallocSeconds * 1.0e9 / numAllocations, trackedSeconds * 1.0e9 / numAllocations);
 }
\ No newline at end of file
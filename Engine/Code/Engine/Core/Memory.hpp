@@ -1,147 +1,98 @@
 #pragma once
 
-#include <cstdlib>
+#include "Engine/Core/BuildConfig.hpp"
 
-#define MEMORY_TRACKING_BASIC 0
-#define MEMORY_TRACKING_VERBOSE 1
-
-#define MEMORY_TRACKING MEMORY_TRACKING_BASIC
+#include <stddef.h>
+#include <stdint.h>
 
 
 //-----------------------------------------------------------------------------------------------
-extern unsigned int g_numAllocations;
-extern unsigned int g_totalAllocatedBytes;
-extern unsigned int g_numStartupAllocations;
-extern unsigned int g_totalAllocatedBytesStartup;
-extern unsigned int g_currentHighwaterBytes;
-extern unsigned int g_bytesAllocatedSinceLastUpdate;
-extern unsigned int g_bytesFreedSinceLastUpdate;
+// ALLOCATION TRACKING
+//	With MEMORY_DETECTION_MODE defined, global new/delete keep live byte and allocation counts,
+//	broken down by memory tag.  Each thread bumps its own counters, so nothing is shared on the hot
+//	path, but the header and counters still add roughly 20ns to a new/delete pair (about 55ns
+//	against 35ns for raw malloc/free in an optimized build; memtrackbenchmark measures it).  Weigh
+//	that before leaving it on in shipping builds.
+//	MEMORY_DETECTION_VERBOSE also captures callstacks for a sample of allocations (every Nth, plus
+//	everything above a size) and keeps them in a lock-free table until they're freed, which is
+//	what the leak report at shutdown is built from.
+//-----------------------------------------------------------------------------------------------
+enum EMemoryTag : unsigned char
+{
+	MEMTAG_UNTAGGED = 0,
+	MEMTAG_CORE,
+	MEMTAG_JOBS,
+	MEMTAG_LOGGING,
+	MEMTAG_PROFILER,
+	MEMTAG_RENDERER,
+	MEMTAG_AUDIO,
+	MEMTAG_NETWORK,
+	MEMTAG_GAME,
+	NUM_MEMORY_TAGS
+};
 
 
 //-----------------------------------------------------------------------------------------------
-void MemoryAnalyticsStartup();
-void MemoryAnalyticsShutdown();
+struct MemoryTagStats
+{
+	uint64_t numLiveAllocations;
+	uint64_t liveBytes;
+	uint64_t totalBytesAllocated;
+	uint64_t totalBytesFreed;
+};
 
 
 //-----------------------------------------------------------------------------------------------
-template<typename T, typename U>
-struct MapNode
+struct MemoryStats
 {
-	T first;
-	U second;
-	MapNode<T, U>* next;
+	uint64_t numLiveAllocations;
+	uint64_t liveBytes;
+	uint64_t highWaterBytes;
+	uint64_t totalBytesAllocated;
+	uint64_t totalBytesFreed;
+	uint64_t numSampledLiveAllocations;
+	MemoryTagStats tags[NUM_MEMORY_TAGS];
 };
 
 
 //-----------------------------------------------------------------------------------------------
-template<typename T, typename U>
-class UntrackedMap
+namespace MemoryTracker
+{
+	MemoryStats GetStats();
+	const char* GetTagName(EMemoryTag tag);
+
+	//Allocations made on this thread are charged to this tag until it's changed
+	EMemoryTag GetThreadTag();
+	void SetThreadTag(EMemoryTag tag);
+
+	//Callstack sampling for MEMORY_DETECTION_VERBOSE.  Pass 0 to turn either trigger off
+	void SetSampling(unsigned int sampleEveryNthAllocation, size_t sampleAllocationsAboveBytes);
+
+	//Prints every sampled allocation still alive.  Returns how many there were
+	size_t ReportLiveSampledAllocations();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Charges allocations in a scope to a tag, then puts the old one back
+class ScopedMemoryTag
 {
 public:
-	UntrackedMap() : head(nullptr) {}
-	void insert(const T& first, const U& second)
-	{
-		if (!head)
-		{
-			head = (MapNode<T, U>*)malloc(sizeof(MapNode<T, U>));
-			memcpy(&head->first, &first, sizeof(T));
-			//head->first = first;
-			memcpy(&head->second, &second, sizeof(U));
-			//head->second = second;
-			head->next = nullptr;
-			return;
-		}
-
-		MapNode<T, U>* curr = head;
-		while (curr->next)
-		{
-			if (curr->first == first)
-			{
-				curr->second = second;
-				return;
-			}
-			curr = curr->next;
-		}
-
-		curr->next = (MapNode<T, U>*)malloc(sizeof(MapNode<T, U>));
-		curr = curr->next;
-		memcpy(&curr->first, &first, sizeof(T));
-		//curr->first = first;
-		memcpy(&curr->second, &second, sizeof(U));
-		//curr->second = second;
-		curr->next = nullptr;
-	}
-	void erase(const T& key)
-	{
-		if (!head)
-		{
-			return;
-		}
-		if (head->first == key)
-		{
-			MapNode<T, U>* temp = head->next;
-			free(head);
-			head = temp;
-			return;
-		}
-
-		MapNode<T, U>* curr = head;
-
-		while (curr->next)
-		{
-			if (curr->next->first == key)
-			{
-				MapNode<T, U>* toFree = curr->next;
-				curr->next = toFree->next;
-				free(toFree);
-				return;
-			}
-			curr = curr->next;
-		}
-	}
-	int get_count()
-	{
-		MapNode<T, U>* curr = head;
-		int result = 0;
-		while (curr)
-		{
-			curr = curr->next;
-			result++;
-		}
-
-		return result;
-	}
-	U& operator[](int index)
+	ScopedMemoryTag(EMemoryTag tag)
+		: m_previousTag(MemoryTracker::GetThreadTag())
 	{
-		if (index >= get_count())
-		{
-			throw std::out_of_range(nullptr);
-		}
-		MapNode<T, U>* curr = head;
-		for (int i = 0; i < index; i++)
-		{
-			curr = curr->next;
-		}
-
-		return curr->second;
+		MemoryTracker::SetThreadTag(tag);
 	}
-	U& at(const T& key)
+	~ScopedMemoryTag()
 	{
-		MapNode<T, U>* curr = head;
-		while (curr)
-		{
-			if (curr->first == key)
-			{
-				return curr->second;
-			}
-
-			curr = curr->next;
-		}
-
-		throw std::exception("Key does not exist");
+		MemoryTracker::SetThreadTag(m_previousTag);
 	}
-	bool empty() { return get_count() == 0; }
 
-public:
-	MapNode<T, U>* head;
-};
\ No newline at end of file
+private:
+	EMemoryTag m_previousTag;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+void MemoryAnalyticsStartup();
+void MemoryAnalyticsShutdown();
\ No newline at end of file
@@ -0,0 +1,577 @@
+#include "Engine/Core/ObjectPool.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+static const size_t CACHE_LINE_BYTES = 64;
+static const size_t MAX_BATCH_SIZE = 32;
+static const size_t MIN_BLOCKS_PER_SLAB = 8;
+static const size_t SLAB_GRANULARITY_BYTES = 4 * 1024;
+
+
+//-----------------------------------------------------------------------------------------------
+// POOL REGISTRY
+//	Maps thread cache slots back to live pools, so an exiting thread can hand its cached blocks
+//	back, and a cache left over from a dead pool is recognized instead of used
+//-----------------------------------------------------------------------------------------------
+struct PoolRegistry
+{
+	std::mutex lock;
+	BlockPool* pools[BlockPool::MAX_CACHED_POOLS];
+	uint64_t poolIDs[BlockPool::MAX_CACHED_POOLS];
+	uint64_t nextPoolID;
+
+	PoolRegistry()
+		: nextPoolID(1)
+	{
+		for (int i = 0; i < BlockPool::MAX_CACHED_POOLS; i++)
+		{
+			pools[i] = nullptr;
+			poolIDs[i] = 0;
+		}
+	}
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Function static so pools that are themselves statics can register during static init
+static PoolRegistry& GetPoolRegistry()
+{
+	static PoolRegistry s_registry;
+	return s_registry;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+struct ThreadBlockCache
+{
+	BlockPool::FreeBlock* head;
+	size_t count;
+	uint64_t poolID;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct ThreadBlockCaches
+{
+	ThreadBlockCache caches[BlockPool::MAX_CACHED_POOLS];
+
+	ThreadBlockCaches()
+	{
+		for (ThreadBlockCache& cache : caches)
+		{
+			cache.head = nullptr;
+			cache.count = 0;
+			cache.poolID = 0;
+		}
+	}
+	~ThreadBlockCaches()
+	{
+		//Thread is exiting; hand everything back to pools that are still around so other threads can reuse it
+		PoolRegistry& registry = GetPoolRegistry();
+		std::lock_guard<std::mutex> lock(registry.lock);
+		for (int slot = 0; slot < BlockPool::MAX_CACHED_POOLS; slot++)
+		{
+			ThreadBlockCache& cache = caches[slot];
+			if (cache.head && registry.poolIDs[slot] == cache.poolID)
+			{
+				BlockPool* pool = registry.pools[slot];
+				SpinLockGuard poolLock(&pool->m_lock);
+				pool->PushBatch(cache.head, cache.count);
+			}
+		}
+	}
+
+	ThreadBlockCache& GetCacheForPool(int slot, uint64_t poolID)
+	{
+		ThreadBlockCache& result = caches[slot];
+		if (result.poolID != poolID)
+		{
+			//Whatever was here belonged to a pool that has since died, along with its slabs
+			result.head = nullptr;
+			result.count = 0;
+			result.poolID = poolID;
+		}
+		return result;
+	}
+};
+static thread_local ThreadBlockCaches t_blockCaches;
+
+
+//-----------------------------------------------------------------------------------------------
+BlockPool::BlockPool(size_t blockBytes, size_t blockAlignment, size_t initialNumBlocks /*= 0*/, const char* debugName /*= nullptr*/)
+	: m_batches(nullptr)
+	, m_slabs(nullptr)
+	, m_numSlabs(0)
+	, m_debugName(debugName ? debugName : "unnamed")
+	, m_cacheSlot(-1)
+	, m_poolID(0)
+	, m_numLive(0)
+	, m_highWaterLive(0)
+	, m_capacity(0)
+{
+	ASSERT_OR_DIE(blockAlignment != 0 && (blockAlignment & (blockAlignment - 1)) == 0, "Pool alignment must be a power of two");
+	ASSERT_OR_DIE(blockAlignment <= CACHE_LINE_BYTES, "Pool alignment can't exceed a cache line");
+
+	//Free blocks hold the list links, so a block can't be smaller than that
+	if (blockBytes < sizeof(FreeBlock))
+	{
+		blockBytes = sizeof(FreeBlock);
+	}
+	if (blockAlignment < alignof(FreeBlock))
+	{
+		blockAlignment = alignof(FreeBlock);
+	}
+	m_blockStride = (blockBytes + blockAlignment - 1) & ~(blockAlignment - 1);
+
+	size_t slabBytes = DEFAULT_SLAB_BYTES;
+	if (m_blockStride * MIN_BLOCKS_PER_SLAB + CACHE_LINE_BYTES > slabBytes)
+	{
+		slabBytes = m_blockStride * MIN_BLOCKS_PER_SLAB + CACHE_LINE_BYTES;
+		slabBytes = (slabBytes + SLAB_GRANULARITY_BYTES - 1) & ~(SLAB_GRANULARITY_BYTES - 1);
+	}
+	m_blocksPerSlab = (slabBytes - CACHE_LINE_BYTES) / m_blockStride;
+	m_batchSize = (m_blocksPerSlab < MAX_BATCH_SIZE) ? m_blocksPerSlab : MAX_BATCH_SIZE;
+
+	PoolRegistry& registry = GetPoolRegistry();
+	{
+		std::lock_guard<std::mutex> lock(registry.lock);
+		m_poolID = registry.nextPoolID++;
+		for (int slot = 0; slot < MAX_CACHED_POOLS; slot++)
+		{
+			if (!registry.pools[slot])
+			{
+				registry.pools[slot] = this;
+				registry.poolIDs[slot] = m_poolID;
+				m_cacheSlot = slot;
+				break;
+			}
+		}
+	}
+
+	while (m_capacity < initialNumBlocks)
+	{
+		FreeBlock* firstBatch = CarveSlab();
+		SpinLockGuard lock(&m_lock);
+		PushBatch(firstBatch, firstBatch->batchCount);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+BlockPool::~BlockPool()
+{
+	if (m_cacheSlot >= 0)
+	{
+		PoolRegistry& registry = GetPoolRegistry();
+		std::lock_guard<std::mutex> lock(registry.lock);
+		registry.pools[m_cacheSlot] = nullptr;
+		registry.poolIDs[m_cacheSlot] = 0;
+	}
+
+	Slab* currSlab = m_slabs;
+	while (currSlab)
+	{
+		Slab* nextSlab = currSlab->next;
+		free(currSlab->allocation);
+		currSlab = nextSlab;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void* BlockPool::Allocate()
+{
+	TrackAllocation();
+
+	if (m_cacheSlot < 0)
+	{
+		return AllocateWithoutCache();
+	}
+
+	ThreadBlockCache& cache = t_blockCaches.GetCacheForPool(m_cacheSlot, m_poolID);
+	if (!cache.head)
+	{
+		FreeBlock* batch = nullptr;
+		{
+			SpinLockGuard lock(&m_lock);
+			batch = PopBatch();
+		}
+		if (!batch)
+		{
+			//Carve outside the lock; only the leftovers need to be published
+			batch = CarveSlab();
+		}
+		cache.head = batch;
+		cache.count = batch->batchCount;
+	}
+
+	FreeBlock* result = cache.head;
+	cache.head = result->next;
+	--cache.count;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void BlockPool::Free(void* block)
+{
+	m_numLive.fetch_sub(1, std::memory_order_relaxed);
+
+	FreeBlock* freedBlock = (FreeBlock*)block;
+	if (m_cacheSlot < 0)
+	{
+		SpinLockGuard lock(&m_lock);
+		PushBatch(freedBlock, 1);
+		return;
+	}
+
+	ThreadBlockCache& cache = t_blockCaches.GetCacheForPool(m_cacheSlot, m_poolID);
+	freedBlock->next = cache.head;
+	cache.head = freedBlock;
+	++cache.count;
+
+	//Consumers free far more than they allocate; spill a batch so producers can pick it up
+	if (cache.count >= m_batchSize * 2)
+	{
+		FreeBlock* first = cache.head;
+		FreeBlock* last = first;
+		for (size_t i = 1; i < m_batchSize; i++)
+		{
+			last = last->next;
+		}
+		cache.head = last->next;
+		cache.count -= m_batchSize;
+		last->next = nullptr;
+
+		SpinLockGuard lock(&m_lock);
+		PushBatch(first, m_batchSize);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+ObjectPoolStats BlockPool::GetStats() const
+{
+	ObjectPoolStats result;
+	result.debugName = m_debugName;
+	result.blockBytes = m_blockStride;
+	result.numLive = m_numLive.load(std::memory_order_relaxed);
+	result.highWaterLive = m_highWaterLive.load(std::memory_order_relaxed);
+	result.capacity = m_capacity.load(std::memory_order_relaxed);
+	{
+		SpinLockGuard lock(&m_lock);
+		result.numSlabs = m_numSlabs;
+	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void BlockPool::ForEachRegisteredPool(void(*callback)(const BlockPool& pool, void* userData), void* userData)
+{
+	PoolRegistry& registry = GetPoolRegistry();
+	std::lock_guard<std::mutex> lock(registry.lock);
+	for (BlockPool* pool : registry.pools)
+	{
+		if (pool)
+		{
+			callback(*pool, userData);
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Carves a new slab into batches of contiguous blocks, keeps the first batch for the caller and publishes the rest
+BlockPool::FreeBlock* BlockPool::CarveSlab()
+{
+	size_t slabBytes = CACHE_LINE_BYTES + m_blocksPerSlab * m_blockStride;
+	void* allocation = malloc(slabBytes + CACHE_LINE_BYTES - 1);
+	ASSERT_OR_DIE(allocation, "Object pool failed to allocate a slab");
+
+	//Slab header takes the first cache line so blocks start on a line boundary
+	unsigned char* slabBase = (unsigned char*)(((size_t)allocation + CACHE_LINE_BYTES - 1) & ~(CACHE_LINE_BYTES - 1));
+	Slab* slab = (Slab*)slabBase;
+	slab->allocation = allocation;
+	unsigned char* firstBlock = slabBase + CACHE_LINE_BYTES;
+
+	FreeBlock* firstBatch = nullptr;
+	FreeBlock* lastBatch = nullptr;
+	for (size_t batchStart = 0; batchStart < m_blocksPerSlab; batchStart += m_batchSize)
+	{
+		size_t batchCount = m_blocksPerSlab - batchStart;
+		if (batchCount > m_batchSize)
+		{
+			batchCount = m_batchSize;
+		}
+
+		//Link in address order so a fresh batch is handed out front to back
+		FreeBlock* batch = (FreeBlock*)(firstBlock + batchStart * m_blockStride);
+		for (size_t i = 0; i < batchCount; i++)
+		{
+			FreeBlock* block = (FreeBlock*)(firstBlock + (batchStart + i) * m_blockStride);
+			block->next = (i + 1 < batchCount) ? (FreeBlock*)((unsigned char*)block + m_blockStride) : nullptr;
+		}
+		batch->batchCount = batchCount;
+		batch->nextBatch = nullptr;
+
+		if (lastBatch)
+		{
+			lastBatch->nextBatch = batch;
+		}
+		else
+		{
+			firstBatch = batch;
+		}
+		lastBatch = batch;
+	}
+
+	m_capacity.fetch_add(m_blocksPerSlab, std::memory_order_relaxed);
+
+	SpinLockGuard lock(&m_lock);
+	slab->next = m_slabs;
+	m_slabs = slab;
+	++m_numSlabs;
+	if (firstBatch != lastBatch)
+	{
+		lastBatch->nextBatch = m_batches;
+		m_batches = firstBatch->nextBatch;
+	}
+	return firstBatch;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Lock must be held
+BlockPool::FreeBlock* BlockPool::PopBatch()
+{
+	FreeBlock* result = m_batches;
+	if (result)
+	{
+		m_batches = result->nextBatch;
+	}
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Lock must be held.  first->next must already chain count blocks
+void BlockPool::PushBatch(FreeBlock* first, size_t count)
+{
+	if (count == 1)
+	{
+		first->next = nullptr;
+	}
+	first->batchCount = count;
+	first->nextBatch = m_batches;
+	m_batches = first;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//For pools that didn't get a thread cache slot: take one block off the front batch under the lock
+void* BlockPool::AllocateWithoutCache()
+{
+	FreeBlock* batch = nullptr;
+	{
+		SpinLockGuard lock(&m_lock);
+		batch = PopBatch();
+	}
+	if (!batch)
+	{
+		batch = CarveSlab();
+	}
+
+	if (batch->batchCount > 1)
+	{
+		SpinLockGuard lock(&m_lock);
+		PushBatch(batch->next, batch->batchCount - 1);
+	}
+	return batch;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void BlockPool::TrackAllocation()
+{
+	size_t numLive = m_numLive.fetch_add(1, std::memory_order_relaxed) + 1;
+	size_t highWater = m_highWaterLive.load(std::memory_order_relaxed);
+	while (numLive > highWater && !m_highWaterLive.compare_exchange_weak(highWater, numLive, std::memory_order_relaxed))
+	{
+	}
+}
+
+//-----------------------------------------------------------------------------------------------
+static void PrintPoolStats(const BlockPool& pool, void* userData)
+{
+	UNUSED(userData);
+
+	ObjectPoolStats stats = pool.GetStats();
+	ConsolePrintf(WHITE, " %s (%u byte blocks): %u live, %u high water, %u capacity in %u slabs", stats.debugName, (unsigned int)stats.blockBytes,
+		(unsigned int)stats.numLive, (unsigned int)stats.highWaterLive, (unsigned int)stats.capacity, (unsigned int)stats.numSlabs);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(PoolStats, args)
+{
+	UNUSED(args);
+
+	ConsolePrint("Object pools:", WHITE);
+	BlockPool::ForEachRegisteredPool(PrintPoolStats, nullptr);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// ALLOCATION BENCHMARK
+//	Every thread allocates a batch, then hands it to its neighbor to free, so most frees land on a
+//	different thread than the allocation - the job and message pattern the pool is built for
+//-----------------------------------------------------------------------------------------------
+static const int BENCHMARK_OBJECTS_PER_BATCH = 256;
+
+
+//-----------------------------------------------------------------------------------------------
+struct BenchmarkObject
+{
+	uint64_t payload[8];
+
+	BenchmarkObject(uint64_t value) { payload[0] = value; }
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct BenchmarkHandoff
+{
+	std::atomic<BenchmarkObject**> batch;
+	char padding[CACHE_LINE_BYTES - sizeof(std::atomic<BenchmarkObject**>)];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Returns nanoseconds per alloc+free pair
+template<typename AllocFunc, typename FreeFunc>
+static double RunPoolBenchmark(int numThreads, int numBatches, AllocFunc allocFunc, FreeFunc freeFunc)
+{
+	std::vector<BenchmarkHandoff> handoffs(numThreads);
+	for (BenchmarkHandoff& handoff : handoffs)
+	{
+		handoff.batch = nullptr;
+	}
+	std::atomic<bool> hasStarted(false);
+
+	//Two batch arrays per thread, owned out here since the neighbor may still be freeing from one after its owner finishes
+	std::vector<BenchmarkObject*> batchStorage((size_t)numThreads * 2 * BENCHMARK_OBJECTS_PER_BATCH);
+
+	std::vector<std::thread> threads;
+	for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		threads.emplace_back([&, threadIndex]()
+		{
+			BenchmarkObject** myBatches = &batchStorage[(size_t)threadIndex * 2 * BENCHMARK_OBJECTS_PER_BATCH];
+			BenchmarkHandoff& myHandoff = handoffs[threadIndex];
+			BenchmarkHandoff& neighborHandoff = handoffs[(threadIndex + 1) % numThreads];
+			while (!hasStarted)
+			{
+				std::this_thread::yield();
+			}
+
+			for (int batchIndex = 0; batchIndex < numBatches; batchIndex++)
+			{
+				BenchmarkObject** batch = myBatches + (batchIndex & 1) * BENCHMARK_OBJECTS_PER_BATCH;
+				for (int i = 0; i < BENCHMARK_OBJECTS_PER_BATCH; i++)
+				{
+					batch[i] = allocFunc((uint64_t)i);
+				}
+
+				//Wait for the neighbor to take the last batch, then give it this one
+				BenchmarkObject** expected = nullptr;
+				while (!neighborHandoff.batch.compare_exchange_weak(expected, batch))
+				{
+					expected = nullptr;
+					std::this_thread::yield();
+				}
+
+				//Free whatever the other neighbor handed us.  Clearing the slot afterwards tells them the array is free to reuse
+				BenchmarkObject** received = nullptr;
+				while ((received = myHandoff.batch.load()) == nullptr)
+				{
+					std::this_thread::yield();
+				}
+				for (int i = 0; i < BENCHMARK_OBJECTS_PER_BATCH; i++)
+				{
+					freeFunc(received[i]);
+				}
+				myHandoff.batch = nullptr;
+			}
+		});
+	}
+
+	double startSeconds = GetCurrentTimeSeconds();
+	hasStarted = true;
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	double elapsedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	return elapsedSeconds * 1.0e9 / ((double)numThreads * numBatches * BENCHMARK_OBJECTS_PER_BATCH);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(PoolBenchmark, args)
+{
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	int numBatches = 2000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			maxThreads = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numBatches = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: poolbenchmark [maxThreads] [numBatches]", RED);
+		return;
+	}
+
+	if (maxThreads < 1 || numBatches < 1)
+	{
+		ConsolePrint("Need at least one thread and one batch", RED);
+		return;
+	}
+
+	ConsolePrintf(WHITE, "Pool benchmark: %i batches of %i objects per thread, freed on the next thread over (ns per alloc+free)", numBatches, BENCHMARK_OBJECTS_PER_BATCH);
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads++)
+	{
+		double heapNanoseconds = RunPoolBenchmark(numThreads, numBatches,
+			[](uint64_t value) { return new BenchmarkObject(value); },
+			[](BenchmarkObject* toFree) { delete toFree; });
+
+		ObjectPool<BenchmarkObject> pool(0, "Pool benchmark");
+		double poolNanoseconds = RunPoolBenchmark(numThreads, numBatches,
+			[&pool](uint64_t value) { return pool.Create(value); },
+			[&pool](BenchmarkObject* toFree) { pool.Free(toFree); });
+
+		ObjectPoolStats stats = pool.GetStats();
+		bool isValid = (stats.numLive == 0);
+		ConsolePrintf(isValid ? WHITE : RED, " %i threads: new/delete %.1f, pool %.1f (high water %u, %u slabs)%s", numThreads, heapNanoseconds, poolNanoseconds,
+			(unsigned int)stats.highWaterLive, (unsigned int)stats.numSlabs, isValid ? "" : " (LEAKED OBJECTS)");
+	}
+}
\ No newline at end of file
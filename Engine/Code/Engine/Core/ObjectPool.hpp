@@ -1,26 +1,134 @@
 #pragma once
 
+#include "Engine/Memory/SpinLock.hpp"
+
+#include <atomic>
+#include <stdint.h>
+#include <stdlib.h>
+
 
 //-----------------------------------------------------------------------------------------------
-template<typename T>
-class ObjectPool
+struct ObjectPoolStats
+{
+	const char* debugName;
+	size_t blockBytes;
+	size_t numLive;
+	size_t highWaterLive;
+	size_t capacity;
+	size_t numSlabs;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Untyped fixed-size block allocator behind ObjectPool.  Grows a slab (64KB by default) at a time
+// and never gives slabs back until it dies.
+//
+// Each thread keeps its own free list per pool, so the common Allocate/Free is a pointer pop/push
+// with no synchronization.  Lists trade blocks with the pool's global return list in whole
+// batches, which is what keeps producer/consumer patterns (allocate here, free over there) cheap.
+// Only the first MAX_CACHED_POOLS live pools get thread caches; the rest take the global lock.
+//
+// Slabs are cache-line aligned and blocks are laid out at alignof(T), so declare T alignas(64)
+// if objects used on different threads must not share lines.
+//-----------------------------------------------------------------------------------------------
+class BlockPool
 {
+	friend struct ThreadBlockCache;
+	friend struct ThreadBlockCaches;
 public:
-	ObjectPool(size_t maxNumObjects);
-	~ObjectPool();
-	template<typename... Args> T* Create(Args... args);
-	void Free(T* toFree);
+	static const int MAX_CACHED_POOLS = 64;
+	static const size_t DEFAULT_SLAB_BYTES = 64 * 1024;
+
+public:
+	BlockPool(size_t blockBytes, size_t blockAlignment, size_t initialNumBlocks = 0, const char* debugName = nullptr);
+	~BlockPool();
+
+	void* Allocate();
+	void Free(void* block);
+	ObjectPoolStats GetStats() const;
+
+	//Every pool with a thread cache slot, for the poolstats command
+	static void ForEachRegisteredPool(void(*callback)(const BlockPool& pool, void* userData), void* userData);
 
 private:
-	struct Page
+	BlockPool(const BlockPool&) = delete;
+	void operator=(const BlockPool&) = delete;
+
+	struct FreeBlock
 	{
-		Page* nextPage;
+		FreeBlock* next;
+		FreeBlock* nextBatch;
+		size_t batchCount;
 	};
 
+	struct Slab
+	{
+		Slab* next;
+		void* allocation;
+	};
+
+	FreeBlock* CarveSlab();
+	FreeBlock* PopBatch();
+	void PushBatch(FreeBlock* first, size_t count);
+	void* AllocateWithoutCache();
+	void TrackAllocation();
+
 private:
-	Page* m_freeListHead;
-	void* m_initialPointer;
+	mutable SpinLock m_lock;
+	FreeBlock* m_batches;
+	Slab* m_slabs;
+	size_t m_numSlabs;
+
+	size_t m_blockStride;
+	size_t m_blocksPerSlab;
+	size_t m_batchSize;
+	const char* m_debugName;
 
+	int m_cacheSlot;
+	uint64_t m_poolID;
+
+	std::atomic<size_t> m_numLive;
+	std::atomic<size_t> m_highWaterLive;
+	std::atomic<size_t> m_capacity;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Typed wrapper over BlockPool.  Thread-safe, grows on demand, and runs destructors on Free
+template<typename T>
+class ObjectPool
+{
+public:
+	ObjectPool(size_t initialNumObjects = 0, const char* debugName = nullptr);
+	template<typename... Args> T* Create(Args&&... args);
+	void Free(T* toFree);
+	ObjectPoolStats GetStats() const { return m_blocks.GetStats(); }
+
+private:
+	BlockPool m_blocks;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Routes an STL container's single-element allocations (list/map/set nodes, one-element deque blocks
+//of big types) through a process-wide pool per node type.  Array allocations go to the heap as usual
+template<typename T>
+class PoolSTLAllocator
+{
+public:
+	typedef T value_type;
+
+	PoolSTLAllocator() {}
+	template<typename U> PoolSTLAllocator(const PoolSTLAllocator<U>&) {}
+
+	T* allocate(size_t count);
+	void deallocate(T* toFree, size_t count);
+
+	template<typename U> bool operator==(const PoolSTLAllocator<U>&) const { return true; }
+	template<typename U> bool operator!=(const PoolSTLAllocator<U>&) const { return false; }
+
+private:
+	static BlockPool& GetSharedPool();
 };
 
 #include "Engine/Core/ObjectPool.inl"
\ No newline at end of file
@@ -2,59 +2,71 @@
 //INLINE FILE FOR OBJECT POOL TEMPLATE CLASS
 //-----------------------------------------------------------------------------------------------
 
-#include "Engine/Core/ErrorWarningAssert.hpp"
-#include "Engine/Math/MathUtils.hpp"
-#include <stdlib.h>
+#include <new>
+#include <utility>
 
 
 //-----------------------------------------------------------------------------------------------
 template<typename T>
-ObjectPool<T>::ObjectPool(size_t maxNumObjects)
-	: m_freeListHead(nullptr)
+ObjectPool<T>::ObjectPool(size_t initialNumObjects /*= 0*/, const char* debugName /*= nullptr*/)
+	: m_blocks(sizeof(T), alignof(T), initialNumObjects, debugName)
 {
-	ASSERT_OR_DIE(maxNumObjects > 0, "Cannot allocate fewer than 1 object");
-	size_t sizeOfPage = Max(sizeof(T), sizeof(Page));
-	size_t numBytes = maxNumObjects * sizeOfPage;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+template<typename... Args>
+T* ObjectPool<T>::Create(Args&&... ctorArgs)
+{
+	return new (m_blocks.Allocate()) T(std::forward<Args>(ctorArgs)...);
+}
 
-	m_initialPointer = malloc(numBytes);
 
-	for (size_t i = 0; i < maxNumObjects; i++)
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void ObjectPool<T>::Free(T* toFree)
+{
+	if (!toFree)
 	{
-		Page* currPage = (Page*)((size_t)m_initialPointer + i * sizeOfPage);
-		currPage->nextPage = m_freeListHead;
-		m_freeListHead = currPage;
+		return;
 	}
+
+	toFree->~T();
+	m_blocks.Free(toFree);
 }
 
 
 //-----------------------------------------------------------------------------------------------
 template<typename T>
-ObjectPool<T>::~ObjectPool()
+T* PoolSTLAllocator<T>::allocate(size_t count)
 {
-	free(m_initialPointer);
+	if (count == 1)
+	{
+		return (T*)GetSharedPool().Allocate();
+	}
+	return (T*)::operator new(count * sizeof(T));
 }
 
 
 //-----------------------------------------------------------------------------------------------
 template<typename T>
-template<typename... Args>
-T* ObjectPool<T>::Create(Args... ctorArgs)
+void PoolSTLAllocator<T>::deallocate(T* toFree, size_t count)
 {
-	ASSERT_OR_DIE(m_freeListHead, "Object pool ran out of space!");
-
-	T* currObjectMemory = (T*)m_freeListHead;
-	m_freeListHead = m_freeListHead->nextPage;
-	new (currObjectMemory) T(ctorArgs...);
-	
-	return currObjectMemory;
+	if (count == 1)
+	{
+		GetSharedPool().Free(toFree);
+		return;
+	}
+	::operator delete(toFree);
 }
 
 
 //-----------------------------------------------------------------------------------------------
 template<typename T>
-void ObjectPool<T>::Free(T* toFree)
+BlockPool& PoolSTLAllocator<T>::GetSharedPool()
 {
-	Page* currPage = (Page*)toFree;
-	currPage->nextPage = m_freeListHead;
-	m_freeListHead = currPage;
+	//Never destroyed, so containers in other statics can still free nodes during exit
+	static BlockPool* s_pool = new BlockPool(sizeof(T), alignof(T), 0, "STL nodes");
+	return *s_pool;
 }
\ No newline at end of file
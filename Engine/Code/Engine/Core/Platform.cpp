@@ -0,0 +1,213 @@
+#include "Engine/Core/Platform.hpp"
+
+#include <string.h>
+
+#if defined(PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <execinfo.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+std::thread* Platform::StartThread(const std::string& name, int coreIndex, const ThreadEntryFunc& entryFunc)
+{
+	return new std::thread([name, coreIndex, entryFunc]()
+	{
+		SetCurrentThreadName(name.c_str());
+		if (coreIndex >= 0)
+		{
+			SetCurrentThreadAffinity(coreIndex);
+		}
+		entryFunc();
+	});
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static const size_t MAX_THREAD_NAME_LENGTH = 32;
+static thread_local char t_threadName[MAX_THREAD_NAME_LENGTH];
+
+
+//-----------------------------------------------------------------------------------------------
+static void RememberThreadName(const char* name)
+{
+	strncpy(t_threadName, name, MAX_THREAD_NAME_LENGTH - 1);
+	t_threadName[MAX_THREAD_NAME_LENGTH - 1] = '\0';
+}
+
+
+//-----------------------------------------------------------------------------------------------
+const char* Platform::GetCurrentThreadName()
+{
+	return t_threadName;
+}
+
+
+#if defined(PLATFORM_WINDOWS)
+//-----------------------------------------------------------------------------------------------
+uint64_t Platform::GetPerformanceCounter()
+{
+	LARGE_INTEGER result;
+	QueryPerformanceCounter(&result);
+	return (uint64_t)result.QuadPart;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static uint64_t QueryFrequency()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return (uint64_t)frequency.QuadPart;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint64_t Platform::GetPerformanceFrequency()
+{
+	static const uint64_t s_frequency = QueryFrequency();
+	return s_frequency;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int Platform::GetNumLogicalCores()
+{
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (int)si.dwNumberOfProcessors;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//The debugger picks thread names out of this exception (works on every Windows version, unlike SetThreadDescription)
+#pragma pack(push, 8)
+struct ThreadNameInfo
+{
+	DWORD type;
+	LPCSTR name;
+	DWORD threadID;
+	DWORD flags;
+};
+#pragma pack(pop)
+
+void Platform::SetCurrentThreadName(const char* name)
+{
+	RememberThreadName(name);
+
+	const DWORD MS_VC_EXCEPTION = 0x406D1388;
+
+	ThreadNameInfo info;
+	info.type = 0x1000;
+	info.name = name;
+	info.threadID = (DWORD)-1;
+	info.flags = 0;
+
+	__try
+	{
+		RaiseException(MS_VC_EXCEPTION, 0, sizeof(info) / sizeof(ULONG_PTR), (ULONG_PTR*)&info);
+	}
+	__except (EXCEPTION_EXECUTE_HANDLER)
+	{
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool Platform::SetCurrentThreadAffinity(int coreIndex)
+{
+	if (coreIndex < 0 || coreIndex >= (int)(sizeof(DWORD_PTR) * 8))
+	{
+		return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << coreIndex) != 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int Platform::CaptureCallstack(void** outFrames, int maxFrames, int framesToSkip)
+{
+	//Skip ourselves too
+	return (int)CaptureStackBackTrace((DWORD)(framesToSkip + 1), (DWORD)maxFrames, outFrames, nullptr);
+}
+
+
+#else
+//-----------------------------------------------------------------------------------------------
+uint64_t Platform::GetPerformanceCounter()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint64_t Platform::GetPerformanceFrequency()
+{
+	return 1000000000ULL;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int Platform::GetNumLogicalCores()
+{
+	cpu_set_t allowedCores;
+	if (sched_getaffinity(0, sizeof(allowedCores), &allowedCores) == 0)
+	{
+		return CPU_COUNT(&allowedCores);
+	}
+	return (int)sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Platform::SetCurrentThreadName(const char* name)
+{
+	RememberThreadName(name);
+
+	//Linux caps names at 15 characters plus the terminator
+	char truncatedName[16];
+	strncpy(truncatedName, name, sizeof(truncatedName) - 1);
+	truncatedName[sizeof(truncatedName) - 1] = '\0';
+	pthread_setname_np(pthread_self(), truncatedName);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool Platform::SetCurrentThreadAffinity(int coreIndex)
+{
+	if (coreIndex < 0 || coreIndex >= CPU_SETSIZE)
+	{
+		return false;
+	}
+
+	cpu_set_t cores;
+	CPU_ZERO(&cores);
+	CPU_SET(coreIndex, &cores);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int Platform::CaptureCallstack(void** outFrames, int maxFrames, int framesToSkip)
+{
+	//backtrace has no skip parameter, so capture into a scratch buffer and drop the top (plus ourselves)
+	static const int MAX_CAPTURED_FRAMES = 128;
+	void* capturedFrames[MAX_CAPTURED_FRAMES];
+	int numToSkip = framesToSkip + 1;
+	int numCaptured = backtrace(capturedFrames, (maxFrames + numToSkip < MAX_CAPTURED_FRAMES) ? maxFrames + numToSkip : MAX_CAPTURED_FRAMES);
+	int numFrames = 0;
+	for (int i = numToSkip; i < numCaptured && numFrames < maxFrames; i++)
+	{
+		outFrames[numFrames++] = capturedFrames[i];
+	}
+	return numFrames;
+}
+#endif
\ No newline at end of file
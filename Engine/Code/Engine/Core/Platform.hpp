@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <functional>
+
+#if defined(_WIN32) && !defined(PLATFORM_WINDOWS)
+#define PLATFORM_WINDOWS
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+// The small slice of the OS that Core needs for threading and timing.  Windows and Linux
+// (pthreads) implementations live in Platform.cpp, so nothing else has to include <windows.h>.
+//-----------------------------------------------------------------------------------------------
+namespace Platform
+{
+	typedef std::function<void()> ThreadEntryFunc;
+
+	//High-resolution monotonic clock.  Counts are only meaningful relative to each other
+	uint64_t GetPerformanceCounter();
+	uint64_t GetPerformanceFrequency();
+
+	//Logical cores available to this process
+	int GetNumLogicalCores();
+
+	//Pass coreIndex < 0 to leave the thread unpinned.  Names show up in debuggers and profilers
+	std::thread* StartThread(const std::string& name, int coreIndex, const ThreadEntryFunc& entryFunc);
+	void SetCurrentThreadName(const char* name);
+	const char* GetCurrentThreadName(); //Empty if SetCurrentThreadName was never called on this thread
+	bool SetCurrentThreadAffinity(int coreIndex);
+
+	//Return addresses of the calling thread's stack, innermost first.  Never allocates through operator new
+	int CaptureCallstack(void** outFrames, int maxFrames, int framesToSkip);
+
+	//Cheapest clock there is, for ordering events across threads.  Not convertible to seconds
+	inline uint64_t GetTimestampCounter()
+	{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return GetPerformanceCounter();
+#endif
+	}
+
+	//Hint to the core that we're in a spin-wait loop
+	inline void CpuRelax()
+	{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+}
\ No newline at end of file
@@ -0,0 +1,471 @@
+#include "Engine/Core/ProfileStats.hpp"
+#include "Engine/Core/Profiler.hpp"
+#include "Engine/Core/Logger.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+#include <algorithm>
+#include <map>
+#include <string.h>
+#include <unordered_map>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+static int GetHighestSetBit(uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long bitIndex;
+	_BitScanReverse64(&bitIndex, value);
+	return (int)bitIndex;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LatencyHistogram::Clear()
+{
+	memset(m_counts, 0, sizeof(m_counts));
+	m_count = 0;
+	m_sum = 0;
+	m_max = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LatencyHistogram::Record(uint64_t value)
+{
+	m_counts[GetBucketIndex(value)]++;
+	m_count++;
+	m_sum += value;
+	m_max = (value > m_max) ? value : m_max;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void LatencyHistogram::Add(const LatencyHistogram& other)
+{
+	for (int bucketIndex = 0; bucketIndex < NUM_BUCKETS; bucketIndex++)
+	{
+		m_counts[bucketIndex] += other.m_counts[bucketIndex];
+	}
+	m_count += other.m_count;
+	m_sum += other.m_sum;
+	m_max = (other.m_max > m_max) ? other.m_max : m_max;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint64_t LatencyHistogram::GetValueAtPercentile(double percentile) const
+{
+	if (m_count == 0)
+	{
+		return 0;
+	}
+
+	uint64_t targetCount = (uint64_t)(percentile / 100. * (double)m_count + 0.5);
+	targetCount = (targetCount < 1) ? 1 : targetCount;
+
+	uint64_t countSoFar = 0;
+	for (int bucketIndex = 0; bucketIndex < NUM_BUCKETS; bucketIndex++)
+	{
+		countSoFar += m_counts[bucketIndex];
+		if (countSoFar >= targetCount)
+		{
+			uint64_t midpoint = GetBucketMidpoint(bucketIndex);
+			return (midpoint < m_max) ? midpoint : m_max;
+		}
+	}
+	return m_max;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+	if (value < NUM_SUB_BUCKETS)
+	{
+		return (int)value;
+	}
+
+	//value >> shift lands in [NUM_SUB_BUCKETS, 2 * NUM_SUB_BUCKETS), which picks the sub-bucket
+	int shift = GetHighestSetBit(value) - SUB_BUCKET_BITS;
+	return ((shift + 1) << SUB_BUCKET_BITS) + (int)((value >> shift) - NUM_SUB_BUCKETS);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint64_t LatencyHistogram::GetBucketMidpoint(int bucketIndex)
+{
+	int octave = bucketIndex >> SUB_BUCKET_BITS;
+	int subBucket = bucketIndex & (NUM_SUB_BUCKETS - 1);
+	if (octave == 0)
+	{
+		return (uint64_t)subBucket;
+	}
+
+	int shift = octave - 1;
+	uint64_t lowestValue = (uint64_t)(NUM_SUB_BUCKETS + subBucket) << shift;
+	return lowestValue + ((1ULL << shift) >> 1);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// ROLLING TAG STATS
+//-----------------------------------------------------------------------------------------------
+static const int NUM_WINDOW_SLICES = 6;
+static const double SECONDS_BETWEEN_BUDGET_WARNINGS = 1.;
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileTagStats
+{
+	ProfileTagStats(const std::string& tagName)
+		: tag(tagName)
+		, budgetNanoseconds(0)
+		, frameCounts(0)
+		, isInFrame(false)
+		, lastWarningSeconds(-1.e9)
+		, numSuppressedWarnings(0)
+	{
+		memset(numFramesOverBudget, 0, sizeof(numFramesOverBudget));
+	}
+
+	std::string tag;
+	LatencyHistogram slices[NUM_WINDOW_SLICES];
+	uint64_t numFramesOverBudget[NUM_WINDOW_SLICES];
+	uint64_t budgetNanoseconds;
+
+	//Time accumulated for the frame being recorded
+	uint64_t frameCounts;
+	bool isInFrame;
+
+	double lastWarningSeconds;
+	uint64_t numSuppressedWarnings;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::map<std::string, ProfileTagStats*> s_tagsByName;
+static std::unordered_map<const char*, ProfileTagStats*> s_tagsByPointer;
+static std::vector<ProfileTagStats*> s_tagsInFrame;
+static double s_windowSeconds = 10.;
+static int64_t s_currentSliceNumber = -1;
+
+
+//-----------------------------------------------------------------------------------------------
+static ProfileTagStats* GetOrCreateTagStats(const std::string& tag)
+{
+	auto found = s_tagsByName.find(tag);
+	if (found != s_tagsByName.end())
+	{
+		return found->second;
+	}
+
+	ProfileTagStats* result = new ProfileTagStats(tag);
+	s_tagsByName[tag] = result;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Tags are almost always string literals, so the pointer is a cheap first lookup.  The same text from
+//two translation units can have two pointers, which is why both map to the stats found by name
+static ProfileTagStats* GetTagStatsForSample(const char* tag)
+{
+	auto found = s_tagsByPointer.find(tag);
+	if (found != s_tagsByPointer.end())
+	{
+		return found->second;
+	}
+
+	ProfileTagStats* result = GetOrCreateTagStats(tag);
+	s_tagsByPointer[tag] = result;
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool IsNestedInSameTag(const ProfileSample& sample)
+{
+	for (const ProfileSample* ancestor = sample.parent; ancestor; ancestor = ancestor->parent)
+	{
+		if (ancestor->tag == sample.tag || strcmp(ancestor->tag, sample.tag) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void ClearSlice(int sliceIndex)
+{
+	for (auto& tagPair : s_tagsByName)
+	{
+		tagPair.second->slices[sliceIndex].Clear();
+		tagPair.second->numFramesOverBudget[sliceIndex] = 0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Returns the slice this time lands in, expiring every slice the window moved past on the way
+static int AdvanceWindow(double currentSeconds)
+{
+	double sliceSeconds = s_windowSeconds / (double)NUM_WINDOW_SLICES;
+	int64_t sliceNumber = (int64_t)(currentSeconds / sliceSeconds);
+
+	if (s_currentSliceNumber >= 0 && sliceNumber > s_currentSliceNumber)
+	{
+		int64_t numToClear = sliceNumber - s_currentSliceNumber;
+		numToClear = (numToClear < NUM_WINDOW_SLICES) ? numToClear : NUM_WINDOW_SLICES;
+		for (int64_t sliceOffset = 1; sliceOffset <= numToClear; sliceOffset++)
+		{
+			ClearSlice((int)((s_currentSliceNumber + sliceOffset) % NUM_WINDOW_SLICES));
+		}
+	}
+	if (sliceNumber > s_currentSliceNumber)
+	{
+		s_currentSliceNumber = sliceNumber;
+	}
+
+	return (int)(s_currentSliceNumber % NUM_WINDOW_SLICES);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void CheckBudget(ProfileTagStats* stats, uint64_t frameNanoseconds, int sliceIndex, uint64_t frameNumber, double currentSeconds)
+{
+	if (stats->budgetNanoseconds == 0 || frameNanoseconds <= stats->budgetNanoseconds)
+	{
+		return;
+	}
+
+	stats->numFramesOverBudget[sliceIndex]++;
+	if (currentSeconds - stats->lastWarningSeconds < SECONDS_BETWEEN_BUDGET_WARNINGS)
+	{
+		stats->numSuppressedWarnings++;
+		return;
+	}
+
+	BINARY_TAG_LOG(WARNING_MAJOR, "Profiler", "%s took %.3fms in frame %llu, over its %.3fms budget (%llu more times since the last warning)\n", stats->tag,
+		(double)frameNanoseconds * 1.e-6, frameNumber, (double)stats->budgetNanoseconds * 1.e-6, stats->numSuppressedWarnings);
+	stats->lastWarningSeconds = currentSeconds;
+	stats->numSuppressedWarnings = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileStats::RecordFrame(const ProfileFrame& frame)
+{
+	if (frame.samples.empty())
+	{
+		return;
+	}
+
+	double currentSeconds = ProfilerHelper::PerformanceCountToSeconds(frame.endCounter);
+	int sliceIndex = AdvanceWindow(currentSeconds);
+
+	for (const ProfileSample& sample : frame.samples)
+	{
+		if (IsNestedInSameTag(sample))
+		{
+			continue;
+		}
+
+		ProfileTagStats* stats = GetTagStatsForSample(sample.tag);
+		if (!stats->isInFrame)
+		{
+			stats->isInFrame = true;
+			stats->frameCounts = 0;
+			s_tagsInFrame.push_back(stats);
+		}
+		stats->frameCounts += sample.endCounter - sample.startCounter;
+	}
+
+	for (ProfileTagStats* stats : s_tagsInFrame)
+	{
+		uint64_t frameNanoseconds = (uint64_t)(ProfilerHelper::PerformanceCountToSeconds(stats->frameCounts) * 1.e9);
+		stats->slices[sliceIndex].Record(frameNanoseconds);
+		CheckBudget(stats, frameNanoseconds, sliceIndex, frame.frameNumber, currentSeconds);
+		stats->isInFrame = false;
+	}
+	s_tagsInFrame.clear();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileStats::Reset()
+{
+	for (int sliceIndex = 0; sliceIndex < NUM_WINDOW_SLICES; sliceIndex++)
+	{
+		ClearSlice(sliceIndex);
+	}
+	s_currentSliceNumber = -1;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileStats::SetWindowSeconds(double windowSeconds)
+{
+	//Slice numbers mean something else at a new width, so start over
+	s_windowSeconds = windowSeconds;
+	Reset();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+double ProfileStats::GetWindowSeconds()
+{
+	return s_windowSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void ProfileStats::SetBudget(const std::string& tag, double budgetMs)
+{
+	ProfileTagStats* stats = GetOrCreateTagStats(tag);
+	stats->budgetNanoseconds = (budgetMs > 0.) ? (uint64_t)(budgetMs * 1.e6) : 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+std::vector<ProfileTagSummary> ProfileStats::GetSummaries()
+{
+	std::vector<ProfileTagSummary> result;
+
+	LatencyHistogram windowHistogram;
+	for (auto& tagPair : s_tagsByName)
+	{
+		const ProfileTagStats* stats = tagPair.second;
+
+		windowHistogram.Clear();
+		uint64_t numFramesOverBudget = 0;
+		for (int sliceIndex = 0; sliceIndex < NUM_WINDOW_SLICES; sliceIndex++)
+		{
+			windowHistogram.Add(stats->slices[sliceIndex]);
+			numFramesOverBudget += stats->numFramesOverBudget[sliceIndex];
+		}
+		if (windowHistogram.GetCount() == 0)
+		{
+			continue;
+		}
+
+		ProfileTagSummary summary;
+		summary.tag = stats->tag;
+		summary.numFrames = windowHistogram.GetCount();
+		summary.meanMs = windowHistogram.GetMean() * 1.e-6;
+		summary.p50Ms = (double)windowHistogram.GetValueAtPercentile(50.) * 1.e-6;
+		summary.p95Ms = (double)windowHistogram.GetValueAtPercentile(95.) * 1.e-6;
+		summary.p99Ms = (double)windowHistogram.GetValueAtPercentile(99.) * 1.e-6;
+		summary.maxMs = (double)windowHistogram.GetMax() * 1.e-6;
+		summary.budgetMs = (double)stats->budgetNanoseconds * 1.e-6;
+		summary.numFramesOverBudget = numFramesOverBudget;
+		result.push_back(summary);
+	}
+
+	std::sort(result.begin(), result.end(), [](const ProfileTagSummary& first, const ProfileTagSummary& second) { return first.p99Ms > second.p99Ms; });
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Print through the console, so all of these answer over the remote command service too
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(ProfilerStats, args)
+{
+	int maxTags = 20;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			maxTags = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: profilerstats [maxTags]", RED);
+		return;
+	}
+
+	std::vector<ProfileTagSummary> summaries = ProfileStats::GetSummaries();
+	if (summaries.empty())
+	{
+		ConsolePrint("No profile data in the window.  Is the profiler on?", RED);
+		return;
+	}
+
+	ConsolePrintf(WHITE, "Per-frame ms over the last %.1f seconds:", ProfileStats::GetWindowSeconds());
+	ConsolePrintf(WHITE, "%-24s %8s %9s %9s %9s %9s %9s %s", "TAG", "FRAMES", "MEAN", "P50", "P95", "P99", "MAX", "BUDGET");
+	for (int summaryIndex = 0; summaryIndex < (int)summaries.size() && summaryIndex < maxTags; summaryIndex++)
+	{
+		const ProfileTagSummary& summary = summaries[summaryIndex];
+		std::string budgetString = (summary.budgetMs > 0.) ? Stringf("%.3f (%llu over)", summary.budgetMs, (unsigned long long)summary.numFramesOverBudget) : "-";
+		ConsolePrintf((summary.numFramesOverBudget > 0) ? RED : WHITE, "%-24s %8llu %9.3f %9.3f %9.3f %9.3f %9.3f %s", summary.tag.c_str(), (unsigned long long)summary.numFrames,
+			summary.meanMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs, budgetString.c_str());
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(ProfilerBudget, args)
+{
+	std::string tag = args.GetNextArg();
+	double budgetMs = 0.;
+
+	try
+	{
+		budgetMs = std::stod(args.GetNextArg());
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: profilerbudget <tag> <milliseconds> (0 removes the budget)", RED);
+		return;
+	}
+
+	ProfileStats::SetBudget(tag, budgetMs);
+	if (budgetMs > 0.)
+	{
+		ConsolePrintf(WHITE, "%s is budgeted %.3fms per frame", tag.c_str(), budgetMs);
+	}
+	else
+	{
+		ConsolePrintf(WHITE, "%s has no budget", tag.c_str());
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(ProfilerWindow, args)
+{
+	double windowSeconds = 0.;
+
+	try
+	{
+		windowSeconds = std::stod(args.GetNextArg());
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: profilerwindow <seconds>", RED);
+		return;
+	}
+
+	if (windowSeconds <= 0.)
+	{
+		ConsolePrint("Window has to be longer than 0 seconds", RED);
+		return;
+	}
+
+	ProfileStats::SetWindowSeconds(windowSeconds);
+	ConsolePrintf(WHITE, "Profile stats now cover the last %.1f seconds", windowSeconds);
+}
\ No newline at end of file
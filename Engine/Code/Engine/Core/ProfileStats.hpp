@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileFrame;
+
+
+//-----------------------------------------------------------------------------------------------
+// Log-linear histogram in the spirit of HdrHistogram.  Values below 16 get a bucket each; above
+// that, every power of two is split into 16 equal buckets, so a percentile read back is within
+// about 3% of the real value whatever its magnitude.  Fixed size, never allocates.
+//-----------------------------------------------------------------------------------------------
+class LatencyHistogram
+{
+public:
+	static const int SUB_BUCKET_BITS = 4;
+	static const int NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * NUM_SUB_BUCKETS;
+
+public:
+	LatencyHistogram() { Clear(); }
+
+	void Clear();
+	void Record(uint64_t value);
+	void Add(const LatencyHistogram& other);
+
+	uint64_t GetCount() const { return m_count; }
+	uint64_t GetMax() const { return m_max; }
+	double GetMean() const { return (m_count > 0) ? (double)m_sum / (double)m_count : 0.; }
+	uint64_t GetValueAtPercentile(double percentile) const;
+
+private:
+	static int GetBucketIndex(uint64_t value);
+	static uint64_t GetBucketMidpoint(int bucketIndex);
+
+private:
+	uint32_t m_counts[NUM_BUCKETS];
+	uint64_t m_count;
+	uint64_t m_sum;
+	uint64_t m_max;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileTagSummary
+{
+	std::string tag;
+	uint64_t numFrames;
+	double meanMs;
+	double p50Ms;
+	double p95Ms;
+	double p99Ms;
+	double maxMs;
+	double budgetMs;
+	uint64_t numFramesOverBudget;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Rolling per-tag distributions of time per frame, fed from every frame the Profiler collects.
+// A tag's time is summed over all its calls on all threads (outermost call only, if it nests in
+// itself).  The window is split into slices that expire whole, so old spikes age out in steps.
+// Tags with a budget log a warning through Logger when a frame goes over, at most once a second
+// per tag.  Everything here runs on the thread that calls Profiler::MarkFrame.
+//-----------------------------------------------------------------------------------------------
+namespace ProfileStats
+{
+	void RecordFrame(const ProfileFrame& frame);
+	void Reset();
+
+	void SetWindowSeconds(double windowSeconds);
+	double GetWindowSeconds();
+
+	//A budget of 0 or less removes it
+	void SetBudget(const std::string& tag, double budgetMs);
+
+	//Tags seen in the window, worst p99 first
+	std::vector<ProfileTagSummary> GetSummaries();
+}
\ No newline at end of file
@@ -1,8 +1,14 @@
 #include "Engine/Core/Profiler.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Platform.hpp"
+#include "Engine/Core/ObjectPool.hpp"
+#include "Engine/Core/ChromeTraceWriter.hpp"
+#include "Engine/Core/ProfileStats.hpp"
+#include "Engine/Core/Memory.hpp"
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+#include <stdio.h>
+#include <string.h>
 
 //-----------------------------------------------------------------------------------------------
 // PROFILER_HELPER NAMESPACE FUNCTIONS
@@ -12,19 +18,15 @@
 //-----------------------------------------------------------------------------------------------
 uint64_t ProfilerHelper::GetCurrentPerformanceCounter()
 {
-	LARGE_INTEGER result;
-	QueryPerformanceCounter(&result);
-	return result.QuadPart;
+	return Platform::GetPerformanceCounter();
 }
 
 
 //-----------------------------------------------------------------------------------------------
 double ProfilerHelper::PerformanceCountToSeconds(const uint64_t& performanceCounter)
 {
-	LARGE_INTEGER frequency;
-	QueryPerformanceFrequency(&frequency);
-	double secondsPerCount = 1. / (double)frequency.QuadPart;
-	return secondsPerCount * (double)performanceCounter;
+	static const double s_secondsPerCount = 1. / (double)Platform::GetPerformanceFrequency();
+	return s_secondsPerCount * (double)performanceCounter;
 }
 
 
@@ -41,51 +43,165 @@ double ProfilerHelper::GetCurrentSeconds()
 
 
 //-----------------------------------------------------------------------------------------------
-bool Profiler::s_isProfiling = false;
+std::atomic<bool> Profiler::s_isProfiling(false);
 bool Profiler::s_desiresProfiling = false;
-ProfileSample* Profiler::s_currFrame = nullptr;
-ProfileSample* Profiler::s_prevFrame = nullptr;
-ProfileSample* Profiler::s_currSample = nullptr;
-ObjectPool<ProfileSample>* Profiler::s_samples = nullptr;
+uint64_t Profiler::s_frameNumber = 0;
+ProfileFrame* Profiler::s_currFrame = nullptr;
+ProfileFrame* Profiler::s_prevFrame = nullptr;
+ChromeTraceWriter* Profiler::s_captureWriter = nullptr;
+int Profiler::s_numCaptureFramesRemaining = 0;
+bool Profiler::s_wasProfilingBeforeCapture = false;
 
 
 //-----------------------------------------------------------------------------------------------
 #ifdef __USING_PROFILER
+//-----------------------------------------------------------------------------------------------
+// PER-THREAD SAMPLE BUFFERS
+//	Each thread that pushes a sample gets a ring of records it alone writes.  Records go in in push
+//	order with their depth, which is all MarkFrame needs to rebuild the tree.  The owning thread
+//	publishes committedSeq when its outermost sample closes; MarkFrame copies everything up to it
+//	and publishes readSeq to give the slots back.  A full ring drops samples (they're counted)
+//	rather than ever make the pushing thread wait.
+//
+//	Buffers are never freed, since a thread can still be holding its pointer after Shutdown.
+//-----------------------------------------------------------------------------------------------
+static const size_t PROFILE_RING_CAPACITY = 4096;
+static const int MAX_PROFILE_DEPTH = 64;
+static const uint64_t SKIPPED_SAMPLE = ~0ULL;
+static const size_t MAX_PROFILE_THREAD_NAME_LENGTH = 32;
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileRecord
+{
+	const char* tag;
+	uint64_t startCounter;
+	uint64_t endCounter;
+	uint64_t bytesAllocated;
+	uint64_t bytesFreed;
+	int depth;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileThreadBuffer
+{
+	ProfileRecord records[PROFILE_RING_CAPACITY];
+	std::atomic<uint64_t> committedSeq;
+	std::atomic<uint64_t> readSeq;
+	std::atomic<uint64_t> numDropped;
+	uint64_t writeSeq;
+
+	//Ring position of each open sample, or SKIPPED_SAMPLE if it wasn't recorded
+	uint64_t openSamples[MAX_PROFILE_DEPTH];
+	int numOpenSamples;
+	int numOpenRecordedSamples;
+
+	int threadID;
+	char threadName[MAX_PROFILE_THREAD_NAME_LENGTH];
+	ProfileThreadBuffer* next;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic<ProfileThreadBuffer*> s_threadBuffers(nullptr);
+static std::atomic<int> s_nextProfileThreadID(0);
+static ProfileThreadBuffer* s_mainThreadBuffer = nullptr;
+static thread_local ProfileThreadBuffer* t_threadBuffer = nullptr;
+
+
+//-----------------------------------------------------------------------------------------------
+static ProfileThreadBuffer* RegisterProfileThread()
+{
+	ScopedMemoryTag memoryTag(MEMTAG_PROFILER);
+	ProfileThreadBuffer* result = new ProfileThreadBuffer;
+	result->committedSeq.store(0, std::memory_order_relaxed);
+	result->readSeq.store(0, std::memory_order_relaxed);
+	result->numDropped.store(0, std::memory_order_relaxed);
+	result->writeSeq = 0;
+	result->numOpenSamples = 0;
+	result->numOpenRecordedSamples = 0;
+	result->threadID = s_nextProfileThreadID.fetch_add(1, std::memory_order_relaxed);
+
+	const char* threadName = Platform::GetCurrentThreadName();
+	if (threadName[0] != '\0')
+	{
+		strncpy(result->threadName, threadName, MAX_PROFILE_THREAD_NAME_LENGTH - 1);
+		result->threadName[MAX_PROFILE_THREAD_NAME_LENGTH - 1] = '\0';
+	}
+	else
+	{
+		snprintf(result->threadName, MAX_PROFILE_THREAD_NAME_LENGTH, "Thread %i", result->threadID);
+	}
+
+	result->next = s_threadBuffers.load(std::memory_order_relaxed);
+	while (!s_threadBuffers.compare_exchange_weak(result->next, result, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+
+	t_threadBuffer = result;
+	return result;
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void Profiler::Startup()
 {
 	s_desiresProfiling = true;
-	s_samples = new ObjectPool<ProfileSample>(1024);
+	s_currFrame = new ProfileFrame();
+	s_prevFrame = nullptr;
+
+	//Startup is called from the thread that will call MarkFrame
+	s_mainThreadBuffer = t_threadBuffer ? t_threadBuffer : RegisterProfileThread();
+	if (Platform::GetCurrentThreadName()[0] == '\0')
+	{
+		strncpy(s_mainThreadBuffer->threadName, "Main", MAX_PROFILE_THREAD_NAME_LENGTH);
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void Profiler::Shutdown()
 {
+	StopCapture();
 	s_desiresProfiling = false;
-	s_isProfiling = false;
-	delete s_samples;
+	s_isProfiling.store(false, std::memory_order_relaxed);
+	delete s_currFrame;
+	delete s_prevFrame;
+	s_currFrame = nullptr;
+	s_prevFrame = nullptr;
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void Profiler::MarkFrame()
 {
-	if (s_isProfiling)
+	if (s_isProfiling.load(std::memory_order_relaxed))
 	{
 		PopSample();
-		ASSERT_OR_DIE(!s_currSample, "Leaked profile samples!");
-		if (s_prevFrame)
+		ASSERT_OR_DIE(!t_threadBuffer || t_threadBuffer->numOpenSamples == 0, "Leaked profile samples!");
+
+		CollectFrame(*s_currFrame);
+
+		ProfileFrame* finishedFrame = s_currFrame;
+		s_currFrame = s_prevFrame ? s_prevFrame : new ProfileFrame();
+		s_prevFrame = finishedFrame;
+
+		ProfileStats::RecordFrame(*s_prevFrame);
+
+		if (s_captureWriter)
 		{
-			RecursivelyFreeSample(s_prevFrame);
+			s_captureWriter->WriteFrame(*s_prevFrame, MemoryTracker::GetStats());
+			if (--s_numCaptureFramesRemaining <= 0)
+			{
+				StopCapture();
+			}
 		}
-		s_prevFrame = s_currFrame;
-		s_currFrame = nullptr;
 	}
 
-	s_isProfiling = s_desiresProfiling;
+	s_isProfiling.store(s_desiresProfiling, std::memory_order_relaxed);
 
-	if (s_isProfiling)
+	if (s_isProfiling.load(std::memory_order_relaxed))
 	{
 		PushSample("frame");
 	}
@@ -95,85 +211,247 @@ void Profiler::MarkFrame()
 //-----------------------------------------------------------------------------------------------
 void Profiler::PushSample(const char* tag)
 {
-	if (!s_isProfiling)
+	ProfileThreadBuffer* buffer = t_threadBuffer;
+	if (!s_isProfiling.load(std::memory_order_relaxed))
+	{
+		//Still have to keep pushes and pops paired if profiling stopped with samples open
+		if (buffer && buffer->numOpenSamples > 0)
+		{
+			ASSERT_OR_DIE(buffer->numOpenSamples < MAX_PROFILE_DEPTH, "Profile samples nested too deeply");
+			buffer->openSamples[buffer->numOpenSamples++] = SKIPPED_SAMPLE;
+		}
+		return;
+	}
+
+	if (!buffer)
+	{
+		buffer = RegisterProfileThread();
+	}
+	ASSERT_OR_DIE(buffer->numOpenSamples < MAX_PROFILE_DEPTH, "Profile samples nested too deeply");
+
+	if (buffer->writeSeq - buffer->readSeq.load(std::memory_order_acquire) >= PROFILE_RING_CAPACITY)
+	{
+		buffer->numDropped.fetch_add(1, std::memory_order_relaxed);
+		buffer->openSamples[buffer->numOpenSamples++] = SKIPPED_SAMPLE;
+		return;
+	}
+
+	ProfileRecord& record = buffer->records[buffer->writeSeq & (PROFILE_RING_CAPACITY - 1)];
+	record.tag = tag;
+	record.bytesAllocated = 0;
+	record.bytesFreed = 0;
+	record.depth = buffer->numOpenRecordedSamples;
+	record.startCounter = ProfilerHelper::GetCurrentPerformanceCounter();
+
+	buffer->openSamples[buffer->numOpenSamples++] = buffer->writeSeq;
+	buffer->numOpenRecordedSamples++;
+	buffer->writeSeq++;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Profiler::PopSample()
+{
+	//Nothing open means the matching push came before profiling started
+	ProfileThreadBuffer* buffer = t_threadBuffer;
+	if (!buffer || buffer->numOpenSamples == 0)
 	{
 		return;
 	}
 
-	ProfileSample* currSample = s_samples->Create(tag);
-	currSample->startCounter = ProfilerHelper::GetCurrentPerformanceCounter();
+	uint64_t sampleSeq = buffer->openSamples[--buffer->numOpenSamples];
+	if (sampleSeq == SKIPPED_SAMPLE)
+	{
+		return;
+	}
+
+	buffer->records[sampleSeq & (PROFILE_RING_CAPACITY - 1)].endCounter = ProfilerHelper::GetCurrentPerformanceCounter();
+	if (--buffer->numOpenRecordedSamples == 0)
+	{
+		buffer->committedSeq.store(buffer->writeSeq, std::memory_order_release);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Copies one thread's finished samples into the frame and links them back into trees
+static void CollectThreadSamples(ProfileThreadBuffer* buffer, ProfileFrame& frame)
+{
+	uint64_t readSeq = buffer->readSeq.load(std::memory_order_relaxed);
+	uint64_t committedSeq = buffer->committedSeq.load(std::memory_order_acquire);
+	frame.numDroppedSamples += buffer->numDropped.exchange(0, std::memory_order_relaxed);
 
-	if (s_currSample)
+	size_t firstSampleIndex = frame.samples.size();
+	bool isKeepingTree = false;
+	for (uint64_t seq = readSeq; seq < committedSeq; seq++)
 	{
-		currSample->parent = s_currSample;
+		const ProfileRecord& record = buffer->records[seq & (PROFILE_RING_CAPACITY - 1)];
 
-		//Is it the first child?
-		if (!s_currSample->firstChild)
+		//Whole trees left over from before profiling was last turned on are stale
+		if (record.depth == 0)
 		{
-			s_currSample->firstChild = currSample;
+			isKeepingTree = (record.endCounter >= frame.startCounter);
 		}
-		else
+		if (!isKeepingTree)
 		{
-			ProfileSample* currChild = s_currSample->firstChild;
-			while (currChild->nextSibling)
-			{
-				currChild = currChild->nextSibling;
-			}
-			currChild->nextSibling = currSample;
+			continue;
 		}
+
+		ProfileSample sample(record.tag);
+		sample.startCounter = record.startCounter;
+		sample.endCounter = record.endCounter;
+		sample.bytesAllocated = record.bytesAllocated;
+		sample.bytesFreed = record.bytesFreed;
+		sample.threadID = buffer->threadID;
+		sample.depth = record.depth;
+		frame.samples.push_back(sample);
 	}
-	else
+	buffer->readSeq.store(committedSeq, std::memory_order_release);
+
+	if (frame.samples.size() == firstSampleIndex)
 	{
-		s_currFrame = currSample;
+		return;
 	}
 
-	s_currSample = currSample;
+	ProfileFrameThread thread;
+	thread.threadID = buffer->threadID;
+	thread.threadName = buffer->threadName;
+	thread.firstRoot = nullptr;
+	thread.numSamples = frame.samples.size() - firstSampleIndex;
+	frame.threads.push_back(thread);
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void Profiler::PopSample()
+static void LinkThreadSamples(ProfileSample* samples, size_t numSamples, ProfileFrameThread& thread)
 {
-	if (!s_isProfiling)
+	ProfileSample* openAtDepth[MAX_PROFILE_DEPTH];
+	ProfileSample* lastChildAtDepth[MAX_PROFILE_DEPTH + 1];
+	lastChildAtDepth[0] = nullptr;
+	int numOpen = 0;
+
+	for (size_t sampleIndex = 0; sampleIndex < numSamples; sampleIndex++)
 	{
-		return;
+		ProfileSample* sample = &samples[sampleIndex];
+		numOpen = (sample->depth < numOpen) ? sample->depth : numOpen;
+
+		sample->parent = (numOpen > 0) ? openAtDepth[numOpen - 1] : nullptr;
+		ProfileSample* previousSibling = lastChildAtDepth[numOpen];
+		if (previousSibling)
+		{
+			previousSibling->nextSibling = sample;
+		}
+		else if (sample->parent)
+		{
+			sample->parent->firstChild = sample;
+		}
+		else
+		{
+			thread.firstRoot = sample;
+		}
+
+		lastChildAtDepth[numOpen] = sample;
+		openAtDepth[numOpen] = sample;
+		numOpen++;
+		lastChildAtDepth[numOpen] = nullptr;
 	}
+}
+
 
-	ASSERT_OR_DIE(s_currSample, "Attempted to pop null sample");
-	s_currSample->endCounter = ProfilerHelper::GetCurrentPerformanceCounter();
-	s_currSample = s_currSample->parent;
+//-----------------------------------------------------------------------------------------------
+void Profiler::CollectFrame(ProfileFrame& frame)
+{
+	frame.samples.clear();
+	frame.threads.clear();
+	frame.frameNumber = s_frameNumber++;
+	frame.numDroppedSamples = 0;
+
+	//The "frame" sample is the oldest uncollected record on this thread
+	ProfileThreadBuffer* mainBuffer = t_threadBuffer;
+	const ProfileRecord& frameRecord = mainBuffer->records[mainBuffer->readSeq.load(std::memory_order_relaxed) & (PROFILE_RING_CAPACITY - 1)];
+	frame.startCounter = frameRecord.startCounter;
+	frame.endCounter = frameRecord.endCounter;
+
+	CollectThreadSamples(mainBuffer, frame);
+	for (ProfileThreadBuffer* buffer = s_threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+	{
+		if (buffer != mainBuffer)
+		{
+			CollectThreadSamples(buffer, frame);
+		}
+	}
+
+	//Samples can't be linked until the vector is done growing
+	size_t firstSampleIndex = 0;
+	for (ProfileFrameThread& thread : frame.threads)
+	{
+		LinkThreadSamples(&frame.samples[firstSampleIndex], thread.numSamples, thread);
+		firstSampleIndex += thread.numSamples;
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
 bool Profiler::ToggleProfiling()
 {
-	s_desiresProfiling = !s_isProfiling;
+	s_desiresProfiling = !s_isProfiling.load(std::memory_order_relaxed);
 	return s_desiresProfiling;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-ProfileSample* Profiler::GetLastFrame()
+const ProfileFrame* Profiler::GetLastFrame()
 {
 	return s_prevFrame;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void Profiler::RecursivelyFreeSample(ProfileSample* toDelete)
+bool Profiler::StartCapture(int numFrames, const std::string& filePath)
+{
+	if (s_captureWriter || numFrames < 1 || !s_currFrame)
+	{
+		return false;
+	}
+
+	s_captureWriter = new ChromeTraceWriter();
+	if (!s_captureWriter->Open(filePath))
+	{
+		delete s_captureWriter;
+		s_captureWriter = nullptr;
+		return false;
+	}
+
+	s_numCaptureFramesRemaining = numFrames;
+	s_wasProfilingBeforeCapture = s_desiresProfiling;
+	s_desiresProfiling = true;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void Profiler::StopCapture()
 {
-	if (!toDelete)
+	if (!s_captureWriter)
 	{
 		return;
 	}
 
-	RecursivelyFreeSample(toDelete->firstChild);
-	RecursivelyFreeSample(toDelete->nextSibling);
+	s_captureWriter->Close();
+	DebuggerPrintf("Profile capture of %i frames written to %s\n", s_captureWriter->GetNumFramesWritten(), s_captureWriter->GetFilePath().c_str());
+	delete s_captureWriter;
+	s_captureWriter = nullptr;
+	s_desiresProfiling = s_wasProfilingBeforeCapture;
+}
+
 
-	s_samples->Free(toDelete);
+//-----------------------------------------------------------------------------------------------
+bool Profiler::IsCapturing()
+{
+	return s_captureWriter != nullptr;
 }
 
+
 struct ReportEntry
 {
 	const char* tag;
@@ -333,27 +611,57 @@ static std::string GetStringForEntryRecursively(ReportEntry* currEntry, uint64_t
 //-----------------------------------------------------------------------------------------------
 std::string Profiler::CompileReport(EProfileReportFormat format)
 {
-	if (!s_prevFrame)
+	if (!s_prevFrame || s_prevFrame->threads.empty())
 	{
 		return "";
 	}
 
 	uint64_t frameDuration = s_prevFrame->endCounter - s_prevFrame->startCounter;
 
-	ObjectPool<ReportEntry>* entries = new ObjectPool<ReportEntry>(1024);
-	ReportEntry* rootEntry = CreateEntryAndAddToTreeRecursively(s_prevFrame, nullptr, entries);
-	ReportEntry* lastSiblingOfRoot = rootEntry;
+	ObjectPool<ReportEntry>* entries = new ObjectPool<ReportEntry>(1024, "Profile report entries");
+	std::string result = "TAG\t\tCALLS\t\tTIME\t\t\t\tSELF_TIME\t\t\tPERCENT_FRAME_TIME\t\tBYTES_ALLOCATED\t\tBYTES_FREED\n";
 
-	if (format == PRF_FLAT_VIEW)
+	for (size_t threadIndex = 0; threadIndex < s_prevFrame->threads.size(); threadIndex++)
 	{
-		//If all nodes are on the same level, there is no hierarchy (effectively flat)
-		MakeAllNodesSiblingsOfRootRecursively(rootEntry, lastSiblingOfRoot, true);
-	}
+		const ProfileFrameThread& thread = s_prevFrame->threads[threadIndex];
+
+		//The main thread's tree hangs off "frame" as always; other threads get an entry of their own
+		//whose time is how long they spent inside samples
+		ReportEntry* rootEntry = nullptr;
+		if (threadIndex == 0)
+		{
+			rootEntry = CreateEntryAndAddToTreeRecursively(thread.firstRoot, nullptr, entries);
+		}
+		else
+		{
+			rootEntry = entries->Create();
+			rootEntry->tag = thread.threadName;
+			rootEntry->totalCycles = 0;
+			rootEntry->calls = 0;
+			for (const ProfileSample* root = thread.firstRoot; root; root = root->nextSibling)
+			{
+				rootEntry->totalCycles += root->endCounter - root->startCounter;
+				rootEntry->calls++;
+			}
+			rootEntry->selfCycles = rootEntry->totalCycles;
+			rootEntry->firstChild = CreateEntryAndAddToTreeRecursively(thread.firstRoot, rootEntry, entries);
+		}
+		ReportEntry* lastSiblingOfRoot = rootEntry;
 
-	ConcatenateSiblingsInTreeRecursively(rootEntry, entries);
+		if (format == PRF_FLAT_VIEW)
+		{
+			//If all nodes are on the same level, there is no hierarchy (effectively flat)
+			MakeAllNodesSiblingsOfRootRecursively(rootEntry, lastSiblingOfRoot, true);
+		}
 
-	std::string result = "TAG\t\tCALLS\t\tTIME\t\t\t\tSELF_TIME\t\t\tPERCENT_FRAME_TIME\t\tBYTES_ALLOCATED\t\tBYTES_FREED\n";
-	result += GetStringForEntryRecursively(rootEntry, frameDuration, 0);
+		ConcatenateSiblingsInTreeRecursively(rootEntry, entries);
+		result += GetStringForEntryRecursively(rootEntry, frameDuration, 0);
+	}
+
+	if (s_prevFrame->numDroppedSamples > 0)
+	{
+		result += Stringf("%llu samples dropped (profile ring buffers full)\n", s_prevFrame->numDroppedSamples);
+	}
 
 	delete entries;
 
@@ -362,33 +670,37 @@ std::string Profiler::CompileReport(EProfileReportFormat format)
 
 
 //-----------------------------------------------------------------------------------------------
+//Charged to the innermost sample open on the allocating thread.  Called from operator new, so no allocating in here
 void Profiler::AddAllocation(const uint64_t& bytesAllocated)
 {
-	if (!s_currSample || !s_isProfiling)
+	ProfileThreadBuffer* buffer = t_threadBuffer;
+	if (!buffer || buffer->numOpenSamples == 0)
 	{
 		return;
 	}
 
-	s_currSample->bytesAllocated += bytesAllocated;
+	uint64_t sampleSeq = buffer->openSamples[buffer->numOpenSamples - 1];
+	if (sampleSeq != SKIPPED_SAMPLE)
+	{
+		buffer->records[sampleSeq & (PROFILE_RING_CAPACITY - 1)].bytesAllocated += bytesAllocated;
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void Profiler::SubtractAllocation(const uint64_t& bytesFreed)
 {
-	if (!s_currSample || !s_isProfiling)
+	ProfileThreadBuffer* buffer = t_threadBuffer;
+	if (!buffer || buffer->numOpenSamples == 0)
 	{
 		return;
 	}
 
-	s_currSample->bytesFreed += bytesFreed;
-}
-
-
-//-----------------------------------------------------------------------------------------------
-bool Profiler::IsProfiling()
-{
-	return s_isProfiling;
+	uint64_t sampleSeq = buffer->openSamples[buffer->numOpenSamples - 1];
+	if (sampleSeq != SKIPPED_SAMPLE)
+	{
+		buffer->records[sampleSeq & (PROFILE_RING_CAPACITY - 1)].bytesFreed += bytesFreed;
+	}
 }
 
 #else
@@ -398,12 +710,14 @@ void Profiler::MarkFrame() {}
 void Profiler::PushSample(const char* tag) { UNUSED(tag); }
 void Profiler::PopSample() {}
 bool Profiler::ToggleProfiling() { return false; }
-void Profiler::RecursivelyFreeSample(ProfileSample* toDelete) { UNUSED(toDelete); }
-ProfileSample* Profiler::GetLastFrame() { return nullptr; }
+void Profiler::CollectFrame(ProfileFrame& frame) { UNUSED(frame); }
+const ProfileFrame* Profiler::GetLastFrame() { return nullptr; }
 std::string Profiler::CompileReport(EProfileReportFormat format) { UNUSED(format); return ""; }
+bool Profiler::StartCapture(int numFrames, const std::string& filePath) { UNUSED(numFrames); UNUSED(filePath); return false; }
+void Profiler::StopCapture() {}
+bool Profiler::IsCapturing() { return false; }
 void Profiler::AddAllocation(const uint64_t& bytesAllocated) { UNUSED(bytesAllocated); }
 void Profiler::SubtractAllocation(const uint64_t& bytesFreed) { UNUSED(bytesFreed); }
-bool Profiler::IsProfiling() { return false; }
 #endif
 
 
@@ -444,4 +758,42 @@ CONSOLE_COMMAND(ProfilerPrintFrame, args)
 	{
 		ConsolePrint(currString, WHITE);
 	}
+}
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(ProfilerCapture, args)
+{
+	int numFrames = 300;
+	std::string filePath = "Data/Logs/ProfileCapture.json";
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numFrames = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			filePath = arg;
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: profilercapture [numFrames] [filePath]", RED);
+		return;
+	}
+
+	if (Profiler::IsCapturing())
+	{
+		ConsolePrint("A profile capture is already running", RED);
+		return;
+	}
+	if (!Profiler::StartCapture(numFrames, filePath))
+	{
+		ConsolePrintf(RED, "Could not start a %i frame capture to %s", numFrames, filePath.c_str());
+		return;
+	}
+	ConsolePrintf(WHITE, "Capturing %i frames to %s", numFrames, filePath.c_str());
 }
\ No newline at end of file
@@ -1,13 +1,11 @@
 #pragma once
 
 #include "Engine/Core/BuildConfig.hpp"
-#include "Engine/Core/ObjectPool.hpp"
 #include "Engine/Core/Logger.hpp"
+#include <atomic>
 #include <string>
-
-
-//-----------------------------------------------------------------------------------------------
-typedef unsigned __int64 uint64_t;
+#include <vector>
+#include <stdint.h>
 
 
 //-----------------------------------------------------------------------------------------------
@@ -29,12 +27,46 @@ struct ProfileSample
 	ProfileSample* nextSibling;
 	uint64_t bytesAllocated;
 	uint64_t bytesFreed;
+	int threadID;
+	int depth;
 
 	//Initialize with tag, make sure pointers are null until set
-	ProfileSample(const char* thisTag) : tag(thisTag), parent(nullptr), firstChild(nullptr), nextSibling(nullptr), bytesAllocated(0), bytesFreed(0) {}
+	ProfileSample(const char* thisTag) : tag(thisTag), parent(nullptr), firstChild(nullptr), nextSibling(nullptr), bytesAllocated(0), bytesFreed(0), threadID(0), depth(0) {}
+};
+
+
+//-----------------------------------------------------------------------------------------------
+class ChromeTraceWriter;
+
+
+//-----------------------------------------------------------------------------------------------
+struct ProfileFrameThread
+{
+	int threadID;
+	const char* threadName;
+	ProfileSample* firstRoot; //Top-level samples that finished this frame, chained through nextSibling
+	size_t numSamples;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Every thread's samples for one frame.  The thread that calls MarkFrame comes first, and its only
+//root is the "frame" sample spanning startCounter to endCounter
+struct ProfileFrame
+{
+	uint64_t frameNumber;
+	uint64_t startCounter;
+	uint64_t endCounter;
+	uint64_t numDroppedSamples;
+	std::vector<ProfileSample> samples;
+	std::vector<ProfileFrameThread> threads;
 };
 
 
+//-----------------------------------------------------------------------------------------------
+// Any thread can push samples.  Each records into its own ring buffer with no locks, and only hands
+// samples over once its outermost open sample closes.  MarkFrame (main thread) collects everything
+// handed over since the last frame into one ProfileFrame.
 //-----------------------------------------------------------------------------------------------
 class Profiler
 {
@@ -45,22 +77,30 @@ public:
 	static void PushSample(const char* tag);
 	static void PopSample();
 	static bool ToggleProfiling();
-	static ProfileSample* GetLastFrame();
+	static const ProfileFrame* GetLastFrame();
 	static std::string CompileReport(EProfileReportFormat format);
 	static void AddAllocation(const uint64_t& bytesAllocated);
 	static void SubtractAllocation(const uint64_t& bytesFreed);
-	static bool IsProfiling();
+	static bool IsProfiling() { return s_isProfiling.load(std::memory_order_relaxed); }
+
+	//Profiles the next numFrames frames into a Chrome trace (chrome://tracing, ui.perfetto.dev), then
+	//puts profiling back how it was.  Needs nothing but MarkFrame, so it works headless
+	static bool StartCapture(int numFrames, const std::string& filePath);
+	static void StopCapture();
+	static bool IsCapturing();
 
 private:
-	static void RecursivelyFreeSample(ProfileSample* toDelete);
+	static void CollectFrame(ProfileFrame& frame);
 
 private:
-	static bool s_isProfiling;
+	static std::atomic<bool> s_isProfiling;
 	static bool s_desiresProfiling;
-	static ProfileSample* s_currFrame;
-	static ProfileSample* s_prevFrame;
-	static ProfileSample* s_currSample;
-	static ObjectPool<ProfileSample>* s_samples;
+	static uint64_t s_frameNumber;
+	static ProfileFrame* s_currFrame;
+	static ProfileFrame* s_prevFrame;
+	static ChromeTraceWriter* s_captureWriter;
+	static int s_numCaptureFramesRemaining;
+	static bool s_wasProfilingBeforeCapture;
 };
 
 
@@ -0,0 +1,253 @@
+#include "Engine/Core/ReferenceCount.hpp"
+
+
+//-----------------------------------------------------------------------------------------------
+void RefCount::Acquire(void* refCountedPtr)
+{
+	//Whoever hands us the pointer already holds a reference, so no ordering is needed here
+	GetHeader(refCountedPtr)->strongCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void RefCount::AcquireWeak(void* refCountedPtr)
+{
+	GetHeader(refCountedPtr)->weakCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void RefCount::ReleaseWeak(void* refCountedPtr)
+{
+	Header* header = GetHeader(refCountedPtr);
+	if (header->weakCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		header->freeFunc(header);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool RefCount::TryAcquire(void* refCountedPtr)
+{
+	Header* header = GetHeader(refCountedPtr);
+	unsigned int currCount = header->strongCount.load(std::memory_order_relaxed);
+
+	//Never resurrect: once the count hits zero the destructor is already running
+	while (currCount != 0)
+	{
+		if (header->strongCount.compare_exchange_weak(currCount, currCount + 1, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool RefCount::IsAlive(const void* refCountedPtr)
+{
+	return GetHeader(refCountedPtr)->strongCount.load(std::memory_order_acquire) != 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// STRESS TEST
+//-----------------------------------------------------------------------------------------------
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+#include <thread>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+static std::atomic<int> s_stressNumDestroyed;
+static std::atomic<int> s_stressNumFreed;
+static std::atomic<int> s_stressNumErrors;
+
+
+//-----------------------------------------------------------------------------------------------
+struct RefCountStressObject
+{
+	RefCountStressObject() : m_isAlive(true) {}
+	~RefCountStressObject()
+	{
+		if (!m_isAlive.exchange(false))
+		{
+			++s_stressNumErrors;
+		}
+		++s_stressNumDestroyed;
+	}
+
+	std::atomic<bool> m_isAlive;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static void StressFree(void* block)
+{
+	++s_stressNumFreed;
+	free(block);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static RefCountStressObject* CreateStressObject()
+{
+	return RefCount::ConstructAndAcquire<RefCountStressObject>(malloc(RefCount::GetBlockSize<RefCountStressObject>()), StressFree);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void HammerSharedObject(RefCountStressObject* sharedObject, int numIterations)
+{
+	RefCount::WeakRef<RefCountStressObject> weak(sharedObject);
+	for (int i = 0; i < numIterations; i++)
+	{
+		RefCount::Acquire(sharedObject);
+		RefCountStressObject* locked = weak.Lock();
+		if (!locked || !locked->m_isAlive)
+		{
+			++s_stressNumErrors;
+		}
+		else
+		{
+			RefCount::Release(locked);
+		}
+		RefCount::Release(sharedObject);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void PromoteWhileDying(const std::vector<RefCount::WeakRef<RefCountStressObject>>* weakRefs)
+{
+	for (const RefCount::WeakRef<RefCountStressObject>& weak : *weakRefs)
+	{
+		//Keep promoting until the owner wins; every successful promotion must see a live object
+		for (;;)
+		{
+			RefCountStressObject* locked = weak.Lock();
+			if (!locked)
+			{
+				break;
+			}
+			if (!locked->m_isAlive)
+			{
+				++s_stressNumErrors;
+			}
+			RefCount::Release(locked);
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(RefCountStressTest, args)
+{
+	int numThreads = (int)std::thread::hardware_concurrency();
+	int numIterations = 1000000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numThreads = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numIterations = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: refcountstresstest [numThreads] [numIterations]", RED);
+		return;
+	}
+
+	if (numThreads < 1 || numIterations < 1)
+	{
+		ConsolePrint("Need at least one thread and one iteration", RED);
+		return;
+	}
+
+	s_stressNumDestroyed = 0;
+	s_stressNumFreed = 0;
+	s_stressNumErrors = 0;
+
+	//Many threads acquiring, promoting and releasing the same object
+	RefCountStressObject* sharedObject = CreateStressObject();
+	double startTime = GetCurrentTimeSeconds();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back(HammerSharedObject, sharedObject, numIterations);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	double hammerSeconds = GetCurrentTimeSeconds() - startTime;
+	threads.clear();
+
+	RefCount::Header* header = RefCount::GetHeader(sharedObject);
+	if (header->strongCount != 1 || header->weakCount != 1 || s_stressNumDestroyed != 0)
+	{
+		++s_stressNumErrors;
+	}
+	RefCount::Release(sharedObject);
+
+	//Weak holders racing the final release of each object
+	int numObjects = numIterations / 100 + 1;
+	std::vector<RefCountStressObject*> objects;
+	std::vector<RefCount::WeakRef<RefCountStressObject>> weakRefs;
+	objects.reserve(numObjects);
+	weakRefs.reserve(numObjects);
+	for (int i = 0; i < numObjects; i++)
+	{
+		objects.push_back(CreateStressObject());
+		weakRefs.emplace_back(objects.back());
+	}
+
+	startTime = GetCurrentTimeSeconds();
+	for (int i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back(PromoteWhileDying, &weakRefs);
+	}
+	for (RefCountStressObject* object : objects)
+	{
+		RefCount::Release(object);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	double raceSeconds = GetCurrentTimeSeconds() - startTime;
+
+	for (RefCount::WeakRef<RefCountStressObject>& weak : weakRefs)
+	{
+		if (!weak.IsExpired())
+		{
+			++s_stressNumErrors;
+		}
+	}
+	weakRefs.clear();
+
+	int expectedObjects = numObjects + 1;
+	if (s_stressNumDestroyed != expectedObjects || s_stressNumFreed != expectedObjects)
+	{
+		++s_stressNumErrors;
+	}
+
+	ConsolePrintf(WHITE, "Shared acquire/release: %i threads x %i iterations in %.3fms (%.1fns/iteration)", numThreads, numIterations,
+		hammerSeconds * 1000.0, hammerSeconds * 1.0e9 / ((double)numThreads * numIterations));
+	ConsolePrintf(WHITE, "Weak promotion vs final release: %i objects in %.3fms", numObjects, raceSeconds * 1000.0);
+	ConsolePrintf(s_stressNumErrors == 0 ? WHITE : RED, "Destroyed %i, freed %i of %i, %i errors",
+		(int)s_stressNumDestroyed, (int)s_stressNumFreed, expectedObjects, (int)s_stressNumErrors);
+}
\ No newline at end of file
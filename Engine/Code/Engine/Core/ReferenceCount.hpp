@@ -1,40 +1,80 @@
 #pragma once
 
 #include <stdlib.h>
+#include <atomic>
+#include <new>
 
 
+//-----------------------------------------------------------------------------------------------
+// Intrusive, thread-safe reference counting.  The count lives in a header just in front of the
+// object, so a ref counted T* is still a plain pointer.
+//
+// Strong references keep the object alive; weak references keep only the memory alive, so a
+// weak holder can safely ask whether the object still exists and promote itself if it does.
+// All strong references together hold one weak reference, which is dropped on destruction.
 //-----------------------------------------------------------------------------------------------
 namespace RefCount
 {
+	typedef void(*FreeFunc)(void* block);
+
+	struct Header
+	{
+		std::atomic<unsigned int> strongCount;
+		std::atomic<unsigned int> weakCount;
+		FreeFunc freeFunc;
+	};
+
+	//Bytes needed to hold a ref counted T (count header followed by the object)
+	template<typename T>
+	constexpr size_t GetBlockSize()
+	{
+		return sizeof(T) + sizeof(Header);
+	}
+
+	inline Header* GetHeader(const void* refCountedPtr)
+	{
+		return (Header*)refCountedPtr - 1;
+	}
+
+	//Constructs into caller-provided memory (e.g. from a pool).  freeFunc returns the block once the last weak reference is gone
 	template<typename T, typename... Args>
-	T* CreateAndAcquire(Args... args)
+	T* ConstructAndAcquire(void* memory, FreeFunc freeFunc, Args... args)
 	{
-		size_t* block = (size_t*)malloc(sizeof(T) + sizeof(size_t));
-		*block = 1;
-		++block;
-		T* result = (T*)block;
+		Header* header = (Header*)memory;
+		new (&header->strongCount) std::atomic<unsigned int>(1);
+		new (&header->weakCount) std::atomic<unsigned int>(1);
+		header->freeFunc = freeFunc;
+		++header;
+		T* result = (T*)header;
 		new (result) T(args...);
 
 		return result;
 	}
 
-	void Acquire(void* refCountedPtr)
+	template<typename T, typename... Args>
+	T* CreateAndAcquire(Args... args)
 	{
-		size_t* memory = (size_t*)refCountedPtr;
-		--memory;
-		++(*memory);
+		return ConstructAndAcquire<T>(malloc(GetBlockSize<T>()), free, args...);
 	}
 
+	void Acquire(void* refCountedPtr);
+	void AcquireWeak(void* refCountedPtr);
+	void ReleaseWeak(void* refCountedPtr);
+
+	//Promotes a weak reference to a strong one.  Fails if the object has already been destroyed
+	bool TryAcquire(void* refCountedPtr);
+	bool IsAlive(const void* refCountedPtr);
+
 	template<typename T>
 	void Release(T* refCountedPtr)
 	{
-		size_t* memory = (size_t*)refCountedPtr;
-		--memory;
-		--(*memory);
-		if (*memory == 0)
+		Header* header = GetHeader(refCountedPtr);
+
+		//Release so our writes happen before destruction; acquire so the destroying thread sees everyone else's
+		if (header->strongCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
 		{
 			refCountedPtr->~T();
-			free(memory);
+			ReleaseWeak(refCountedPtr);
 		}
 	}
 
@@ -47,6 +87,7 @@ namespace RefCount
 	template<typename T>
 	class ScopedAcquirer
 	{
+	public:
 		ScopedAcquirer(T* refCountedPtr)
 			: m_refCountedPtr(refCountedPtr)
 		{
@@ -59,6 +100,41 @@ namespace RefCount
 	private:
 		T* m_refCountedPtr;
 	};
+
+	//Owns a weak reference.  Lock() hands back a strong reference (release it when done) or nullptr
+	template<typename T>
+	class WeakRef
+	{
+	public:
+		WeakRef() : m_refCountedPtr(nullptr) {}
+		explicit WeakRef(T* refCountedPtr) : m_refCountedPtr(refCountedPtr) { if (m_refCountedPtr) AcquireWeak(m_refCountedPtr); }
+		WeakRef(const WeakRef& other) : m_refCountedPtr(other.m_refCountedPtr) { if (m_refCountedPtr) AcquireWeak(m_refCountedPtr); }
+		WeakRef(WeakRef&& other) : m_refCountedPtr(other.m_refCountedPtr) { other.m_refCountedPtr = nullptr; }
+		~WeakRef() { Reset(); }
+
+		WeakRef& operator=(WeakRef other)
+		{
+			T* temp = m_refCountedPtr;
+			m_refCountedPtr = other.m_refCountedPtr;
+			other.m_refCountedPtr = temp;
+			return *this;
+		}
+
+		void Reset()
+		{
+			if (m_refCountedPtr)
+			{
+				ReleaseWeak(m_refCountedPtr);
+				m_refCountedPtr = nullptr;
+			}
+		}
+
+		T* Lock() const { return (m_refCountedPtr && TryAcquire(m_refCountedPtr)) ? m_refCountedPtr : nullptr; }
+		bool IsExpired() const { return !m_refCountedPtr || !IsAlive(m_refCountedPtr); }
+
+	private:
+		T* m_refCountedPtr;
+	};
 }
 
 #define REF_ACQUIRE_SCOPE(Typename, Ptr) RefCount::ScopedAcquirer<Typename> raiiRefCountAcquirer(Ptr);
\ No newline at end of file
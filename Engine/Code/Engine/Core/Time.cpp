@@ -1,32 +1,28 @@
 //-----------------------------------------------------------------------------------------------
 // Time.cpp
-//	A simple high-precision time utility function for Windows
+//	A simple high-precision time utility function
 //	based on code by Squirrel Eiserloh
 
 //-----------------------------------------------------------------------------------------------
 #include "Engine/Core/Time.hpp"
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
+#include "Engine/Core/Platform.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
-double InitializeTime( LARGE_INTEGER& out_initialTime )
+double InitializeTime( uint64_t& out_initialTime )
 {
-	LARGE_INTEGER countsPerSecond;
-	QueryPerformanceFrequency( &countsPerSecond );
-	QueryPerformanceCounter( &out_initialTime );
-	return( 1.0 / static_cast< double >( countsPerSecond.QuadPart ) );
+	out_initialTime = Platform::GetPerformanceCounter();
+	return( 1.0 / static_cast< double >( Platform::GetPerformanceFrequency() ) );
 }
 
 
 //-----------------------------------------------------------------------------------------------
 double GetCurrentTimeSeconds()
 {
-	static LARGE_INTEGER initialTime;
+	static uint64_t initialTime;
 	static double secondsPerCount = InitializeTime( initialTime );
-	LARGE_INTEGER currentCount;
-	QueryPerformanceCounter( &currentCount );
-	LONGLONG elapsedCountsSinceInitialTime = currentCount.QuadPart - initialTime.QuadPart;
+	uint64_t currentCount = Platform::GetPerformanceCounter();
+	uint64_t elapsedCountsSinceInitialTime = currentCount - initialTime;
 
 	double currentSeconds = static_cast< double >( elapsedCountsSinceInitialTime ) * secondsPerCount;
 	return currentSeconds;
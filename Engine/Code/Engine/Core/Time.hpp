@@ -1,6 +1,6 @@
 //-----------------------------------------------------------------------------------------------
 // Time.hpp
-//	A simple high-precision time utility function for Windows
+//	A simple high-precision time utility function
 //	based on code by Squirrel Eiserloh
 #pragma once
 
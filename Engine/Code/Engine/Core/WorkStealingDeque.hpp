@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+//-----------------------------------------------------------------------------------------------
+// Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli 2013).
+// The owning thread pushes and pops at the bottom; any other thread may steal from the top.
+// T must be trivially copyable (in practice, a pointer).
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+class WorkStealingDeque
+{
+	static const int64_t INITIAL_CAPACITY = 256;
+
+public:
+	WorkStealingDeque();
+	~WorkStealingDeque();
+
+	//Owner thread only
+	void Push(const T& datum);
+	bool Pop(T* outValue);
+
+	//Any thread
+	bool Steal(T* outValue);
+	bool IsEmpty() const;
+	int64_t GetSize() const;
+
+private:
+	struct RingBuffer
+	{
+		RingBuffer(int64_t capacity) : m_capacity(capacity), m_mask(capacity - 1), m_data(new std::atomic<T>[(size_t)capacity]) {}
+		~RingBuffer() { delete[] m_data; }
+		T Get(int64_t index) const { return m_data[index & m_mask].load(std::memory_order_relaxed); }
+		void Put(int64_t index, const T& datum) { m_data[index & m_mask].store(datum, std::memory_order_relaxed); }
+		RingBuffer* Grow(int64_t bottom, int64_t top) const;
+
+		int64_t m_capacity;
+		int64_t m_mask;
+		std::atomic<T>* m_data;
+	};
+
+private:
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	void operator=(const WorkStealingDeque&) = delete;
+
+private:
+	//Padded apart rather than alignas'd, so deques can sit in arrays allocated with new
+	char m_topPadding[64];
+	std::atomic<int64_t> m_top;
+	char m_bottomPadding[64];
+	std::atomic<int64_t> m_bottom;
+	std::atomic<RingBuffer*> m_buffer;
+
+	//Thieves may still be reading an old buffer after a grow, so keep them alive until destruction
+	std::vector<RingBuffer*> m_retiredBuffers;
+	char m_endPadding[64];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+typename WorkStealingDeque<T>::RingBuffer* WorkStealingDeque<T>::RingBuffer::Grow(int64_t bottom, int64_t top) const
+{
+	RingBuffer* result = new RingBuffer(m_capacity * 2);
+	for (int64_t i = top; i != bottom; i++)
+	{
+		result->Put(i, Get(i));
+	}
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+WorkStealingDeque<T>::WorkStealingDeque()
+	: m_top(0)
+	, m_bottom(0)
+	, m_buffer(new RingBuffer(INITIAL_CAPACITY))
+{
+
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+WorkStealingDeque<T>::~WorkStealingDeque()
+{
+	delete m_buffer.load(std::memory_order_relaxed);
+	for (RingBuffer* retired : m_retiredBuffers)
+	{
+		delete retired;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void WorkStealingDeque<T>::Push(const T& datum)
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	int64_t top = m_top.load(std::memory_order_acquire);
+	RingBuffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+	if (bottom - top > buffer->m_capacity - 1)
+	{
+		RingBuffer* grownBuffer = buffer->Grow(bottom, top);
+		m_retiredBuffers.push_back(buffer);
+		m_buffer.store(grownBuffer, std::memory_order_release);
+		buffer = grownBuffer;
+	}
+
+	buffer->Put(bottom, datum);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool WorkStealingDeque<T>::Pop(T* outValue)
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	RingBuffer* buffer = m_buffer.load(std::memory_order_relaxed);
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		//Was already empty; restore
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	*outValue = buffer->Get(bottom);
+	if (top == bottom)
+	{
+		//Last element; race any thieves for it
+		bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool WorkStealingDeque<T>::Steal(T* outValue)
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return false;
+	}
+
+	RingBuffer* buffer = m_buffer.load(std::memory_order_acquire);
+	T datum = buffer->Get(top);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		//Lost the race to the owner or another thief
+		return false;
+	}
+
+	*outValue = datum;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool WorkStealingDeque<T>::IsEmpty() const
+{
+	return GetSize() <= 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+int64_t WorkStealingDeque<T>::GetSize() const
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+	return bottom - top;
+}
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 
 //-----------------------------------------------------------------------------------------------
-__declspec(align(16)) class Vector4
+class alignas(16) Vector4
 {
 public:
 	union
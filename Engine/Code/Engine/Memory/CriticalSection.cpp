@@ -1,6 +1,7 @@
 #include "Engine/Memory/CriticalSection.hpp"
 
 
+#if defined(PLATFORM_WINDOWS)
 //-----------------------------------------------------------------------------------------------
 CriticalSection::CriticalSection()
 {
@@ -8,6 +9,13 @@ CriticalSection::CriticalSection()
 }
 
 
+//-----------------------------------------------------------------------------------------------
+CriticalSection::~CriticalSection()
+{
+	DeleteCriticalSection(&m_cs);
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void CriticalSection::Enter()
 {
@@ -26,4 +34,46 @@ void CriticalSection::Leave()
 bool CriticalSection::TryEnter()
 {
 	return TryEnterCriticalSection(&m_cs) != 0;
-}
\ No newline at end of file
+}
+
+
+#else
+//-----------------------------------------------------------------------------------------------
+CriticalSection::CriticalSection()
+{
+	//Critical sections are re-entrant; match that so code behaves the same on both platforms
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&m_cs, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CriticalSection::~CriticalSection()
+{
+	pthread_mutex_destroy(&m_cs);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CriticalSection::Enter()
+{
+	pthread_mutex_lock(&m_cs);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void CriticalSection::Leave()
+{
+	pthread_mutex_unlock(&m_cs);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool CriticalSection::TryEnter()
+{
+	return pthread_mutex_trylock(&m_cs) == 0;
+}
+#endif
\ No newline at end of file
@@ -1,20 +1,36 @@
 #pragma once
 
+#include "Engine/Core/Platform.hpp"
+
+#if defined(PLATFORM_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 
 //-----------------------------------------------------------------------------------------------
+//Recursive mutex (a CRITICAL_SECTION on Windows, a recursive pthread mutex elsewhere)
 class CriticalSection
 {
 public:
 	CriticalSection();
+	~CriticalSection();
 	void Enter();
 	void Leave();
 	bool TryEnter();
 
 private:
+	CriticalSection(const CriticalSection&) = delete;
+	void operator=(const CriticalSection&) = delete;
+
+private:
+#if defined(PLATFORM_WINDOWS)
 	CRITICAL_SECTION m_cs;
+#else
+	pthread_mutex_t m_cs;
+#endif
 };
 
 
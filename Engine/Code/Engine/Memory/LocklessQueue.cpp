@@ -0,0 +1,168 @@
+#include "Engine/Memory/LocklessQueue.hpp"
+#include "Engine/Memory/SPSCQueue.hpp"
+#include "Engine/Memory/ThreadSafeSTL.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Renderer/Rgba.hpp"
+
+#include <thread>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+// CONTENTION BENCHMARK
+//	N producers and N consumers hammer one queue with no work in between, so this measures the
+//	queue itself under the worst contention it will see
+//-----------------------------------------------------------------------------------------------
+static const size_t BENCHMARK_BOUNDED_CAPACITY = 1024;
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename QueueType>
+static void BenchmarkEnqueue(QueueType& queue, size_t value)
+{
+	queue.Enqueue(value);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void BenchmarkEnqueue(BoundedLocklessQueue<size_t>& queue, size_t value)
+{
+	while (!queue.Enqueue(value))
+	{
+		std::this_thread::yield();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void BenchmarkEnqueue(SPSCQueue<size_t>& queue, size_t value)
+{
+	while (!queue.Enqueue(value))
+	{
+		std::this_thread::yield();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Returns items per second, or a negative number if items were lost or duplicated
+template<typename QueueType>
+static double RunQueueBenchmark(QueueType& queue, int numThreads, int itemsPerProducer)
+{
+	std::atomic<bool> hasStarted(false);
+	std::atomic<size_t> numConsumed(0);
+	std::atomic<size_t> consumedSum(0);
+	size_t totalItems = (size_t)numThreads * itemsPerProducer;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back([&]()
+		{
+			while (!hasStarted)
+			{
+				std::this_thread::yield();
+			}
+			for (int item = 1; item <= itemsPerProducer; item++)
+			{
+				BenchmarkEnqueue(queue, (size_t)item);
+			}
+		});
+		threads.emplace_back([&]()
+		{
+			size_t localSum = 0;
+			size_t value = 0;
+			while (numConsumed.load(std::memory_order_relaxed) < totalItems)
+			{
+				if (queue.Dequeue(&value))
+				{
+					localSum += value;
+					++numConsumed;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+			consumedSum += localSum;
+		});
+	}
+
+	double startSeconds = GetCurrentTimeSeconds();
+	hasStarted = true;
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	double elapsedSeconds = GetCurrentTimeSeconds() - startSeconds;
+
+	size_t expectedSum = (size_t)numThreads * ((size_t)itemsPerProducer * (itemsPerProducer + 1) / 2);
+	if (numConsumed != totalItems || consumedSum != expectedSum)
+	{
+		return -1.0;
+	}
+
+	return (double)totalItems / elapsedSeconds;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(QueueBenchmark, args)
+{
+	int maxThreads = (int)std::thread::hardware_concurrency() / 2;
+	int itemsPerProducer = 200000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			maxThreads = std::stoi(arg);
+		}
+		arg = args.GetNextArg();
+		if (arg != "")
+		{
+			itemsPerProducer = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: queuebenchmark [maxProducers] [itemsPerProducer]", RED);
+		return;
+	}
+
+	if (maxThreads < 1)
+	{
+		maxThreads = 1;
+	}
+	if (itemsPerProducer < 1)
+	{
+		ConsolePrint("Need at least one item per producer", RED);
+		return;
+	}
+
+	ConsolePrintf(WHITE, "Queue benchmark: %i items per producer, equal producers and consumers (million items/sec)", itemsPerProducer);
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads++)
+	{
+		LockedQueue<size_t> lockedQueue;
+		BoundedLocklessQueue<size_t> boundedQueue(BENCHMARK_BOUNDED_CAPACITY);
+		LocklessQueue<size_t> unboundedQueue;
+
+		double lockedRate = RunQueueBenchmark(lockedQueue, numThreads, itemsPerProducer);
+		double boundedRate = RunQueueBenchmark(boundedQueue, numThreads, itemsPerProducer);
+		double unboundedRate = RunQueueBenchmark(unboundedQueue, numThreads, itemsPerProducer);
+
+		bool isValid = (lockedRate > 0.0 && boundedRate > 0.0 && unboundedRate > 0.0);
+		ConsolePrintf(isValid ? WHITE : RED, " %ix%i: locked %.2f, bounded lockless %.2f, unbounded lockless %.2f%s", numThreads, numThreads,
+			lockedRate * 1.0e-6, boundedRate * 1.0e-6, unboundedRate * 1.0e-6, isValid ? "" : " (ITEMS LOST)");
+
+		//Only correct with one of each
+		if (numThreads == 1)
+		{
+			SPSCQueue<size_t> spscQueue(BENCHMARK_BOUNDED_CAPACITY);
+			double spscRate = RunQueueBenchmark(spscQueue, numThreads, itemsPerProducer);
+			ConsolePrintf(spscRate > 0.0 ? WHITE : RED, " 1x1: single producer/consumer %.2f%s", spscRate * 1.0e-6, spscRate > 0.0 ? "" : " (ITEMS LOST)");
+		}
+	}
+}
\ No newline at end of file
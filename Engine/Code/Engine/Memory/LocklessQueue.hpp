@@ -0,0 +1,486 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+
+//-----------------------------------------------------------------------------------------------
+// Bounded multi-producer, multi-consumer ring buffer (Vyukov).
+// Each cell carries a sequence number that tells producers and consumers whose turn it is, so
+// the only shared writes are one CAS on the enqueue or dequeue position.
+// Capacity is rounded up to a power of two.  Enqueue fails instead of blocking when full.
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+class BoundedLocklessQueue
+{
+public:
+	BoundedLocklessQueue(size_t capacity);
+	~BoundedLocklessQueue();
+
+	bool Enqueue(const T& datum);
+	bool Enqueue(T&& datum);
+	bool Dequeue(T* outValue);
+	size_t GetCapacity() const { return m_mask + 1; }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	template<typename U>
+	bool EnqueueInternal(U&& datum);
+
+private:
+	BoundedLocklessQueue(const BoundedLocklessQueue&) = delete;
+	void operator=(const BoundedLocklessQueue&) = delete;
+
+private:
+	//Padded apart rather than alignas'd, so a queue can be a member of something allocated with new
+	Cell* m_cells;
+	size_t m_mask;
+	char m_enqueuePadding[64];
+	std::atomic<size_t> m_enqueuePos;
+	char m_dequeuePadding[64];
+	std::atomic<size_t> m_dequeuePos;
+	char m_endPadding[64];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Unbounded multi-producer, multi-consumer queue made of linked, single-use segments.
+// Producers claim cells with a fetch_add; consumers use the same sequence handshake as the
+// bounded queue.  Drained segments are retired and reclaimed once no operation is in flight, so
+// nobody can still be holding a pointer into them; one is kept as a spare for the next link.
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+class LocklessQueue
+{
+	static const size_t SEGMENT_SIZE = 256;
+
+public:
+	LocklessQueue();
+	~LocklessQueue();
+
+	void Enqueue(const T& datum);
+	void Enqueue(T&& datum);
+	bool Dequeue(T* outValue);
+
+	//Not safe to call while other threads are using the queue
+	void clear();
+
+private:
+	struct Cell
+	{
+		std::atomic<bool> isPublished;
+		T data;
+	};
+
+	struct Segment
+	{
+		Segment();
+		void Reset();
+
+		//Padded rather than alignas'd, since segments are allocated with new
+		char m_enqueuePadding[64];
+		std::atomic<size_t> m_enqueuePos;
+		char m_dequeuePadding[64];
+		std::atomic<size_t> m_dequeuePos;
+		std::atomic<Segment*> m_next;
+		Segment* m_nextRetired;
+		Cell m_cells[SEGMENT_SIZE];
+	};
+
+	template<typename U>
+	void EnqueueInternal(U&& datum);
+	Segment* AllocateSegment();
+	void RecycleSegment(Segment* unusedSegment);
+	void Retire(Segment* drainedSegment);
+	void PushRetiredList(Segment* first);
+	void EndOperation();
+	void ReclaimRetiredSegments(Segment* first);
+
+private:
+	LocklessQueue(const LocklessQueue&) = delete;
+	void operator=(const LocklessQueue&) = delete;
+
+private:
+	char m_headPadding[64];
+	std::atomic<Segment*> m_head;
+	char m_tailPadding[64];
+	std::atomic<Segment*> m_tail;
+	char m_operationsPadding[64];
+	std::atomic<int> m_numActiveOperations;
+	std::atomic<Segment*> m_retiredSegments;
+	std::atomic<Segment*> m_spareSegment;
+	char m_endPadding[64];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+BoundedLocklessQueue<T>::BoundedLocklessQueue(size_t capacity)
+	: m_enqueuePos(0)
+	, m_dequeuePos(0)
+{
+	size_t roundedCapacity = 2;
+	while (roundedCapacity < capacity)
+	{
+		roundedCapacity <<= 1;
+	}
+
+	m_cells = new Cell[roundedCapacity];
+	m_mask = roundedCapacity - 1;
+	for (size_t i = 0; i < roundedCapacity; i++)
+	{
+		m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+BoundedLocklessQueue<T>::~BoundedLocklessQueue()
+{
+	delete[] m_cells;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool BoundedLocklessQueue<T>::Enqueue(const T& datum)
+{
+	return EnqueueInternal(datum);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool BoundedLocklessQueue<T>::Enqueue(T&& datum)
+{
+	return EnqueueInternal(std::move(datum));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+template<typename U>
+bool BoundedLocklessQueue<T>::EnqueueInternal(U&& datum)
+{
+	size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = m_cells[pos & m_mask];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)pos;
+		if (difference == 0)
+		{
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				cell.data = std::forward<U>(datum);
+				cell.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			//The consumer a full lap behind hasn't freed this cell yet
+			return false;
+		}
+		else
+		{
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool BoundedLocklessQueue<T>::Dequeue(T* outValue)
+{
+	size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = m_cells[pos & m_mask];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(pos + 1);
+		if (difference == 0)
+		{
+			if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				*outValue = std::move(cell.data);
+
+				//Hand the cell to the producer one lap ahead
+				cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			return false;
+		}
+		else
+		{
+			pos = m_dequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+LocklessQueue<T>::Segment::Segment()
+{
+	Reset();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::Segment::Reset()
+{
+	m_enqueuePos.store(0, std::memory_order_relaxed);
+	m_dequeuePos.store(0, std::memory_order_relaxed);
+	m_next.store(nullptr, std::memory_order_relaxed);
+	m_nextRetired = nullptr;
+	for (size_t i = 0; i < SEGMENT_SIZE; i++)
+	{
+		m_cells[i].isPublished.store(false, std::memory_order_relaxed);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+LocklessQueue<T>::LocklessQueue()
+	: m_numActiveOperations(0)
+	, m_retiredSegments(nullptr)
+	, m_spareSegment(nullptr)
+{
+	Segment* firstSegment = new Segment();
+	m_head.store(firstSegment, std::memory_order_relaxed);
+	m_tail.store(firstSegment, std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+LocklessQueue<T>::~LocklessQueue()
+{
+	Segment* currSegment = m_head.load(std::memory_order_relaxed);
+	while (currSegment)
+	{
+		Segment* next = currSegment->m_next.load(std::memory_order_relaxed);
+		delete currSegment;
+		currSegment = next;
+	}
+	currSegment = m_retiredSegments.load(std::memory_order_relaxed);
+	while (currSegment)
+	{
+		Segment* next = currSegment->m_nextRetired;
+		delete currSegment;
+		currSegment = next;
+	}
+	delete m_spareSegment.load(std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::Enqueue(const T& datum)
+{
+	EnqueueInternal(datum);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::Enqueue(T&& datum)
+{
+	EnqueueInternal(std::move(datum));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+template<typename U>
+void LocklessQueue<T>::EnqueueInternal(U&& datum)
+{
+	//Registering before touching any segment is what keeps retired segments alive under us
+	m_numActiveOperations.fetch_add(1);
+
+	for (;;)
+	{
+		Segment* tail = m_tail.load();
+		size_t pos = tail->m_enqueuePos.fetch_add(1, std::memory_order_relaxed);
+		if (pos < SEGMENT_SIZE)
+		{
+			Cell& cell = tail->m_cells[pos];
+			cell.data = std::forward<U>(datum);
+			cell.isPublished.store(true, std::memory_order_release);
+			break;
+		}
+
+		//Segment is full; link a new one (or follow whoever beat us to it) and swing the tail
+		Segment* next = tail->m_next.load(std::memory_order_acquire);
+		if (!next)
+		{
+			Segment* newSegment = AllocateSegment();
+			if (tail->m_next.compare_exchange_strong(next, newSegment))
+			{
+				next = newSegment;
+			}
+			else
+			{
+				RecycleSegment(newSegment);
+			}
+		}
+		m_tail.compare_exchange_strong(tail, next);
+	}
+
+	EndOperation();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool LocklessQueue<T>::Dequeue(T* outValue)
+{
+	m_numActiveOperations.fetch_add(1);
+
+	bool result = false;
+	for (;;)
+	{
+		Segment* head = m_head.load();
+		size_t pos = head->m_dequeuePos.load(std::memory_order_relaxed);
+		if (pos < SEGMENT_SIZE)
+		{
+			Cell& cell = head->m_cells[pos];
+			if (!cell.isPublished.load(std::memory_order_acquire))
+			{
+				//Empty, or the producer that claimed this cell hasn't finished writing it
+				break;
+			}
+			if (head->m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				*outValue = std::move(cell.data);
+				result = true;
+				break;
+			}
+			continue;
+		}
+
+		//Every cell in this segment has been consumed
+		Segment* next = head->m_next.load(std::memory_order_acquire);
+		if (!next)
+		{
+			break;
+		}
+
+		//Move a lagging tail off this segment first, so no new producer can reach it once it's retired
+		Segment* expectedTail = head;
+		m_tail.compare_exchange_strong(expectedTail, next);
+		if (m_head.compare_exchange_strong(head, next))
+		{
+			Retire(head);
+		}
+	}
+
+	EndOperation();
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::clear()
+{
+	T discarded;
+	while (Dequeue(&discarded))
+	{
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::Retire(Segment* drainedSegment)
+{
+	drainedSegment->m_nextRetired = nullptr;
+	PushRetiredList(drainedSegment);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::PushRetiredList(Segment* first)
+{
+	Segment* last = first;
+	while (last->m_nextRetired)
+	{
+		last = last->m_nextRetired;
+	}
+
+	Segment* currHead = m_retiredSegments.load(std::memory_order_relaxed);
+	do
+	{
+		last->m_nextRetired = currHead;
+	} while (!m_retiredSegments.compare_exchange_weak(currHead, first));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::EndOperation()
+{
+	//Take the retired list while we're still registered.  Everyone who could have seen those segments was
+	//registered before they were retired, so if we turn out to be the last one out, they're all done
+	Segment* toReclaim = nullptr;
+	if (m_retiredSegments.load(std::memory_order_relaxed))
+	{
+		toReclaim = m_retiredSegments.exchange(nullptr);
+	}
+
+	if (m_numActiveOperations.fetch_sub(1) == 1)
+	{
+		ReclaimRetiredSegments(toReclaim);
+	}
+	else if (toReclaim)
+	{
+		PushRetiredList(toReclaim);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+typename LocklessQueue<T>::Segment* LocklessQueue<T>::AllocateSegment()
+{
+	Segment* result = m_spareSegment.exchange(nullptr);
+	return result ? result : new Segment();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::RecycleSegment(Segment* unusedSegment)
+{
+	unusedSegment->Reset();
+	delete m_spareSegment.exchange(unusedSegment);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+void LocklessQueue<T>::ReclaimRetiredSegments(Segment* first)
+{
+	while (first)
+	{
+		Segment* next = first->m_nextRetired;
+		RecycleSegment(first);
+		first = next;
+	}
+}
\ No newline at end of file
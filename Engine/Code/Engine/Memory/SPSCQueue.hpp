@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+
+//-----------------------------------------------------------------------------------------------
+// Bounded single-producer, single-consumer ring buffer.
+// The producer only ever writes the tail and the consumer the head, so there's no CAS and no
+// waiting on each other.  Each side caches the other's index and rereads it only when the ring
+// looks full (or empty) from the cached copy.
+// Capacity is rounded up to a power of two.  Enqueue fails instead of blocking when full.
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+class SPSCQueue
+{
+public:
+	SPSCQueue(size_t capacity);
+	~SPSCQueue();
+
+	//PRODUCER ONLY
+	bool Enqueue(const T& datum);
+	bool Enqueue(T&& datum);
+	//Never more than are really free, since the consumer only ever frees more
+	size_t GetNumFree();
+
+	//CONSUMER ONLY
+	//Dequeued cells are reset to T(), so anything they held is let go right away
+	bool Dequeue(T* outValue);
+
+	size_t GetCapacity() const { return m_mask + 1; }
+
+private:
+	template<typename U>
+	bool EnqueueInternal(U&& datum);
+
+private:
+	SPSCQueue(const SPSCQueue&) = delete;
+	void operator=(const SPSCQueue&) = delete;
+
+private:
+	//Padded apart rather than alignas'd, so a queue can be a member of something allocated with new
+	T* m_cells;
+	size_t m_mask;
+	char m_producerPadding[64];
+	std::atomic<size_t> m_tail;
+	size_t m_cachedHead;
+	char m_consumerPadding[64];
+	std::atomic<size_t> m_head;
+	size_t m_cachedTail;
+	char m_endPadding[64];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+SPSCQueue<T>::SPSCQueue(size_t capacity)
+	: m_tail(0)
+	, m_cachedHead(0)
+	, m_head(0)
+	, m_cachedTail(0)
+{
+	size_t roundedCapacity = 2;
+	while (roundedCapacity < capacity)
+	{
+		roundedCapacity <<= 1;
+	}
+
+	m_cells = new T[roundedCapacity];
+	m_mask = roundedCapacity - 1;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+SPSCQueue<T>::~SPSCQueue()
+{
+	delete[] m_cells;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool SPSCQueue<T>::Enqueue(const T& datum)
+{
+	return EnqueueInternal(datum);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool SPSCQueue<T>::Enqueue(T&& datum)
+{
+	return EnqueueInternal(std::move(datum));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+template<typename U>
+bool SPSCQueue<T>::EnqueueInternal(U&& datum)
+{
+	size_t tail = m_tail.load(std::memory_order_relaxed);
+	if (tail - m_cachedHead > m_mask)
+	{
+		m_cachedHead = m_head.load(std::memory_order_acquire);
+		if (tail - m_cachedHead > m_mask)
+		{
+			return false;
+		}
+	}
+
+	m_cells[tail & m_mask] = std::forward<U>(datum);
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+size_t SPSCQueue<T>::GetNumFree()
+{
+	m_cachedHead = m_head.load(std::memory_order_acquire);
+	return GetCapacity() - (m_tail.load(std::memory_order_relaxed) - m_cachedHead);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+bool SPSCQueue<T>::Dequeue(T* outValue)
+{
+	size_t head = m_head.load(std::memory_order_relaxed);
+	if (head == m_cachedTail)
+	{
+		m_cachedTail = m_tail.load(std::memory_order_acquire);
+		if (head == m_cachedTail)
+		{
+			return false;
+		}
+	}
+
+	T& cell = m_cells[head & m_mask];
+	*outValue = std::move(cell);
+	cell = T();
+	m_head.store(head + 1, std::memory_order_release);
+	return true;
+}
\ No newline at end of file
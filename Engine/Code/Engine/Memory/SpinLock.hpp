@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Engine/Core/Platform.hpp"
+
+#include <atomic>
+
+
+//-----------------------------------------------------------------------------------------------
+//For very short critical sections where putting the thread to sleep costs more than waiting.  Not recursive
+class SpinLock
+{
+public:
+	SpinLock() : m_isLocked(false) {}
+
+	void Enter()
+	{
+		for (;;)
+		{
+			if (!m_isLocked.exchange(true, std::memory_order_acquire))
+			{
+				return;
+			}
+
+			//Spin on a plain load so waiters don't keep stealing the cache line from the owner
+			while (m_isLocked.load(std::memory_order_relaxed))
+			{
+				Platform::CpuRelax();
+			}
+		}
+	}
+	void Leave()
+	{
+		m_isLocked.store(false, std::memory_order_release);
+	}
+	bool TryEnter()
+	{
+		return !m_isLocked.load(std::memory_order_relaxed) && !m_isLocked.exchange(true, std::memory_order_acquire);
+	}
+
+private:
+	SpinLock(const SpinLock&) = delete;
+	void operator=(const SpinLock&) = delete;
+
+private:
+	std::atomic<bool> m_isLocked;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+class SpinLockGuard
+{
+public:
+	SpinLockGuard(SpinLock* lock)
+		: m_lock(lock)
+	{
+		m_lock->Enter();
+	}
+	~SpinLockGuard()
+	{
+		m_lock->Leave();
+	}
+
+
+private:
+	SpinLock* m_lock;
+};
\ No newline at end of file
@@ -1,30 +1,37 @@
 #pragma once
 
 #include "Engine/Memory/CriticalSection.hpp"
+#include "Engine/Memory/LocklessQueue.hpp"
 
 #include <queue>
 
 
 //-----------------------------------------------------------------------------------------------
 template<typename T>
-class ThreadSafeQueue : protected std::deque<T>
+using ThreadSafeQueue = LocklessQueue<T>;
+
+
+//-----------------------------------------------------------------------------------------------
+//Critical-section queue that ThreadSafeQueue used to be; kept as a baseline for benchmarks
+template<typename T>
+class LockedQueue : protected std::deque<T>
 {
 public:
 	void Enqueue(const T& datum)
 	{
 		m_cs.Enter();
-		push_back(datum);
+		this->push_back(datum);
 		m_cs.Leave();
 	}
 	bool Dequeue(T* outValue)
 	{
 		CriticalSectionGuard csg(&m_cs);
-		if (empty())
+		if (this->empty())
 		{
 			return false;
 		}
-		*outValue = front();
-		pop_front();
+		*outValue = this->front();
+		this->pop_front();
 		return true;
 	}
 	void clear()
@@ -4,7 +4,7 @@
 
 
 //-----------------------------------------------------------------------------------------------
-std::vector<Matrix44> AnimationState::GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime)
+FrameVector<Matrix44> AnimationState::GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime)
 {
 	return m_motion->GetMatricesForSkeletonAtNormalizedTime(skeleton, normalizedTime);
 }
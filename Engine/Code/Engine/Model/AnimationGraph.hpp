@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Engine/Core/ArenaAllocator.hpp"
+
 #include <vector>
 
 
@@ -15,7 +17,7 @@ public:
 class AnimationState
 {
 public:
-	std::vector<class Matrix44> GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime);
+	FrameVector<class Matrix44> GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime);
 	float GetAnimationLength();
 
 public:
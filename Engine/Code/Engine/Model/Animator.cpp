@@ -174,10 +174,10 @@ bool Animator::AdvanceIntoTransition(float deltaSeconds)
 	m_currentDstNormalizedTime += deltaNormalizedTime;
 	CorrectNormalizedTime(m_currentNormalizedTime);
 	CorrectNormalizedTime(m_currentDstNormalizedTime);
-	std::vector<Matrix44> srcMatrices = m_currTransition->m_srcState->GetMatricesForSkeletonAtNormalizedTime(m_skeleton, m_currentNormalizedTime);
-	std::vector<Matrix44> dstMatrices = m_currTransition->m_dstState->GetMatricesForSkeletonAtNormalizedTime(m_skeleton, m_currentDstNormalizedTime);
+	FrameVector<Matrix44> srcMatrices = m_currTransition->m_srcState->GetMatricesForSkeletonAtNormalizedTime(m_skeleton, m_currentNormalizedTime);
+	FrameVector<Matrix44> dstMatrices = m_currTransition->m_dstState->GetMatricesForSkeletonAtNormalizedTime(m_skeleton, m_currentDstNormalizedTime);
 
-	std::vector<Matrix44> compositeMatrices;
+	FrameVector<Matrix44> compositeMatrices;
 	compositeMatrices.reserve(srcMatrices.size());
 	for (size_t i = 0; i < srcMatrices.size(); i++)
 	{
@@ -223,7 +223,7 @@ void Animator::AdvanceIntoState(float deltaSeconds)
 		}
 	}
 
-	std::vector<Matrix44> transformationMatrices = m_currState->GetMatricesForSkeletonAtNormalizedTime(m_skeleton, m_currentNormalizedTime);
+	FrameVector<Matrix44> transformationMatrices = m_currState->GetMatricesForSkeletonAtNormalizedTime(m_skeleton, m_currentNormalizedTime);
 	ApplyMatricesToSkeleton(&transformationMatrices[0], transformationMatrices.size());
 }
 
@@ -880,7 +880,7 @@ Vector3 SphereFunction(void* userData, float x, float y)
 void MeshBuilder::AddStringEffectFragment(const StringEffectFragment& fragment, const BitmapFont* font, float scale, float totalStringWidth, 
 	float totalWidthUpToNow, float width, float height, int lineNum, float lineWidth, HorizontalAlignment hAlign, EVerticalAlignment vAlign, int& glyphIndex)
 {
-	std::string asciiText = fragment.m_value;
+	const std::string& asciiText = fragment.m_value;
 	if (asciiText.empty())
 	{
 		return;
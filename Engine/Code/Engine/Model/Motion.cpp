@@ -116,10 +116,11 @@ void Motion::Update(class Skeleton* skeleton, float deltaSeconds)
 
 
 //-----------------------------------------------------------------------------------------------
-std::vector<Matrix44> Motion::GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime)
+//Called for every animated skeleton every frame, so the result lives in the frame arena
+FrameVector<Matrix44> Motion::GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime)
 {
 	float time = normalizedTime * (m_totalLengthOfAnimation + startTime);
-	std::vector<Matrix44> result;
+	FrameVector<Matrix44> result;
 	int jointCount = skeleton->GetNumJoints();
 	result.reserve(jointCount);
 	int curveCount = m_curves.size();
@@ -130,11 +131,9 @@ std::vector<Matrix44> Motion::GetMatricesForSkeletonAtNormalizedTime(class Skele
 		int jointIndex;
 		for (jointIndex = 0; jointIndex < curveCount; jointIndex++)
 		{
-			Joint* joint = skeleton->GetJoint(jointIndex);
 			Matrix44 localTransformChangeForJoint = m_curves[jointIndex]->EvaluateLocalTransformAt(time, skeleton->m_jointMetadata[jointIndex]);
 			result.push_back(localTransformChangeForJoint);
 			//skeleton->SetWorldTransformForJoint(jointIndex, localTransformChangeForJoint);
-			delete joint;
 		}
 		for (; jointIndex < jointCount; jointIndex++)
 		{
@@ -146,11 +145,9 @@ std::vector<Matrix44> Motion::GetMatricesForSkeletonAtNormalizedTime(class Skele
 	{
 		for (int jointIndex = 0; jointIndex < jointCount; jointIndex++)
 		{
-			Joint* joint = skeleton->GetJoint(jointIndex);
 			Matrix44 localTransformChangeForJoint = m_curves[jointIndex]->EvaluateLocalTransformAt(time, skeleton->m_jointMetadata[jointIndex]);
 			result.push_back(localTransformChangeForJoint);
 			//skeleton->SetWorldTransformForJoint(jointIndex, localTransformChangeForJoint);
-			delete joint;
 		}
 	}
 	//If this skeleton has fewer joints than the source, then animate the joints we have, and don't use the remaining animation curves
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Engine/Core/ArenaAllocator.hpp"
+
 #include <vector>
 
 
@@ -69,5 +71,5 @@ private:
 	bool m_isPlaying;
 
 private:
-	std::vector<class Matrix44> GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime);
+	FrameVector<class Matrix44> GetMatricesForSkeletonAtNormalizedTime(class Skeleton* skeleton, float normalizedTime);
 };
\ No newline at end of file
@@ -12,18 +12,25 @@
 STATIC const float NetConnection::TIME_UNTIL_HEARTBEAT = 1.5f;
 STATIC const float NetConnection::TIME_UNTIL_MARKED_BAD = 5.f;
 STATIC const float NetConnection::TIME_UNTIL_DISCONNECTED = 15.f;
+STATIC std::atomic<uint32_t> NetConnection::s_nextConnectionID(0);
 
 
 //-----------------------------------------------------------------------------------------------
 NetConnection::NetConnection(byte index, const std::string& guid, const sockaddr_in& addr)
-	: m_index(index)
+	: m_connectionID(s_nextConnectionID++)
+	, m_index(index)
 	, m_guid(guid)
 	, m_timeSinceLastReceivedPacket(0.f)
-	, m_currentZerothAckBundleIndex(0)
 	, m_highestReceivedAck(INVALID_PACKET_ACK)
 	, m_currentAckIndex(0)
 	, m_previousReceivedAckBitfield(0)
 	, m_currentReliableID(0)
+	, m_oldestUnconfirmedReliableID(0)
+	, m_nextReliableToSend(0)
+	, m_numUnconfirmedReliables(0)
+	, m_pendingSnapshotID(0)
+	, m_lastAckedSnapshotID(INVALID_SNAPSHOT_ID)
+	, m_hasUnsentAcks(false)
 	, m_currentSequenceID(0)
 	, m_nextExpectedReliableID(0)
 	, m_nextExpectedSequenceID(0)
@@ -35,59 +42,51 @@ NetConnection::NetConnection(byte index, const std::string& guid, const sockaddr
 
 
 //-----------------------------------------------------------------------------------------------
-void NetConnection::PushReliablesIntoPacket(NetPacket& packet, PacketHeader* header)
+//outSentReliableIDs needs room for 256, since a packet can't hold more messages than its byte-sized count
+int NetConnection::PushReliablesIntoPacket(NetPacket& packet, ushort* outSentReliableIDs)
 {
-	AckBundle bundle;
-	bundle.ackID = m_currentAckIndex;
+	int numSentReliables = 0;
 
-	bool pushedReliables = false;
-
-	std::deque<NetMessage> workingReliablesQueue;
-	std::swap(workingReliablesQueue, m_unconfirmedReliables);
+	//Start where the last packet left off, wrapping around to the oldest unconfirmed
+	int numOutstanding = GetNumOutstandingReliables();
+	int startOffset = (ushort)(m_nextReliableToSend - m_oldestUnconfirmedReliableID);
+	if (startOffset >= numOutstanding)
+	{
+		startOffset = 0;
+	}
 
-	while (!workingReliablesQueue.empty())
+	for (int offset = 0; offset < numOutstanding; offset++)
 	{
-		//Work through unconfirmed reliables, adding them to the packet if possible
-		//Work them back into the queue to be removed on ack
-		NetMessage& message = workingReliablesQueue.back();
-		bool success = packet.WriteContents(message);
-		if (success)
+		ushort reliableID = (ushort)(m_oldestUnconfirmedReliableID + (startOffset + offset) % numOutstanding);
+		const UnconfirmedReliable& unconfirmed = GetUnconfirmedReliable(reliableID);
+		if (!unconfirmed.message.IsValid())
 		{
-			pushedReliables = true;
-			bundle.reliableIDs.push_back(message.GetReliableID());
-			m_unconfirmedReliables.push_front(message);
-			workingReliablesQueue.pop_back();
+			continue;
 		}
-		else
+
+		if (!packet.WriteContents(*unconfirmed.message, reliableID, unconfirmed.sequenceID))
 		{
+			//The first reliable that doesn't fit goes first next time
+			m_nextReliableToSend = reliableID;
 			break;
 		}
-	}
-	while (!workingReliablesQueue.empty())
-	{
-		//Clean up any reliables we couldn't write.  They'll go first in the queue
-		NetMessage& toCopy = workingReliablesQueue.front();
-		m_unconfirmedReliables.push_back(toCopy);
-		workingReliablesQueue.pop_front();
+		outSentReliableIDs[numSentReliables++] = reliableID;
 	}
 
-	if (pushedReliables)
-	{
-		ushort ackIndex = GetBundleIndexForID(m_currentAckIndex);
-		AckBundle& thisBundle = m_ackBundles[ackIndex];
-		thisBundle.reliableIDs.clear();
-		thisBundle.reliableIDs.shrink_to_fit();
-		thisBundle = bundle;
-		header->thisAck = m_currentAckIndex;
-		m_currentAckIndex++;
-	}
-	else
+	return numSentReliables;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int NetConnection::PushSnapshotIntoPacket(NetPacket& packet)
+{
+	if (!m_pendingSnapshot.IsValid() || !packet.WriteContents(*m_pendingSnapshot, 0, 0))
 	{
-		header->thisAck = INVALID_PACKET_ACK;
+		return INVALID_SNAPSHOT_ID;
 	}
 
-	workingReliablesQueue.clear();
-	workingReliablesQueue.shrink_to_fit();
+	m_pendingSnapshot.Reset();
+	return m_pendingSnapshotID;
 }
 
 
@@ -96,11 +95,11 @@ void NetConnection::PushUnreliablesIntoPacket(NetPacket& packet)
 {
 	while (!m_unsentUnreliables.empty())
 	{
-		NetMessage& message = m_unsentUnreliables.back();
-		bool success = packet.WriteContents(message);
+		const NetMessageRef& message = m_unsentUnreliables.front();
+		bool success = packet.WriteContents(*message, 0, 0);
 		if (success)
 		{
-			m_unsentUnreliables.pop_back();
+			m_unsentUnreliables.pop_front();
 		}
 		else
 		{
@@ -111,25 +110,53 @@ void NetConnection::PushUnreliablesIntoPacket(NetPacket& packet)
 
 
 //-----------------------------------------------------------------------------------------------
-ushort NetConnection::GetBundleIndexForID(ushort ackIndex)
+//Only packets with something worth hearing back about get an ack ID
+ushort NetConnection::RecordAckBundle(const ushort* sentReliableIDs, int numSentReliables, int sentSnapshotID)
 {
-	while (ackIndex >= m_currentZerothAckBundleIndex + ARRAY_LENGTH(m_ackBundles))
+	if (numSentReliables == 0 && sentSnapshotID == INVALID_SNAPSHOT_ID)
+	{
+		return INVALID_PACKET_ACK;
+	}
+
+	ushort ackID = m_currentAckIndex;
+	AckBundle& thisBundle = m_ackBundles[GetBundleIndexForID(ackID)];
+	thisBundle.ackID = ackID;
+	thisBundle.reliableIDs.assign(sentReliableIDs, sentReliableIDs + numSentReliables);
+	thisBundle.snapshotID = sentSnapshotID;
+
+	//The invalid ack is never handed out
+	m_currentAckIndex++;
+	if (m_currentAckIndex == INVALID_PACKET_ACK)
 	{
-		m_currentZerothAckBundleIndex += ARRAY_LENGTH(m_ackBundles);
+		m_currentAckIndex = 0;
 	}
 
-	return ackIndex - m_currentZerothAckBundleIndex;
+	return ackID;
 }
 
 
 //-----------------------------------------------------------------------------------------------
 bool NetConnection::ConstructPacketAndSend(byte playerIndex)
 {
-	if (m_unsentUnreliables.empty() && m_unconfirmedReliables.empty())
+	if (g_netSession && g_netSession->ShouldQueueForNetworkThread())
 	{
 		return false;
 	}
 
+	return SendNextPacket(playerIndex);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetConnection::SendNextPacket(byte playerIndex)
+{
+	//Acks ride along on every packet, so owing some is reason enough to send one
+	if (m_unsentUnreliables.empty() && m_numUnconfirmedReliables == 0 && !m_pendingSnapshot.IsValid() && !m_hasUnsentAcks)
+	{
+		return false;
+	}
+	m_hasUnsentAcks = false;
+
 	NetPacket packet;
 	PacketHeader* header = packet.GetPacketHeader();
 	header->playerIndex = playerIndex;
@@ -139,38 +166,76 @@ bool NetConnection::ConstructPacketAndSend(byte playerIndex)
 	//Based on this implementation, the first reliable that doesn't fit in the packet won't get through
 	//Consequently, it's possible that some unreliables will be preferred based on this criterion
 	//I don't think it's a huge issue, though
-	PushReliablesIntoPacket(packet, header);
+	ushort sentReliableIDs[256];
+	int numSentReliables = PushReliablesIntoPacket(packet, sentReliableIDs);
+	int sentSnapshotID = PushSnapshotIntoPacket(packet);
 	PushUnreliablesIntoPacket(packet);
+	header->thisAck = RecordAckBundle(sentReliableIDs, numSentReliables, sentSnapshotID);
+
+	//A snapshot that doesn't fit even with the packet to itself never will
+	if (m_pendingSnapshot.IsValid() && header->messageCount == 0)
+	{
+		m_pendingSnapshot.Reset();
+	}
 	if (g_netSession)
 	{
 		m_timeSinceLastSentPacket = 0.f;
 		g_netSession->SendPacketDirect(&m_toAddr, packet);
 	}
 
-	return !m_unsentUnreliables.empty();
+	return !m_unsentUnreliables.empty() || m_pendingSnapshot.IsValid();
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void NetConnection::AddMessage(NetMessage& message)
 {
-	if (message.IsOrdered())
+	if (g_netSession && g_netSession->ShouldQueueForNetworkThread())
 	{
-		ASSERT_OR_DIE(message.IsReliable(), "Cannot support unreliable ordered traffic");
-		message.SetSequenceID(m_currentSequenceID++);
+		g_netSession->QueueOutgoingMessage(this, message.Share());
+		return;
 	}
-	if (message.IsReliable())
+
+	AddSharedMessage(message.Share());
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Reliable and sequence IDs are handed out here, on whichever thread owns the connection
+void NetConnection::AddSharedMessage(const NetMessageRef& message)
+{
+	bool isReliable = (message->GetFlags() & (1 << NETMESSAGEFLAG_RELIABLE)) != 0;
+	bool isOrdered = (message->GetFlags() & (1 << NETMESSAGEFLAG_ORDERED)) != 0;
+	ushort sequenceID = 0;
+	if (isOrdered)
 	{
-		message.SetReliableID(m_currentReliableID++);
-		m_unconfirmedReliables.push_front(message);
+		ASSERT_OR_DIE(isReliable, "Cannot support unreliable ordered traffic");
+		sequenceID = m_currentSequenceID++;
+	}
+	if (isReliable)
+	{
+		UnconfirmedReliable waiting;
+		waiting.message = message;
+		waiting.sequenceID = sequenceID;
+		m_waitingReliables.push_back(waiting);
+		AdmitWaitingReliables();
 	}
 	else
 	{
-		m_unsentUnreliables.push_front(message);
+		m_unsentUnreliables.push_back(message);
 	}
 }
 
 
+//-----------------------------------------------------------------------------------------------
+void NetConnection::QueueSnapshot(const NetMessage& snapshot, ushort snapshotID)
+{
+	ASSERT_OR_DIE(!snapshot.IsReliable(), "Snapshots are superseded, not resent, so they must be unreliable");
+	m_pendingSnapshot = snapshot.Share();
+	m_pendingSnapshotID = snapshotID;
+}
+
+
 //-----------------------------------------------------------------------------------------------
 bool NetConnection::IsMe() const
 {
@@ -204,16 +269,17 @@ void NetConnection::UpdateAcksAndStatus(const NetPacket& packet)
 
 	if (header->thisAck != INVALID_PACKET_ACK)
 	{
-		//Update current receieved ack fields based on packet's ackID
-		if (header->thisAck > m_highestReceivedAck)
+		//Update current receieved ack fields based on packet's ackID.  IDs wrap, so newer means less than half the range ahead
+		if (m_highestReceivedAck == INVALID_PACKET_ACK)
 		{
-			ushort distToShift = header->thisAck - m_highestReceivedAck;
 			m_highestReceivedAck = header->thisAck;
-			m_previousReceivedAckBitfield >>= distToShift;
+			m_previousReceivedAckBitfield = 0;
 		}
-		else if (m_highestReceivedAck == INVALID_PACKET_ACK)
+		else if ((short)(header->thisAck - m_highestReceivedAck) > 0)
 		{
-			m_highestReceivedAck = 0;
+			ushort distToShift = header->thisAck - m_highestReceivedAck;
+			m_highestReceivedAck = header->thisAck;
+			m_previousReceivedAckBitfield = (distToShift < BITS_PER_ACK_FIELD) ? (ushort)(m_previousReceivedAckBitfield >> distToShift) : 0;
 		}
 		ushort difference = m_highestReceivedAck - header->thisAck;
 
@@ -222,6 +288,7 @@ void NetConnection::UpdateAcksAndStatus(const NetPacket& packet)
 			ushort distToShift = (BITS_PER_ACK_FIELD - 1) - difference;
 			m_previousReceivedAckBitfield |= (1 << distToShift);
 		}
+		m_hasUnsentAcks = true;
 	}
 
 	//Now, for the bitfield the packet sent us, we update our unconfirmed reliables
@@ -232,51 +299,88 @@ void NetConnection::UpdateAcksAndStatus(const NetPacket& packet)
 			ushort ackID = GetAckIDForBitfieldIndex(bitIndex, header->mostRecentReceivedAck);
 			AckBundle& currBundle = GetAckForID(ackID);
 
+			//A bundle is acked by the next sixteen packets; after the first, or once its slot is reused, there's nothing left to do
+			if (currBundle.ackID != ackID)
+			{
+				continue;
+			}
+
 			RemoveReceivedReliablesForBundle(currBundle);
+			if (currBundle.snapshotID != INVALID_SNAPSHOT_ID)
+			{
+				ConfirmSnapshot((ushort)currBundle.snapshotID);
+			}
+			currBundle.ackID = INVALID_PACKET_ACK;
 		}
 	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
+//The bundle in the ID's slot may belong to another ack; check its ackID
 AckBundle& NetConnection::GetAckForID(ushort ackID)
 {
-	if (ackID >= m_currentZerothAckBundleIndex)
+	return m_ackBundles[GetBundleIndexForID(ackID)];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetConnection::RemoveReceivedReliablesForBundle(const AckBundle& bundle)
+{
+	for (ushort reliableID : bundle.reliableIDs)
+	{
+		ConfirmReliable(reliableID);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetConnection::ConfirmReliable(ushort reliableID)
+{
+	//Acks for a bundle keep arriving for a while, long after its reliables were confirmed
+	if ((ushort)(reliableID - m_oldestUnconfirmedReliableID) >= GetNumOutstandingReliables())
+	{
+		return;
+	}
+
+	UnconfirmedReliable& unconfirmed = GetUnconfirmedReliable(reliableID);
+	if (!unconfirmed.message.IsValid())
+	{
+		return;
+	}
+	unconfirmed.message.Reset();
+	m_numUnconfirmedReliables--;
+
+	//Slide the window past everything confirmed at the old end
+	while (m_oldestUnconfirmedReliableID != m_currentReliableID && !GetUnconfirmedReliable(m_oldestUnconfirmedReliableID).message.IsValid())
 	{
-		return m_ackBundles[ackID - m_currentZerothAckBundleIndex];
+		m_oldestUnconfirmedReliableID++;
 	}
+	AdmitWaitingReliables();
+}
 
-	//We wrapped and this ack is from the previous cycle, so offset the result by the size of the array
-	ushort newIndex = ackID + ARRAY_LENGTH(m_ackBundles) - m_currentZerothAckBundleIndex;
 
-	return m_ackBundles[newIndex];
+//-----------------------------------------------------------------------------------------------
+void NetConnection::AdmitWaitingReliables()
+{
+	while (!m_waitingReliables.empty() && GetNumOutstandingReliables() < MAX_NUM_UNCONFIRMED_RELIABLES)
+	{
+		UnconfirmedReliable& unconfirmed = GetUnconfirmedReliable(m_currentReliableID);
+		unconfirmed = m_waitingReliables.front();
+		m_waitingReliables.pop_front();
+		m_currentReliableID++;
+		m_numUnconfirmedReliables++;
+	}
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void NetConnection::RemoveReceivedReliablesForBundle(const AckBundle& bundle)
+//Acks can arrive out of order; only a newer snapshot moves the baseline forward
+void NetConnection::ConfirmSnapshot(ushort snapshotID)
 {
-	for (auto messageIter = m_unconfirmedReliables.begin(); messageIter != m_unconfirmedReliables.end();)
+	if (m_lastAckedSnapshotID == INVALID_SNAPSHOT_ID || (short)(snapshotID - (ushort)m_lastAckedSnapshotID) > 0)
 	{
-		NetMessage& thisMessage = *messageIter;
-		ushort reliableID = thisMessage.GetReliableID();
-		bool foundID = false;
-		for (ushort toConfirm : bundle.reliableIDs)
-		{
-			if (toConfirm == reliableID)
-			{
-				foundID = true;
-				break;
-			}
-		}
-		if (foundID)
-		{
-			messageIter = m_unconfirmedReliables.erase(messageIter);
-		}
-		else
-		{
-			messageIter++;
-		}
+		m_lastAckedSnapshotID = snapshotID;
 	}
 }
 
@@ -305,10 +409,9 @@ bool NetConnection::UpdateExpectedReliablesAndCheckShouldProcess(ushort reliable
 	//This code assumes equality.  We must update the next expected id based on our previous received ids
 	//and remove any previous received now less than the new next expected.
 	//Optimization depends on the implementation of the set, which SHOULD be ordered least to greatest
+	m_nextExpectedReliableID++;
 	while (!m_receivedReliablesPastExpected.empty())
 	{
-		m_nextExpectedReliableID++;
-
 		auto iter = m_receivedReliablesPastExpected.begin();
 		ushort testReliableID = *iter;
 
@@ -318,6 +421,7 @@ bool NetConnection::UpdateExpectedReliablesAndCheckShouldProcess(ushort reliable
 		}
 
 		m_receivedReliablesPastExpected.erase(iter);
+		m_nextExpectedReliableID++;
 	}
 
 	return true;
@@ -367,6 +471,7 @@ QuString NetConnection::GetDebugString() const
 	result += QuString::F("    Time since last received packet: %.2fs\n", m_timeSinceLastReceivedPacket);
 	result += QuString::F("    Current outgoing packet ack: %u\n", (m_currentAckIndex) ? m_currentAckIndex : INVALID_PACKET_ACK);
 	result += QuString::F("    Most recently confirmed ack: %u\n", m_highestReceivedAck);
+	result += QuString::F("    Last acked snapshot: %i\n", m_lastAckedSnapshotID);
 	result += "    Previous confirmed ack bitfield: ";
 	for (int i = BITS_PER_ACK_FIELD - 1; i >= 0; i--)
 	{
@@ -2,9 +2,12 @@
 
 #include "Engine/Network/NetworkSystem.hpp"
 #include "Engine/Network/NetMessage.hpp"
+#include "Engine/Network/NetPacket.hpp"
 #include "Engine/Network/VoiceChatSystem.hpp"
+#include "Engine/Core/ObjectPool.hpp"
 #include "Quantum/Core/String.h"
 
+#include <atomic>
 #include <string>
 #include <deque>
 #include <set>
@@ -14,6 +17,8 @@
 
 //-----------------------------------------------------------------------------------------------
 #define MAX_NUM_RELEVANT_ACK_BUNDLES 128
+#define MAX_NUM_UNCONFIRMED_RELIABLES 1024
+#define INVALID_SNAPSHOT_ID -1
 
 
 //-----------------------------------------------------------------------------------------------
@@ -32,10 +37,29 @@ enum ENetConnectionType
 
 
 //-----------------------------------------------------------------------------------------------
+//Queues hold shared messages by handle, so queueing and resending never copy a payload
+typedef std::deque<NetMessageRef> NetMessageDeque;
+typedef std::map<ushort, NetMessageRef, std::less<ushort>, PoolSTLAllocator<std::pair<const ushort, NetMessageRef>>> NetMessageMap;
+
+
+//-----------------------------------------------------------------------------------------------
+//Bundles are rewritten in place, so their ID lists keep their capacity from one use to the next
 struct AckBundle
 {
+	AckBundle() : ackID(INVALID_PACKET_ACK), snapshotID(INVALID_SNAPSHOT_ID) {}
+
 	ushort ackID;
 	std::vector<ushort> reliableIDs;
+	int snapshotID;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//An empty message marks a slot whose reliable has been confirmed
+struct UnconfirmedReliable
+{
+	NetMessageRef message;
+	ushort sequenceID;
 };
 
 
@@ -50,8 +74,14 @@ class NetConnection
 public:
 	NetConnection(byte index, const std::string& guid, const sockaddr_in& addr);
 	byte GetIndex() const { return m_index; }
+	uint32_t GetConnectionID() const { return m_connectionID; }
+	//Off the network thread, messages go over to it in the session's outgoing queue, and sending is left to it
 	bool ConstructPacketAndSend(byte playerIndex);
 	void AddMessage(NetMessage& message);
+
+	//Only the newest queued snapshot is kept; one still waiting when the next arrives is stale anyway
+	void QueueSnapshot(const NetMessage& snapshot, ushort snapshotID);
+	int GetLastAckedSnapshotID() const { return m_lastAckedSnapshotID; }
 	bool IsMe() const;
 	bool IsValid() const { return m_guid != ""; }
 	void UpdateAcksAndStatus(const class NetPacket& packet);
@@ -74,13 +104,26 @@ public:
 	void StartFromReliableID(ushort firstReliableID) { m_nextExpectedReliableID = firstReliableID + 1; }
 
 private:
-	void PushReliablesIntoPacket(NetPacket& packet, struct PacketHeader* header);
+	int PushReliablesIntoPacket(NetPacket& packet, ushort* outSentReliableIDs);
+	int PushSnapshotIntoPacket(NetPacket& packet);
 	void PushUnreliablesIntoPacket(NetPacket& packet);
-	ushort GetBundleIndexForID(ushort ackIndex);
+	ushort RecordAckBundle(const ushort* sentReliableIDs, int numSentReliables, int sentSnapshotID);
+	ushort GetBundleIndexForID(ushort ackID) const { return ackID % MAX_NUM_RELEVANT_ACK_BUNDLES; }
+	void ConfirmSnapshot(ushort snapshotID);
+	void AddSharedMessage(const NetMessageRef& message);
+	bool SendNextPacket(byte playerIndex);
+	int GetNumOutstandingReliables() const { return (ushort)(m_currentReliableID - m_oldestUnconfirmedReliableID); }
+	UnconfirmedReliable& GetUnconfirmedReliable(ushort reliableID) { return m_unconfirmedReliables[reliableID % MAX_NUM_UNCONFIRMED_RELIABLES]; }
+	void ConfirmReliable(ushort reliableID);
+	void AdmitWaitingReliables();
 
 private:
 	//This constructor should only be used by the NetSession for its own connection
-	NetConnection() {}
+	NetConnection() : m_connectionID(s_nextConnectionID++), m_currentReliableID(0), m_oldestUnconfirmedReliableID(0), m_nextReliableToSend(0), m_numUnconfirmedReliables(0)
+		, m_pendingSnapshotID(0), m_lastAckedSnapshotID(INVALID_SNAPSHOT_ID), m_hasUnsentAcks(false) {}
+	//Unique for the run, so a stale pointer to a deleted connection can't pass for a new one at the same address
+	static std::atomic<uint32_t> s_nextConnectionID;
+	uint32_t m_connectionID;
 	byte m_index;
 	std::string m_guid;
 	sockaddr_in m_toAddr;
@@ -91,18 +134,27 @@ private:
 	ushort m_currentReliableID;
 	ushort m_currentSequenceID;
 
-	//Would prefer queues here, but I want to iterate and change the data structure based on received reliables
-	std::deque<NetMessage> m_unconfirmedReliables;
-	std::deque<NetMessage> m_unsentUnreliables;
-
-
+	//Reliables from the oldest unconfirmed ID up to m_currentReliableID live in a ring indexed by reliable ID.
+	//Sends pick up from m_nextReliableToSend, so a backlog bigger than a packet goes round robin
+	UnconfirmedReliable m_unconfirmedReliables[MAX_NUM_UNCONFIRMED_RELIABLES];
+	ushort m_oldestUnconfirmedReliableID;
+	ushort m_nextReliableToSend;
+	int m_numUnconfirmedReliables;
+	//Reliables added while the ring is full wait here, in order, and get their IDs as acks make room
+	std::deque<UnconfirmedReliable> m_waitingReliables;
+	NetMessageDeque m_unsentUnreliables;
+	NetMessageRef m_pendingSnapshot;
+	ushort m_pendingSnapshotID;
+	int m_lastAckedSnapshotID;
+
+	//Indexed by ack ID modulo the count, which divides the ID range, so wrapping needs no special case
 	AckBundle m_ackBundles[MAX_NUM_RELEVANT_ACK_BUNDLES];
-	byte m_currentZerothAckBundleIndex;
+	bool m_hasUnsentAcks;
 	ushort m_nextExpectedReliableID;
 	std::set<ushort> m_receivedReliablesPastExpected;
 
 	//Using a map here because we can sort by ID but have a message value, and it's in order, so we can just poll the beginning
-	std::map<ushort, NetMessage> m_outOfOrderMessages;
+	NetMessageMap m_outOfOrderMessages;
 	ushort m_nextExpectedSequenceID;
 
 	float m_timeSinceLastReceivedPacket;
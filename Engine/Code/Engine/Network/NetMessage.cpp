@@ -1,5 +1,7 @@
 #include "Engine/Network/NetMessage.hpp"
 #include "Engine/Core/BytePacker.hpp"
+#include "Engine/Core/ObjectPool.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Math/Vector3.hpp"
 
 #include <string.h>
@@ -7,10 +9,83 @@
 const unsigned char INVALID_STRING_TOKEN = 0xFF;
 
 
+//-----------------------------------------------------------------------------------------------
+// SHARED MESSAGE ALLOCATION
+//	Most messages are a few bytes of game state, so payloads are rounded up to one of a handful
+//	of size classes, each with its own block pool
+//-----------------------------------------------------------------------------------------------
+static const uint16_t SHARED_MESSAGE_SIZE_CLASSES[] = { 32, 96, 224, 480, UDP_PACKET_MAX_LENGTH };
+static const char* SHARED_MESSAGE_POOL_NAMES[] = { "NetMessage32", "NetMessage96", "NetMessage224", "NetMessage480", "NetMessageMax" };
+static const int NUM_SHARED_MESSAGE_SIZE_CLASSES = ARRAY_LENGTH(SHARED_MESSAGE_SIZE_CLASSES);
+
+
+//-----------------------------------------------------------------------------------------------
+static BlockPool** CreateSharedMessagePools()
+{
+	BlockPool** pools = new BlockPool*[NUM_SHARED_MESSAGE_SIZE_CLASSES];
+	for (int sizeClass = 0; sizeClass < NUM_SHARED_MESSAGE_SIZE_CLASSES; sizeClass++)
+	{
+		size_t blockBytes = RefCount::GetBlockSize<SharedNetMessage>() + SHARED_MESSAGE_SIZE_CLASSES[sizeClass];
+		pools[sizeClass] = new BlockPool(blockBytes, alignof(RefCount::Header), 0, SHARED_MESSAGE_POOL_NAMES[sizeClass]);
+	}
+	return pools;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static BlockPool** GetSharedMessagePools()
+{
+	//Never destroyed, like the job pool; connections torn down during static destruction still release into them
+	static BlockPool** s_pools = CreateSharedMessagePools();
+	return s_pools;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC SharedNetMessage* SharedNetMessage::CreateAndAcquire(ENetMessage type, byte flags, const void* payload, uint16_t payloadBytes)
+{
+	ASSERT_OR_DIE(payloadBytes <= UDP_PACKET_MAX_LENGTH, "Message payload is larger than a packet");
+
+	byte sizeClass = 0;
+	while (SHARED_MESSAGE_SIZE_CLASSES[sizeClass] < payloadBytes)
+	{
+		sizeClass++;
+	}
+
+	void* block = GetSharedMessagePools()[sizeClass]->Allocate();
+	SharedNetMessage* result = RefCount::ConstructAndAcquire<SharedNetMessage>(block, FreeBlock, type, flags, payloadBytes, sizeClass);
+	memcpy(result + 1, payload, payloadBytes);
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+SharedNetMessage::SharedNetMessage(ENetMessage type, byte flags, uint16_t payloadBytes, byte sizeClass)
+	: m_size(payloadBytes)
+	, m_type(type)
+	, m_flags(flags)
+	, m_sizeClass(sizeClass)
+{
+
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC void SharedNetMessage::FreeBlock(void* block)
+{
+	const SharedNetMessage* message = (const SharedNetMessage*)((RefCount::Header*)block + 1);
+	GetSharedMessagePools()[message->m_sizeClass]->Free(block);
+}
+
+
 //-----------------------------------------------------------------------------------------------
 NetMessage::NetMessage()
 	: m_currPtr(m_buffer)
+	, m_spareBits(0)
 	, m_flags(0)
+	, m_reliableID(0)
+	, m_sequenceID(0)
 {
 
 }
@@ -21,6 +96,9 @@ NetMessage::NetMessage(byte type)
 	: m_type(type)
 	, m_flags(0)
 	, m_currPtr(m_buffer)
+	, m_spareBits(0)
+	, m_reliableID(0)
+	, m_sequenceID(0)
 {
 	m_currPtr = m_buffer;
 }
@@ -32,6 +110,7 @@ NetMessage::NetMessage(const NetMessage& other)
 	int numBytes = other.m_currPtr - other.m_buffer;
 	memcpy(m_buffer, other.m_buffer, numBytes);
 	m_currPtr = m_buffer + numBytes;
+	m_spareBits = other.m_spareBits;
 	m_type = other.m_type;
 	m_flags = other.m_flags;
 	m_reliableID = other.m_reliableID;
@@ -42,9 +121,11 @@ NetMessage::NetMessage(const NetMessage& other)
 //-----------------------------------------------------------------------------------------------
 void NetMessage::operator=(const NetMessage& other)
 {
+	m_shared.Reset();
 	int numBytes = other.m_currPtr - other.m_buffer;
 	memcpy(m_buffer, other.m_buffer, numBytes);
 	m_currPtr = m_buffer + numBytes;
+	m_spareBits = other.m_spareBits;
 	m_type = other.m_type;
 	m_flags = other.m_flags;
 	m_reliableID = other.m_reliableID;
@@ -52,6 +133,116 @@ void NetMessage::operator=(const NetMessage& other)
 }
 
 
+//-----------------------------------------------------------------------------------------------
+NetMessageRef NetMessage::Share() const
+{
+	if (!m_shared.IsValid())
+	{
+		m_shared = NetMessageRef(SharedNetMessage::CreateAndAcquire(m_type, m_flags, m_buffer, GetSize()));
+	}
+
+	return m_shared;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Leaves the message as if it had just been read out of a packet
+void NetMessage::LoadForReading(const SharedNetMessage& shared, ushort sequenceID)
+{
+	Reset();
+	m_type = shared.GetMessageType();
+	m_flags = shared.GetFlags();
+	m_sequenceID = sequenceID;
+	memcpy(m_buffer, shared.GetContents(), shared.GetSize());
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetMessage::WriteBits(uint32_t value, int numBits)
+{
+	m_shared.Reset();
+	if (GetWritableBytes() >= BitPacker::GetNumNewBytes(numBits, m_spareBits))
+	{
+		BitPacker::WriteBits(value, numBits, (void**)&m_currPtr, &m_spareBits);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetMessage::ReadBits(uint32_t& outValue, int numBits)
+{
+	if (GetReadableBytes() < BitPacker::GetNumNewBytes(numBits, m_spareBits))
+	{
+		return false;
+	}
+
+	outValue = BitPacker::ReadBits(numBits, (void**)&m_currPtr, &m_spareBits);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetMessage::ReadBool(bool& outValue)
+{
+	uint32_t bit;
+	if (!ReadBits(bit, 1))
+	{
+		return false;
+	}
+
+	outValue = (bit != 0);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetMessage::WriteVarUInt(uint32_t value)
+{
+	m_shared.Reset();
+	if (GetWritableBytes() >= BitPacker::GetNumNewBytes(BitPacker::GetVarUIntBits(value), m_spareBits))
+	{
+		BitPacker::WriteVarUInt(value, (void**)&m_currPtr, &m_spareBits);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetMessage::ReadVarUInt(uint32_t& outValue)
+{
+	outValue = 0;
+	for (int shift = 0; shift < 32; shift += 7)
+	{
+		uint32_t group;
+		if (!ReadBits(group, 8))
+		{
+			return false;
+		}
+
+		outValue |= (group & 0x7F) << shift;
+		if ((group & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetMessage::ReadVarInt(int32_t& outValue)
+{
+	uint32_t encoded;
+	if (!ReadVarUInt(encoded))
+	{
+		return false;
+	}
+
+	outValue = BitPacker::ZigZagDecode(encoded);
+	return true;
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void NetMessage::WriteBuffer(void* buffer, ushort numBytes)
 {
@@ -90,6 +281,8 @@ bool NetMessage::ReadBuffer(void* outBuffer, ushort& outBytes)
 //-----------------------------------------------------------------------------------------------
 void NetMessage::WriteString(const char* toWrite)
 {
+	m_shared.Reset();
+	m_spareBits = 0;
 	if (GetWritableBytes() < 1)
 	{
 		return;
@@ -121,6 +314,7 @@ void NetMessage::WriteString(const char* toWrite)
 //-----------------------------------------------------------------------------------------------
 char* NetMessage::ReadString(char* buffer)
 {
+	m_spareBits = 0;
 	char peek = *m_currPtr;
 	if (peek == INVALID_STRING_TOKEN)
 	{
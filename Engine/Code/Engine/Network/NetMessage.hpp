@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Engine/Network/NetworkSystem.hpp"
+#include "Engine/Core/ReferenceCount.hpp"
+#include "Engine/Core/BitPacker.hpp"
 
 #include <string>
 
@@ -20,6 +22,8 @@ enum ENetMessageCore : byte
 	NETMESSAGE_LEAVE,
 	NETMESSAGE_VOICE_SYNC,
 	NETMESSAGE_VOICE_CHUNK,
+	NETMESSAGE_SNAPSHOT,
+	NETMESSAGE_SNAPSHOT_RESET,
 	NETMESSAGE_CORE_COUNT
 };
 typedef byte ENetMessage;
@@ -35,9 +39,10 @@ enum ENetMessageFlag : byte
 
 
 //-----------------------------------------------------------------------------------------------
+//Unpacked form; NetPacket bit packs these on the wire
 struct MessageHeader
 {
-	uint16_t messageSize;
+	uint16_t payloadSize;
 	ushort reliableID;
 	ushort sequenceID;
 	ENetMessage type;
@@ -56,11 +61,87 @@ struct NetMessageDef
 };
 
 
+//-----------------------------------------------------------------------------------------------
+// A message's type, flags and payload, frozen and ref counted so that every connection queueing
+// it, and every resend, shares one copy.  The payload sits right behind the object, in a block
+// from a slab pool sized to fit it rather than a whole packet.
+//-----------------------------------------------------------------------------------------------
+class SharedNetMessage
+{
+public:
+	static SharedNetMessage* CreateAndAcquire(ENetMessage type, byte flags, const void* payload, uint16_t payloadBytes);
+	static void Acquire(SharedNetMessage* message) { RefCount::Acquire(message); }
+	static void Release(SharedNetMessage* message) { RefCount::Release(message); }
+
+	//Only for CreateAndAcquire, which makes room for the payload
+	SharedNetMessage(ENetMessage type, byte flags, uint16_t payloadBytes, byte sizeClass);
+
+	ENetMessage GetMessageType() const { return m_type; }
+	byte GetFlags() const { return m_flags; }
+	uint16_t GetSize() const { return m_size; }
+	const void* GetContents() const { return this + 1; }
+	bool CheckFlag(ENetMessageFlag flag) const { return ((1 << flag) & m_flags) != 0; }
+
+private:
+	static void FreeBlock(void* block);
+
+private:
+	uint16_t m_size;
+	ENetMessage m_type;
+	byte m_flags;
+	byte m_sizeClass;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Owns one strong reference to a SharedNetMessage
+class NetMessageRef
+{
+public:
+	NetMessageRef() : m_message(nullptr) {}
+	explicit NetMessageRef(SharedNetMessage* acquiredMessage) : m_message(acquiredMessage) {}
+	NetMessageRef(const NetMessageRef& other) : m_message(other.m_message) { if (m_message) SharedNetMessage::Acquire(m_message); }
+	NetMessageRef(NetMessageRef&& other) : m_message(other.m_message) { other.m_message = nullptr; }
+	~NetMessageRef() { Reset(); }
+
+	NetMessageRef& operator=(NetMessageRef other)
+	{
+		SharedNetMessage* temp = m_message;
+		m_message = other.m_message;
+		other.m_message = temp;
+		return *this;
+	}
+
+	void Reset()
+	{
+		if (m_message)
+		{
+			SharedNetMessage::Release(m_message);
+			m_message = nullptr;
+		}
+	}
+
+	bool IsValid() const { return m_message != nullptr; }
+	const SharedNetMessage* operator->() const { return m_message; }
+	const SharedNetMessage& operator*() const { return *m_message; }
+
+private:
+	SharedNetMessage* m_message;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+// Messages are built and read in place, in a full packet's worth of buffer.  Queueing one on a
+// connection shares a frozen copy of what has been written so far.
+//
+// Bit-packed writes (and reads) pack into each other's spare bits; a byte-sized Write or Read
+// always starts on a fresh byte.  Read back in the same order and widths they were written.
 //-----------------------------------------------------------------------------------------------
 class NetMessage
 {
 	friend class NetSession;
 	friend class NetConnection;
+	friend class SnapshotReplicator;
 public:
 	NetMessage(byte type);
 	NetMessage(const NetMessage& other);
@@ -69,6 +150,16 @@ public:
 	template<typename T> bool Read(ND<T>& outData);
 	void WriteBuffer(void* buffer, ushort numBytes);
 	bool ReadBuffer(void* outBuffer, ushort& numBytes);
+	void WriteBits(uint32_t value, int numBits);
+	bool ReadBits(uint32_t& outValue, int numBits);
+	void WriteBool(bool value) { WriteBits(value ? 1 : 0, 1); }
+	bool ReadBool(bool& outValue);
+	void WriteVarUInt(uint32_t value);
+	bool ReadVarUInt(uint32_t& outValue);
+	void WriteVarInt(int32_t value) { WriteVarUInt(BitPacker::ZigZagEncode(value)); }
+	bool ReadVarInt(int32_t& outValue);
+	template<typename T> void WriteQuantized(const ND<T>& toWrite, const FloatQuantization& quantization);
+	template<typename T> bool ReadQuantized(ND<T>& outData, const FloatQuantization& quantization);
 	uint16_t GetSize() const { return (uint16_t)(m_currPtr - m_buffer); }
 	uint16_t GetWritableBytes() const { return (uint16_t)(UDP_PACKET_MAX_LENGTH - GetLength()); }
 	uint16_t GetReadableBytes() const { return GetWritableBytes(); }
@@ -76,10 +167,10 @@ public:
 	const void* GetContents() const { return m_buffer; }
 	ENetMessage GetMessageType() const { return m_type; }
 	ENetMessageFlag GetFlags() const { return (ENetMessageFlag)m_flags; }
-	void Reset() { m_currPtr = m_buffer; }
+	void Reset() { m_currPtr = m_buffer; m_spareBits = 0; m_shared.Reset(); }
 	bool CheckFlag(ENetMessageFlag flag) const { return ((1 << flag) & m_flags) != 0; }
-	void SetFlag(ENetMessageFlag flag) { m_flags |= (1 << flag); }
-	void ClearFlag(ENetMessageFlag flag) { m_flags &= ~(1 << flag); }
+	void SetFlag(ENetMessageFlag flag) { m_flags |= (1 << flag); m_shared.Reset(); }
+	void ClearFlag(ENetMessageFlag flag) { m_flags &= ~(1 << flag); m_shared.Reset(); }
 	bool IsReliable() const { return CheckFlag(NETMESSAGEFLAG_RELIABLE); }
 	ushort GetReliableID() const { return m_reliableID; }
 	void SetReliableID(ushort reliableID) { m_reliableID = reliableID; }
@@ -87,18 +178,24 @@ public:
 	ushort GetSequenceID() const { return m_sequenceID; }
 	void SetSequenceID(ushort sequenceID) { m_sequenceID = sequenceID; }
 
+	//Cached until the message is next changed, so adding it to several connections makes one copy
+	NetMessageRef Share() const;
+
 private:
 	NetMessage();
 	void WriteString(const char* toWrite);
 	char* ReadString(char* buffer);
+	void LoadForReading(const SharedNetMessage& shared, ushort sequenceID);
 	
 private:
 	byte m_buffer[UDP_PACKET_MAX_LENGTH];
 	byte* m_currPtr;
+	byte m_spareBits;
 	byte m_type;
 	byte m_flags;
 	ushort m_reliableID;
 	ushort m_sequenceID;
+	mutable NetMessageRef m_shared;
 };
 
 #include "Engine/Network/NetMessage.inl"
\ No newline at end of file
@@ -3,6 +3,9 @@
 //-----------------------------------------------------------------------------------------------
 
 #include "Engine/Core/BytePacker.hpp"
+#include "Engine/Core/ArenaAllocator.hpp"
+#include "Engine/Math/Vector2.hpp"
+#include "Engine/Math/Vector3.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -11,6 +14,8 @@ void inline NetMessage::Write(const ND<T>& toWrite)
 {
 	int dataSize = sizeof(T);
 
+	m_shared.Reset();
+	m_spareBits = 0;
 	if (GetWritableBytes() >= dataSize)
 	{
 		if (Network::GetEngineEndianness() == NET_TRAFFIC_ENDIANNESS)
@@ -31,6 +36,7 @@ bool inline NetMessage::Read(ND<T>& outResult)
 {
 	int dataSize = sizeof(T);
 
+	m_spareBits = 0;
 	if (GetReadableBytes() >= dataSize)
 	{
 		if (Network::GetEngineEndianness() == NET_TRAFFIC_ENDIANNESS)
@@ -52,6 +58,59 @@ bool inline NetMessage::Read(ND<T>& outResult)
 }
 
 
+//-----------------------------------------------------------------------------------------------
+template<> inline void NetMessage::WriteQuantized<float>(const float& toWrite, const FloatQuantization& quantization)
+{
+	WriteBits(BitPacker::QuantizeFloat(toWrite, quantization), quantization.numBits);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<> inline bool NetMessage::ReadQuantized<float>(float& outData, const FloatQuantization& quantization)
+{
+	uint32_t quantized;
+	if (!ReadBits(quantized, quantization.numBits))
+	{
+		return false;
+	}
+
+	outData = BitPacker::DequantizeFloat(quantized, quantization);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Vectors quantize each component over the same range
+template<> inline void NetMessage::WriteQuantized<Vector2>(const Vector2& toWrite, const FloatQuantization& quantization)
+{
+	WriteQuantized<float>(toWrite.x, quantization);
+	WriteQuantized<float>(toWrite.y, quantization);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<> inline bool NetMessage::ReadQuantized<Vector2>(Vector2& outData, const FloatQuantization& quantization)
+{
+	return ReadQuantized<float>(outData.x, quantization) && ReadQuantized<float>(outData.y, quantization);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<> inline void NetMessage::WriteQuantized<Vector3>(const Vector3& toWrite, const FloatQuantization& quantization)
+{
+	WriteQuantized<float>(toWrite.x, quantization);
+	WriteQuantized<float>(toWrite.y, quantization);
+	WriteQuantized<float>(toWrite.z, quantization);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+template<> inline bool NetMessage::ReadQuantized<Vector3>(Vector3& outData, const FloatQuantization& quantization)
+{
+	return ReadQuantized<float>(outData.x, quantization) && ReadQuantized<float>(outData.y, quantization) && ReadQuantized<float>(outData.z, quantization);
+}
+
+
 //-----------------------------------------------------------------------------------------------
 template<> inline void NetMessage::Write<const char*>(const char* const& data)
 {
@@ -100,16 +159,15 @@ template<> inline bool NetMessage::Read<char* const>(char* const& data)
 //-----------------------------------------------------------------------------------------------
 template<> inline bool NetMessage::Read<std::string>(std::string& data)
 {
-	char* buffer = (char*)malloc(UDP_PACKET_MAX_LENGTH);
-	buffer = ReadString(buffer);
-	if (!buffer)
+	ArenaAllocator& scratch = FrameArena::Get();
+	ScopedArenaRewind rewindScratch(scratch);
+	char* buffer = scratch.Alloc<char>(UDP_PACKET_MAX_LENGTH);
+	if (!ReadString(buffer))
 	{
 		data = "";
-		free(buffer);
 		return false;
 	}
 
 	data = buffer;
-	free(buffer);
 	return true;
 }
\ No newline at end of file
@@ -1,6 +1,185 @@
 #include "Engine/Network/NetPacket.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Math/MathUtils.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+
+#include <cstring>
+#include <math.h>
+
+
+//-----------------------------------------------------------------------------------------------
+// MESSAGE HEADERS
+//	Bit packed, then padded out to a byte so the payload can be copied straight in:
+//		flags (3 bits), type (8), payload size (11)
+//		reliable ID if reliable, then sequence ID if ordered.  The first of each in a packet is
+//		sent whole; after that, one set bit means "one past the last", or a clear bit is followed
+//		by the zigzagged difference from the last as a varint
+//-----------------------------------------------------------------------------------------------
+static const int MESSAGE_FLAG_BITS = 3;
+static const int MESSAGE_TYPE_BITS = 8;
+static const int MESSAGE_PAYLOAD_SIZE_BITS = 11;
+static const int MESSAGE_ID_BITS = 16;
+
+
+//-----------------------------------------------------------------------------------------------
+static int GetMessageIDBits(ushort messageID, int previousID)
+{
+	if (previousID < 0)
+	{
+		return MESSAGE_ID_BITS;
+	}
+	if (messageID == (ushort)(previousID + 1))
+	{
+		return 1;
+	}
+
+	return 1 + BitPacker::GetVarUIntBits(BitPacker::ZigZagEncode((short)(messageID - previousID)));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void WriteMessageID(ushort messageID, int& previousID, void** destPtr, byte* spareBits)
+{
+	if (previousID < 0)
+	{
+		BitPacker::WriteBits(messageID, MESSAGE_ID_BITS, destPtr, spareBits);
+	}
+	else if (messageID == (ushort)(previousID + 1))
+	{
+		BitPacker::WriteBits(1, 1, destPtr, spareBits);
+	}
+	else
+	{
+		BitPacker::WriteBits(0, 1, destPtr, spareBits);
+		BitPacker::WriteVarUInt(BitPacker::ZigZagEncode((short)(messageID - previousID)), destPtr, spareBits);
+	}
+	previousID = messageID;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Checks each field fits in what's left of the packet before reading it
+static bool ReadMessageHeaderBits(uint32_t& outValue, int numBits, void** srcPtr, byte* spareBits, int readableBytes)
+{
+	if (readableBytes < BitPacker::GetNumNewBytes(numBits, *spareBits))
+	{
+		return false;
+	}
+
+	outValue = BitPacker::ReadBits(numBits, srcPtr, spareBits);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int NetPacket::GetMessageHeaderBytes(const MessageHeader& msgHeader) const
+{
+	int numBits = MESSAGE_FLAG_BITS + MESSAGE_TYPE_BITS + MESSAGE_PAYLOAD_SIZE_BITS;
+	if ((msgHeader.flags & (1 << NETMESSAGEFLAG_RELIABLE)) != 0)
+	{
+		numBits += GetMessageIDBits(msgHeader.reliableID, m_previousReliableID);
+	}
+	if ((msgHeader.flags & (1 << NETMESSAGEFLAG_ORDERED)) != 0)
+	{
+		numBits += GetMessageIDBits(msgHeader.sequenceID, m_previousSequenceID);
+	}
+
+	return (numBits + 7) / 8;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetPacket::WriteMessageHeader(const MessageHeader& msgHeader)
+{
+	byte spareBits = 0;
+	BitPacker::WriteBits(msgHeader.flags, MESSAGE_FLAG_BITS, (void**)&m_currPtr, &spareBits);
+	BitPacker::WriteBits(msgHeader.type, MESSAGE_TYPE_BITS, (void**)&m_currPtr, &spareBits);
+	BitPacker::WriteBits(msgHeader.payloadSize, MESSAGE_PAYLOAD_SIZE_BITS, (void**)&m_currPtr, &spareBits);
+	if ((msgHeader.flags & (1 << NETMESSAGEFLAG_RELIABLE)) != 0)
+	{
+		WriteMessageID(msgHeader.reliableID, m_previousReliableID, (void**)&m_currPtr, &spareBits);
+	}
+	if ((msgHeader.flags & (1 << NETMESSAGEFLAG_ORDERED)) != 0)
+	{
+		WriteMessageID(msgHeader.sequenceID, m_previousSequenceID, (void**)&m_currPtr, &spareBits);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetPacket::ReadMessageHeaderAndAdvance(MessageHeader* outHeader)
+{
+	byte spareBits = 0;
+	uint32_t fields[3];
+	const int fieldBits[3] = { MESSAGE_FLAG_BITS, MESSAGE_TYPE_BITS, MESSAGE_PAYLOAD_SIZE_BITS };
+	for (int fieldIndex = 0; fieldIndex < 3; fieldIndex++)
+	{
+		if (!ReadMessageHeaderBits(fields[fieldIndex], fieldBits[fieldIndex], (void**)&m_currPtr, &spareBits, GetReadableBytes()))
+		{
+			return false;
+		}
+	}
+	outHeader->flags = (byte)fields[0];
+	outHeader->type = (ENetMessage)fields[1];
+	outHeader->payloadSize = (uint16_t)fields[2];
+	outHeader->reliableID = 0;
+	outHeader->sequenceID = 0;
+
+	int* previousIDs[2] = { &m_previousReliableID, &m_previousSequenceID };
+	ushort* outIDs[2] = { &outHeader->reliableID, &outHeader->sequenceID };
+	const ENetMessageFlag idFlags[2] = { NETMESSAGEFLAG_RELIABLE, NETMESSAGEFLAG_ORDERED };
+	for (int idIndex = 0; idIndex < 2; idIndex++)
+	{
+		if ((outHeader->flags & (1 << idFlags[idIndex])) == 0)
+		{
+			continue;
+		}
+
+		int& previousID = *previousIDs[idIndex];
+		uint32_t value;
+		if (previousID < 0)
+		{
+			if (!ReadMessageHeaderBits(value, MESSAGE_ID_BITS, (void**)&m_currPtr, &spareBits, GetReadableBytes()))
+			{
+				return false;
+			}
+			*outIDs[idIndex] = (ushort)value;
+		}
+		else
+		{
+			if (!ReadMessageHeaderBits(value, 1, (void**)&m_currPtr, &spareBits, GetReadableBytes()))
+			{
+				return false;
+			}
+			if (value)
+			{
+				*outIDs[idIndex] = (ushort)(previousID + 1);
+			}
+			else
+			{
+				//Zigzagged 16-bit deltas never take more than three varint groups
+				uint32_t delta = 0;
+				for (int shift = 0; shift < 21; shift += 7)
+				{
+					uint32_t group;
+					if (!ReadMessageHeaderBits(group, 8, (void**)&m_currPtr, &spareBits, GetReadableBytes()))
+					{
+						return false;
+					}
+					delta |= (group & 0x7F) << shift;
+					if ((group & 0x80) == 0)
+					{
+						break;
+					}
+				}
+				*outIDs[idIndex] = (ushort)(previousID + BitPacker::ZigZagDecode(delta));
+			}
+		}
+		previousID = *outIDs[idIndex];
+	}
+
+	return true;
+}
 
 
 //-----------------------------------------------------------------------------------------------
@@ -9,21 +188,44 @@ bool NetPacket::WriteContents(const NetMessage& msg)
 	MessageHeader msgHeader;
 	msgHeader.flags = msg.GetFlags();
 	msgHeader.type = msg.GetMessageType();
-	uint16_t payloadSize = msg.GetSize();
-	msgHeader.messageSize = sizeof(MessageHeader) + payloadSize;
+	msgHeader.payloadSize = msg.GetSize();
 	msgHeader.reliableID = msg.GetReliableID();
 	msgHeader.sequenceID = msg.GetSequenceID();
-	if (GetWritableBytes() < msgHeader.messageSize)
+
+	return WriteMessage(msgHeader, msg.GetContents());
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Reliable and sequence IDs belong to the connection sending it, not the shared message
+bool NetPacket::WriteContents(const SharedNetMessage& msg, ushort reliableID, ushort sequenceID)
+{
+	MessageHeader msgHeader;
+	msgHeader.flags = msg.GetFlags();
+	msgHeader.type = msg.GetMessageType();
+	msgHeader.payloadSize = msg.GetSize();
+	msgHeader.reliableID = reliableID;
+	msgHeader.sequenceID = sequenceID;
+
+	return WriteMessage(msgHeader, msg.GetContents());
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetPacket::WriteMessage(const MessageHeader& msgHeader, const void* contents)
+{
+	//Packed headers are small enough that empty messages would overflow the count before the buffer
+	PacketHeader* header = (PacketHeader*)m_buffer;
+	if (header->messageCount == MAX_MESSAGES_PER_PACKET || GetWritableBytes() < GetMessageHeaderBytes(msgHeader) + msgHeader.payloadSize)
 	{
 		return false;
 	}
 
-	Write<MessageHeader>(msgHeader);
+	WriteMessageHeader(msgHeader);
 	//Messages should already be in correct byte order, so write them forward
-	BytePacker::WriteForward(msg.GetContents(), (void**)&m_currPtr, payloadSize);
+	BytePacker::WriteForward(contents, (void**)&m_currPtr, msgHeader.payloadSize);
 
 	//Increase message count by one
-	PacketHeader* header = (PacketHeader*)m_buffer;
 	header->messageCount++;
 
 	return true;
@@ -55,17 +257,194 @@ void NetPacket::Initialize(int bufferSize)
 {
 	PacketHeader* header = ReadPacketHeaderAndAdvance();
 	byte numMessages = header->messageCount;
-	int packetSize = sizeof(PacketHeader);
-	for (int i = 0; i < numMessages; i++)
+	bool isReadable = true;
+	for (int i = 0; i < numMessages && isReadable; i++)
 	{
-		MessageHeader* msgHeader = ReadMessageHeaderAndAdvance();
-		packetSize += msgHeader->messageSize;
-		Advance(msgHeader->messageSize - sizeof(MessageHeader));
+		MessageHeader msgHeader;
+		isReadable = ReadMessageHeaderAndAdvance(&msgHeader) && msgHeader.payloadSize <= GetReadableBytes();
+		if (isReadable)
+		{
+			Advance(msgHeader.payloadSize);
+		}
 	}
+	int packetSize = GetLength();
 
-	ASSERT_OR_DIE(bufferSize == packetSize, "Packet corrupted. Buffer size does not match packet read size");
+	ASSERT_OR_DIE(isReadable && bufferSize == packetSize, "Packet corrupted. Buffer size does not match packet read size");
 
 	//Rewind read
 	m_currPtr = m_buffer + sizeof(PacketHeader);
 	m_remainingMessages = numMessages;
+	ResetMessageIDDeltas();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// PACKING TESTS
+//	Round trips the bit packer and compact headers, and measures what position updates cost on
+//	the wire now against byte-aligned Vector3s under the old 8-byte message header
+//-----------------------------------------------------------------------------------------------
+static const int LEGACY_MESSAGE_HEADER_BYTES = 8;
+static const ENetMessage TEST_POSITION_MESSAGE = NETMESSAGE_CORE_COUNT;
+
+//Half a kilometer each way at about 1.5cm steps
+static const FloatQuantization TEST_POSITION_QUANTIZATION = { -512.f, 512.f, 16 };
+
+
+//-----------------------------------------------------------------------------------------------
+static bool TestBitPackerRoundTrip()
+{
+	byte buffer[256];
+	memset(buffer, 0xCD, sizeof(buffer));
+	void* writePtr = buffer;
+	byte writeSpareBits = 0;
+
+	const uint32_t values[] = { 0, 1, 0x5A, 0x3FF, 0xFFFF, 0x12345, 0xFFFFFFFF, 7 };
+	const int widths[] = { 1, 1, 7, 10, 16, 17, 32, 3 };
+	for (size_t index = 0; index < ARRAY_LENGTH(values); index++)
+	{
+		BitPacker::WriteBits(values[index], widths[index], &writePtr, &writeSpareBits);
+	}
+	const int varValues[] = { 0, -1, 1, 63, -64, 64, 300, -70000, 0x7FFFFFFF, (int)0x80000000 };
+	for (int varValue : varValues)
+	{
+		BitPacker::WriteVarUInt(BitPacker::ZigZagEncode(varValue), &writePtr, &writeSpareBits);
+	}
+
+	void* readPtr = buffer;
+	byte readSpareBits = 0;
+	for (size_t index = 0; index < ARRAY_LENGTH(values); index++)
+	{
+		if (BitPacker::ReadBits(widths[index], &readPtr, &readSpareBits) != values[index])
+		{
+			return false;
+		}
+	}
+	for (int varValue : varValues)
+	{
+		if (BitPacker::ZigZagDecode(BitPacker::ReadVarUInt(&readPtr, &readSpareBits)) != varValue)
+		{
+			return false;
+		}
+	}
+
+	return readPtr == writePtr && readSpareBits == writeSpareBits;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static Vector3 GetTestPosition(int index)
+{
+	return Vector3(GetRandominRange(-500.f, 500.f), GetRandominRange(0.f, 40.f), (float)(index % 100) - 50.f);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Fills one packet with position updates, reads it back and returns bytes per message
+STATIC float NetPacket::PackTestPositions(bool isQuantized, bool isReliable, float& outMaxError, bool& outIsIntact)
+{
+	NetPacket packet;
+	std::vector<Vector3> positions;
+	ushort reliableID = 40000;
+	for (;;)
+	{
+		Vector3 position = GetTestPosition((int)positions.size());
+		NetMessage msg(TEST_POSITION_MESSAGE);
+		if (isReliable)
+		{
+			msg.SetFlag(NETMESSAGEFLAG_RELIABLE);
+			msg.SetFlag(NETMESSAGEFLAG_ORDERED);
+			msg.SetReliableID(reliableID);
+			msg.SetSequenceID(reliableID - 100);
+			reliableID++;
+		}
+		if (isQuantized)
+		{
+			msg.WriteQuantized<Vector3>(position, TEST_POSITION_QUANTIZATION);
+		}
+		else
+		{
+			msg.Write<Vector3>(position);
+		}
+		if (!packet.WriteContents(msg))
+		{
+			break;
+		}
+		positions.push_back(position);
+	}
+
+	NetPacket received(false);
+	memcpy(received.GetBuffer(), packet.GetCopyableBuffer(), packet.GetLength());
+	received.Initialize(packet.GetLength());
+
+	outMaxError = 0.f;
+	outIsIntact = true;
+	reliableID = 40000;
+	for (const Vector3& sent : positions)
+	{
+		MessageHeader msgHeader;
+		received.ReadMessageHeaderAndAdvance(&msgHeader);
+		byte payload[UDP_PACKET_MAX_LENGTH];
+		received.ReadContents(payload, msgHeader.payloadSize);
+		NetMessage msg(msgHeader.type);
+		for (int payloadIndex = 0; payloadIndex < msgHeader.payloadSize; payloadIndex++)
+		{
+			msg.Write<byte>(payload[payloadIndex]);
+		}
+		//Rewind to read back what was just copied in
+		msg.Reset();
+
+		Vector3 position;
+		bool isRead = isQuantized ? msg.ReadQuantized<Vector3>(position, TEST_POSITION_QUANTIZATION) : msg.Read<Vector3>(position);
+		if (!isRead || msgHeader.type != TEST_POSITION_MESSAGE || (isReliable && (msgHeader.reliableID != reliableID || msgHeader.sequenceID != (ushort)(reliableID - 100))))
+		{
+			outIsIntact = false;
+		}
+		reliableID++;
+
+		Vector3 error = position - sent;
+		float maxComponentError = Max(Max(fabsf(error.x), fabsf(error.y)), fabsf(error.z));
+		outMaxError = Max(outMaxError, maxComponentError);
+	}
+
+	float payloadBytes = (float)(packet.GetLength() - (int)sizeof(PacketHeader));
+	if (!isQuantized)
+	{
+		//What the same messages cost before headers were packed
+		payloadBytes = (float)((LEGACY_MESSAGE_HEADER_BYTES + sizeof(Vector3)) * positions.size());
+	}
+	return payloadBytes / (float)positions.size();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(NetPackTest, args)
+{
+	(void)args;
+	bool isPassing = TestBitPackerRoundTrip();
+	ConsolePrintf(isPassing ? WHITE : RED, "Bit packer round trip: %s", isPassing ? "passed" : "FAILED");
+
+	const char* trafficNames[] = { "Unreliable", "Reliable ordered" };
+	for (int traffic = 0; traffic < 2; traffic++)
+	{
+		bool isReliable = (traffic == 1);
+		float legacyError;
+		float packedError;
+		bool isLegacyIntact;
+		bool isPackedIntact;
+		float legacyBytes = NetPacket::PackTestPositions(false, isReliable, legacyError, isLegacyIntact);
+		float packedBytes = NetPacket::PackTestPositions(true, isReliable, packedError, isPackedIntact);
+
+		//Rounding puts every component within half a step
+		float halfStep = (TEST_POSITION_QUANTIZATION.maxValue - TEST_POSITION_QUANTIZATION.minValue) / (float)((1 << TEST_POSITION_QUANTIZATION.numBits) - 1) * .5f;
+		bool isTrafficPassing = isLegacyIntact && isPackedIntact && legacyError == 0.f && packedError <= halfStep * 1.001f;
+		isPassing = isPassing && isTrafficPassing;
+
+		ConsolePrintf(isTrafficPassing ? WHITE : RED, "%s position updates: %.1f bytes/message before, %.1f packed (max error %.4f): %s",
+			trafficNames[traffic], legacyBytes, packedBytes, packedError, isTrafficPassing ? "passed" : "FAILED");
+	}
+
+	if (!isPassing)
+	{
+		ConsolePrint("Net packing tests FAILED", RED);
+	}
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #define INVALID_PACKET_ACK 0xFFFF
 #define BITS_PER_ACK_FIELD 16
+#define MAX_MESSAGES_PER_PACKET 255	//PacketHeader::messageCount is a byte
 
 struct PacketHeader
 {
@@ -26,25 +27,37 @@ public:
 	template<typename T> void Write(const ND<T>& data);
 	template<typename T> bool Read(ND<T>& outData) const;
 	bool WriteContents(const NetMessage& msg);
+	bool WriteContents(const SharedNetMessage& msg, ushort reliableID, ushort sequenceID);
 	void ReadContents(byte* outBuffer, uint16_t messageSize);
 	uint16_t GetWritableBytes() const { return (uint16_t)(UDP_PACKET_MAX_LENGTH - GetLength()); }
 	uint16_t GetReadableBytes() const { return GetWritableBytes(); }
 	const char* GetCopyableBuffer() const { return (const char*)m_buffer; }
 	int GetLength() const { return m_currPtr - m_buffer; }
 	uint16_t Advance(int numBytes);
-	void Reset() { m_currPtr = m_buffer; }
+
+	//For the netpacktest command, which plays both sender and receiver
+	static float PackTestPositions(bool isQuantized, bool isReliable, float& outMaxError, bool& outIsIntact);
+	void Reset() { m_currPtr = m_buffer; ResetMessageIDDeltas(); }
 	inline PacketHeader* ReadPacketHeaderAndAdvance();
 	inline PacketHeader* GetPacketHeader() const { return (PacketHeader*)m_buffer; }
-	inline MessageHeader* ReadMessageHeaderAndAdvance();
+	bool ReadMessageHeaderAndAdvance(MessageHeader* outHeader);
+	int GetMessageHeaderBytes(const MessageHeader& msgHeader) const;
 
 private:
 	char* GetBuffer() { return (char*)m_buffer; }
 	void Initialize(int bufferSize);
+	bool WriteMessage(const MessageHeader& msgHeader, const void* contents);
+	void WriteMessageHeader(const MessageHeader& msgHeader);
+	void ResetMessageIDDeltas() { m_previousReliableID = -1; m_previousSequenceID = -1; }
 
 private:
 	byte m_buffer[UDP_PACKET_MAX_LENGTH];
 	byte* m_currPtr;
 	int m_remainingMessages;
+
+	//Reliable and sequence IDs are sent relative to the last ones in the packet.  -1 before the first
+	int m_previousReliableID;
+	int m_previousSequenceID;
 };
 
 
@@ -7,6 +7,7 @@
 NetPacket::NetPacket(bool forWriting /* = true */)
 {
 	m_currPtr = m_buffer;
+	ResetMessageIDDeltas();
 	PacketHeader* header = (PacketHeader*)m_buffer;
 	header->playerIndex = INVALID_CONNECTION_INDEX;
 	header->messageCount = 0;
@@ -75,16 +76,4 @@ PacketHeader* NetPacket::ReadPacketHeaderAndAdvance()
 	m_currPtr = (byte*)advancePtr;
 
 	return header;
-}
-
-
-//-----------------------------------------------------------------------------------------------
-MessageHeader* NetPacket::ReadMessageHeaderAndAdvance()
-{
-	MessageHeader* result = (MessageHeader*)m_currPtr;
-	MessageHeader* advancePtr = result;
-	advancePtr++;
-	m_currPtr = (byte*)advancePtr;
-
-	return result;
 }
\ No newline at end of file
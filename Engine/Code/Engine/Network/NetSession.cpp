@@ -1,14 +1,21 @@
 #include "Engine/Network/NetSession.hpp"
 #include "Engine/Core/ConsoleCommand.hpp"
 #include "Engine/Network/NetPacket.hpp"
+#include "Engine/Network/SnapshotReplicator.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/EventSystem.hpp"
+#include "Engine/Core/ArenaAllocator.hpp"
+#include "Engine/Core/Memory.hpp"
+#include "Engine/Core/Time.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
 static const int NS_GAME_PORT = 4334;
 STATIC const float NetSession::NETWORK_TICK_INTERVAL = 1.f / 60.f;
 STATIC const float NetSession::TIME_UNTIL_JOIN_TIMEOUT = 15.f;
+STATIC const int NetSession::NETWORK_THREAD_WAIT_MILLISECONDS = 1;
+STATIC const size_t NetSession::NETWORK_THREAD_QUEUE_CAPACITY = 4096;
+static const size_t HANDLER_SCRATCH_CHUNK_BYTES = 16 * 1024;
 
 
 //-----------------------------------------------------------------------------------------------
@@ -21,14 +28,19 @@ NetSession::NetSession()
 	, m_state(NETSESSIONSTATE_INVALID)
 	, m_lastError(NETERROR_NONE)
 	, m_isHost(false)
+	, m_isNetworkThreadRunning(false)
+	, m_receivedMessages(NETWORK_THREAD_QUEUE_CAPACITY)
+	, m_outgoingMessages(NETWORK_THREAD_QUEUE_CAPACITY)
 {
 	g_eventSystem->RegisterEvent<NetSession, &NetSession::Tick>("Tick", this);
+	g_eventSystem->RegisterEvent<NetSession, &NetSession::OnNetworkNotice>(EVENT_ID("OnNetworkNotice"), this);
 }
 
 
 //-----------------------------------------------------------------------------------------------
 NetSession::~NetSession()
 {
+	StopNetworkThread();
 	g_eventSystem->UnregisterFromAllEvents(this);
 	SAFE_DELETE(m_packetChannel);
 
@@ -85,6 +97,7 @@ bool NetSession::Start(const int portNum, const int maxDistanceFromPort /* = 8 *
 //-----------------------------------------------------------------------------------------------
 void NetSession::Stop()
 {
+	StopNetworkThread();
 	SAFE_DELETE(m_packetChannel);
 	m_state = NETSESSIONSTATE_INVALID;
 }
@@ -102,6 +115,7 @@ std::string NetSession::GetAddressString()
 //-----------------------------------------------------------------------------------------------
 void NetSession::SendMessageDirect(const sockaddr_in* dest, NetMessage& msg)
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	NetConnection* conn = FindConnectionWithAddr(*dest);
 	if (conn)
 	{
@@ -120,10 +134,11 @@ void NetSession::SendMessageDirect(const sockaddr_in* dest, NetMessage& msg)
 //-----------------------------------------------------------------------------------------------
 void NetSession::SendPacketDirect(const sockaddr_in* dest, const NetPacket& packet)
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	const char* buff = packet.GetCopyableBuffer();
 	int len = packet.GetLength();
 	m_timeSinceLastPacketSent = 0.f;
-	m_packetChannel->SendTo(buff, len, 0, dest);
+	m_packetChannel->QueueSendTo(buff, len, dest);
 }
 
 
@@ -134,10 +149,12 @@ void NetSession::Tick(Event* e)
 
 	float deltaSeconds = te->deltaSeconds;
 
+	CriticalSectionGuard guard(&m_connectionLock);
 	m_timeSinceLastNetworkTick += deltaSeconds;
 	m_timeSinceLastPacketReceived += deltaSeconds;
 	m_timeSinceLastPacketSent += deltaSeconds;
 	m_joinAttemptTime += deltaSeconds;
+
 	if (m_state == NETSESSIONSTATE_JOINING && m_joinAttemptTime >= TIME_UNTIL_JOIN_TIMEOUT)
 	{
 		m_lastError = NETERROR_JOIN_HOST_TIMEOUT;
@@ -150,6 +167,19 @@ void NetSession::Tick(Event* e)
 		m_activeConnections.clear();
 	}
 
+	//The network thread keeps its own time for these
+	if (!IsNetworkThreaded())
+	{
+		TickConnections(deltaSeconds);
+	}
+
+	Update();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::TickConnections(float deltaSeconds)
+{
 	for (auto iter = m_activeConnections.begin(); iter != m_activeConnections.end();)
 	{
 		NetConnection* conn = *iter;
@@ -172,7 +202,7 @@ void NetSession::Tick(Event* e)
 				{
 					m_lastError = NETERROR_HOST_DISCONNECTED;
 				}
-				ConsolePrintf(RED, "Connection with %s timed out", Network::GetFullStringFromAddr((sockaddr*)&conn->m_toAddr));
+				PrintNotice(Stringf("Connection with %s timed out", Network::GetFullStringFromAddr((sockaddr*)&conn->m_toAddr)), RED);
 				SAFE_DELETE(conn);
 				iter = m_activeConnections.erase(iter);
 				continue;
@@ -180,34 +210,46 @@ void NetSession::Tick(Event* e)
 		}
 		iter++;
 	}
-
-	Update();
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void NetSession::Update()
 {
-	ProcessPackets();
-
-	if (m_timeSinceLastNetworkTick < NETWORK_TICK_INTERVAL)
+	ScopedMemoryTag memoryTag(MEMTAG_NETWORK);
+	CriticalSectionGuard guard(&m_connectionLock);
+	if (IsNetworkThreaded())
 	{
-		return;
+		DrainReceivedMessages();
+	}
+	else
+	{
+		ProcessPackets();
 	}
 
-	m_timeSinceLastNetworkTick = 0.f;
+	if (m_timeSinceLastNetworkTick >= NETWORK_TICK_INTERVAL)
+	{
+		m_timeSinceLastNetworkTick = 0.f;
 
-	NetworkTickEvent nte;
-	nte.connection = m_myConnection;
+		NetworkTickEvent nte;
+		nte.connection = m_myConnection;
 
-	g_eventSystem->TriggerEvent("OnNetworkTick", &nte);
+		g_eventSystem->TriggerEvent(EVENT_ID("OnNetworkTick"), &nte);
 
-	for (NetConnection* nc : m_activeConnections)
+		for (NetConnection* nc : m_activeConnections)
+		{
+			NetworkTickEvent nten;
+			nten.connection = nc;
+			g_eventSystem->TriggerEvent(EVENT_ID("OnNetworkTick"), &nten);
+		}
+	}
+
+	//Everything sent this frame, replies included, leaves in one batch.  The network thread flushes its own
+	if (m_packetChannel && !IsNetworkThreaded())
 	{
-		NetworkTickEvent nten;
-		nten.connection = nc;
-		g_eventSystem->TriggerEvent("OnNetworkTick", &nten);
+		m_packetChannel->FlushSends();
 	}
+	FlushOutgoingOverflow();
 }
 
 
@@ -302,7 +344,7 @@ static void OnJoinRequest(NetSender& sender, NetMessage& msg)
 
 	ConnectionChangeEvent cce;
 	cce.connection = conn;
-	g_eventSystem->TriggerEvent("OnConnectionJoin", &cce);
+	g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionJoin"), &cce);
 }
 TODO("Implement no new connections deny and full deny");
 
@@ -366,7 +408,7 @@ static void OnConnectionLeave(NetSender& sender, NetMessage& msg)
 	{
 		ConnectionChangeEvent cce;
 		cce.connection = sender.connection;
-		g_eventSystem->TriggerEvent("OnConnectionLeave", &cce);
+		g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionLeave"), &cce);
 		g_netSession->RemoveConnection(sender.connection);
 	}
 	sender.connection = nullptr;
@@ -411,6 +453,8 @@ void NetSession::RegisterCoreMessages()
 	RegisterMessage(NETMESSAGE_LEAVE, "leave", OnConnectionLeave);
 	RegisterMessage(NETMESSAGE_VOICE_SYNC, "voiceinit", OnVoiceSync);
 	RegisterMessage(NETMESSAGE_VOICE_CHUNK, "voice", OnVoiceReceived);
+	RegisterMessage(NETMESSAGE_SNAPSHOT, "snapshot", SnapshotReplicator::OnSnapshotReceived);
+	RegisterMessage(NETMESSAGE_SNAPSHOT_RESET, "snapshotreset", SnapshotReplicator::OnSnapshotResetReceived);
 
 }
 
@@ -425,6 +469,7 @@ bool NetSession::IsMe(const sockaddr_in& otherAddr) const
 //-----------------------------------------------------------------------------------------------
 void NetSession::AddConnection(NetConnection* nc)
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	m_activeConnections.push_back(nc);
 	nc->m_type = NETCONNECTIONTYPE_UNCONFIRMED;
 }
@@ -433,6 +478,7 @@ void NetSession::AddConnection(NetConnection* nc)
 //-----------------------------------------------------------------------------------------------
 void NetSession::RemoveConnection(NetConnection* nc)
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	for (auto iter = m_activeConnections.begin(); iter != m_activeConnections.end(); iter++)
 	{
 		if (*iter == nc)
@@ -509,6 +555,7 @@ bool NetSession::IsGUIDTaken(const std::string& guid)
 //-----------------------------------------------------------------------------------------------
 void NetSession::DestroyConnection(byte index)
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	if (index == m_myConnection->m_index)
 	{
 		m_myConnection->m_index = INVALID_CONNECTION_INDEX;
@@ -589,6 +636,7 @@ NetConnection* NetSession::FindConnectionWithAddr(const sockaddr_in& address) co
 //-----------------------------------------------------------------------------------------------
 QuString NetSession::GetDebugString() const
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	QuString result = IsHost() ? "Host\n" : "";
 
 	result += QuString::F("Time since packet received: %.2fs\n", m_timeSinceLastPacketReceived);
@@ -643,6 +691,7 @@ byte NetSession::GetValidPlayerIndex() const
 //-----------------------------------------------------------------------------------------------
 void NetSession::OnJoinFail()
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	m_state = NETSESSIONSTATE_DISCONNECTED;
 	FlushConnections();
 }
@@ -655,12 +704,12 @@ void NetSession::OnJoin()
 
 	ConnectionChangeEvent cce;
 	cce.connection = m_myConnection;
-	g_eventSystem->TriggerEvent("OnConnectionJoin", &cce);
+	g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionJoin"), &cce);
 
 	for (NetConnection* conn : m_activeConnections)
 	{
 		cce.connection = conn;
-		g_eventSystem->TriggerEvent("OnConnectionJoin", &cce);
+		g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionJoin"), &cce);
 	}
 }
 
@@ -668,13 +717,14 @@ void NetSession::OnJoin()
 //-----------------------------------------------------------------------------------------------
 void NetSession::FlushConnections()
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	ConnectionChangeEvent cce;
 	cce.connection = GetOwnConnection();
-	g_eventSystem->TriggerEvent("OnConnectionLeave", &cce);
+	g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionLeave"), &cce);
 	for (NetConnection* conn : m_activeConnections)
 	{
 		cce.connection = conn;
-		g_eventSystem->TriggerEvent("OnConnectionLeave", &cce);
+		g_eventSystem->TriggerEvent(EVENT_ID("OnConnectionLeave"), &cce);
 		SAFE_DELETE(conn);
 	}
 	m_activeConnections.clear();
@@ -684,6 +734,7 @@ void NetSession::FlushConnections()
 //-----------------------------------------------------------------------------------------------
 void NetSession::Host(const char* username)
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	ASSERT_OR_DIE(m_state == NETSESSIONSTATE_DISCONNECTED, "Can't host unless valid and disconnected");
 	m_state = NETSESSIONSTATE_HOSTING;
 
@@ -700,6 +751,7 @@ void NetSession::Host(const char* username)
 //-----------------------------------------------------------------------------------------------
 void NetSession::Join(const char* username, const sockaddr_in& addr)
 {
+	CriticalSectionGuard guard(&m_connectionLock);
 	ASSERT_OR_DIE(m_state == NETSESSIONSTATE_DISCONNECTED, "Can't join unless valid and disconnected");
 	m_state = NETSESSIONSTATE_JOINING;
 	m_joinAttemptTime = 0.f;
@@ -722,12 +774,15 @@ void NetSession::Join(const char* username, const sockaddr_in& addr)
 //-----------------------------------------------------------------------------------------------
 void NetSession::Leave()
 {
+	//Sent straight from here, threaded or not, since the connections are gone once this returns
+	CriticalSectionGuard guard(&m_connectionLock);
 	for (NetConnection* conn : m_activeConnections)
 	{
 		NetMessage leave(NETMESSAGE_LEAVE);
-		conn->AddMessage(leave);
-		conn->ConstructPacketAndSend(GetOwnConnection()->GetIndex());
+		conn->AddSharedMessage(leave.Share());
+		conn->SendNextPacket(GetOwnConnection()->GetIndex());
 	}
+	m_packetChannel->FlushSends();
 	FlushConnections();
 
 	m_state = NETSESSIONSTATE_DISCONNECTED;
@@ -741,9 +796,11 @@ void NetSession::ProcessPackets()
 	NetPacket packet(false);
 	NetSender from;
 	from.session = this;
+	bool isHandingOff = IsNetworkThreaded();
 
 	while (ReadNextPacket(&packet, &from.address))
 	{
+		from.receivedSeconds = GetCurrentTimeSeconds();
 		PacketHeader* header = packet.GetPacketHeader();
 		from.ackID = header->thisAck;
 		m_timeSinceLastPacketReceived = 0.f;
@@ -753,17 +810,23 @@ void NetSession::ProcessPackets()
 			from.connection->UpdateAcksAndStatus(packet);
 		}
 		NetMessage msg;
-		while (ReadNextMessage(&msg, packet, from.connection))
+		uint16_t payloadSize;
+		while (ReadNextMessage(&msg, &payloadSize, packet, from.connection))
 		{
-			const NetMessageDef* def = GetDefinition(msg.m_type);
-			if (!def)
+			if (!GetDefinition(msg.m_type))
 			{
-				ConsolePrint("Bad packet.  Contains unsupported message type", RED);
+				PrintNotice("Bad packet.  Contains unsupported message type", RED);
 				break;
 			}
-			//This one's redundant and clunky to receive per frame.  So, just using it to debug when I need it
-			ConsolePrintf(WHITE, "Received '%s' message", def->debugName);
-			def->callback(from, msg);
+
+			if (isHandingOff)
+			{
+				HandOffMessage(from, msg, payloadSize);
+			}
+			else
+			{
+				DispatchMessage(from, msg);
+			}
 			msg.Reset();
 		}
 		packet.Reset();
@@ -771,12 +834,305 @@ void NetSession::ProcessPackets()
 }
 
 
+//-----------------------------------------------------------------------------------------------
+void NetSession::DispatchMessage(NetSender& from, NetMessage& msg)
+{
+	ScopedArenaRewind rewindHandlerScratch(GetHandlerScratch());
+	const NetMessageDef* def = GetDefinition(msg.m_type);
+
+	//This one's redundant and clunky to receive per frame.  So, just using it to debug when I need it
+	ConsolePrintf(WHITE, "Received '%s' message", def->debugName);
+	def->callback(from, msg);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Not the frame arena, which promises its allocations last into the next frame
+STATIC ArenaAllocator& NetSession::GetHandlerScratch()
+{
+	static thread_local ArenaAllocator s_handlerScratch(HANDLER_SCRATCH_CHUNK_BYTES, true);
+	return s_handlerScratch;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::HandOffMessage(const NetSender& from, const NetMessage& msg, uint16_t payloadSize)
+{
+	ReceivedNetMessage received;
+	received.message = NetMessageRef(SharedNetMessage::CreateAndAcquire(msg.m_type, msg.m_flags, msg.m_buffer, payloadSize));
+	received.connection = from.connection;
+	received.connectionID = from.connection ? from.connection->GetConnectionID() : 0;
+	received.address = from.address;
+	received.receivedSeconds = from.receivedSeconds;
+	received.ackID = from.ackID;
+	received.reliableID = msg.m_reliableID;
+	received.sequenceID = msg.m_sequenceID;
+
+	//Reliables have already been marked received, so nothing can be dropped here.  Order is kept by
+	//only touching the queue once the overflow is empty
+	if (!m_receivedOverflow.empty() || !m_receivedMessages.Enqueue(std::move(received)))
+	{
+		m_receivedOverflow.push_back(std::move(received));
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::DrainReceivedMessages()
+{
+	ReceivedNetMessage received;
+	while (m_receivedMessages.Dequeue(&received))
+	{
+		DispatchReceivedMessage(received);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::DispatchReceivedMessage(const ReceivedNetMessage& received)
+{
+	NetSender from;
+	from.session = this;
+	from.address = received.address;
+	from.ackID = received.ackID;
+	from.receivedSeconds = received.receivedSeconds;
+	from.connection = IsLiveConnection(received.connection, received.connectionID) ? received.connection : nullptr;
+
+	NetMessage msg;
+	msg.LoadForReading(*received.message, received.sequenceID);
+	msg.m_reliableID = received.reliableID;
+
+	//Its connection went away while it sat in the queue
+	if (received.connection && !from.connection && !msg.CheckFlag(NETMESSAGEFLAG_CONNECTIONLESS))
+	{
+		return;
+	}
+
+	//Or one came about, most likely from an earlier message in the queue.  Resent reliables (like join
+	//requests) must then be weeded out here, as they would have been had the packet been read just now
+	if (!received.connection)
+	{
+		from.connection = FindConnectionWithAddr(*(sockaddr_in*)&from.address);
+		if (from.connection && msg.IsReliable() && !from.connection->UpdateExpectedReliablesAndCheckShouldProcess(msg.m_reliableID))
+		{
+			return;
+		}
+	}
+
+	DispatchMessage(from, msg);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool NetSession::IsLiveConnection(const NetConnection* connection, uint32_t connectionID) const
+{
+	if (!connection)
+	{
+		return false;
+	}
+
+	if (connection == m_myConnection)
+	{
+		return connection->GetConnectionID() == connectionID;
+	}
+
+	for (NetConnection* conn : m_activeConnections)
+	{
+		if (conn == connection)
+		{
+			return conn->GetConnectionID() == connectionID;
+		}
+	}
+
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//The console belongs to the game thread, so the network thread posts what it has to say
+void NetSession::PrintNotice(const std::string& text, const Rgba& color)
+{
+	if (IsNetworkThreaded() && std::this_thread::get_id() != m_gameThreadID)
+	{
+		NetworkNoticeEvent notice;
+		notice.text = text;
+		notice.color = color;
+		g_eventSystem->PostEvent(EVENT_ID("OnNetworkNotice"), notice);
+		return;
+	}
+
+	ConsolePrint(text, color);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::OnNetworkNotice(Event* e)
+{
+	NetworkNoticeEvent* notice = (NetworkNoticeEvent*)e;
+	ConsolePrint(notice->text, notice->color);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::SetNetworkThreaded(bool isThreaded)
+{
+	if (isThreaded == IsNetworkThreaded())
+	{
+		return;
+	}
+
+	if (!isThreaded)
+	{
+		StopNetworkThread();
+
+		//Received messages are still owed to the game, so they're handled now rather than dropped
+		CriticalSectionGuard guard(&m_connectionLock);
+		DrainReceivedMessages();
+		for (const ReceivedNetMessage& received : m_receivedOverflow)
+		{
+			DispatchReceivedMessage(received);
+		}
+		m_receivedOverflow.clear();
+		return;
+	}
+
+	ASSERT_OR_DIE(m_packetChannel, "Network thread needs a bound session");
+	m_gameThreadID = std::this_thread::get_id();
+	m_packetChannel->SetTickedByGame(false);
+	m_isNetworkThreadRunning.store(true, std::memory_order_release);
+	m_networkThread = std::thread(&NetSession::RunNetworkThread, this);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::QueueOutgoingMessage(NetConnection* connection, const NetMessageRef& message)
+{
+	ASSERT_OR_DIE(std::this_thread::get_id() == m_gameThreadID, "Only the game thread can queue for the network thread");
+
+	OutgoingNetMessage outgoing;
+	outgoing.message = message;
+	outgoing.connection = connection;
+	outgoing.connectionID = connection->GetConnectionID();
+
+	//No waiting for room.  The game thread may hold the connection lock, which the network thread needs
+	//before it comes back for more.  Order is kept by only touching the queue once the overflow is empty
+	FlushOutgoingOverflow();
+	if (!m_outgoingOverflow.empty() || !m_outgoingMessages.Enqueue(std::move(outgoing)))
+	{
+		m_outgoingOverflow.push_back(std::move(outgoing));
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::FlushOutgoingOverflow()
+{
+	while (!m_outgoingOverflow.empty() && m_outgoingMessages.Enqueue(std::move(m_outgoingOverflow.front())))
+	{
+		m_outgoingOverflow.pop_front();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::RunNetworkThread()
+{
+	ScopedMemoryTag memoryTag(MEMTAG_NETWORK);
+	double lastSeconds = GetCurrentTimeSeconds();
+	float timeSinceLastSend = 0.f;
+	while (m_isNetworkThreadRunning.load(std::memory_order_acquire))
+	{
+		m_packetChannel->WaitForPackets(NETWORK_THREAD_WAIT_MILLISECONDS);
+		double currentSeconds = GetCurrentTimeSeconds();
+		float deltaSeconds = (float)(currentSeconds - lastSeconds);
+		lastSeconds = currentSeconds;
+		timeSinceLastSend += deltaSeconds;
+
+		//Pulled out before taking the lock, which the game thread may hold for a whole drain
+		OutgoingNetMessage outgoing;
+		while (m_outgoingMessages.Dequeue(&outgoing))
+		{
+			m_outgoingStaging.push_back(std::move(outgoing));
+		}
+
+		CriticalSectionGuard guard(&m_connectionLock);
+		for (OutgoingNetMessage& staged : m_outgoingStaging)
+		{
+			if (IsLiveConnection(staged.connection, staged.connectionID))
+			{
+				staged.connection->AddSharedMessage(staged.message);
+			}
+		}
+		m_outgoingStaging.clear();
+
+		while (!m_receivedOverflow.empty() && m_receivedMessages.Enqueue(std::move(m_receivedOverflow.front())))
+		{
+			m_receivedOverflow.pop_front();
+		}
+
+		m_packetChannel->AdvanceLaggedPackets(deltaSeconds);
+		ProcessPackets();
+		TickConnections(deltaSeconds);
+
+		//Unconfirmed reliables ride along on every packet, so sends keep to the network tick, though on
+		//this thread's clock rather than the frame's
+		if (timeSinceLastSend >= NETWORK_TICK_INTERVAL && m_myConnection)
+		{
+			timeSinceLastSend = 0.f;
+			byte myIndex = m_myConnection->GetIndex();
+			for (NetConnection* conn : m_activeConnections)
+			{
+				while (conn->SendNextPacket(myIndex));
+			}
+		}
+		m_packetChannel->FlushSends();
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void NetSession::StopNetworkThread()
+{
+	if (!m_networkThread.joinable())
+	{
+		return;
+	}
+
+	m_isNetworkThreadRunning.store(false, std::memory_order_release);
+	m_networkThread.join();
+
+	//Whatever the game thread queued still goes out, in the order it would have
+	CriticalSectionGuard guard(&m_connectionLock);
+	OutgoingNetMessage outgoing;
+	while (m_outgoingMessages.Dequeue(&outgoing))
+	{
+		if (IsLiveConnection(outgoing.connection, outgoing.connectionID))
+		{
+			outgoing.connection->AddSharedMessage(outgoing.message);
+		}
+	}
+	for (const OutgoingNetMessage& overflowed : m_outgoingOverflow)
+	{
+		if (IsLiveConnection(overflowed.connection, overflowed.connectionID))
+		{
+			overflowed.connection->AddSharedMessage(overflowed.message);
+		}
+	}
+	m_outgoingOverflow.clear();
+
+	if (m_packetChannel)
+	{
+		m_packetChannel->SetTickedByGame(true);
+	}
+}
+
+
 //-----------------------------------------------------------------------------------------------
 bool NetSession::ReadNextPacket(NetPacket* packet, sockaddr* addr)
 {
 	sockaddr_storage stor;
 	int addrlen = sizeof(sockaddr_storage);
-	int recvResult = m_packetChannel->RecvFrom(packet->GetBuffer(), UDP_PACKET_MAX_LENGTH, 0, (sockaddr_in*)&stor, &addrlen);
+	int recvResult = m_packetChannel->RecvFrom(packet->GetBuffer(), UDP_PACKET_MAX_LENGTH, (sockaddr_in*)&stor, &addrlen);
 
 	if (recvResult <= 0)
 	{
@@ -790,7 +1146,7 @@ bool NetSession::ReadNextPacket(NetPacket* packet, sockaddr* addr)
 
 
 //-----------------------------------------------------------------------------------------------
-bool NetSession::ReadNextMessage(NetMessage* msg, NetPacket& packet, NetConnection* connection)
+bool NetSession::ReadNextMessage(NetMessage* msg, uint16_t* outPayloadSize, NetPacket& packet, NetConnection* connection)
 {
 	if (connection)
 	{
@@ -801,7 +1157,8 @@ bool NetSession::ReadNextMessage(NetMessage* msg, NetPacket& packet, NetConnecti
 			ushort sequenceID = iter->first;
 			if (sequenceID == connection->m_nextExpectedSequenceID)
 			{
-				*msg = iter->second;
+				msg->LoadForReading(*iter->second, sequenceID);
+				*outPayloadSize = iter->second->GetSize();
 				connection->m_outOfOrderMessages.erase(iter);
 				connection->m_nextExpectedSequenceID++;
 				return true;
@@ -815,24 +1172,26 @@ bool NetSession::ReadNextMessage(NetMessage* msg, NetPacket& packet, NetConnecti
 
 	//I think I finally found the place for a goto.  YAAAAAYYYYY!!!!
 readmessage:
-	MessageHeader* header = packet.ReadMessageHeaderAndAdvance();
-	uint16_t messageSize = header->messageSize;
-	msg->m_type = header->type;
-	msg->m_flags = header->flags;
-	msg->m_reliableID = header->reliableID;
-	msg->m_sequenceID = header->sequenceID;
-	//Decreasing message size during advance so it only reflects payload
-	messageSize -= sizeof(MessageHeader);
+	MessageHeader header;
+	packet.ReadMessageHeaderAndAdvance(&header);
+	uint16_t messageSize = header.payloadSize;
+	*outPayloadSize = messageSize;
+	msg->m_type = header.type;
+	msg->m_flags = header.flags;
+	msg->m_reliableID = header.reliableID;
+	msg->m_sequenceID = header.sequenceID;
 
 	packet.ReadContents(msg->m_buffer, messageSize);
 
+	//Messages that get read but not processed skip ahead to the next, rather than ending the packet.
+	//Every packet resends the oldest unconfirmed reliables first, so new ones tend to come after them
 	if (msg->IsReliable())
 	{
 		if (connection)
 		{
 			if (!connection->UpdateExpectedReliablesAndCheckShouldProcess(msg->m_reliableID))
 			{
-				return false;
+				goto skipmessage;
 			}
 		}
 	}
@@ -840,14 +1199,19 @@ readmessage:
 	{
 		if (!connection)
 		{
-			return false;
+			goto skipmessage;
 		}
 
 		//Shouldn't have to check if the sequenceID is too low, cause it will have been processed and discarded
 		if (connection->m_nextExpectedSequenceID != msg->m_sequenceID)
 		{
 			//We can't process this message now, so we add it to the pending list and try again
-			connection->m_outOfOrderMessages.insert(std::make_pair(msg->m_sequenceID, *msg));
+			SharedNetMessage* pending = SharedNetMessage::CreateAndAcquire(msg->m_type, msg->m_flags, msg->m_buffer, messageSize);
+			connection->m_outOfOrderMessages.insert(std::make_pair(msg->m_sequenceID, NetMessageRef(pending)));
+			if (packet.m_remainingMessages == 0)
+			{
+				return false;
+			}
 
 			//Using a goto because the only reason to ever repeat the above process is to pass several checks
 			//It seemed like the cleanest way to do it
@@ -864,12 +1228,19 @@ readmessage:
 	{
 		if (!connection)
 		{
-			return false;
+			goto skipmessage;
 		}
 	}
 	
 
 	return true;
+
+skipmessage:
+	if (packet.m_remainingMessages == 0)
+	{
+		return false;
+	}
+	goto readmessage;
 }
 
 
@@ -977,4 +1348,42 @@ CONSOLE_COMMAND(NSSimLoss, args)
 	lossPercent = Clampi(lossPercent, 0, 100);
 
 	g_netSession->SetLoss((float)lossPercent * .01f);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(NSBatchedIO, args)
+{
+	if (!g_netSession)
+	{
+		return;
+	}
+
+	std::string onOff = args.GetNextArg();
+	if (onOff != "on" && onOff != "off")
+	{
+		ConsolePrint("Usage: nsbatchedio on|off", RED);
+		return;
+	}
+
+	g_netSession->SetBatchedIO(onOff == "on");
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(NSThreaded, args)
+{
+	if (!g_netSession)
+	{
+		return;
+	}
+
+	std::string onOff = args.GetNextArg();
+	if (onOff != "on" && onOff != "off")
+	{
+		ConsolePrint("Usage: nsthreaded on|off", RED);
+		return;
+	}
+
+	g_netSession->SetNetworkThreaded(onOff == "on");
 }
\ No newline at end of file
@@ -5,10 +5,16 @@
 #include "Engine/Network/NetPacket.hpp"
 #include "Engine/Core/EventSystem.hpp"
 #include "Engine/Network/PacketChannel.hpp"
+#include "Engine/Memory/SPSCQueue.hpp"
+#include "Engine/Memory/CriticalSection.hpp"
+#include "Engine/Renderer/Rgba.hpp"
 #include "Quantum/Core/String.h"
 
+#include <atomic>
+#include <deque>
 #include <string>
 #include <map>
+#include <thread>
 #include <vector>
 
 
@@ -49,6 +55,41 @@ struct NetSender
 	sockaddr address;
 	NetConnection* connection;
 	ushort ackID;	//For reliable connectionless, we can send an ack right back
+	double receivedSeconds;	//When the packet came off the socket, which may be well before it's handled
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Decoded on the network thread for the game thread.  The connection only counts if, by then, it
+//still exists with the same ID
+struct ReceivedNetMessage
+{
+	NetMessageRef message;
+	NetConnection* connection;
+	uint32_t connectionID;
+	sockaddr address;
+	double receivedSeconds;
+	ushort ackID;
+	ushort reliableID;
+	ushort sequenceID;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct OutgoingNetMessage
+{
+	NetMessageRef message;
+	NetConnection* connection;
+	uint32_t connectionID;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Posted by the network thread, printed when the game thread dispatches deferred events
+struct NetworkNoticeEvent : Event
+{
+	std::string text;
+	Rgba color;
 };
 
 
@@ -66,6 +107,49 @@ struct ConnectionChangeEvent : Event
 };
 
 
+//-----------------------------------------------------------------------------------------------
+//Holds the session's connection lock for as long as it lives.  With a network thread, connections
+//can time out and be deleted at any moment, so walking the list (or keeping a connection from it
+//between calls) is only safe while one of these is held.  The lock is recursive, so session calls
+//made meanwhile are fine
+class LockedConnections
+{
+public:
+	LockedConnections(CriticalSection* lock, std::vector<NetConnection*>& connections)
+		: m_lock(lock)
+		, m_connections(connections)
+	{
+		m_lock->Enter();
+	}
+	LockedConnections(LockedConnections&& other)
+		: m_lock(other.m_lock)
+		, m_connections(other.m_connections)
+	{
+		other.m_lock = nullptr;
+	}
+	~LockedConnections()
+	{
+		if (m_lock)
+		{
+			m_lock->Leave();
+		}
+	}
+
+	std::vector<NetConnection*>::iterator begin() { return m_connections.begin(); }
+	std::vector<NetConnection*>::iterator end() { return m_connections.end(); }
+	size_t size() const { return m_connections.size(); }
+	NetConnection* operator[](size_t index) const { return m_connections[index]; }
+
+private:
+	LockedConnections(const LockedConnections&) = delete;
+	void operator=(const LockedConnections&) = delete;
+
+private:
+	CriticalSection* m_lock;
+	std::vector<NetConnection*>& m_connections;
+};
+
+
 
 //-----------------------------------------------------------------------------------------------
 class NetSession
@@ -74,6 +158,8 @@ class NetSession
 
 	static const float NETWORK_TICK_INTERVAL;
 	static const float TIME_UNTIL_JOIN_TIMEOUT;
+	static const int NETWORK_THREAD_WAIT_MILLISECONDS;
+	static const size_t NETWORK_THREAD_QUEUE_CAPACITY;
 public:
 	NetSession();
 	~NetSession();
@@ -84,8 +170,22 @@ public:
 	void SendPacketDirect(const sockaddr_in* dest, const NetPacket& packet);
 	void Update();
 	void Tick(Event* e);
+
+	//With a network thread, the thread owns the socket and all connection traffic: it receives,
+	//acks, heartbeats and sends on its own, with no frame to wait on.  Messages cross over in SPSC
+	//queues, and Update is where the game thread drains them, once a frame
+	void SetNetworkThreaded(bool isThreaded);
+	bool IsNetworkThreaded() const { return m_isNetworkThreadRunning.load(std::memory_order_acquire); }
+	bool ShouldQueueForNetworkThread() const { return IsNetworkThreaded() && std::this_thread::get_id() == m_gameThreadID; }
+	void QueueOutgoingMessage(NetConnection* connection, const NetMessageRef& message);
+
 	void RegisterMessage(ENetMessage type, const char* debugName, OnMessageReceiveFunc callback);
 	void RegisterCoreMessages();
+
+	//Scratch for message handlers, rewound after every message.  Anything that has to outlive the
+	//handler belongs in the frame arena instead
+	static class ArenaAllocator& GetHandlerScratch();
+
 	bool IsMe(const sockaddr_in& otherAddr) const;
 	bool IsMe(const NetConnection* connection) const { return connection == m_myConnection; }
 	void AddConnection(NetConnection* nc);
@@ -98,9 +198,10 @@ public:
 	NetConnection* GetOwnConnection() const { return m_myConnection; }
 	NetConnection* GetConnectionAtIndex(byte index) const;
 	NetConnection* FindConnectionWithAddr(const sockaddr_in& address) const;
-	void SetLoss(float lossPercentage) { m_packetChannel->SetLoss(lossPercentage); }
-	void SetLag(int minMilliseconds, int maxMilliseconds) { m_packetChannel->SetLag(minMilliseconds, maxMilliseconds); }
-	std::vector<NetConnection*>& GetConnections() { return m_activeConnections; }
+	void SetLoss(float lossPercentage) { CriticalSectionGuard guard(&m_connectionLock); m_packetChannel->SetLoss(lossPercentage); }
+	void SetLag(int minMilliseconds, int maxMilliseconds) { CriticalSectionGuard guard(&m_connectionLock); m_packetChannel->SetLag(minMilliseconds, maxMilliseconds); }
+	void SetBatchedIO(bool isBatched) { CriticalSectionGuard guard(&m_connectionLock); m_packetChannel->SetBatchedIO(isBatched); }
+	LockedConnections GetConnections() { return LockedConnections(&m_connectionLock, m_activeConnections); }
 	QuString GetDebugString() const;
 	ENetErrorType GetLastError() const { return m_lastError; }
 	ENetSessionState GetSessionState() const { return m_state; }
@@ -118,8 +219,19 @@ public:
 
 private:
 	void ProcessPackets();
+	void TickConnections(float deltaSeconds);
+	void DispatchMessage(NetSender& from, NetMessage& msg);
+	void HandOffMessage(const NetSender& from, const NetMessage& msg, uint16_t payloadSize);
+	void DrainReceivedMessages();
+	void DispatchReceivedMessage(const ReceivedNetMessage& received);
+	void RunNetworkThread();
+	void StopNetworkThread();
+	bool IsLiveConnection(const NetConnection* connection, uint32_t connectionID) const;
+	void PrintNotice(const std::string& text, const Rgba& color);
+	void OnNetworkNotice(Event* e);
+	void FlushOutgoingOverflow();
 	bool ReadNextPacket(class NetPacket* packet, sockaddr* addr);
-	bool ReadNextMessage(NetMessage* msg, NetPacket& packet, NetConnection* connection);
+	bool ReadNextMessage(NetMessage* msg, uint16_t* outPayloadSize, NetPacket& packet, NetConnection* connection);
 	NetMessageDef* GetDefinition(ENetMessage type) { if (type + 1U > m_definitions.size()) return nullptr; return m_definitions.at(type); }
 
 private:
@@ -134,4 +246,19 @@ private:
 	ENetSessionState m_state;
 	ENetErrorType m_lastError;
 	bool m_isHost;
+
+	//Guards the connections and the packet channel.  The network thread holds it for each pass, the
+	//game thread while it drains, and the public calls that touch connections take it as well
+	mutable CriticalSection m_connectionLock;
+	std::thread m_networkThread;
+	std::atomic<bool> m_isNetworkThreadRunning;
+	std::thread::id m_gameThreadID;
+	SPSCQueue<ReceivedNetMessage> m_receivedMessages;
+	SPSCQueue<OutgoingNetMessage> m_outgoingMessages;
+
+	//Network thread only.  Received messages wait here rather than be dropped when the queue is full
+	std::deque<ReceivedNetMessage> m_receivedOverflow;
+	//Game thread only, and likewise for outgoing ones
+	std::deque<OutgoingNetMessage> m_outgoingOverflow;
+	std::vector<OutgoingNetMessage> m_outgoingStaging;
 };
\ No newline at end of file
@@ -2,23 +2,31 @@
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/StringUtils.hpp"
 
+#include <stdio.h>
+
+#if defined(PLATFORM_WINDOWS)
 #pragma comment (lib, "ws2_32")
+#endif
 
 
 //-----------------------------------------------------------------------------------------------
 void Network::SystemStartup()
 {
+#if defined(PLATFORM_WINDOWS)
 	WSADATA data;
 	int error = WSAStartup(MAKEWORD(2, 2), &data);
 	ASSERT_OR_DIE(!error, "WSAStortup failed");
+#endif
 }
 
 
 //-----------------------------------------------------------------------------------------------
 void Network::SystemShutdown()
 {
+#if defined(PLATFORM_WINDOWS)
 	int error = WSACleanup();
 	ASSERT_OR_DIE(!error, "WSACleanup failed");
+#endif
 }
 
 
@@ -42,7 +50,7 @@ const char* Network::GetLocalHostName()
 void Network::GetPortString(int portNum, char* buffer)
 {
 	//Port nums can't be longer than 5 chars, so using a magic number here XD
-	GLOBAL::_itoa_s(portNum, buffer, 6, 10);
+	snprintf(buffer, 6, "%i", portNum);
 }
 
 
@@ -127,7 +135,7 @@ void Network::FreeAddresses(addrinfo* addresses)
 //-----------------------------------------------------------------------------------------------
 const char* Network::GetStringFromAddr(const sockaddr* addr)
 {
-	static char buffer[256];
+	static thread_local char buffer[256];
 
 	sockaddr_in* inAddr = (sockaddr_in*)addr;
 	inet_ntop(inAddr->sin_family, (void*)&inAddr->sin_addr, buffer, 256);
@@ -139,14 +147,10 @@ const char* Network::GetStringFromAddr(const sockaddr* addr)
 //-----------------------------------------------------------------------------------------------
 const char* Network::GetFullStringFromAddr(const sockaddr* addr)
 {
-	static char buffer[256];
+	static thread_local char buffer[256];
 
 	sockaddr_in* inAddr = (sockaddr_in*)addr;
-	const char* inetAddr = GetStringFromAddr(addr);
-	int addrlen = strlen(inetAddr);
-	strcpy_s(buffer, addrlen + 1, inetAddr);
-	buffer[addrlen] = ':';
-	_itoa_s(ntohs(inAddr->sin_port), &buffer[addrlen + 1], 6, 10);
+	snprintf(buffer, 256, "%s:%i", GetStringFromAddr(addr), (int)ntohs(inAddr->sin_port));
 
 	return buffer;
 }
@@ -205,5 +209,5 @@ bool Network::ShouldDisconnect(int errorCode)
 //-----------------------------------------------------------------------------------------------
 bool Network::AreSameAddress(const sockaddr_in& first, const sockaddr_in& second)
 {
-	return first.sin_addr.S_un.S_addr == second.sin_addr.S_un.S_addr && first.sin_port == second.sin_port;
+	return first.sin_addr.s_addr == second.sin_addr.s_addr && first.sin_port == second.sin_port;
 }
\ No newline at end of file
@@ -1,13 +1,40 @@
 #pragma once
 
+#include "Engine/Core/Platform.hpp"
+
+#if defined(PLATFORM_WINDOWS)
 #include <WinSock2.h>
 #include <WS2tcpip.h>
+#else
+//BSD sockets, under the WinSock names the rest of Network uses
+#include <arpa/inet.h>
+#include <cstring>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+typedef unsigned long u_long;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define closesocket close
+#define ioctlsocket ioctl
+#define WSAGetLastError() errno
+#define WSAECONNRESET ECONNRESET
+#define WSAEMSGSIZE EMSGSIZE
+#define WSAEWOULDBLOCK EWOULDBLOCK
+#endif
 
-#define LITTLE_ENDIAN 0
-#define BIG_ENDIAN 1
+//Not LITTLE_ENDIAN/BIG_ENDIAN, which glibc's headers already define (as 1234/4321)
+#define ENDIANNESS_LITTLE 0
+#define ENDIANNESS_BIG 1
 
 //Global expected endianness for network traffic
-#define NET_TRAFFIC_ENDIANNESS LITTLE_ENDIAN
+#define NET_TRAFFIC_ENDIANNESS ENDIANNESS_LITTLE
 #define INVALID_CONNECTION_INDEX 0xFF
 
 
@@ -48,5 +75,5 @@ inline Endianness Network::GetEngineEndianness()
 	};
 	converter c;
 	c.conI = 1;
-	return (c.conB[0] == 0) ? BIG_ENDIAN : LITTLE_ENDIAN;
+	return (c.conB[0] == 0) ? ENDIANNESS_BIG : ENDIANNESS_LITTLE;
 }
\ No newline at end of file
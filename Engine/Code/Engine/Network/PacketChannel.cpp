@@ -1,5 +1,8 @@
 #include "Engine/Network/PacketChannel.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Core/Time.hpp"
 
 
 //-----------------------------------------------------------------------------------------------
@@ -7,17 +10,57 @@ PacketChannel::PacketChannel(SOCKET sock)
 	: m_sock(sock)
 	, m_loss(0.f)
 	, m_lag(0, 0)
+	, m_isBatched(true)
+	, m_numReceivedPackets(0)
+	, m_nextReceivedPacket(0)
+	, m_isSocketDrained(false)
+	, m_numQueuedSends(0)
 {
+#if defined(PACKETCHANNEL_MMSG)
+	//Headers point straight into the batches, so nothing is copied around the syscalls
+	memset(m_receiveHeaders, 0, sizeof(m_receiveHeaders));
+	memset(m_sendHeaders, 0, sizeof(m_sendHeaders));
+	for (int packetIndex = 0; packetIndex < BATCH_SIZE; packetIndex++)
+	{
+		m_receiveVectors[packetIndex].iov_base = m_receivedPackets[packetIndex].buffer;
+		m_receiveVectors[packetIndex].iov_len = UDP_PACKET_MAX_LENGTH;
+		m_receiveHeaders[packetIndex].msg_hdr.msg_name = &m_receivedPackets[packetIndex].addr;
+		m_receiveHeaders[packetIndex].msg_hdr.msg_iov = &m_receiveVectors[packetIndex];
+		m_receiveHeaders[packetIndex].msg_hdr.msg_iovlen = 1;
+
+		m_sendVectors[packetIndex].iov_base = m_queuedSends[packetIndex].buffer;
+		m_sendHeaders[packetIndex].msg_hdr.msg_name = &m_queuedSends[packetIndex].addr;
+		m_sendHeaders[packetIndex].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		m_sendHeaders[packetIndex].msg_hdr.msg_iov = &m_sendVectors[packetIndex];
+		m_sendHeaders[packetIndex].msg_hdr.msg_iovlen = 1;
+	}
+#endif
+
 	g_eventSystem->RegisterEvent<PacketChannel, &PacketChannel::Tick>("Tick", this);
 }
 
 
+//-----------------------------------------------------------------------------------------------
+PacketChannel::~PacketChannel()
+{
+	//Whatever was queued this frame (a leave message, say) still goes out
+	FlushSends();
+	g_eventSystem->UnregisterFromAllEvents(this);
+	closesocket(m_sock);
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void PacketChannel::Tick(Event* e)
 {
 	TickEvent* te = (TickEvent*)e;
-	float deltaSeconds = te->deltaSeconds;
+	AdvanceLaggedPackets(te->deltaSeconds);
+}
 
+
+//-----------------------------------------------------------------------------------------------
+void PacketChannel::AdvanceLaggedPackets(float deltaSeconds)
+{
 	//For each lagged packet, tick it down on the multimap by deltaSeconds
 	std::multimap<float, PacketInfo> oldLaggedPackets;
 	std::swap(oldLaggedPackets, m_laggedPackets);
@@ -28,6 +71,37 @@ void PacketChannel::Tick(Event* e)
 }
 
 
+//-----------------------------------------------------------------------------------------------
+void PacketChannel::SetTickedByGame(bool isTickedByGame)
+{
+	g_eventSystem->UnregisterFromAllEvents(this);
+	if (isTickedByGame)
+	{
+		g_eventSystem->RegisterEvent<PacketChannel, &PacketChannel::Tick>("Tick", this);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool PacketChannel::WaitForPackets(int timeoutMilliseconds)
+{
+	if (m_nextReceivedPacket < m_numReceivedPackets)
+	{
+		return true;
+	}
+
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET(m_sock, &readSet);
+	timeval timeout;
+	timeout.tv_sec = timeoutMilliseconds / 1000;
+	timeout.tv_usec = (timeoutMilliseconds % 1000) * 1000;
+
+	//The first argument is ignored by WinSock
+	return select((int)m_sock + 1, &readSet, nullptr, nullptr, &timeout) > 0;
+}
+
+
 //-----------------------------------------------------------------------------------------------
 int PacketChannel::SendTo(const char* buffer, size_t bytes, int flags, const sockaddr_in* toAddress)
 {
@@ -36,27 +110,163 @@ int PacketChannel::SendTo(const char* buffer, size_t bytes, int flags, const soc
 
 
 //-----------------------------------------------------------------------------------------------
-int PacketChannel::RecvFrom(char* buffer, size_t maxBytes, int flags, sockaddr_in* outAddr, int* outAddrLen)
+void PacketChannel::QueueSendTo(const char* buffer, size_t bytes, const sockaddr_in* toAddress)
+{
+	if (!m_isBatched)
+	{
+		SendTo(buffer, bytes, 0, toAddress);
+		return;
+	}
+
+	ASSERT_OR_DIE(bytes <= UDP_PACKET_MAX_LENGTH, "Queued packet is larger than a UDP packet");
+	if (m_numQueuedSends == BATCH_SIZE)
+	{
+		FlushSends();
+	}
+
+	PacketInfo& queued = m_queuedSends[m_numQueuedSends];
+	memcpy(queued.buffer, buffer, bytes);
+	memcpy(&queued.addr, toAddress, sizeof(sockaddr_in));
+	queued.addrlen = sizeof(sockaddr_in);
+	queued.bytes = (int)bytes;
+#if defined(PACKETCHANNEL_MMSG)
+	m_sendVectors[m_numQueuedSends].iov_len = bytes;
+#endif
+	m_numQueuedSends++;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int PacketChannel::FlushSends()
 {
-	PacketInfo packReceived;
-	memcpy(&packReceived.addrlen, outAddrLen, sizeof(int));
-	packReceived.bytes = GLOBAL::recvfrom(m_sock, packReceived.buffer, maxBytes, flags, (sockaddr*)&packReceived.addr, &packReceived.addrlen);
+	int numToSend = m_numQueuedSends;
+	m_numQueuedSends = 0;
+	int numSent = 0;
 
-	//Passthrough for no packet
-	if (packReceived.bytes > 0)
+#if defined(PACKETCHANNEL_MMSG)
+	//sendmmsg costs more than sendto for a lone datagram
+	int numAttempted = 0;
+	if (numToSend == 1)
 	{
-		float lossFloat = GetRandomNormalized();
-		//If random value is inside loss percentage, drop the packet
-		if (lossFloat >= m_loss)
+		numAttempted = 1;
+		numSent = (SendTo(m_queuedSends[0].buffer, m_queuedSends[0].bytes, 0, &m_queuedSends[0].addr) > 0) ? 1 : 0;
+	}
+	while (numAttempted < numToSend)
+	{
+		int result = sendmmsg(m_sock, &m_sendHeaders[numAttempted], numToSend - numAttempted, 0);
+		if (result > 0)
+		{
+			numAttempted += result;
+			numSent += result;
+		}
+		else
+		{
+			//sendmmsg stops at the first datagram that fails.  Drop it, as the network might have, and carry on
+			numAttempted++;
+		}
+	}
+#else
+	for (int packetIndex = 0; packetIndex < numToSend; packetIndex++)
+	{
+		const PacketInfo& queued = m_queuedSends[packetIndex];
+		if (SendTo(queued.buffer, queued.bytes, 0, &queued.addr) > 0)
 		{
-			//Get random lag and insert packet into multimap (sorted by key, and then by order of insertion)
-			int lagMilliseconds = m_lag.GetRandom();
-			float lagSeconds = (float)lagMilliseconds * .001f;
+			numSent++;
+		}
+	}
+#endif
 
-			m_laggedPackets.insert(std::make_pair(lagSeconds, packReceived));
+	return numSent;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Only called once the last batch has been handed out
+int PacketChannel::ReceiveBatch()
+{
+	m_numReceivedPackets = 0;
+	m_nextReceivedPacket = 0;
+
+#if defined(PACKETCHANNEL_MMSG)
+	if (m_isBatched)
+	{
+		for (int packetIndex = 0; packetIndex < BATCH_SIZE; packetIndex++)
+		{
+			m_receiveHeaders[packetIndex].msg_hdr.msg_namelen = sizeof(sockaddr_in);
 		}
+
+		int numReceived = recvmmsg(m_sock, m_receiveHeaders, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+		for (int packetIndex = 0; packetIndex < numReceived; packetIndex++)
+		{
+			m_receivedPackets[packetIndex].bytes = (int)m_receiveHeaders[packetIndex].msg_len;
+			m_receivedPackets[packetIndex].addrlen = (int)m_receiveHeaders[packetIndex].msg_hdr.msg_namelen;
+		}
+		m_numReceivedPackets = (numReceived > 0) ? numReceived : 0;
+		m_isSocketDrained = (m_numReceivedPackets < BATCH_SIZE);
+		return m_numReceivedPackets;
+	}
+#endif
+
+	int maxPackets = m_isBatched ? BATCH_SIZE : 1;
+	while (m_numReceivedPackets < maxPackets)
+	{
+		PacketInfo& received = m_receivedPackets[m_numReceivedPackets];
+		socklen_t addrlen = sizeof(sockaddr_in);
+		received.bytes = GLOBAL::recvfrom(m_sock, received.buffer, UDP_PACKET_MAX_LENGTH, 0, (sockaddr*)&received.addr, &addrlen);
+		received.addrlen = (int)addrlen;
+
+		//Would block, so the socket is drained
+		if (received.bytes <= 0)
+		{
+			break;
+		}
+		m_numReceivedPackets++;
 	}
+	m_isSocketDrained = (m_numReceivedPackets < maxPackets);
+
+	return m_numReceivedPackets;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int PacketChannel::RecvFrom(char* buffer, size_t maxBytes, sockaddr_in* outAddr, int* outAddrLen)
+{
+	for (;;)
+	{
+		if (m_nextReceivedPacket == m_numReceivedPackets)
+		{
+			//A short batch already found the socket empty, so this drain is over without another syscall
+			if (m_isSocketDrained || ReceiveBatch() == 0)
+			{
+				m_isSocketDrained = false;
+				break;
+			}
+		}
+
+		const PacketInfo& packReceived = m_receivedPackets[m_nextReceivedPacket++];
+		if (packReceived.bytes > (int)maxBytes)
+		{
+			continue;
+		}
 
+		//No simulated loss or lag, so hand it straight out of the batch
+		if (!IsSimulatingConditions() && m_laggedPackets.empty())
+		{
+			memcpy(buffer, packReceived.buffer, packReceived.bytes);
+			memcpy(outAddr, &packReceived.addr, packReceived.addrlen);
+			*outAddrLen = packReceived.addrlen;
+			return packReceived.bytes;
+		}
+
+		SimulateConditions(packReceived);
+
+		//Keep feeding the simulation from the batch until something is ready to come out
+		auto first = m_laggedPackets.begin();
+		if (first != m_laggedPackets.end() && first->first <= 0.f)
+		{
+			break;
+		}
+	}
 
 	//If first packet has exhausted its timeout, copy it out, as if it were the one received
 	auto iter = m_laggedPackets.begin();
@@ -80,6 +290,32 @@ int PacketChannel::RecvFrom(char* buffer, size_t maxBytes, int flags, sockaddr_i
 }
 
 
+//-----------------------------------------------------------------------------------------------
+bool PacketChannel::IsSimulatingConditions() const
+{
+	int min;
+	int max;
+	m_lag.GetRangeValues(min, max);
+	return m_loss > 0.f || max > 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void PacketChannel::SimulateConditions(const PacketInfo& packReceived)
+{
+	float lossFloat = GetRandomNormalized();
+	//If random value is inside loss percentage, drop the packet
+	if (lossFloat >= m_loss)
+	{
+		//Get random lag and insert packet into multimap (sorted by key, and then by order of insertion)
+		int lagMilliseconds = m_lag.GetRandom();
+		float lagSeconds = (float)lagMilliseconds * .001f;
+
+		m_laggedPackets.insert(std::make_pair(lagSeconds, packReceived));
+	}
+}
+
+
 //-----------------------------------------------------------------------------------------------
 QuString PacketChannel::GetDebugString() const
 {
@@ -90,6 +326,156 @@ QuString PacketChannel::GetDebugString() const
 	m_lag.GetRangeValues(min, max);
 	result += QuString::F("Simulated lag: %ims to %ims\n", min, max);
 	result += QuString::F("Simulated loss: %i%%\n", (int)(m_loss * 100.f));
+#if defined(PACKETCHANNEL_MMSG)
+	result += QuString::F("Batched I/O: %s (recvmmsg/sendmmsg)\n", m_isBatched ? "on" : "off");
+#else
+	result += QuString::F("Batched I/O: %s\n", m_isBatched ? "on" : "off");
+#endif
 
 	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static SOCKET CreateLoopbackSocket(sockaddr_in* outAddr)
+{
+	//Port 0 lets the OS pick, so ask the socket where it ended up
+	SOCKET sock = Network::CreateUDPSocket("127.0.0.1", "0", outAddr);
+	if (sock != INVALID_SOCKET)
+	{
+		socklen_t addrlen = sizeof(sockaddr_in);
+		getsockname(sock, (sockaddr*)outAddr, &addrlen);
+	}
+	return sock;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Every client sends the server a packet, then the server answers each of them, like one network tick.
+//Time spent in the server's receives and sends is added to serverSeconds, as that side is the one batching helps
+static int RunPacketBenchmarkRound(PacketChannel* server, const sockaddr_in& serverAddr, std::vector<PacketChannel*>& clients,
+	const std::vector<sockaddr_in>& clientAddrs, const char* payload, int payloadBytes, double& serverSeconds)
+{
+	char buffer[UDP_PACKET_MAX_LENGTH];
+	sockaddr_in fromAddr;
+	int fromAddrLen = sizeof(sockaddr_in);
+	int numDelivered = 0;
+
+	for (PacketChannel* client : clients)
+	{
+		client->QueueSendTo(payload, payloadBytes, &serverAddr);
+		client->FlushSends();
+	}
+
+	double serverStartSeconds = GetCurrentTimeSeconds();
+	while (server->RecvFrom(buffer, UDP_PACKET_MAX_LENGTH, &fromAddr, &fromAddrLen) > 0)
+	{
+		numDelivered++;
+	}
+
+	for (const sockaddr_in& clientAddr : clientAddrs)
+	{
+		server->QueueSendTo(payload, payloadBytes, &clientAddr);
+	}
+	server->FlushSends();
+	serverSeconds += GetCurrentTimeSeconds() - serverStartSeconds;
+	for (PacketChannel* client : clients)
+	{
+		while (client->RecvFrom(buffer, UDP_PACKET_MAX_LENGTH, &fromAddr, &fromAddrLen) > 0)
+		{
+			numDelivered++;
+		}
+	}
+
+	return numDelivered;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(PacketBenchmark, args)
+{
+	int numPackets = 200000;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numPackets = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: packetbenchmark [numPacketsPerRun]", RED);
+		return;
+	}
+
+	const int connectionCounts[] = { 1, 8, 64 };
+	const int payloadBytes = 128;
+	char payload[payloadBytes];
+	memset(payload, 0xAB, payloadBytes);
+
+	for (int numConnections : connectionCounts)
+	{
+		sockaddr_in serverAddr;
+		SOCKET serverSock = CreateLoopbackSocket(&serverAddr);
+		if (serverSock == INVALID_SOCKET)
+		{
+			ConsolePrint("Could not create a loopback socket", RED);
+			return;
+		}
+		PacketChannel* server = new PacketChannel(serverSock);
+
+		std::vector<PacketChannel*> clients;
+		std::vector<sockaddr_in> clientAddrs;
+		for (int connection = 0; connection < numConnections; connection++)
+		{
+			sockaddr_in clientAddr;
+			SOCKET clientSock = CreateLoopbackSocket(&clientAddr);
+			if (clientSock == INVALID_SOCKET)
+			{
+				break;
+			}
+			clients.push_back(new PacketChannel(clientSock));
+			clientAddrs.push_back(clientAddr);
+		}
+
+		int numRounds = (numPackets / (2 * numConnections) > 1) ? numPackets / (2 * numConnections) : 1;
+		double packetsPerSecond[2];
+		double serverNanosecondsPerPacket[2];
+		int numDropped[2];
+		for (int mode = 0; mode < 2; mode++)
+		{
+			bool isBatched = (mode == 1);
+			server->SetBatchedIO(isBatched);
+			for (PacketChannel* client : clients)
+			{
+				client->SetBatchedIO(isBatched);
+			}
+
+			int numDelivered = 0;
+			double serverSeconds = 0.0;
+			double startSeconds = GetCurrentTimeSeconds();
+			for (int round = 0; round < numRounds; round++)
+			{
+				numDelivered += RunPacketBenchmarkRound(server, serverAddr, clients, clientAddrs, payload, payloadBytes, serverSeconds);
+			}
+			double seconds = GetCurrentTimeSeconds() - startSeconds;
+
+			packetsPerSecond[mode] = (double)numDelivered / seconds;
+			serverNanosecondsPerPacket[mode] = serverSeconds * 1.e9 / (double)(numRounds * 2 * clients.size());
+			numDropped[mode] = numRounds * 2 * (int)clients.size() - numDelivered;
+		}
+
+		ConsolePrintf(WHITE, "%2i connections: %.0fK packets/sec per call, %.0fK batched (x%.2f), %i/%i dropped", (int)clients.size(),
+			packetsPerSecond[0] * 1.e-3, packetsPerSecond[1] * 1.e-3, packetsPerSecond[1] / packetsPerSecond[0], numDropped[0], numDropped[1]);
+		ConsolePrintf(WHITE, "    server side: %.0fns/packet per call, %.0fns batched (x%.2f)",
+			serverNanosecondsPerPacket[0], serverNanosecondsPerPacket[1], serverNanosecondsPerPacket[0] / serverNanosecondsPerPacket[1]);
+
+		for (PacketChannel* client : clients)
+		{
+			delete client;
+		}
+		delete server;
+	}
 }
\ No newline at end of file
@@ -8,6 +8,12 @@
 
 #include <map>
 
+//recvmmsg/sendmmsg move a whole batch of datagrams per syscall.  Elsewhere, batches are filled
+//and flushed with one recvfrom/sendto per datagram
+#if defined(__linux__)
+#define PACKETCHANNEL_MMSG
+#endif
+
 struct PacketInfo
 {
 	char buffer[UDP_PACKET_MAX_LENGTH];
@@ -17,22 +23,59 @@ struct PacketInfo
 };
 
 
+//-----------------------------------------------------------------------------------------------
+// Datagrams are drained from the socket a batch at a time into a pre-allocated receive batch,
+// and sends queue up in a pre-allocated send batch until FlushSends (or the batch fills).
 //-----------------------------------------------------------------------------------------------
 class PacketChannel
 {
+public:
+	static const int BATCH_SIZE = 64;
+
 public:
 	PacketChannel(SOCKET sock);
-	~PacketChannel() { closesocket(m_sock); }
+	~PacketChannel();
 	int SendTo(const char* buffer, size_t bytes, int flags, const sockaddr_in* toAddress);
-	int RecvFrom(char* buffer, size_t maxBytes, int flags, sockaddr_in* outAddr, int* outAddrLen);
+	int RecvFrom(char* buffer, size_t maxBytes, sockaddr_in* outAddr, int* outAddrLen);
+	void QueueSendTo(const char* buffer, size_t bytes, const sockaddr_in* toAddress);
+	int FlushSends();
+	int ReceiveBatch();
+
+	//Blocks until a datagram can be read or the timeout passes.  Returns whether one can
+	bool WaitForPackets(int timeoutMilliseconds);
+	void SetBatchedIO(bool isBatched) { FlushSends(); m_isBatched = isBatched; }
+	bool IsBatchedIO() const { return m_isBatched; }
 	void SetLag(int minMilliSeconds, int maxMilliSeconds) { m_lag.SetRange(minMilliSeconds, maxMilliSeconds); }
 	void SetLoss(float loss) { m_loss = loss; }
 	void Tick(Event*);
+	void AdvanceLaggedPackets(float deltaSeconds);
+
+	//A network thread that owns the channel ticks its lag itself instead
+	void SetTickedByGame(bool isTickedByGame);
 	QuString GetDebugString() const;
 
+private:
+	bool IsSimulatingConditions() const;
+	void SimulateConditions(const PacketInfo& packReceived);
+
 private:
 	SOCKET m_sock;
 	float m_loss;
 	Range<int> m_lag;
 	std::multimap<float, PacketInfo> m_laggedPackets;
+	bool m_isBatched;
+
+	PacketInfo m_receivedPackets[BATCH_SIZE];
+	int m_numReceivedPackets;
+	int m_nextReceivedPacket;
+	bool m_isSocketDrained;
+	PacketInfo m_queuedSends[BATCH_SIZE];
+	int m_numQueuedSends;
+
+#if defined(PACKETCHANNEL_MMSG)
+	mmsghdr m_receiveHeaders[BATCH_SIZE];
+	iovec m_receiveVectors[BATCH_SIZE];
+	mmsghdr m_sendHeaders[BATCH_SIZE];
+	iovec m_sendVectors[BATCH_SIZE];
+#endif
 };
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "Engine/Network/TCPConnection.hpp"
 #include "Engine/Network/TCPListener.hpp"
 
+#include <stdexcept>
+
 #define RCS_PORT "4325"
 
 RemoteCommandService* g_remoteCommandService = nullptr;
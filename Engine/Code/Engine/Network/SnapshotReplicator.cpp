@@ -0,0 +1,945 @@
+#include "Engine/Network/SnapshotReplicator.hpp"
+#include "Engine/Network/NetSession.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/ConsoleCommand.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+#include <algorithm>
+#include <deque>
+
+
+//-----------------------------------------------------------------------------------------------
+SnapshotReplicator* g_snapshotReplicator = nullptr;
+
+
+//-----------------------------------------------------------------------------------------------
+enum ESnapshotEntryOp : byte
+{
+	SNAPSHOTENTRY_UPDATE = 0,
+	SNAPSHOTENTRY_CREATE,
+	SNAPSHOTENTRY_REMOVE
+};
+#define NUM_SNAPSHOT_ENTRY_OP_BITS 2
+
+
+//-----------------------------------------------------------------------------------------------
+int SnapshotSchema::AddField(int numBits)
+{
+	ASSERT_OR_DIE(numFields < MAX_NUM_SNAPSHOT_FIELDS, "Too many snapshot fields");
+	ASSERT_OR_DIE(numBits > 0 && numBits <= 32, "Snapshot fields must be 1 to 32 bits");
+	fieldBits[numFields] = (byte)numBits;
+	return numFields++;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static void AppendEntity(Snapshot& snapshot, ushort entityID, const uint32_t* fields, int numFields)
+{
+	snapshot.entityIDs.push_back(entityID);
+	snapshot.fields.insert(snapshot.fields.end(), fields, fields + numFields);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//More flag, ID delta, op, change mask, and each field as its larger encoding
+static int GetMaxEntryBits(const SnapshotSchema& schema)
+{
+	int numBits = 1 + BitPacker::GetVarUIntBits(0xFFFF) + NUM_SNAPSHOT_ENTRY_OP_BITS + schema.numFields;
+	for (int fieldIndex = 0; fieldIndex < schema.numFields; fieldIndex++)
+	{
+		numBits += 1 + schema.fieldBits[fieldIndex];
+	}
+
+	return numBits;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//A changed field is sent as its difference from baseline when that's shorter than the field itself
+static void WriteFieldDelta(NetMessage& msg, uint32_t value, uint32_t baselineValue, int numBits)
+{
+	uint32_t zigZagDelta = BitPacker::ZigZagEncode((int32_t)(value - baselineValue));
+	if (BitPacker::GetVarUIntBits(zigZagDelta) < numBits)
+	{
+		msg.WriteBool(true);
+		msg.WriteVarUInt(zigZagDelta);
+	}
+	else
+	{
+		msg.WriteBool(false);
+		msg.WriteBits(value, numBits);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool ReadFieldDelta(NetMessage& msg, uint32_t& inOutValue, int numBits)
+{
+	bool isDelta;
+	if (!msg.ReadBool(isDelta))
+	{
+		return false;
+	}
+
+	if (!isDelta)
+	{
+		return msg.ReadBits(inOutValue, numBits);
+	}
+
+	int32_t delta;
+	if (!msg.ReadVarInt(delta))
+	{
+		return false;
+	}
+	inOutValue += (uint32_t)delta;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// Wire format: 16-bit snapshot ID, then a baseline flag and the baseline's distance back as a
+// varint.  Entries follow in entity ID order, each behind a 1 bit, and a 0 bit ends them.  An
+// entry is its ID's distance past the last entry's, its op, and then all fields (create) or a
+// change mask and the changed fields (update).  Entities with nothing to say aren't written.
+//-----------------------------------------------------------------------------------------------
+STATIC int SnapshotReplicator::WriteSnapshot(NetMessage& msg, const SnapshotSchema& schema, ushort snapshotID, const Snapshot* baseline, const Snapshot& target, Snapshot& outSent)
+{
+	const int numFields = schema.numFields;
+	const int maxEntryBits = GetMaxEntryBits(schema);
+	outSent.snapshotID = snapshotID;
+	outSent.entityIDs.clear();
+	outSent.fields.clear();
+
+	msg.WriteBits(snapshotID, 16);
+	msg.WriteBool(baseline != nullptr);
+	if (baseline)
+	{
+		msg.WriteVarUInt((ushort)(snapshotID - baseline->snapshotID));
+	}
+
+	size_t numBaseline = baseline ? baseline->entityIDs.size() : 0;
+	size_t numTarget = target.entityIDs.size();
+	size_t baselineIndex = 0;
+	size_t targetIndex = 0;
+	int previousEntityID = -1;
+	int numEntries = 0;
+	while (baselineIndex < numBaseline || targetIndex < numTarget)
+	{
+		bool isInBaseline = baselineIndex < numBaseline && (targetIndex >= numTarget || baseline->entityIDs[baselineIndex] <= target.entityIDs[targetIndex]);
+		bool isInTarget = targetIndex < numTarget && (baselineIndex >= numBaseline || target.entityIDs[targetIndex] <= baseline->entityIDs[baselineIndex]);
+		ushort entityID = isInTarget ? target.entityIDs[targetIndex] : baseline->entityIDs[baselineIndex];
+		const uint32_t* baselineFields = isInBaseline ? baseline->GetFields((int)baselineIndex, numFields) : nullptr;
+		const uint32_t* targetFields = isInTarget ? target.GetFields((int)targetIndex, numFields) : nullptr;
+
+		uint32_t changedMask = 0;
+		if (isInBaseline && isInTarget)
+		{
+			for (int fieldIndex = 0; fieldIndex < numFields; fieldIndex++)
+			{
+				if (targetFields[fieldIndex] != baselineFields[fieldIndex])
+				{
+					changedMask |= (1U << fieldIndex);
+				}
+			}
+		}
+
+		//Leave room for this entry at its largest, and the end bit
+		bool needsEntry = !(isInBaseline && isInTarget) || changedMask != 0;
+		bool hasRoom = msg.GetLength() + BitPacker::GetNumNewBytes(maxEntryBits + 1, msg.m_spareBits) <= (int)MAX_SNAPSHOT_PAYLOAD_BYTES;
+		bool isWritten = needsEntry && hasRoom;
+		if (isWritten)
+		{
+			msg.WriteBool(true);
+			msg.WriteVarUInt((uint32_t)(entityID - previousEntityID - 1));
+			previousEntityID = entityID;
+			numEntries++;
+
+			if (!isInTarget)
+			{
+				msg.WriteBits(SNAPSHOTENTRY_REMOVE, NUM_SNAPSHOT_ENTRY_OP_BITS);
+			}
+			else if (!isInBaseline)
+			{
+				msg.WriteBits(SNAPSHOTENTRY_CREATE, NUM_SNAPSHOT_ENTRY_OP_BITS);
+				for (int fieldIndex = 0; fieldIndex < numFields; fieldIndex++)
+				{
+					msg.WriteBits(targetFields[fieldIndex], schema.fieldBits[fieldIndex]);
+				}
+			}
+			else
+			{
+				msg.WriteBits(SNAPSHOTENTRY_UPDATE, NUM_SNAPSHOT_ENTRY_OP_BITS);
+				msg.WriteBits(changedMask, numFields);
+				for (int fieldIndex = 0; fieldIndex < numFields; fieldIndex++)
+				{
+					if ((changedMask & (1U << fieldIndex)) != 0)
+					{
+						WriteFieldDelta(msg, targetFields[fieldIndex], baselineFields[fieldIndex], schema.fieldBits[fieldIndex]);
+					}
+				}
+			}
+		}
+
+		//What the receiver holds once this snapshot is applied.  Entries that didn't fit go out next time
+		const uint32_t* heldFields = (isWritten || !needsEntry) ? targetFields : baselineFields;
+		if (heldFields)
+		{
+			AppendEntity(outSent, entityID, heldFields, numFields);
+		}
+
+		if (isInBaseline)
+		{
+			baselineIndex++;
+		}
+		if (isInTarget)
+		{
+			targetIndex++;
+		}
+	}
+	msg.WriteBool(false);
+
+	return numEntries;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC bool SnapshotReplicator::ReadSnapshotHeader(NetMessage& msg, int& outSnapshotID, int& outBaselineID)
+{
+	uint32_t snapshotID;
+	bool hasBaseline;
+	if (!msg.ReadBits(snapshotID, 16) || !msg.ReadBool(hasBaseline))
+	{
+		return false;
+	}
+
+	outSnapshotID = (int)snapshotID;
+	outBaselineID = INVALID_SNAPSHOT_ID;
+	if (hasBaseline)
+	{
+		uint32_t baselineDistance;
+		if (!msg.ReadVarUInt(baselineDistance))
+		{
+			return false;
+		}
+		outBaselineID = (ushort)(snapshotID - baselineDistance);
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Baseline entities no entry mentions carry over untouched
+STATIC bool SnapshotReplicator::ReadSnapshotEntries(NetMessage& msg, const SnapshotSchema& schema, const Snapshot* baseline, Snapshot& outSnapshot)
+{
+	const int numFields = schema.numFields;
+	outSnapshot.entityIDs.clear();
+	outSnapshot.fields.clear();
+
+	size_t numBaseline = baseline ? baseline->entityIDs.size() : 0;
+	size_t baselineIndex = 0;
+	int previousEntityID = -1;
+	for (;;)
+	{
+		bool hasEntry;
+		if (!msg.ReadBool(hasEntry))
+		{
+			return false;
+		}
+		if (!hasEntry)
+		{
+			break;
+		}
+
+		uint32_t entityIDDelta;
+		uint32_t op;
+		if (!msg.ReadVarUInt(entityIDDelta) || !msg.ReadBits(op, NUM_SNAPSHOT_ENTRY_OP_BITS))
+		{
+			return false;
+		}
+		int entityID = previousEntityID + 1 + (int)entityIDDelta;
+		if (entityIDDelta > 0xFFFF || entityID > 0xFFFF)
+		{
+			return false;
+		}
+		previousEntityID = entityID;
+
+		while (baselineIndex < numBaseline && baseline->entityIDs[baselineIndex] < entityID)
+		{
+			AppendEntity(outSnapshot, baseline->entityIDs[baselineIndex], baseline->GetFields((int)baselineIndex, numFields), numFields);
+			baselineIndex++;
+		}
+		bool isInBaseline = baselineIndex < numBaseline && baseline->entityIDs[baselineIndex] == entityID;
+
+		switch (op)
+		{
+		case SNAPSHOTENTRY_CREATE:
+		{
+			if (isInBaseline)
+			{
+				return false;
+			}
+
+			outSnapshot.entityIDs.push_back((ushort)entityID);
+			for (int fieldIndex = 0; fieldIndex < numFields; fieldIndex++)
+			{
+				uint32_t value;
+				if (!msg.ReadBits(value, schema.fieldBits[fieldIndex]))
+				{
+					return false;
+				}
+				outSnapshot.fields.push_back(value);
+			}
+			break;
+		}
+		case SNAPSHOTENTRY_UPDATE:
+		{
+			uint32_t changedMask;
+			if (!isInBaseline || !msg.ReadBits(changedMask, numFields))
+			{
+				return false;
+			}
+
+			size_t firstField = outSnapshot.fields.size();
+			AppendEntity(outSnapshot, (ushort)entityID, baseline->GetFields((int)baselineIndex, numFields), numFields);
+			for (int fieldIndex = 0; fieldIndex < numFields; fieldIndex++)
+			{
+				if ((changedMask & (1U << fieldIndex)) != 0 && !ReadFieldDelta(msg, outSnapshot.fields[firstField + fieldIndex], schema.fieldBits[fieldIndex]))
+				{
+					return false;
+				}
+			}
+			baselineIndex++;
+			break;
+		}
+		case SNAPSHOTENTRY_REMOVE:
+		{
+			if (!isInBaseline)
+			{
+				return false;
+			}
+			baselineIndex++;
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+
+	for (; baselineIndex < numBaseline; baselineIndex++)
+	{
+		AppendEntity(outSnapshot, baseline->entityIDs[baselineIndex], baseline->GetFields((int)baselineIndex, numFields), numFields);
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+SnapshotReplicator::SnapshotReplicator(const SnapshotSchema& schema)
+	: m_schema(schema)
+	, m_relevanceFunc(nullptr)
+	, m_relevanceUserData(nullptr)
+{
+	ASSERT_OR_DIE(schema.numFields > 0, "Snapshot schema has no fields");
+	g_eventSystem->RegisterEvent<SnapshotReplicator, &SnapshotReplicator::OnNetworkTick>(EVENT_ID("OnNetworkTick"), this);
+	g_eventSystem->RegisterEvent<SnapshotReplicator, &SnapshotReplicator::OnConnectionLeave>(EVENT_ID("OnConnectionLeave"), this);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+SnapshotReplicator::~SnapshotReplicator()
+{
+	g_eventSystem->UnregisterFromAllEvents(this);
+	for (auto& connectionPair : m_connections)
+	{
+		delete connectionPair.second;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SnapshotReplicator::SetEntity(ushort entityID, const Vector3& position, const uint32_t* fields)
+{
+	ReplicatedEntity& entity = m_entities[entityID];
+	entity.position = position;
+	for (int fieldIndex = 0; fieldIndex < m_schema.numFields; fieldIndex++)
+	{
+		int numBits = m_schema.fieldBits[fieldIndex];
+		ASSERT_OR_DIE(numBits == 32 || fields[fieldIndex] < (1U << numBits), "Snapshot field value is wider than its schema");
+		entity.fields[fieldIndex] = fields[fieldIndex];
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SnapshotReplicator::RemoveEntity(ushort entityID)
+{
+	m_entities.erase(entityID);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SnapshotReplicator::SetViewer(const NetConnection* connection, const Vector3& position, float relevantRadius)
+{
+	ConnectionReplication& replication = GetReplication(connection);
+	replication.hasViewer = true;
+	replication.viewerPosition = position;
+	replication.relevantRadius = relevantRadius;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+const Snapshot* SnapshotReplicator::GetLatestReceived(const NetConnection* connection) const
+{
+	auto found = m_connections.find(connection);
+	if (found == m_connections.end() || found->second->applied.snapshotID == INVALID_SNAPSHOT_ID)
+	{
+		return nullptr;
+	}
+
+	return &found->second->applied;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Asks the sender to stop using baselines we can't produce.  Without a replicator, there's nothing to keep yet
+static void SendSnapshotReset(NetConnection* connection)
+{
+	NetMessage reset(NETMESSAGE_SNAPSHOT_RESET);
+	connection->AddMessage(reset);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC void SnapshotReplicator::OnSnapshotReceived(NetSender& sender, NetMessage& msg)
+{
+	if (!sender.connection)
+	{
+		return;
+	}
+
+	if (!g_snapshotReplicator)
+	{
+		SendSnapshotReset(sender.connection);
+		return;
+	}
+
+	g_snapshotReplicator->ReceiveSnapshot(sender.connection, msg);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC void SnapshotReplicator::OnSnapshotResetReceived(NetSender& sender, NetMessage& msg)
+{
+	UNUSED(msg);
+	if (!sender.connection || !g_snapshotReplicator)
+	{
+		return;
+	}
+
+	g_snapshotReplicator->ForgetSentSnapshots(sender.connection);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Snapshots for every connection go out on our own connection's tick, which comes first
+void SnapshotReplicator::OnNetworkTick(Event* e)
+{
+	NetworkTickEvent* nte = (NetworkTickEvent*)e;
+	if (!g_netSession || !nte->connection || !nte->connection->IsMe())
+	{
+		return;
+	}
+
+	PruneDepartedConnections();
+	for (NetConnection* connection : g_netSession->GetConnections())
+	{
+		if (connection->IsValid())
+		{
+			SendSnapshot(connection, GetReplication(connection));
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SnapshotReplicator::OnConnectionLeave(Event* e)
+{
+	ConnectionChangeEvent* cce = (ConnectionChangeEvent*)e;
+	auto found = m_connections.find(cce->connection);
+	if (found != m_connections.end())
+	{
+		delete found->second;
+		m_connections.erase(found);
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SnapshotReplicator::SendSnapshot(NetConnection* connection, ConnectionReplication& replication)
+{
+	const int numFields = m_schema.numFields;
+	m_relevantScratch.entityIDs.clear();
+	m_relevantScratch.fields.clear();
+	for (auto& entityPair : m_entities)
+	{
+		if (IsRelevant(connection, replication, entityPair.first, entityPair.second.position))
+		{
+			AppendEntity(m_relevantScratch, entityPair.first, entityPair.second.fields, numFields);
+		}
+	}
+
+	//The last acked snapshot stays in the history until an ID a full ring later is sent, and so does the receiver's copy
+	ushort snapshotID = replication.nextSnapshotID;
+	int ackedID = connection->GetLastAckedSnapshotID();
+	const Snapshot* baseline = nullptr;
+	if (ackedID != INVALID_SNAPSHOT_ID && replication.sent[ackedID % NUM_SNAPSHOT_HISTORY].snapshotID == ackedID)
+	{
+		baseline = &replication.sent[ackedID % NUM_SNAPSHOT_HISTORY];
+	}
+
+	NetMessage snapshotMsg(NETMESSAGE_SNAPSHOT);
+	int numEntries = WriteSnapshot(snapshotMsg, m_schema, snapshotID, baseline, m_relevantScratch, m_deltaScratch);
+
+	//Nothing changed, and nothing newer than what they hold is in flight to overrule it
+	if (numEntries == 0 && baseline && (ushort)(snapshotID - 1) == ackedID)
+	{
+		return;
+	}
+
+	std::swap(replication.sent[snapshotID % NUM_SNAPSHOT_HISTORY], m_deltaScratch);
+	replication.nextSnapshotID++;
+	connection->QueueSnapshot(snapshotMsg, snapshotID);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SnapshotReplicator::ReceiveSnapshot(NetConnection* connection, NetMessage& msg)
+{
+	int snapshotID;
+	int baselineID;
+	if (!ReadSnapshotHeader(msg, snapshotID, baselineID))
+	{
+		ConsolePrint("Bad snapshot header", RED);
+		return;
+	}
+
+	ConnectionReplication& replication = GetReplication(connection);
+	const Snapshot* baseline = nullptr;
+	if (baselineID != INVALID_SNAPSHOT_ID)
+	{
+		baseline = &replication.received[baselineID % NUM_SNAPSHOT_HISTORY];
+		if (baseline->snapshotID != baselineID)
+		{
+			ConsolePrintf(RED, "Snapshot %i is against baseline %i, which we don't have.  Asking for a reset", snapshotID, baselineID);
+			SendSnapshotReset(connection);
+			return;
+		}
+	}
+
+	//Decoded aside, since the baseline may sit in the slot this one goes into
+	if (!ReadSnapshotEntries(msg, m_schema, baseline, m_deltaScratch))
+	{
+		ConsolePrintf(RED, "Bad snapshot %i.  Asking for a reset", snapshotID);
+		SendSnapshotReset(connection);
+		return;
+	}
+	m_deltaScratch.snapshotID = snapshotID;
+	std::swap(replication.received[snapshotID % NUM_SNAPSHOT_HISTORY], m_deltaScratch);
+
+	//Late arrivals can still be baselines, but the world only moves forward
+	const Snapshot& received = replication.received[snapshotID % NUM_SNAPSHOT_HISTORY];
+	int appliedID = replication.applied.snapshotID;
+	if (appliedID == INVALID_SNAPSHOT_ID || (short)(snapshotID - appliedID) > 0)
+	{
+		TriggerChangedEntities(connection, replication.applied, received);
+		replication.applied = received;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Every baseline we held for this connection is suspect; full snapshots until a new one is acked
+void SnapshotReplicator::ForgetSentSnapshots(const NetConnection* connection)
+{
+	ConnectionReplication& replication = GetReplication(connection);
+	for (Snapshot& sent : replication.sent)
+	{
+		sent.snapshotID = INVALID_SNAPSHOT_ID;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void SnapshotReplicator::TriggerChangedEntities(NetConnection* connection, const Snapshot& previous, const Snapshot& current) const
+{
+	const int numFields = m_schema.numFields;
+	size_t numPrevious = previous.entityIDs.size();
+	size_t numCurrent = current.entityIDs.size();
+	size_t previousIndex = 0;
+	size_t currentIndex = 0;
+
+	SnapshotEntityEvent see;
+	see.connection = connection;
+	see.numFields = numFields;
+	while (previousIndex < numPrevious || currentIndex < numCurrent)
+	{
+		bool isInPrevious = previousIndex < numPrevious && (currentIndex >= numCurrent || previous.entityIDs[previousIndex] <= current.entityIDs[currentIndex]);
+		bool isInCurrent = currentIndex < numCurrent && (previousIndex >= numPrevious || current.entityIDs[currentIndex] <= previous.entityIDs[previousIndex]);
+
+		if (!isInCurrent)
+		{
+			see.entityID = previous.entityIDs[previousIndex];
+			see.fields = nullptr;
+			g_eventSystem->TriggerEvent(EVENT_ID("OnSnapshotEntityRemoved"), &see);
+		}
+		else
+		{
+			const uint32_t* currentFields = current.GetFields((int)currentIndex, numFields);
+			if (!isInPrevious || memcmp(currentFields, previous.GetFields((int)previousIndex, numFields), numFields * sizeof(uint32_t)) != 0)
+			{
+				see.entityID = current.entityIDs[currentIndex];
+				see.fields = currentFields;
+				g_eventSystem->TriggerEvent(EVENT_ID("OnSnapshotEntityUpdated"), &see);
+			}
+		}
+
+		if (isInPrevious)
+		{
+			previousIndex++;
+		}
+		if (isInCurrent)
+		{
+			currentIndex++;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool SnapshotReplicator::IsRelevant(const NetConnection* connection, const ConnectionReplication& replication, ushort entityID, const Vector3& position) const
+{
+	if (m_relevanceFunc)
+	{
+		return m_relevanceFunc(connection, entityID, position, m_relevanceUserData);
+	}
+
+	if (replication.hasViewer)
+	{
+		return (position - replication.viewerPosition).LengthSquared() <= replication.relevantRadius * replication.relevantRadius;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+SnapshotReplicator::ConnectionReplication& SnapshotReplicator::GetReplication(const NetConnection* connection)
+{
+	ConnectionReplication*& replication = m_connections[connection];
+	if (!replication)
+	{
+		replication = new ConnectionReplication();
+	}
+
+	return *replication;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Timed out connections are deleted without a leave event, so anything the session no longer has goes too
+void SnapshotReplicator::PruneDepartedConnections()
+{
+	LockedConnections connections = g_netSession->GetConnections();
+	for (auto iter = m_connections.begin(); iter != m_connections.end();)
+	{
+		if (std::find(connections.begin(), connections.end(), iter->first) == connections.end())
+		{
+			delete iter->second;
+			iter = m_connections.erase(iter);
+		}
+		else
+		{
+			iter++;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+// SNAPSHOT BENCHMARK
+// Entities drift around a cube world while receivers watch from fixed spots.  Snapshots land a
+// few ticks late or not at all, and acks take as long to come back.  The last ticks are quiet
+// and lossless, by the end of which every receiver should hold exactly what it's relevant to.
+//-----------------------------------------------------------------------------------------------
+static const float BENCHMARK_WORLD_SIZE = 1024.f;
+static const int BENCHMARK_NUM_RECEIVERS = 4;
+static const int BENCHMARK_NUM_TICKS = 300;
+static const int BENCHMARK_NUM_SETTLE_TICKS = 20;
+static const int BENCHMARK_LATENCY_TICKS = 3;
+static const float BENCHMARK_LOSS_CHANCE = .05f;
+static const FloatQuantization BENCHMARK_POSITION_QUANTIZATION = { 0.f, BENCHMARK_WORLD_SIZE, 16 };
+
+
+//-----------------------------------------------------------------------------------------------
+struct BenchmarkInFlight
+{
+	int arrivalTick;
+	ushort snapshotID;
+	NetMessageRef message;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+struct BenchmarkReceiver
+{
+	Vector3 viewerPosition;
+	ushort nextSnapshotID;
+	int ackedID;
+	int latestReceivedID;
+	Snapshot sent[NUM_SNAPSHOT_HISTORY];
+	Snapshot received[NUM_SNAPSHOT_HISTORY];
+	std::deque<BenchmarkInFlight> snapshotsInFlight;
+	std::deque<BenchmarkInFlight> acksInFlight;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+static Vector3 GetRandomBenchmarkPosition()
+{
+	return Vector3(GetRandominRange(0.f, BENCHMARK_WORLD_SIZE), GetRandominRange(0.f, BENCHMARK_WORLD_SIZE), GetRandominRange(0.f, BENCHMARK_WORLD_SIZE));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Bytes to send all of target with no baseline, in as many snapshots as it takes, each building on the last
+static int MeasureFullStateBytes(const SnapshotSchema& schema, const Snapshot& target)
+{
+	NetMessage msg(NETMESSAGE_SNAPSHOT);
+	Snapshot chunks[2];
+	const Snapshot* baseline = nullptr;
+	int currentChunk = 0;
+	int totalBytes = 0;
+	do
+	{
+		msg.Reset();
+		SnapshotReplicator::WriteSnapshot(msg, schema, 0, baseline, target, chunks[currentChunk]);
+		totalBytes += msg.GetLength();
+		baseline = &chunks[currentChunk];
+		currentChunk ^= 1;
+	} while (baseline->entityIDs.size() < target.entityIDs.size());
+
+	return totalBytes;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC float SnapshotReplicator::BenchmarkTraffic(int numEntities, float relevantRadius, float& outFullStateBytes, bool& outIsIntact)
+{
+	SnapshotSchema schema;
+	int positionFields[3];
+	for (int& positionField : positionFields)
+	{
+		positionField = schema.AddField(BENCHMARK_POSITION_QUANTIZATION.numBits);
+	}
+	int headingField = schema.AddField(10);
+	int healthField = schema.AddField(8);
+	const int numFields = schema.numFields;
+
+	std::vector<Vector3> positions(numEntities);
+	std::vector<uint32_t> entityFields(numEntities * numFields);
+	std::vector<bool> isAlive(numEntities, true);
+	for (int entityIndex = 0; entityIndex < numEntities; entityIndex++)
+	{
+		positions[entityIndex] = GetRandomBenchmarkPosition();
+		entityFields[entityIndex * numFields + headingField] = rand() % (1 << 10);
+		entityFields[entityIndex * numFields + healthField] = 255;
+	}
+
+	BenchmarkReceiver* receivers = new BenchmarkReceiver[BENCHMARK_NUM_RECEIVERS];
+	for (int receiverIndex = 0; receiverIndex < BENCHMARK_NUM_RECEIVERS; receiverIndex++)
+	{
+		receivers[receiverIndex].viewerPosition = GetRandomBenchmarkPosition();
+		receivers[receiverIndex].nextSnapshotID = 0;
+		receivers[receiverIndex].ackedID = INVALID_SNAPSHOT_ID;
+		receivers[receiverIndex].latestReceivedID = INVALID_SNAPSHOT_ID;
+	}
+
+	NetMessage msg(NETMESSAGE_SNAPSHOT);
+	NetMessage readMsg;
+	Snapshot target;
+	Snapshot scratch;
+	long long deltaBytes = 0;
+	long long fullStateBytes = 0;
+	outIsIntact = true;
+	for (int tick = 0; tick < BENCHMARK_NUM_TICKS; tick++)
+	{
+		bool isSettling = tick >= BENCHMARK_NUM_TICKS - BENCHMARK_NUM_SETTLE_TICKS;
+		for (int entityIndex = 0; !isSettling && entityIndex < numEntities; entityIndex++)
+		{
+			uint32_t* fields = &entityFields[entityIndex * numFields];
+			if (GetRandomNormalized() < .1f)
+			{
+				Vector3& position = positions[entityIndex];
+				position += Vector3(GetRandominRange(-.5f, .5f), GetRandominRange(-.5f, .5f), GetRandominRange(-.5f, .5f));
+				position = Vector3(Clampf(position.x, 0.f, BENCHMARK_WORLD_SIZE), Clampf(position.y, 0.f, BENCHMARK_WORLD_SIZE), Clampf(position.z, 0.f, BENCHMARK_WORLD_SIZE));
+				fields[headingField] = (fields[headingField] + 1) % (1 << 10);
+			}
+			if (GetRandomNormalized() < .01f)
+			{
+				fields[healthField] = rand() % 256;
+			}
+			if (GetRandomNormalized() < .002f)
+			{
+				isAlive[entityIndex] = !isAlive[entityIndex];
+			}
+			fields[positionFields[0]] = BitPacker::QuantizeFloat(positions[entityIndex].x, BENCHMARK_POSITION_QUANTIZATION);
+			fields[positionFields[1]] = BitPacker::QuantizeFloat(positions[entityIndex].y, BENCHMARK_POSITION_QUANTIZATION);
+			fields[positionFields[2]] = BitPacker::QuantizeFloat(positions[entityIndex].z, BENCHMARK_POSITION_QUANTIZATION);
+		}
+
+		for (int receiverIndex = 0; receiverIndex < BENCHMARK_NUM_RECEIVERS; receiverIndex++)
+		{
+			BenchmarkReceiver& receiver = receivers[receiverIndex];
+			while (!receiver.acksInFlight.empty() && receiver.acksInFlight.front().arrivalTick <= tick)
+			{
+				ushort ackedID = receiver.acksInFlight.front().snapshotID;
+				if (receiver.ackedID == INVALID_SNAPSHOT_ID || (short)(ackedID - (ushort)receiver.ackedID) > 0)
+				{
+					receiver.ackedID = ackedID;
+				}
+				receiver.acksInFlight.pop_front();
+			}
+
+			//Every decode must match what the sender recorded the receiver as holding
+			while (!receiver.snapshotsInFlight.empty() && receiver.snapshotsInFlight.front().arrivalTick <= tick)
+			{
+				readMsg.LoadForReading(*receiver.snapshotsInFlight.front().message, 0);
+				int snapshotID;
+				int baselineID;
+				bool isRead = ReadSnapshotHeader(readMsg, snapshotID, baselineID);
+				const Snapshot* baseline = nullptr;
+				if (isRead && baselineID != INVALID_SNAPSHOT_ID)
+				{
+					baseline = &receiver.received[baselineID % NUM_SNAPSHOT_HISTORY];
+					isRead = (baseline->snapshotID == baselineID);
+				}
+				isRead = isRead && ReadSnapshotEntries(readMsg, schema, baseline, scratch);
+
+				const Snapshot& expected = receiver.sent[snapshotID % NUM_SNAPSHOT_HISTORY];
+				outIsIntact = outIsIntact && isRead && expected.snapshotID == snapshotID && scratch.entityIDs == expected.entityIDs && scratch.fields == expected.fields;
+				scratch.snapshotID = snapshotID;
+				std::swap(receiver.received[snapshotID % NUM_SNAPSHOT_HISTORY], scratch);
+				if (receiver.latestReceivedID == INVALID_SNAPSHOT_ID || (short)(snapshotID - receiver.latestReceivedID) > 0)
+				{
+					receiver.latestReceivedID = snapshotID;
+				}
+
+				BenchmarkInFlight ack = { tick + BENCHMARK_LATENCY_TICKS, (ushort)snapshotID, NetMessageRef() };
+				receiver.acksInFlight.push_back(ack);
+				receiver.snapshotsInFlight.pop_front();
+			}
+
+			//Same as SendSnapshot, minus the connection
+			target.entityIDs.clear();
+			target.fields.clear();
+			for (int entityIndex = 0; entityIndex < numEntities; entityIndex++)
+			{
+				if (isAlive[entityIndex] && (positions[entityIndex] - receiver.viewerPosition).LengthSquared() <= relevantRadius * relevantRadius)
+				{
+					AppendEntity(target, (ushort)entityIndex, &entityFields[entityIndex * numFields], numFields);
+				}
+			}
+			fullStateBytes += MeasureFullStateBytes(schema, target);
+
+			ushort snapshotID = receiver.nextSnapshotID;
+			const Snapshot* baseline = nullptr;
+			if (receiver.ackedID != INVALID_SNAPSHOT_ID && receiver.sent[receiver.ackedID % NUM_SNAPSHOT_HISTORY].snapshotID == receiver.ackedID)
+			{
+				baseline = &receiver.sent[receiver.ackedID % NUM_SNAPSHOT_HISTORY];
+			}
+
+			msg.Reset();
+			int numEntries = WriteSnapshot(msg, schema, snapshotID, baseline, target, scratch);
+			if (numEntries == 0 && baseline && (ushort)(snapshotID - 1) == receiver.ackedID)
+			{
+				continue;
+			}
+			deltaBytes += msg.GetLength();
+			std::swap(receiver.sent[snapshotID % NUM_SNAPSHOT_HISTORY], scratch);
+			receiver.nextSnapshotID++;
+
+			if (isSettling || GetRandomNormalized() >= BENCHMARK_LOSS_CHANCE)
+			{
+				BenchmarkInFlight inFlight = { tick + BENCHMARK_LATENCY_TICKS, snapshotID, msg.Share() };
+				receiver.snapshotsInFlight.push_back(inFlight);
+			}
+		}
+	}
+
+	//Once settled, the newest snapshot each receiver holds is the whole relevant world
+	for (int receiverIndex = 0; receiverIndex < BENCHMARK_NUM_RECEIVERS; receiverIndex++)
+	{
+		BenchmarkReceiver& receiver = receivers[receiverIndex];
+		target.entityIDs.clear();
+		target.fields.clear();
+		for (int entityIndex = 0; entityIndex < numEntities; entityIndex++)
+		{
+			if (isAlive[entityIndex] && (positions[entityIndex] - receiver.viewerPosition).LengthSquared() <= relevantRadius * relevantRadius)
+			{
+				AppendEntity(target, (ushort)entityIndex, &entityFields[entityIndex * numFields], numFields);
+			}
+		}
+
+		const Snapshot& latest = receiver.received[receiver.latestReceivedID % NUM_SNAPSHOT_HISTORY];
+		outIsIntact = outIsIntact && receiver.latestReceivedID != INVALID_SNAPSHOT_ID && latest.entityIDs == target.entityIDs && latest.fields == target.fields;
+	}
+	delete[] receivers;
+
+	float numSends = (float)(BENCHMARK_NUM_TICKS * BENCHMARK_NUM_RECEIVERS);
+	outFullStateBytes = fullStateBytes / numSends;
+	return deltaBytes / numSends;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+CONSOLE_COMMAND(SnapshotBenchmark, args)
+{
+	int numEntities = 1024;
+
+	try
+	{
+		std::string arg = args.GetNextArg();
+		if (arg != "")
+		{
+			numEntities = std::stoi(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		ConsolePrint("Usage: snapshotbenchmark [numEntities]", RED);
+		return;
+	}
+	numEntities = Clampi(numEntities, 1, 0x10000);
+
+	//The first radius takes in the whole world
+	const float relevantRadii[] = { BENCHMARK_WORLD_SIZE * 2.f, BENCHMARK_WORLD_SIZE * .25f };
+	const char* radiusNames[] = { "Everything relevant", "Relevant within a quarter world" };
+	bool isPassing = true;
+	for (int radiusIndex = 0; radiusIndex < 2; radiusIndex++)
+	{
+		float fullStateBytes;
+		bool isIntact;
+		float deltaBytes = SnapshotReplicator::BenchmarkTraffic(numEntities, relevantRadii[radiusIndex], fullStateBytes, isIntact);
+		isPassing = isPassing && isIntact;
+
+		ConsolePrintf(isIntact ? WHITE : RED, "%s, %i entities: %.0f bytes/connection/tick full state, %.0f as deltas (%.1f%%): %s",
+			radiusNames[radiusIndex], numEntities, fullStateBytes, deltaBytes, deltaBytes / fullStateBytes * 100.f, isIntact ? "passed" : "FAILED");
+	}
+
+	if (!isPassing)
+	{
+		ConsolePrint("Snapshot replication tests FAILED", RED);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Core/EventSystem.hpp"
+#include "Engine/Math/Vector3.hpp"
+
+#include <map>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+#define MAX_NUM_SNAPSHOT_FIELDS 32
+#define NUM_SNAPSHOT_HISTORY 32
+
+//Room left for the packet header and the message's own header
+#define MAX_SNAPSHOT_PAYLOAD_BYTES (UDP_PACKET_MAX_LENGTH - sizeof(PacketHeader) - 8)
+
+
+//-----------------------------------------------------------------------------------------------
+extern class SnapshotReplicator* g_snapshotReplicator;
+
+
+//-----------------------------------------------------------------------------------------------
+//Both ends must build the same schema.  Fields are unsigned ints numBits wide; quantize floats into them with BitPacker
+struct SnapshotSchema
+{
+	SnapshotSchema() : numFields(0) {}
+	int AddField(int numBits);
+
+	int numFields;
+	byte fieldBits[MAX_NUM_SNAPSHOT_FIELDS];
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Entities sorted by ID, each with the schema's numFields values laid out back to back
+struct Snapshot
+{
+	Snapshot() : snapshotID(INVALID_SNAPSHOT_ID) {}
+	const uint32_t* GetFields(int entityIndex, int numFields) const { return &fields[entityIndex * numFields]; }
+
+	int snapshotID;
+	std::vector<ushort> entityIDs;
+	std::vector<uint32_t> fields;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+//Triggered as "OnSnapshotEntityUpdated" (fields set) and "OnSnapshotEntityRemoved" (fields null)
+struct SnapshotEntityEvent : Event
+{
+	NetConnection* connection;
+	ushort entityID;
+	const uint32_t* fields;
+	int numFields;
+};
+
+
+//-----------------------------------------------------------------------------------------------
+typedef bool(*SnapshotRelevanceFunc)(const NetConnection* connection, ushort entityID, const Vector3& position, void* userData);
+
+
+//-----------------------------------------------------------------------------------------------
+// Replicates entity state as snapshots on top of the session's connections.  Each connection
+// is sent, every network tick, only what differs from the last snapshot it acked: new and
+// removed entities, and changed fields of the rest.  Entities the connection's relevance test
+// rejects aren't sent at all, and drop out of its view.
+//
+// A snapshot is acked with the packet that carried it, through the connection's ack bundles.
+// Either end can author entities; received snapshots are applied as entity events.
+//-----------------------------------------------------------------------------------------------
+class SnapshotReplicator
+{
+public:
+	SnapshotReplicator(const SnapshotSchema& schema);
+	~SnapshotReplicator();
+
+	//AUTHORING
+	void SetEntity(ushort entityID, const Vector3& position, const uint32_t* fields);
+	void RemoveEntity(ushort entityID);
+	const SnapshotSchema& GetSchema() const { return m_schema; }
+
+	//RELEVANCE
+	//A relevance func replaces the viewer distance test.  Without either, every entity is relevant everywhere
+	void SetViewer(const NetConnection* connection, const Vector3& position, float relevantRadius);
+	void SetRelevanceFunc(SnapshotRelevanceFunc func, void* userData) { m_relevanceFunc = func; m_relevanceUserData = userData; }
+
+	//RECEIVING
+	const Snapshot* GetLatestReceived(const NetConnection* connection) const;
+	static void OnSnapshotReceived(struct NetSender& sender, NetMessage& msg);
+	static void OnSnapshotResetReceived(struct NetSender& sender, NetMessage& msg);
+
+	//Encodes target against baseline (null for a full snapshot).  Entries that don't fit are left at
+	//baseline, so outSent is what the receiver will hold.  Returns the number of entries written
+	static int WriteSnapshot(NetMessage& msg, const SnapshotSchema& schema, ushort snapshotID, const Snapshot* baseline, const Snapshot& target, Snapshot& outSent);
+	static bool ReadSnapshotHeader(NetMessage& msg, int& outSnapshotID, int& outBaselineID);
+	static bool ReadSnapshotEntries(NetMessage& msg, const SnapshotSchema& schema, const Snapshot* baseline, Snapshot& outSnapshot);
+
+	//For the snapshotbenchmark command, which plays the sender and all its receivers.  Returns bytes per receiver per tick
+	static float BenchmarkTraffic(int numEntities, float relevantRadius, float& outFullStateBytes, bool& outIsIntact);
+
+private:
+	struct ReplicatedEntity
+	{
+		Vector3 position;
+		uint32_t fields[MAX_NUM_SNAPSHOT_FIELDS];
+	};
+
+	//Sent and received histories are rings indexed by snapshot ID
+	struct ConnectionReplication
+	{
+		ConnectionReplication() : nextSnapshotID(0), hasViewer(false), relevantRadius(0.f) {}
+
+		ushort nextSnapshotID;
+		Snapshot sent[NUM_SNAPSHOT_HISTORY];
+		Snapshot received[NUM_SNAPSHOT_HISTORY];
+		Snapshot applied;
+		bool hasViewer;
+		Vector3 viewerPosition;
+		float relevantRadius;
+	};
+
+	void OnNetworkTick(Event* e);
+	void OnConnectionLeave(Event* e);
+	void SendSnapshot(NetConnection* connection, ConnectionReplication& replication);
+	void ReceiveSnapshot(NetConnection* connection, NetMessage& msg);
+	void ForgetSentSnapshots(const NetConnection* connection);
+	void TriggerChangedEntities(NetConnection* connection, const Snapshot& previous, const Snapshot& current) const;
+	bool IsRelevant(const NetConnection* connection, const ConnectionReplication& replication, ushort entityID, const Vector3& position) const;
+	ConnectionReplication& GetReplication(const NetConnection* connection);
+	void PruneDepartedConnections();
+
+private:
+	SnapshotSchema m_schema;
+	std::map<ushort, ReplicatedEntity> m_entities;
+	std::map<const NetConnection*, ConnectionReplication*> m_connections;
+	SnapshotRelevanceFunc m_relevanceFunc;
+	void* m_relevanceUserData;
+
+	//Scratch, kept to hold onto capacity between ticks
+	Snapshot m_relevantScratch;
+	Snapshot m_deltaScratch;
+};
\ No newline at end of file
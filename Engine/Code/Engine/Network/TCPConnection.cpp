@@ -4,6 +4,24 @@
 #include <string>
 
 
+//-----------------------------------------------------------------------------------------------
+static const char MSG_TYPE_COMMAND = '0';
+static const char MSG_TYPE_REPLY = '1';
+
+
+//-----------------------------------------------------------------------------------------------
+//While a remote command runs, console output is echoed back to whoever sent it
+static void ReplyConsolePrint(const std::string& toPrint, const Rgba& color, void* echoData)
+{
+	UNUSED(color);
+	TCPConnection* replyConnection = (TCPConnection*)echoData;
+	if (replyConnection)
+	{
+		replyConnection->SendTextMessage(MSG_TYPE_REPLY, toPrint);
+	}
+}
+
+
 //-----------------------------------------------------------------------------------------------
 TCPConnection::TCPConnection(SOCKET sock, const sockaddr_in& addr, const char* name /* = nullptr */)
 	: m_sock(sock)
@@ -47,10 +65,18 @@ void TCPConnection::ReceiveMessages()
 		m_currCommand.push_back(c);
 		if (c == NULL)
 		{
-			std::string substring = m_currCommand.substr(1);
-			ConsolePrintf(WHITE, "Remote: %s", substring.c_str());
-			ConsoleCommand cc(substring);
-			cc.CallFunc();
+			std::string substring = m_currCommand.substr(1, m_currCommand.size() - 2);
+			if (m_currCommand[0] == MSG_TYPE_REPLY)
+			{
+				if (ConsolePrint)
+				{
+					ConsolePrint(substring, WHITE);
+				}
+			}
+			else
+			{
+				RunRemoteCommand(substring);
+			}
 			m_currCommand.clear();
 			m_currCommand.shrink_to_fit();
 		}
@@ -71,9 +97,29 @@ void TCPConnection::ReceiveMessages()
 //-----------------------------------------------------------------------------------------------
 void TCPConnection::SendCommand(const std::string& command)
 {
-	char msgType = '0';
+	SendTextMessage(MSG_TYPE_COMMAND, command);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void TCPConnection::SendTextMessage(char msgType, const std::string& text)
+{
 	send(m_sock, &msgType, 1, 0);
-	send(m_sock, command.c_str(), command.size(), 0);
+	send(m_sock, text.c_str(), text.size(), 0);
 	char endOfMsg = NULL;
 	send(m_sock, &endOfMsg, 1, 0);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Anything the command prints goes back to the sender too, so queries like profilerstats or
+//memstats answer over the connection
+void TCPConnection::RunRemoteCommand(const std::string& command)
+{
+	ConsolePrintf(WHITE, "Remote: %s", command.c_str());
+
+	//Only this thread's output, so nothing printed elsewhere meanwhile is sent
+	ScopedConsoleEcho echo(ReplyConsolePrint, this);
+	ConsoleCommand cc(command);
+	cc.CallFunc();
 }
\ No newline at end of file
@@ -13,6 +13,10 @@ public:
 	void ReceiveMessages();
 	bool IsValid() const { return m_isValid; }
 	void SendCommand(const std::string& command);
+	void SendTextMessage(char msgType, const std::string& text);
+
+private:
+	void RunRemoteCommand(const std::string& command);
 
 private:
 	std::string m_currCommand;
@@ -15,7 +15,7 @@ TCPListener::TCPListener(SOCKET sock, const sockaddr_in& addr)
 TCPConnection* TCPListener::AcceptConnection()
 {
 	sockaddr_storage addr;
-	int addrlen = sizeof(addr);
+	socklen_t addrlen = sizeof(addr);
 	SOCKET acceptedSocket = accept(m_sock, (sockaddr*)&addr, &addrlen);
 
 	if (acceptedSocket == INVALID_SOCKET)
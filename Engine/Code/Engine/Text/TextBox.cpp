@@ -1,5 +1,6 @@
 #include "Engine/Text/TextBox.hpp"
 #include "ThirdParty\XML\xml.hpp"
+#include "Engine/Core/ArenaAllocator.hpp"
 #include "Engine/Core/StringUtils.hpp"
 #include "Engine/Model/MeshBuilder.hpp"
 #include "Engine/Renderer/MeshRenderer.hpp"
@@ -153,9 +154,9 @@ void TextBox::ConstructMeshes()
 	m_meshRenderers.clear();
 	float totalStringWidth = 0.f;
 	int currIndex = 0;
-	std::vector<float>lineWidths;
+	FrameVector<float> lineWidths;
 	float currLineWidth = 0.f;
-	for (StringEffectFragment frag : m_fragments)
+	for (const StringEffectFragment& frag : m_fragments)
 	{
 		if (frag.m_value == "\n")
 		{
@@ -170,7 +171,7 @@ void TextBox::ConstructMeshes()
 	lineWidths.push_back(currLineWidth);
 	float totalWidthUpToNow = 0.f;
 	int lineNum = 0;
-	for (StringEffectFragment frag : m_fragments)
+	for (const StringEffectFragment& frag : m_fragments)
 	{
 		if (frag.m_value == "\n")
 		{
@@ -10,12 +10,67 @@ STATIC QuEventSystem* QuEventSystem::s_instance = nullptr;
 //-----------------------------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------------------------
+QuNamedProperties::QuNamedProperties()
+	: m_entries(m_inlineEntries)
+	, m_data(m_inlineData)
+	, m_numEntries(0)
+	, m_entryCapacity(s_NUM_INLINE_PROPERTIES)
+	, m_numDataBytes(0)
+	, m_dataCapacity(s_NUM_INLINE_DATA_BYTES)
+{
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Boxed values are held by pointer, so the whole block can be moved bytewise
+QuNamedProperties::QuNamedProperties(QuNamedProperties&& otherProperties)
+	: QuNamedProperties()
+{
+	if (otherProperties.m_entries != otherProperties.m_inlineEntries)
+	{
+		m_entries = otherProperties.m_entries;
+		m_entryCapacity = otherProperties.m_entryCapacity;
+	}
+	else
+	{
+		memcpy(m_inlineEntries, otherProperties.m_inlineEntries, otherProperties.m_numEntries * sizeof(QuNamedPropertyEntry));
+	}
+
+	if (otherProperties.m_data != otherProperties.m_inlineData)
+	{
+		m_data = otherProperties.m_data;
+		m_dataCapacity = otherProperties.m_dataCapacity;
+	}
+	else
+	{
+		memcpy(m_inlineData, otherProperties.m_inlineData, otherProperties.m_numDataBytes);
+	}
+
+	m_numEntries = otherProperties.m_numEntries;
+	m_numDataBytes = otherProperties.m_numDataBytes;
+
+	otherProperties.m_entries = otherProperties.m_inlineEntries;
+	otherProperties.m_data = otherProperties.m_inlineData;
+	otherProperties.m_numEntries = 0;
+	otherProperties.m_entryCapacity = s_NUM_INLINE_PROPERTIES;
+	otherProperties.m_numDataBytes = 0;
+	otherProperties.m_dataCapacity = s_NUM_INLINE_DATA_BYTES;
+}
+
+
 //-----------------------------------------------------------------------------------------------
 QuNamedProperties::~QuNamedProperties()
 {
-	for (std::pair<const QuHash, QuNamedPropertyBase*>& p : m_properties)
+	Clear();
+
+	if (m_entries != m_inlineEntries)
+	{
+		delete[] m_entries;
+	}
+	if (m_data != m_inlineData)
 	{
-		delete p.second;
+		delete[] m_data;
 	}
 }
 
@@ -39,13 +94,125 @@ QuEventSystem::~QuEventSystem()
 
 
 //-----------------------------------------------------------------------------------------------
+//The removed value's bytes aren't reclaimed until the block is cleared
 void QuNamedProperties::Remove(const QuString& name)
 {
-	auto propertyIter = m_properties.find(name);
-	if (propertyIter != m_properties.end())
+	int entryIndex = FindEntry(name.GetHash());
+	if (entryIndex < 0)
+	{
+		return;
+	}
+
+	DestroyValue(m_entries[entryIndex]);
+	memmove(&m_entries[entryIndex], &m_entries[entryIndex + 1], (m_numEntries - entryIndex - 1) * sizeof(QuNamedPropertyEntry));
+	m_numEntries--;
+
+	if (m_numEntries == 0)
+	{
+		m_numDataBytes = 0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void QuNamedProperties::Clear()
+{
+	for (uint32 entryIndex = 0; entryIndex < m_numEntries; entryIndex++)
+	{
+		DestroyValue(m_entries[entryIndex]);
+	}
+
+	m_numEntries = 0;
+	m_numDataBytes = 0;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int QuNamedProperties::FindEntry(QuHash nameHash) const
+{
+	int low = 0;
+	int high = (int)m_numEntries;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		QuHash midHash = m_entries[mid].nameHash;
+		if (midHash == nameHash)
+		{
+			return mid;
+		}
+		else if (midHash < nameHash)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return -low - 1;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuNamedPropertyEntry* QuNamedProperties::InsertEntry(int index, QuHash nameHash)
+{
+	if (m_numEntries == m_entryCapacity)
+	{
+		uint32 newCapacity = m_entryCapacity * 2;
+		QuNamedPropertyEntry* newEntries = new QuNamedPropertyEntry[newCapacity];
+		memcpy(newEntries, m_entries, m_numEntries * sizeof(QuNamedPropertyEntry));
+		if (m_entries != m_inlineEntries)
+		{
+			delete[] m_entries;
+		}
+		m_entries = newEntries;
+		m_entryCapacity = newCapacity;
+	}
+
+	memmove(&m_entries[index + 1], &m_entries[index], (m_numEntries - index) * sizeof(QuNamedPropertyEntry));
+	m_numEntries++;
+
+	QuNamedPropertyEntry* entry = &m_entries[index];
+	entry->nameHash = nameHash;
+	return entry;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint32 QuNamedProperties::AllocateData(size_t numBytes, size_t alignment)
+{
+	uint32 offset = (uint32)((m_numDataBytes + alignment - 1) & ~(alignment - 1));
+	uint32 newNumDataBytes = offset + (uint32)numBytes;
+	if (newNumDataBytes > m_dataCapacity)
+	{
+		uint32 newCapacity = m_dataCapacity * 2;
+		while (newCapacity < newNumDataBytes)
+		{
+			newCapacity *= 2;
+		}
+
+		uint8* newData = new uint8[newCapacity];
+		memcpy(newData, m_data, m_numDataBytes);
+		if (m_data != m_inlineData)
+		{
+			delete[] m_data;
+		}
+		m_data = newData;
+		m_dataCapacity = newCapacity;
+	}
+
+	m_numDataBytes = newNumDataBytes;
+	return offset;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void QuNamedProperties::DestroyValue(const QuNamedPropertyEntry& entry)
+{
+	if (entry.isBoxed)
 	{
-		delete propertyIter->second;
-		m_properties.erase(propertyIter);
+		delete *(QuNamedPropertyBase**)GetData(entry);
 	}
 }
 
@@ -72,7 +239,14 @@ STATIC void QuEventSystem::DestroySystem()
 //-----------------------------------------------------------------------------------------------
 void QuEventSystem::Fire(const QuString& name, QuNamedProperties& params)
 {
-	auto funcIter = m_freeFuncSubscribers.find(name);
+	FireHashed(name.GetHash(), params);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void QuEventSystem::FireHashed(QuHash nameHash, QuNamedProperties& params)
+{
+	auto funcIter = m_freeFuncSubscribers.find(nameHash);
 	if (funcIter != m_freeFuncSubscribers.end())
 	{
 		for (EventFunc FireEvent : funcIter->second)
@@ -81,7 +255,7 @@ void QuEventSystem::Fire(const QuString& name, QuNamedProperties& params)
 		}
 	}
 
-	auto methodIter = m_objectSubscribers.find(name);
+	auto methodIter = m_objectSubscribers.find(nameHash);
 	if (methodIter != m_objectSubscribers.end())
 	{
 		for (QuSubscriberBase* sub : methodIter->second)
@@ -195,6 +369,28 @@ void QuEvent::Fire(const QuString& name, QuNamedProperties& params)
 }
 
 
+//-----------------------------------------------------------------------------------------------
+void QuDeferredEvent::Dispatch()
+{
+	QuEventSystem::GetInstance()->FireHashed(nameHash, params);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void QuEvent::Post(const QuString& name, QuNamedProperties&& params)
+{
+	DeferredEvents::Post(QuDeferredEvent(name.GetHash(), std::move(params)));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void QuEvent::PostCoalesced(const QuString& name, uint64 instanceKey, QuNamedProperties&& params)
+{
+	QuHash nameHash = name.GetHash();
+	DeferredEvents::Post(QuDeferredEvent(nameHash, std::move(params)), DeferredEvents::MakeCoalesceKey(nameHash, instanceKey));
+}
+
+
 //-----------------------------------------------------------------------------------------------
 void QuEvent::Register(const QuString& name, EventFunc freeFunc)
 {
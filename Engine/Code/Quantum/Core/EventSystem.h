@@ -1,8 +1,11 @@
 #pragma once
 
 #include "Quantum/Core/String.h"
+#include "Engine/Core/DeferredEvents.hpp"
 
 #include <map>
+#include <string.h>
+#include <type_traits>
 #include <vector>
 
 
@@ -39,12 +42,10 @@ enum EDataType
 };
 
 
-//Dummy parent struct for named properties-------------------------------------------------------
+//Dummy parent struct for boxed named properties------------------------------------------------
 struct QuNamedPropertyBase 
 {
 	virtual ~QuNamedPropertyBase() {}
-
-	EDataType dataType;
 };
 
 
@@ -61,16 +62,41 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------------------------
+//One per property, kept sorted by name hash.  POD values live in the data block itself; anything
+//else is boxed in a heap TNamedProperty and the data block holds the pointer
+struct QuNamedPropertyEntry
+{
+	QuHash nameHash;
+	EDataType dataType;
+	const void* typeID;
+	uint32 dataOffset;
+	bool isBoxed;
+};
+
+
 //-----------------------------------------------------------------------------------------------
 class QuNamedProperties
 {
+	static const uint32 s_NUM_INLINE_PROPERTIES = 8;
+	static const uint32 s_NUM_INLINE_DATA_BYTES = 128;
+
+public:
+	static const size_t s_MAX_INLINE_ALIGNMENT = 8;
+
 public:
 	//-----------------------------------------------------------------------------------------------
 	//CTORS AND DTORS
-	QuNamedProperties() : m_properties() {}
+	QuNamedProperties();
+	QuNamedProperties(QuNamedProperties&& otherProperties);
 	template<typename... T_Params>
 	QuNamedProperties(T_Params... props);
 	~QuNamedProperties();
+
+private:
+	//Boxed properties are owned by pointer, so a copy would free them twice
+	QuNamedProperties(const QuNamedProperties&) = delete;
+	void operator=(const QuNamedProperties&) = delete;
 	//-----------------------------------------------------------------------------------------------
 
 public:
@@ -81,6 +107,8 @@ public:
 	template<typename T>
 	inline EPropertySetResult Set(const QuString& name, const T& datum, EDataType dataType = DATATYPE_UNSPECIFIED);
 	void Remove(const QuString& name);
+	void Clear();
+	uint32 GetNumProperties() const { return m_numEntries; }
 	//-----------------------------------------------------------------------------------------------
 
 public:
@@ -93,7 +121,21 @@ public:
 	//-----------------------------------------------------------------------------------------------
 
 private:
-	std::map<QuHash, QuNamedPropertyBase*> m_properties;
+	int FindEntry(QuHash nameHash) const; //Index if found, otherwise -(insertion index) - 1
+	QuNamedPropertyEntry* InsertEntry(int index, QuHash nameHash);
+	uint32 AllocateData(size_t numBytes, size_t alignment);
+	void DestroyValue(const QuNamedPropertyEntry& entry);
+	void* GetData(const QuNamedPropertyEntry& entry) const { return m_data + entry.dataOffset; }
+
+private:
+	QuNamedPropertyEntry* m_entries;
+	uint8* m_data;
+	uint32 m_numEntries;
+	uint32 m_entryCapacity;
+	uint32 m_numDataBytes;
+	uint32 m_dataCapacity;
+	QuNamedPropertyEntry m_inlineEntries[s_NUM_INLINE_PROPERTIES];
+	alignas(s_MAX_INLINE_ALIGNMENT) uint8 m_inlineData[s_NUM_INLINE_DATA_BYTES];
 };
 
 
@@ -145,6 +187,7 @@ public:
 	static QuEventSystem* GetInstance();
 	static void DestroySystem();
 	void Fire(const QuString& name, QuNamedProperties& params);
+	void FireHashed(QuHash nameHash, QuNamedProperties& params);
 	void Register(const QuString& name, EventFunc freeFunc);
 	void Register(const QuString& name, QuSubscriberBase* subscriber);
 	void UnregisterFunc(const QuString& name, EventFunc toUnregister);
@@ -162,6 +205,19 @@ private:
 };
 
 
+//-----------------------------------------------------------------------------------------------
+//Payload for QuEvent::Post
+struct QuDeferredEvent
+{
+	QuDeferredEvent(QuHash eventNameHash, QuNamedProperties&& eventParams) : nameHash(eventNameHash), params(std::move(eventParams)) {}
+	QuDeferredEvent(QuDeferredEvent&& otherEvent) : nameHash(otherEvent.nameHash), params(std::move(otherEvent.params)) {}
+	void Dispatch();
+
+	QuHash nameHash;
+	QuNamedProperties params;
+};
+
+
 //-----------------------------------------------------------------------------------------------
 namespace QuEvent
 {
@@ -170,6 +226,14 @@ namespace QuEvent
 	template<typename T, typename... T_Params>
 	void Fire(const QuString& name, const QuString& param1Name, const T& param1Value, T_Params... params);
 
+	//Safe from any thread.  Fired on whichever thread calls DeferredEvents::DispatchAll
+	void Post(const QuString& name, QuNamedProperties&& params);
+	template<typename T, typename... T_Params>
+	void Post(const QuString& name, const QuString& param1Name, const T& param1Value, T_Params... params);
+
+	//Of all the posts with the same name and instanceKey in a batch, only the newest is fired
+	void PostCoalesced(const QuString& name, uint64 instanceKey, QuNamedProperties&& params);
+
 	void Register(const QuString& name, EventFunc freeFunc);
 	template<typename T>
 	void Register(const QuString& name, T* obj, TMethodFunc<T> method);
@@ -3,11 +3,52 @@
 //-----------------------------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------------------------
+//The address of s_id is unique per type, which is all Get needs to check a property's type
+template<typename T>
+struct TNamedPropertyTypeID
+{
+	static char s_id; //Not const, or the linker may fold identical IDs together
+	static const void* Get() { return &s_id; }
+};
+template<typename T>
+char TNamedPropertyTypeID<T>::s_id = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T, bool IS_INLINE = std::is_trivially_copyable<T>::value && (alignof(T) <= QuNamedProperties::s_MAX_INLINE_ALIGNMENT)>
+struct TNamedPropertyStorage
+{
+	static const bool IS_BOXED = false;
+	static size_t GetSize() { return sizeof(T); }
+	static size_t GetAlignment() { return alignof(T); }
+	static void Construct(void* data, const T& datum) { memcpy(data, &datum, sizeof(T)); }
+	static void Assign(void* data, const T& datum) { memcpy(data, &datum, sizeof(T)); }
+	static const T& Read(const void* data) { return *(const T*)data; }
+};
+
+
+//-----------------------------------------------------------------------------------------------
+template<typename T>
+struct TNamedPropertyStorage<T, false>
+{
+	static const bool IS_BOXED = true;
+	static size_t GetSize() { return sizeof(QuNamedPropertyBase*); }
+	static size_t GetAlignment() { return alignof(QuNamedPropertyBase*); }
+	static void Construct(void* data, const T& datum) { *(QuNamedPropertyBase**)data = new TNamedProperty<T>(datum); }
+	static void Assign(void* data, const T& datum) { GetBox(data)->m_datum = datum; }
+	static const T& Read(const void* data) { return GetBox(data)->m_datum; }
+
+private:
+	static TNamedProperty<T>* GetBox(const void* data) { return static_cast<TNamedProperty<T>*>(*(QuNamedPropertyBase* const*)data); }
+};
+
+
 //-----------------------------------------------------------------------------------------------
 template<typename... T_Params>
 QuNamedProperties::QuNamedProperties(T_Params... props)
+	: QuNamedProperties()
 {
-	m_properties.clear();
 	ConsumeParams(props...);
 }
 
@@ -31,59 +72,84 @@ void QuNamedProperties::ConsumeParams(const QuString& paramName, const T& paramV
 
 
 //-----------------------------------------------------------------------------------------------
+//The data type is reported even on a type mismatch, so callers can probe with any T
 template<typename T>
 EPropertyGetResult QuNamedProperties::Get(const QuString& name, T& outDatum, EDataType* outDataType /* = nullptr */) const
 {
-	if (m_properties.empty())
+	if (m_numEntries == 0)
 	{
 		return PGR_FAIL_NO_PROPERTIES;
 	}
-	auto propertyIter = m_properties.find(name);
-	if (propertyIter == m_properties.end())
+	int entryIndex = FindEntry(name.GetHash());
+	if (entryIndex < 0)
 	{
 		return PGR_FAIL_DOES_NOT_EXIST;
 	}
 
-	TNamedProperty<T>* prop = (TNamedProperty<T>*)propertyIter->second;
+	const QuNamedPropertyEntry& entry = m_entries[entryIndex];
 	if (outDataType)
 	{
-		*outDataType = prop->dataType;
+		*outDataType = entry.dataType;
 	}
-	if (typeid(prop->m_datum) != typeid(T))
+	if (entry.typeID != TNamedPropertyTypeID<T>::Get())
 	{
 		return PGR_FAIL_TYPE_MISMATCH;
 	}
 	
-	outDatum = prop->m_datum;
+	outDatum = TNamedPropertyStorage<T>::Read(GetData(entry));
 
 	return PGR_SUCCESS;
 }
 
 
 //-----------------------------------------------------------------------------------------------
+//A property declared with a data type only accepts that data type and the C++ type it was declared
+//with.  Overwriting with the same type never allocates
 template<typename T>
 EPropertySetResult QuNamedProperties::Set(const QuString& name, const T& datum, EDataType dataType /* = DATATYPE_UNSPECIFIED */)
 {
-	auto propertyIter = m_properties.find(name);
-	if (propertyIter == m_properties.end())
-	{
-		m_properties.insert(std::make_pair(name, new TNamedProperty<T>(datum)));
-		return PSR_SUCCESS;
-	}
-	else
+	typedef TNamedPropertyStorage<T> Storage;
+	const void* typeID = TNamedPropertyTypeID<T>::Get();
+	QuHash nameHash = name.GetHash();
+
+	int entryIndex = FindEntry(nameHash);
+	QuNamedPropertyEntry* entry;
+	if (entryIndex >= 0)
 	{
-		if (propertyIter->second->dataType != DATATYPE_UNSPECIFIED)
+		entry = &m_entries[entryIndex];
+		if (entry->dataType != DATATYPE_UNSPECIFIED)
 		{
-			if (propertyIter->second->dataType != dataType)
+			bool isDataTypeMismatch = (dataType != DATATYPE_UNSPECIFIED) && (dataType != entry->dataType);
+			if (isDataTypeMismatch || entry->typeID != typeID)
 			{
 				return PSR_FAIL_TYPE_MISMATCH;
 			}
 		}
-		delete propertyIter->second;
 
-		propertyIter->second = new TNamedProperty<T>(datum);
-		return PSR_SUCCESS;
+		if (entry->typeID == typeID)
+		{
+			Storage::Assign(GetData(*entry), datum);
+			if (dataType != DATATYPE_UNSPECIFIED)
+			{
+				entry->dataType = dataType;
+			}
+			return PSR_SUCCESS;
+		}
+
+		DestroyValue(*entry);
 	}
+	else
+	{
+		entry = InsertEntry(-entryIndex - 1, nameHash);
+	}
+
+	entry->dataType = dataType;
+	entry->typeID = typeID;
+	entry->isBoxed = Storage::IS_BOXED;
+	entry->dataOffset = AllocateData(Storage::GetSize(), Storage::GetAlignment());
+	Storage::Construct(GetData(*entry), datum);
+
+	return PSR_SUCCESS;
 }
 
 
@@ -178,6 +244,17 @@ void QuEvent::Fire(const QuString& name, const QuString& param1Name, const T& pa
 }
 
 
+//-----------------------------------------------------------------------------------------------
+template<typename T, typename... T_Params>
+void QuEvent::Post(const QuString& name, const QuString& param1Name, const T& param1Value, T_Params... params)
+{
+	QuNamedProperties passParams;
+	passParams.ConsumeParams(param1Name, param1Value, params...);
+
+	Post(name, std::move(passParams));
+}
+
+
 //-----------------------------------------------------------------------------------------------
 template<typename T>
 void QuEvent::Register(const QuString& name, T* obj, TMethodFunc<T> method)
@@ -0,0 +1,101 @@
+#include "Quantum/Core/HashedName.h"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string.h>
+#include <unordered_map>
+#include <unordered_set>
+
+
+//-----------------------------------------------------------------------------------------------
+//Strings are never removed, so pointers handed out by Lookup stay valid
+static const size_t MAX_INTERNED_NAMES = 16 * 1024;
+static std::unordered_map<QuHash, std::string>* s_names = nullptr;
+static std::mutex s_namesMutex;
+
+//Once the table is full, hashing stops taking the lock at all
+static std::atomic<bool> s_isNameTableFull(false);
+
+#ifdef QU_TRACK_NAMES
+//Each collision is only reported once
+static std::unordered_set<QuHash>* s_collidedHashes = nullptr;
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+QuHash QuNameTable::Intern(const char* name, size_t length)
+{
+	QuHash hash = QuHashNameRuntime(name, length);
+	if (s_isNameTableFull.load(std::memory_order_relaxed))
+	{
+		return hash;
+	}
+
+	std::lock_guard<std::mutex> namesLock(s_namesMutex);
+	if (!s_names)
+	{
+		s_names = new std::unordered_map<QuHash, std::string>();
+	}
+
+	auto nameIter = s_names->find(hash);
+	if (nameIter == s_names->end())
+	{
+		s_names->insert(std::make_pair(hash, std::string(name, length)));
+		if (s_names->size() == MAX_INTERNED_NAMES)
+		{
+			DebuggerPrintf("Name table is full at %u names; later names won't be remembered or checked for collisions\n", (unsigned int)MAX_INTERNED_NAMES);
+			s_isNameTableFull.store(true, std::memory_order_relaxed);
+		}
+	}
+#ifdef QU_TRACK_NAMES
+	else
+	{
+		const std::string& existingName = nameIter->second;
+		bool isSameName = (existingName.size() == length) && (memcmp(existingName.data(), name, length) == 0);
+		if (!isSameName)
+		{
+			if (!s_collidedHashes)
+			{
+				s_collidedHashes = new std::unordered_set<QuHash>();
+			}
+			if (s_collidedHashes->insert(hash).second)
+			{
+				DebuggerPrintf("Name hash collision: \"%s\" and \"%s\" both hash to %08x\n", existingName.c_str(), std::string(name, length).c_str(), hash);
+			}
+		}
+	}
+#endif
+
+	return hash;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuHash QuNameTable::Intern(const char* name)
+{
+	return Intern(name, strlen(name));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+const char* QuNameTable::Lookup(QuHash hash)
+{
+	std::lock_guard<std::mutex> namesLock(s_namesMutex);
+	if (!s_names)
+	{
+		return nullptr;
+	}
+
+	auto nameIter = s_names->find(hash);
+	return (nameIter != s_names->end()) ? nameIter->second.c_str() : nullptr;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+size_t QuNameTable::GetNumNames()
+{
+	std::lock_guard<std::mutex> namesLock(s_namesMutex);
+	return s_names ? s_names->size() : 0;
+}
\ No newline at end of file
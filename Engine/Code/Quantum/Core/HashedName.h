@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <type_traits>
+
+
+//-----------------------------------------------------------------------------------------------
+typedef uint32 QuHash;
+
+
+//-----------------------------------------------------------------------------------------------
+//Debug builds remember the string behind every hash they see, to report collisions and for GetName
+#if defined(_DEBUG) && !defined(QU_TRACK_NAMES)
+#define QU_TRACK_NAMES
+#endif
+
+
+//-----------------------------------------------------------------------------------------------
+//32-bit FNV-1a
+static const QuHash s_QU_HASH_OFFSET_BASIS = 2166136261u;
+static const QuHash s_QU_HASH_PRIME = 16777619u;
+
+
+//-----------------------------------------------------------------------------------------------
+//Recurses once per character, so keep it to literals.  Everything else goes through QuHashNameRuntime
+constexpr QuHash QuHashName(const char* name, QuHash hash = s_QU_HASH_OFFSET_BASIS)
+{
+	return (*name == '\0') ? hash : QuHashName(name + 1, (QuHash)((hash ^ (QuHash)(uint8)*name) * s_QU_HASH_PRIME));
+}
+
+
+//-----------------------------------------------------------------------------------------------
+inline QuHash QuHashNameRuntime(const char* name, size_t length)
+{
+	QuHash hash = s_QU_HASH_OFFSET_BASIS;
+	for (size_t charIndex = 0; charIndex < length; charIndex++)
+	{
+		hash ^= (QuHash)(uint8)name[charIndex];
+		hash *= s_QU_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Forces the hash to be computed at compile time, wherever it's used
+#define QU_HASH(name) (std::integral_constant<QuHash, QuHashName(name)>::value)
+
+
+//-----------------------------------------------------------------------------------------------
+//Hash -> string, for turning hashes back into something readable
+namespace QuNameTable
+{
+	//Warns on a collision if QU_TRACK_NAMES is defined.  Once the table is full, names are hashed but not remembered
+	QuHash Intern(const char* name, size_t length);
+	QuHash Intern(const char* name);
+
+	//nullptr if the hash was never interned
+	const char* Lookup(QuHash hash);
+	size_t GetNumNames();
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//How QuString and QuStringView hash, so names looked up at runtime end up in the table in debug builds
+inline QuHash QuHashNameTracked(const char* name, size_t length)
+{
+#ifdef QU_TRACK_NAMES
+	return QuNameTable::Intern(name, length);
+#else
+	return QuHashNameRuntime(name, length);
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//A name that's only ever compared, never read.  Works as a case label: case QuHashedName("Shader"):
+class QuHashedName
+{
+public:
+	//-----------------------------------------------------------------------------------------------
+	//CTORS AND DTORS
+	constexpr QuHashedName(const char* name) : m_hash(QuHashName(name)) {}
+	constexpr explicit QuHashedName(QuHash hash) : m_hash(hash) {}
+	//-----------------------------------------------------------------------------------------------
+
+public:
+	//-----------------------------------------------------------------------------------------------
+	//GETTERS AND SETTERS
+	constexpr QuHash GetHash() const { return m_hash; }
+	const char* GetName() const { return QuNameTable::Lookup(m_hash); }
+	//-----------------------------------------------------------------------------------------------
+
+public:
+	//-----------------------------------------------------------------------------------------------
+	//OPERATORS
+	constexpr operator QuHash() const { return m_hash; }
+	constexpr bool operator==(const QuHashedName& otherName) const { return m_hash == otherName.m_hash; }
+	constexpr bool operator!=(const QuHashedName& otherName) const { return m_hash != otherName.m_hash; }
+	//-----------------------------------------------------------------------------------------------
+
+private:
+	QuHash m_hash;
+};
\ No newline at end of file
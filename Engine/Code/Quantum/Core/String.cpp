@@ -7,221 +7,229 @@
 #include <string.h>
 
 
+//-----------------------------------------------------------------------------------------------
+static thread_local uint64 s_numThreadAllocations = 0;
+static thread_local uint64 s_numThreadAllocatedBytes = 0;
+
+
+//-----------------------------------------------------------------------------------------------
+//Every heap buffer a QuString owns comes from here, so the counts are complete
+static char* AllocateStringBuffer(size_t capacity)
+{
+	s_numThreadAllocations++;
+	s_numThreadAllocatedBytes += capacity;
+	return new char[capacity];
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//CTORS AND DTOR
+//-----------------------------------------------------------------------------------------------
+
+
 //-----------------------------------------------------------------------------------------------
 QuString::QuString()
-	: m_capacity(s_MIN_STRING_MEMORY_BUFFER)
+	: m_stringPtr(m_internalBuffer)
+	, m_capacity(s_MIN_STRING_MEMORY_BUFFER)
 	, m_length(0)
+	, m_hash(0)
+	, m_isHashCached(false)
 {
-	m_stringPtr = m_internalBuffer;
 	*m_stringPtr = '\0';
 }
 
 
 //-----------------------------------------------------------------------------------------------
 QuString::QuString(const char* otherString)
+	: m_hash(0)
+	, m_isHashCached(false)
 {
-	m_length = strlen(otherString);
-	m_capacity = m_length + 1;
-	if (m_capacity > s_MIN_STRING_MEMORY_BUFFER)
-	{
-		m_stringPtr = new char[m_capacity];
-	}
-	else
-	{
-		m_stringPtr = m_internalBuffer;
-	}
-	if (m_length >= 0)
-	{
-		strcpy_s(m_stringPtr, m_capacity, otherString);
-	}
+	InitializeFrom(otherString, strlen(otherString));
 }
 
 
 //-----------------------------------------------------------------------------------------------
 QuString::QuString(const QuString& otherString)
+	: m_hash(otherString.m_hash)
+	, m_isHashCached(otherString.m_isHashCached)
 {
-	m_length = otherString.GetLength();
-	m_capacity = m_length + 1;
-	if (m_capacity > s_MIN_STRING_MEMORY_BUFFER)
-	{
-		m_stringPtr = new char[m_capacity];
-	}
-	else
-	{
-		m_stringPtr = m_internalBuffer;
-	}
-
-	if (m_length > 0)
-	{
-		strcpy_s(m_stringPtr, m_capacity, otherString.GetRaw());
-	}
+	InitializeFrom(otherString.m_stringPtr, otherString.m_length);
 }
 
 
 //-----------------------------------------------------------------------------------------------
+//Steals the heap buffer if there is one.  The moved-from string is left empty, not invalid
 QuString::QuString(QuString&& otherString)
+	: m_hash(otherString.m_hash)
+	, m_isHashCached(otherString.m_isHashCached)
 {
-	m_length = otherString.m_length;
-	m_capacity = otherString.m_capacity;
-
 	if (otherString.m_stringPtr == otherString.m_internalBuffer)
 	{
-		m_stringPtr = m_internalBuffer;
-		strcpy_s(m_stringPtr, otherString.m_length + 1, otherString.m_stringPtr);
+		InitializeFrom(otherString.m_stringPtr, otherString.m_length);
 	}
 	else
 	{
 		m_stringPtr = otherString.m_stringPtr;
+		m_capacity = otherString.m_capacity;
+		m_length = otherString.m_length;
 	}
 
-	otherString.m_stringPtr = nullptr;
+	otherString.BecomeEmpty();
 }
 
 
 //-----------------------------------------------------------------------------------------------
-QuString::QuString(uint32 inputInt)
+QuString::QuString(const QuStringView& view)
+	: m_hash(0)
+	, m_isHashCached(false)
 {
-	m_stringPtr = m_internalBuffer;
-	*m_stringPtr = '\0';
-	m_capacity = s_MIN_STRING_MEMORY_BUFFER;
-
-	char intString[s_MIN_STRING_MEMORY_BUFFER - 1]; //Ensuring we're within capacity
-	sprintf_s(intString, "%u", inputInt);
+	InitializeFrom(view.GetData(), view.GetLength());
+}
 
-	m_length = strlen(intString);
 
-	strcpy_s(m_stringPtr, m_length + 1, intString);
+//-----------------------------------------------------------------------------------------------
+QuString::QuString(uint32 inputInt)
+	: m_stringPtr(m_internalBuffer)
+	, m_capacity(s_MIN_STRING_MEMORY_BUFFER)
+	, m_hash(0)
+	, m_isHashCached(false)
+{
+	int numChars = snprintf(m_internalBuffer, s_MIN_STRING_MEMORY_BUFFER, "%u", inputInt);
+	m_length = (size_t)numChars;
 }
 
 
 //-----------------------------------------------------------------------------------------------
 QuString::~QuString()
 {
-	if (m_stringPtr != m_internalBuffer)
-	{
-		SAFE_DELETE_ARRAY(m_stringPtr);
-	}
+	ReleaseBuffer();
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void QuString::Push(char c)
-{
-	char buffer[2];
-	buffer[0] = c;
-	buffer[1] = '\0';
-
-	*this += buffer;
-}
+//END CTORS AND DTOR
+//-----------------------------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------------------------
-void QuString::operator=(const QuString& otherString)
+//Only for constructors, since it doesn't release a previous buffer
+void QuString::InitializeFrom(const char* chars, size_t numChars)
 {
-	m_length = otherString.GetLength();
-	m_capacity = m_length + 1;
-	if (m_capacity > s_MIN_STRING_MEMORY_BUFFER)
+	m_length = numChars;
+	if (numChars + 1 > (size_t)s_MIN_STRING_MEMORY_BUFFER)
 	{
-		m_stringPtr = new char[m_capacity];
+		m_capacity = numChars + 1;
+		m_stringPtr = AllocateStringBuffer(m_capacity);
 	}
 	else
 	{
+		m_capacity = s_MIN_STRING_MEMORY_BUFFER;
 		m_stringPtr = m_internalBuffer;
 	}
 
-	if (m_length > 0)
-	{
-		strcpy_s(m_stringPtr, m_capacity, otherString.GetRaw());
-	}
+	memcpy(m_stringPtr, chars, numChars);
+	m_stringPtr[numChars] = '\0';
 }
 
 
 //-----------------------------------------------------------------------------------------------
-QuString QuString::operator+(const QuString& otherString) const
+void QuString::ReleaseBuffer()
 {
-	QuString result = *this;
-	size_t otherLen = otherString.m_length;
-
-	bool changedSize = false;
-	while ((result.m_length + otherLen + 1) > result.m_capacity)
+	if (m_stringPtr != m_internalBuffer)
 	{
-		result.m_capacity *= 2;
-		changedSize = true;
+		SAFE_DELETE_ARRAY(m_stringPtr);
 	}
+}
 
-	if (changedSize && result.m_capacity > s_MIN_STRING_MEMORY_BUFFER)
-	{
-		char* newBuff = new char[result.m_capacity];
-		memcpy(newBuff, result.m_stringPtr, result.m_length);
-		if (result.m_stringPtr != result.m_internalBuffer)
-		{
-			delete[] result.m_stringPtr;
-		}
-		result.m_stringPtr = newBuff;
-	}
 
+//-----------------------------------------------------------------------------------------------
+//Back to the internal buffer, without freeing anything.  For after the heap buffer has been handed off
+void QuString::BecomeEmpty()
+{
+	m_stringPtr = m_internalBuffer;
+	m_capacity = s_MIN_STRING_MEMORY_BUFFER;
+	m_length = 0;
+	m_isHashCached = false;
+	*m_stringPtr = '\0';
+}
 
-	strcpy_s(result.m_stringPtr + result.m_length, otherString.m_length + 1, otherString.m_stringPtr);
-	result.m_length += otherLen;
 
-	return result;
+//-----------------------------------------------------------------------------------------------
+void QuString::Push(char c)
+{
+	Append(&c, 1);
 }
 
 
 //-----------------------------------------------------------------------------------------------
-QuString QuString::operator+(const char* otherString) const
+//Reuses the existing buffer whenever it's big enough
+QuString& QuString::operator=(const QuString& otherString)
 {
-	return *this + QuString(otherString);
+	if (this == &otherString)
+	{
+		return *this;
+	}
+
+	m_length = 0;
+	Append(otherString.m_stringPtr, otherString.m_length);
+	m_hash = otherString.m_hash;
+	m_isHashCached = otherString.m_isHashCached;
+
+	return *this;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-void QuString::operator+=(const QuString& otherString)
+QuString& QuString::operator=(QuString&& otherString)
 {
-	size_t otherLen = otherString.m_length;
-
-	bool changedSize = false;
-	while ((m_length + otherLen + 1) > m_capacity)
+	if (this == &otherString)
 	{
-		m_capacity *= 2;
-		changedSize = true;
+		return *this;
 	}
 
-	if (changedSize)
+	if (otherString.m_stringPtr == otherString.m_internalBuffer)
 	{
-		char* newBuff = new char[m_capacity];
-		memcpy(newBuff, m_stringPtr, m_length);
-		if (m_stringPtr != m_internalBuffer)
-		{
-			delete[] m_stringPtr;
-		}
-		m_stringPtr = newBuff;
+		*this = (const QuString&)otherString;
+	}
+	else
+	{
+		ReleaseBuffer();
+		m_stringPtr = otherString.m_stringPtr;
+		m_capacity = otherString.m_capacity;
+		m_length = otherString.m_length;
+		m_hash = otherString.m_hash;
+		m_isHashCached = otherString.m_isHashCached;
 	}
 
-	strcpy_s(m_stringPtr + m_length, otherString.m_length + 1, otherString.m_stringPtr);
-	m_length += otherString.m_length;
+	otherString.BecomeEmpty();
+	return *this;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-// QuString& QuString::operator=(QuString&& otherString)
-// {
-// 	if (this != &otherString)
-// 	{
-// 		if (m_stringPtr != m_internalBuffer)
-// 		{
-// 			delete[] m_stringPtr;
-// 		}
-// 
-// 		m_stringPtr = otherString.m_stringPtr;
-// 		m_length = otherString.m_length;
-// 		m_capacity = otherString.m_capacity;
-// 
-// 		otherString.m_stringPtr = nullptr;
-// 	}
-// 
-// 	return *this;
-// }
+QuString QuString::operator+(const QuString& otherString) const
+{
+	QuString result;
+	result.Reserve(m_length + otherString.m_length);
+	result.Append(m_stringPtr, m_length);
+	result.Append(otherString.m_stringPtr, otherString.m_length);
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuString QuString::operator+(const char* otherString) const
+{
+	size_t otherLength = strlen(otherString);
+
+	QuString result;
+	result.Reserve(m_length + otherLength);
+	result.Append(m_stringPtr, m_length);
+	result.Append(otherString, otherLength);
+
+	return result;
+}
 
 
 //-----------------------------------------------------------------------------------------------
@@ -238,198 +246,179 @@ bool QuString::operator!=(const QuString& otherString) const
 }
 
 
+//-----------------------------------------------------------------------------------------------
+//Compares characters, so literals don't need a temporary QuString or a hash
+bool QuString::operator==(const char* otherString) const
+{
+	size_t otherLength = strlen(otherString);
+	return (otherLength == m_length) && (memcmp(m_stringPtr, otherString, m_length) == 0);
+}
+
+
 //-----------------------------------------------------------------------------------------------
 char& QuString::operator[](uint32 index) const
 {
 	ASSERT_OR_DIE(index < GetLength(), "Invalid index for char retrieval\n");
+	m_isHashCached = false;
 
 	return m_stringPtr[index];
 }
 
 
 //-----------------------------------------------------------------------------------------------
-STATIC QuString QuString::F(const QuString& formatString, ...)
+//Room for numChars plus the terminator.  Never shrinks
+void QuString::Reserve(size_t numChars)
 {
-#ifndef __X64
-	char textLiteral[2048];
-	va_list vargs;
-	uint32 ptrSize = sizeof(void*);
-
-	//Getting past the annoyance of not using reference types with vargs by manually moving the ptr myself
-	__asm
+	if (numChars + 1 <= m_capacity)
 	{
-		lea eax, [formatString];
-		add eax, [ptrSize];
-		mov[vargs], eax;
+		return;
 	}
-	vsnprintf_s(textLiteral, 2048, _TRUNCATE, formatString.GetRaw(), vargs);
-	textLiteral[2047] = '\0';
 
-	return textLiteral;
-#else
-	return "Cannot execute necessary assembly in x64 architecture.";
-#endif
+	char* newBuffer = AllocateStringBuffer(numChars + 1);
+	memcpy(newBuffer, m_stringPtr, m_length + 1);
+	ReleaseBuffer();
+
+	m_stringPtr = newBuffer;
+	m_capacity = numChars + 1;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-static bool ConvertHexToDecimalByte(char* startPtr, uint8& outByte)
+//chars may point into this string
+QuString& QuString::Append(const char* chars, size_t numChars)
 {
-	outByte = 0;
-	char curr = startPtr[0];
-	if (curr >= '0' && curr <= '9')
-	{
-		outByte += (curr - '0') * 16;
-	}
-	else if (curr >= 'A' && curr <= 'F')
+	size_t newLength = m_length + numChars;
+	if (newLength + 1 > m_capacity)
 	{
-		outByte += (curr - 'A' + 10) * 16;
-	}
-	else
-	{
-		return false;
-	}
+		size_t newCapacity = m_capacity * 2;
+		while (newCapacity < newLength + 1)
+		{
+			newCapacity *= 2;
+		}
 
-	curr = startPtr[1];
-	if (curr >= '0' && curr <= '9')
-	{
-		outByte += (curr - '0');
-	}
-	else if (curr >= 'A' && curr <= 'F')
-	{
-		outByte += (curr - 'A' + 10);
+		char* newBuffer = AllocateStringBuffer(newCapacity);
+		memcpy(newBuffer, m_stringPtr, m_length);
+		memcpy(newBuffer + m_length, chars, numChars);
+		ReleaseBuffer();
+
+		m_stringPtr = newBuffer;
+		m_capacity = newCapacity;
 	}
 	else
 	{
-		return false;
+		memmove(m_stringPtr + m_length, chars, numChars);
 	}
 
-	return true;
+	m_length = newLength;
+	m_stringPtr[m_length] = '\0';
+	m_isHashCached = false;
+
+	return *this;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-QuColor QuString::AsColor() const
+QuString& QuString::AppendF(const char* formatString, ...)
 {
-	//Hex code value, could be 6 or 8 chars, specifying alpha
-	if (m_length != 6 && m_length != 8)
-	{
-		//Bad hex value
-		return QuColor::BAD_COLOR;
-	}
+	va_list vargs;
+	va_start(vargs, formatString);
+	AppendVF(formatString, vargs);
+	va_end(vargs);
+
+	return *this;
+}
 
-	uint8 r, g, b, a;
 
-	if (!ConvertHexToDecimalByte(m_stringPtr, r))
-	{
-		return QuColor::BAD_COLOR;
-	}
-	if (!ConvertHexToDecimalByte(m_stringPtr + 2, g))
-	{
-		return QuColor::BAD_COLOR;
-	}
-	if (!ConvertHexToDecimalByte(m_stringPtr + 4, b))
+//-----------------------------------------------------------------------------------------------
+//Formats straight into the buffer, measuring first so it never has to truncate
+QuString& QuString::AppendVF(const char* formatString, va_list vargs)
+{
+	va_list countingVargs;
+	va_copy(countingVargs, vargs);
+	int numChars = vsnprintf(nullptr, 0, formatString, countingVargs);
+	va_end(countingVargs);
+
+	if (numChars <= 0)
 	{
-		return QuColor::BAD_COLOR;
+		return *this;
 	}
 
-	if (m_length == 8)
+	//Grow the way Append does, so a run of AppendFs doesn't reallocate every time
+	size_t newLength = m_length + (size_t)numChars;
+	if (newLength + 1 > m_capacity)
 	{
-		if (!ConvertHexToDecimalByte(m_stringPtr + 6, a))
+		size_t newCapacity = m_capacity * 2;
+		while (newCapacity < newLength + 1)
 		{
-			return QuColor::BAD_COLOR;
+			newCapacity *= 2;
 		}
-	}
-	else
-	{
-		a = 255;
+		Reserve(newCapacity - 1);
 	}
 
-	return QuColor(r, g, b, a);
+	vsnprintf(m_stringPtr + m_length, (size_t)numChars + 1, formatString, vargs);
+	m_length += (size_t)numChars;
+	m_isHashCached = false;
+
+	return *this;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-float QuString::AsFloat() const
+QuHash QuString::CacheHash() const
 {
-	return (float)atof(m_stringPtr);
+	m_hash = QuHashNameTracked(m_stringPtr, m_length);
+	m_isHashCached = true;
+
+	return m_hash;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-int QuString::AsInt() const
+STATIC QuString QuString::F(const char* formatString, ...)
 {
-	return atoi(m_stringPtr);
+	QuString result;
+
+	va_list vargs;
+	va_start(vargs, formatString);
+	result.AppendVF(formatString, vargs);
+	va_end(vargs);
+
+	return result;
 }
 
 
 //-----------------------------------------------------------------------------------------------
-QuVector2 QuString::AsVec2() const
+QuColor QuString::AsColor() const
 {
-	QuString workingString = *this;
-	workingString.Trim();
-
-	std::vector<QuString> components = workingString.SplitOnDelimiter(',');
-	if (components.size() != 2)
-	{
-		return QuVector2::Zero;
-	}
-
-	if (!components[0].IsNumeric())
-	{
-		return QuVector2::Zero;
-	}
-	if (!components[1].IsNumeric())
-	{
-		return QuVector2::Zero;
-	}
-
-	QuVector2 result;
+	return GetView().AsColor();
+}
 
-	result.x = components[0].AsFloat();
-	result.y = components[1].AsFloat();
 
-	return result;
+//-----------------------------------------------------------------------------------------------
+float QuString::AsFloat() const
+{
+	return (float)atof(m_stringPtr);
 }
 
 
 //-----------------------------------------------------------------------------------------------
-QuVector4 QuString::AsVec4() const
+int QuString::AsInt() const
 {
-	QuString workingString = *this;
-	workingString.Trim();
-
-	std::vector<QuString> components = workingString.SplitOnDelimiter(',');
-	if (components.size() != 4)
-	{
-		return QuVector4::Zero;
-	}
+	return atoi(m_stringPtr);
+}
 
-	if (!components[0].IsNumeric())
-	{
-		return QuVector4::Zero;
-	}
-	if (!components[1].IsNumeric())
-	{
-		return QuVector4::Zero;
-	}
-	if (!components[2].IsNumeric())
-	{
-		return QuVector4::Zero;
-	}
-	if (!components[3].IsNumeric())
-	{
-		return QuVector4::Zero;
-	}
 
-	QuVector4 result;
+//-----------------------------------------------------------------------------------------------
+QuVector2 QuString::AsVec2() const
+{
+	return GetView().AsVec2();
+}
 
-	result.x = components[0].AsFloat();
-	result.y = components[1].AsFloat();
-	result.z = components[2].AsFloat();
-	result.w = components[3].AsFloat();
 
-	return result;
+//-----------------------------------------------------------------------------------------------
+QuVector4 QuString::AsVec4() const
+{
+	return GetView().AsVec4();
 }
 
 
@@ -437,6 +426,7 @@ QuVector4 QuString::AsVec4() const
 QuString QuString::ToUpper() const
 {
 	QuString result = *this;
+	result.m_isHashCached = false;
 
 	for (uint32 i = 0; i < result.m_length; i++)
 	{
@@ -472,61 +462,22 @@ int QuString::GetOccurrencesOf(char c) const
 //-----------------------------------------------------------------------------------------------
 bool QuString::IsNumeric() const
 {
-	uint32 i = 0;
-	if (m_stringPtr[0] == '-')
-	{
-		i = 1;
-	}
-	for (; i < m_length; i++)
-	{
-		char c = m_stringPtr[i];
-		if (c == '.')
-		{
-			continue;
-		}
-
-		if (c >= '0' && c <= '9')
-		{
-			continue;
-		}
-
-		return false;
-	}
-
-	return true;
+	return GetView().IsNumeric();
 }
 
 
 //-----------------------------------------------------------------------------------------------
+//Prefer the QuStringView overload when the pieces don't need to outlive this string
 std::vector<QuString> QuString::SplitOnDelimiter(char delim) const
 {
-	std::vector<QuString> result;
-
-	QuString current;
+	std::vector<QuStringView> tokens;
+	GetView().SplitOnDelimiter(delim, tokens);
 
-	int numCharsAccumulated = 0;
-	for (uint32 i = 0; i < m_length; i++)
-	{
-		char c = m_stringPtr[i];
-		if (c == delim)
-		{
-			if (numCharsAccumulated > 0)
-			{
-				result.push_back(current);
-				current = "";
-				numCharsAccumulated = 0;
-			}
-		}
-		else
-		{
-			current.Push(c);
-			numCharsAccumulated++;
-		}
-	}
-
-	if (numCharsAccumulated > 0)
+	std::vector<QuString> result;
+	result.reserve(tokens.size());
+	for (const QuStringView& token : tokens)
 	{
-		result.push_back(current);
+		result.emplace_back(token);
 	}
 
 	return result;
@@ -536,6 +487,7 @@ std::vector<QuString> QuString::SplitOnDelimiter(char delim) const
 //-----------------------------------------------------------------------------------------------
 void QuString::Trim()
 {
+	m_isHashCached = false;
 	for (uint32 i = 0; i < m_length; i++)
 	{
 		char c = m_stringPtr[i];
@@ -546,11 +498,29 @@ void QuString::Trim()
 			i--;
 		}
 	}
+	m_stringPtr[m_length] = '\0';
 }
 
 
 //-----------------------------------------------------------------------------------------------
+//Keeps the buffer, so building into a cleared string doesn't allocate
 void QuString::Clear()
 {
-	*this = "";
+	m_length = 0;
+	m_isHashCached = false;
+	*m_stringPtr = '\0';
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC uint64 QuString::GetNumThreadAllocations()
+{
+	return s_numThreadAllocations;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+STATIC uint64 QuString::GetNumThreadAllocatedBytes()
+{
+	return s_numThreadAllocatedBytes;
 }
\ No newline at end of file
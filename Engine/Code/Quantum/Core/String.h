@@ -2,16 +2,15 @@
 
 #include "Quantum/Renderer/Color.h"
 #include "Quantum/Math/MathCommon.h"
+#include "Quantum/Core/HashedName.h"
+#include "Quantum/Core/StringView.h"
 
-#include <xstddef>
+#include <stdarg.h>
+#include <functional>
 #include <string>
 #include <vector>
 
 
-//-----------------------------------------------------------------------------------------------
-typedef uint32 QuHash;
-
-
 //-----------------------------------------------------------------------------------------------
 class QuString
 {
@@ -24,6 +23,7 @@ public:
 	QuString(const char* otherString);
 	QuString(const QuString& otherString);
 	QuString(QuString&& otherString);
+	explicit QuString(const QuStringView& view);
 	QuString(uint32 inputInt);
 	~QuString();
 	//-----------------------------------------------------------------------------------------------
@@ -34,28 +34,45 @@ public:
 	size_t GetLength() const { return m_length; }
 	size_t GetCapacity() const { return m_capacity; }
 	const char* GetRaw() const { return m_stringPtr; }
-	QuHash GetHash() const { return std::hash<std::string>{}(GetRaw()); }
+	QuStringView GetView() const { return QuStringView(m_stringPtr, m_length); }
+	QuHash GetHash() const { return m_isHashCached ? m_hash : CacheHash(); }
+	QuHashedName GetHashedName() const { return QuHashedName(GetHash()); }
 	void Push(char c);
 	//-----------------------------------------------------------------------------------------------
 	
 public:
 	//-----------------------------------------------------------------------------------------------
 	//OPERATORS
-	void operator=(const QuString& otherString);
+	QuString& operator=(const QuString& otherString);
+	QuString& operator=(QuString&& otherString);
 	QuString operator+(const QuString& otherString) const;
 	QuString operator+(const char* otherString) const;
-	void operator+=(const QuString& otherString);
-	//QuString& operator=(QuString&& otherString);
+	void operator+=(const QuString& otherString) { Append(otherString.m_stringPtr, otherString.m_length); }
 	bool operator==(const QuString& otherString) const;
 	bool operator!=(const QuString& otherString) const;
-	char& operator[](uint32 index) const;
+	bool operator==(const char* otherString) const;
+	bool operator!=(const char* otherString) const { return !(*this == otherString); }
+	bool operator==(const QuHashedName& otherName) const { return GetHash() == otherName.GetHash(); }
+	bool operator!=(const QuHashedName& otherName) const { return GetHash() != otherName.GetHash(); }
+	char& operator[](uint32 index) const; //Forgets the cached hash, since the char can be written through
 	operator QuHash() const { return GetHash(); } //Easy hashing
 	//-----------------------------------------------------------------------------------------------
 
+public:
+	//-----------------------------------------------------------------------------------------------
+	//BUILDING IN PLACE
+	//Appends only allocate when the capacity runs out, and Clear keeps the capacity, so one string can be reused
+	void Reserve(size_t numChars);
+	QuString& Append(const char* chars, size_t numChars);
+	QuString& Append(const QuStringView& view) { return Append(view.GetData(), view.GetLength()); }
+	QuString& AppendF(const char* formatString, ...);
+	QuString& AppendVF(const char* formatString, va_list vargs);
+	//-----------------------------------------------------------------------------------------------
+
 public:
 	//-----------------------------------------------------------------------------------------------
 	//UTILITY FUNCTIONS
-	static QuString F(const QuString& formatString, ...);
+	static QuString F(const char* formatString, ...);
 	QuColor AsColor() const;
 	float AsFloat() const;
 	int AsInt() const;
@@ -66,15 +83,32 @@ public:
 	int GetOccurrencesOf(char c) const;
 	bool IsNumeric() const;
 	std::vector<QuString> SplitOnDelimiter(char delim) const;
+	void SplitOnDelimiter(char delim, std::vector<QuStringView>& outTokens) const { GetView().SplitOnDelimiter(delim, outTokens); }
 	void Trim();
 	bool IsEmpty() const { return GetLength() == 0; }
 	void Clear();
 	char GetLast() const { return m_stringPtr[m_length - 1]; }
 	//-----------------------------------------------------------------------------------------------
 
+public:
+	//-----------------------------------------------------------------------------------------------
+	//ALLOCATION TRACKING
+	//Heap buffers allocated by QuStrings on the calling thread, ever.  Diff two readings to measure a stretch of code
+	static uint64 GetNumThreadAllocations();
+	static uint64 GetNumThreadAllocatedBytes();
+	//-----------------------------------------------------------------------------------------------
+
+private:
+	QuHash CacheHash() const;
+	void InitializeFrom(const char* chars, size_t numChars);
+	void ReleaseBuffer();
+	void BecomeEmpty();
+
 private:
 	char* m_stringPtr;
 	char m_internalBuffer[s_MIN_STRING_MEMORY_BUFFER];
 	size_t m_capacity;
 	size_t m_length;
+	mutable QuHash m_hash;
+	mutable bool m_isHashCached;
 };
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "Quantum/Core/StringView.h"
+
+#include <stdlib.h>
+
+
+//-----------------------------------------------------------------------------------------------
+//atof and atoi need a terminator, so numbers are copied out first.  Anything longer isn't a number
+static const size_t s_MAX_NUMBER_LENGTH = 63;
+
+
+//-----------------------------------------------------------------------------------------------
+static bool IsWhitespace(char c)
+{
+	return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+
+//-----------------------------------------------------------------------------------------------
+static bool ConvertHexToDecimalByte(const char* startPtr, uint8& outByte)
+{
+	outByte = 0;
+	char curr = startPtr[0];
+	if (curr >= '0' && curr <= '9')
+	{
+		outByte += (curr - '0') * 16;
+	}
+	else if (curr >= 'A' && curr <= 'F')
+	{
+		outByte += (curr - 'A' + 10) * 16;
+	}
+	else
+	{
+		return false;
+	}
+
+	curr = startPtr[1];
+	if (curr >= '0' && curr <= '9')
+	{
+		outByte += (curr - '0');
+	}
+	else if (curr >= 'A' && curr <= 'F')
+	{
+		outByte += (curr - 'A' + 10);
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+size_t QuStringView::Find(char c, size_t startIndex /* = 0 */) const
+{
+	for (size_t charIndex = startIndex; charIndex < m_length; charIndex++)
+	{
+		if (m_data[charIndex] == c)
+		{
+			return charIndex;
+		}
+	}
+
+	return s_NOT_FOUND;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuStringView QuStringView::Substring(size_t startIndex, size_t length /* = s_NOT_FOUND */) const
+{
+	if (startIndex >= m_length)
+	{
+		return QuStringView(m_data + m_length, 0);
+	}
+
+	size_t maxLength = m_length - startIndex;
+	return QuStringView(m_data + startIndex, (length < maxLength) ? length : maxLength);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuStringView QuStringView::Trimmed() const
+{
+	size_t startIndex = 0;
+	size_t endIndex = m_length;
+	while (startIndex < endIndex && IsWhitespace(m_data[startIndex]))
+	{
+		startIndex++;
+	}
+	while (endIndex > startIndex && IsWhitespace(m_data[endIndex - 1]))
+	{
+		endIndex--;
+	}
+
+	return QuStringView(m_data + startIndex, endIndex - startIndex);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+uint32 QuStringView::SplitOnDelimiter(char delim, QuStringView* outTokens, uint32 maxTokens) const
+{
+	uint32 numTokens = 0;
+	size_t tokenStart = 0;
+	for (size_t charIndex = 0; charIndex <= m_length; charIndex++)
+	{
+		if (charIndex < m_length && m_data[charIndex] != delim)
+		{
+			continue;
+		}
+
+		if (charIndex > tokenStart)
+		{
+			if (numTokens < maxTokens)
+			{
+				outTokens[numTokens] = QuStringView(m_data + tokenStart, charIndex - tokenStart);
+			}
+			numTokens++;
+		}
+		tokenStart = charIndex + 1;
+	}
+
+	return numTokens;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+void QuStringView::SplitOnDelimiter(char delim, std::vector<QuStringView>& outTokens) const
+{
+	outTokens.clear();
+
+	size_t tokenStart = 0;
+	for (size_t charIndex = 0; charIndex <= m_length; charIndex++)
+	{
+		if (charIndex < m_length && m_data[charIndex] != delim)
+		{
+			continue;
+		}
+
+		if (charIndex > tokenStart)
+		{
+			outTokens.push_back(QuStringView(m_data + tokenStart, charIndex - tokenStart));
+		}
+		tokenStart = charIndex + 1;
+	}
+}
+
+
+//-----------------------------------------------------------------------------------------------
+bool QuStringView::IsNumeric() const
+{
+	size_t i = 0;
+	if (m_length > 0 && m_data[0] == '-')
+	{
+		i = 1;
+	}
+	for (; i < m_length; i++)
+	{
+		char c = m_data[i];
+		if (c == '.')
+		{
+			continue;
+		}
+
+		if (c >= '0' && c <= '9')
+		{
+			continue;
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+float QuStringView::AsFloat() const
+{
+	if (m_length > s_MAX_NUMBER_LENGTH)
+	{
+		return 0.f;
+	}
+
+	char numberString[s_MAX_NUMBER_LENGTH + 1];
+	memcpy(numberString, m_data, m_length);
+	numberString[m_length] = '\0';
+
+	return (float)atof(numberString);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+int QuStringView::AsInt() const
+{
+	if (m_length > s_MAX_NUMBER_LENGTH)
+	{
+		return 0;
+	}
+
+	char numberString[s_MAX_NUMBER_LENGTH + 1];
+	memcpy(numberString, m_data, m_length);
+	numberString[m_length] = '\0';
+
+	return atoi(numberString);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuColor QuStringView::AsColor() const
+{
+	//Hex code value, could be 6 or 8 chars, specifying alpha
+	if (m_length != 6 && m_length != 8)
+	{
+		//Bad hex value
+		return QuColor::BAD_COLOR;
+	}
+
+	uint8 r, g, b, a;
+
+	if (!ConvertHexToDecimalByte(m_data, r))
+	{
+		return QuColor::BAD_COLOR;
+	}
+	if (!ConvertHexToDecimalByte(m_data + 2, g))
+	{
+		return QuColor::BAD_COLOR;
+	}
+	if (!ConvertHexToDecimalByte(m_data + 4, b))
+	{
+		return QuColor::BAD_COLOR;
+	}
+
+	if (m_length == 8)
+	{
+		if (!ConvertHexToDecimalByte(m_data + 6, a))
+		{
+			return QuColor::BAD_COLOR;
+		}
+	}
+	else
+	{
+		a = 255;
+	}
+
+	return QuColor(r, g, b, a);
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//Comma separated floats, read the way QuString always has: whitespace is dropped wherever it is (so
+//"1 .5, 2" is 1.5 and 2), then empty components are skipped.  False unless there are exactly numComponents
+static bool ParseFloatComponents(const char* data, size_t length, float* outComponents, uint32 numComponents)
+{
+	char component[s_MAX_NUMBER_LENGTH + 1];
+	size_t componentLength = 0;
+	uint32 numParsed = 0;
+	for (size_t charIndex = 0; charIndex <= length; charIndex++)
+	{
+		if (charIndex < length && data[charIndex] != ',')
+		{
+			if (!IsWhitespace(data[charIndex]))
+			{
+				if (componentLength == s_MAX_NUMBER_LENGTH)
+				{
+					return false;
+				}
+				component[componentLength++] = data[charIndex];
+			}
+			continue;
+		}
+
+		if (componentLength == 0)
+		{
+			continue;
+		}
+		if (numParsed == numComponents || !QuStringView(component, componentLength).IsNumeric())
+		{
+			return false;
+		}
+
+		component[componentLength] = '\0';
+		outComponents[numParsed++] = (float)atof(component);
+		componentLength = 0;
+	}
+
+	return numParsed == numComponents;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuVector2 QuStringView::AsVec2() const
+{
+	float components[2];
+	if (!ParseFloatComponents(m_data, m_length, components, 2))
+	{
+		return QuVector2::Zero;
+	}
+
+	QuVector2 result;
+
+	result.x = components[0];
+	result.y = components[1];
+
+	return result;
+}
+
+
+//-----------------------------------------------------------------------------------------------
+QuVector4 QuStringView::AsVec4() const
+{
+	float components[4];
+	if (!ParseFloatComponents(m_data, m_length, components, 4))
+	{
+		return QuVector4::Zero;
+	}
+
+	QuVector4 result;
+
+	result.x = components[0];
+	result.y = components[1];
+	result.z = components[2];
+	result.w = components[3];
+
+	return result;
+}
\ No newline at end of file
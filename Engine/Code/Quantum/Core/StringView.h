@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Quantum/Renderer/Color.h"
+#include "Quantum/Math/MathCommon.h"
+#include "Quantum/Core/HashedName.h"
+
+#include <string.h>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------------------------
+//A pointer and a length into characters owned by someone else.  Not NUL-terminated, and only valid
+//as long as the characters are.  For parsing without copying
+class QuStringView
+{
+public:
+	static const size_t s_NOT_FOUND = (size_t)-1;
+
+public:
+	//-----------------------------------------------------------------------------------------------
+	//CTORS AND DTORS
+	QuStringView() : m_data(""), m_length(0) {}
+	QuStringView(const char* str) : m_data(str), m_length(strlen(str)) {}
+	QuStringView(const char* str, size_t length) : m_data(str), m_length(length) {}
+	//-----------------------------------------------------------------------------------------------
+
+public:
+	//-----------------------------------------------------------------------------------------------
+	//GETTERS AND SETTERS
+	const char* GetData() const { return m_data; }
+	size_t GetLength() const { return m_length; }
+	bool IsEmpty() const { return m_length == 0; }
+	QuHash GetHash() const { return QuHashNameTracked(m_data, m_length); }
+	//-----------------------------------------------------------------------------------------------
+
+public:
+	//-----------------------------------------------------------------------------------------------
+	//OPERATORS
+	bool operator==(const QuStringView& otherView) const { return (m_length == otherView.m_length) && (memcmp(m_data, otherView.m_data, m_length) == 0); }
+	bool operator!=(const QuStringView& otherView) const { return !(*this == otherView); }
+	char operator[](size_t index) const { return m_data[index]; }
+	//-----------------------------------------------------------------------------------------------
+
+public:
+	//-----------------------------------------------------------------------------------------------
+	//UTILITY FUNCTIONS
+	size_t Find(char c, size_t startIndex = 0) const;
+	QuStringView Substring(size_t startIndex, size_t length = s_NOT_FOUND) const;
+	QuStringView Trimmed() const; //Leading and trailing whitespace only
+
+	//Empty tokens are skipped.  Returns the number of tokens, even past maxTokens, so callers can check the count
+	uint32 SplitOnDelimiter(char delim, QuStringView* outTokens, uint32 maxTokens) const;
+	void SplitOnDelimiter(char delim, std::vector<QuStringView>& outTokens) const;
+
+	bool IsNumeric() const;
+	float AsFloat() const;
+	int AsInt() const;
+	QuColor AsColor() const;
+	QuVector2 AsVec2() const;
+	QuVector4 AsVec4() const;
+	//-----------------------------------------------------------------------------------------------
+
+private:
+	const char* m_data;
+	size_t m_length;
+};
\ No newline at end of file
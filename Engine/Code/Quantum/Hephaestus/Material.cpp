@@ -55,17 +55,18 @@ void HMaterial::CreateMaterialState(HPipeline* pipeline, uint32 subpassIndex)
 //-----------------------------------------------------------------------------------------------
 void HMaterial::InitializeFromXML(const QuString& materialHierarchy)
 {
-	std::vector<QuString> hierarchyStrings = materialHierarchy.SplitOnDelimiter('.');
-	ASSERT_OR_DIE(hierarchyStrings.size() <= 2, "Cannot parse hierarchy greater than one level deep\n");
+	QuStringView hierarchyStrings[2];
+	uint32 hierarchyDepth = materialHierarchy.GetView().SplitOnDelimiter('.', hierarchyStrings, 2);
+	ASSERT_OR_DIE(hierarchyDepth <= 2, "Cannot parse hierarchy greater than one level deep\n");
 
-	QuString instanceName = "";
-	if (hierarchyStrings.size() == 2)
+	QuString instanceName;
+	if (hierarchyDepth == 2)
 	{
-		instanceName = hierarchyStrings[1];
+		instanceName.Append(hierarchyStrings[1]);
 	}
-	QuString materialName = hierarchyStrings[0];
+	QuStringView materialName = hierarchyStrings[0];
 
-	QuString materialFile = QuString::F("Data/Materials/%s.Material.xml", materialName.GetRaw());
+	QuString materialFile = QuString::F("Data/Materials/%.*s.Material.xml", (int)materialName.GetLength(), materialName.GetData());
 
 	XMLNode root = XMLUtils::GetRootNode(materialFile);
 
@@ -74,7 +75,7 @@ void HMaterial::InitializeFromXML(const QuString& materialHierarchy)
 	{
 		XMLNode renderPassNode = root.getChildNode(renderPassIndex);
 
-		ASSERT_OR_DIE(QuString(renderPassNode.getName()) == "RenderPass", "Expected RenderPass node\n");
+		ASSERT_OR_DIE(QuStringView(renderPassNode.getName()) == "RenderPass", "Expected RenderPass node\n");
 		ParseRenderPassNode(renderPassNode, instanceName);
 	}
 }
@@ -91,7 +92,7 @@ void HMaterial::ParseRenderPassNode(const XMLNode& node, const QuString& instanc
 	{
 		XMLNode materialNode = node.getChildNode(materialIndex);
 
-		QuString materialName = materialNode.getName();
+		QuStringView materialName = materialNode.getName();
 
 		if (materialName == "Base")
 		{
@@ -130,7 +131,7 @@ void HMaterial::ParseBaseNode(const XMLNode& node, const QuString& renderPassNam
 	{
 		XMLNode subpassNode = node.getChildNode(subpassIndex);
 
-		ASSERT_OR_DIE(QuString(subpassNode.getName()) == "Subpass", "Subpass node expected\n");
+		ASSERT_OR_DIE(QuStringView(subpassNode.getName()) == "Subpass", "Subpass node expected\n");
 		ParseSubpassNode(subpassNode, true, renderPassName);
 	}
 }
@@ -150,7 +151,7 @@ void HMaterial::ParseInstanceNode(const XMLNode& node, const QuString& expectedN
 	{
 		XMLNode subpassNode = node.getChildNode(subpassIndex);
 
-		ASSERT_OR_DIE(QuString(subpassNode.getName()) == "Subpass", "Subpass node expected\n");
+		ASSERT_OR_DIE(QuStringView(subpassNode.getName()) == "Subpass", "Subpass node expected\n");
 		ParseSubpassNode(subpassNode, false, renderPassName);
 	}
 }
@@ -168,7 +169,7 @@ void HMaterial::ParseSubpassNode(const XMLNode& node, bool isBase, const QuStrin
 	{
 		XMLNode settingNode = node.getChildNode(settingIndex);
 		
-		QuString settingName = settingNode.getName();
+		QuStringView settingName = settingNode.getName();
 
 		if (settingName == "Pipeline")
 		{
@@ -243,9 +244,10 @@ void HMaterial::ParseTextureBindingNode(const XMLNode& node, uint32 subpassIndex
 //-----------------------------------------------------------------------------------------------
 static HRenderPass* GetRenderPassForSrc(const QuString& src, uint32 renderPassHash, uint32* pOutAttachmentName)
 {
-	std::vector<QuString> tokens = src.SplitOnDelimiter('.');
+	QuStringView tokens[2];
+	uint32 numTokens = src.GetView().SplitOnDelimiter('.', tokens, 2);
 
-	switch (tokens.size())
+	switch (numTokens)
 	{
 	case 1:
 		if (pOutAttachmentName)
@@ -256,9 +258,9 @@ static HRenderPass* GetRenderPassForSrc(const QuString& src, uint32 renderPassHa
 	case 2:
 		if (pOutAttachmentName)
 		{
-			*pOutAttachmentName = tokens[1];
+			*pOutAttachmentName = tokens[1].GetHash();
 		}
-		return HManager::GetRenderPassByName(tokens[0]);
+		return HManager::GetRenderPassByName(tokens[0].GetHash());
 	default:
 		ERROR_AND_DIE("Invalid attachment src\n");
 	}
@@ -387,12 +389,13 @@ void HMaterial::BindTexture(HTexture* texture, const QuString& name, uint32 subp
 //-----------------------------------------------------------------------------------------------
 void HMaterial::BindUniformBufferData(const QuString& name, void* data, uint32 dataSize, const QuString& renderPassIndexString)
 {
-	std::vector<QuString> indexStrings = renderPassIndexString.SplitOnDelimiter('.');
-	ASSERT_OR_DIE(indexStrings.size() == 2, "renderPassIndexString must have the following form: renderPassName.subpassName\n");
-	uint32 renderPassNameHash = indexStrings[0];
+	QuStringView indexStrings[2];
+	uint32 numIndexStrings = renderPassIndexString.GetView().SplitOnDelimiter('.', indexStrings, 2);
+	ASSERT_OR_DIE(numIndexStrings == 2, "renderPassIndexString must have the following form: renderPassName.subpassName\n");
+	uint32 renderPassNameHash = indexStrings[0].GetHash();
 	HRenderPass* renderPass = HManager::GetRenderPassByName(renderPassNameHash);
 	auto statesForRenderPass = m_states.Find(renderPassNameHash);
-	uint32 subpassIndex = renderPass->RetrieveSubpass(indexStrings[1]).subpassIndex;
+	uint32 subpassIndex = renderPass->RetrieveSubpass(indexStrings[1].GetHash()).subpassIndex;
 
 	(*statesForRenderPass)[subpassIndex]->BindUniformBufferData(name, data, dataSize);
 }
@@ -421,12 +424,13 @@ void HMaterial::BindUniformBufferData(const QuString& name, void* data, uint32 d
 //-----------------------------------------------------------------------------------------------
 void HMaterial::BindTexelBufferData(const QuString& name, void* data, uint32 dataSize, const QuString& renderPassIndexString)
 {
-	std::vector<QuString> indexStrings = renderPassIndexString.SplitOnDelimiter('.');
-	ASSERT_OR_DIE(indexStrings.size() == 2, "renderPassIndexString must have the following form: renderPassName.subpassName\n");
-	uint32 renderPassNameHash = indexStrings[0];
+	QuStringView indexStrings[2];
+	uint32 numIndexStrings = renderPassIndexString.GetView().SplitOnDelimiter('.', indexStrings, 2);
+	ASSERT_OR_DIE(numIndexStrings == 2, "renderPassIndexString must have the following form: renderPassName.subpassName\n");
+	uint32 renderPassNameHash = indexStrings[0].GetHash();
 	HRenderPass* renderPass = HManager::GetRenderPassByName(renderPassNameHash);
 	auto statesForRenderPass = m_states.Find(renderPassNameHash);
-	uint32 subpassIndex = renderPass->RetrieveSubpass(indexStrings[1]).subpassIndex;
+	uint32 subpassIndex = renderPass->RetrieveSubpass(indexStrings[1].GetHash()).subpassIndex;
 
 	(*statesForRenderPass)[subpassIndex]->BindTexelBufferData(name, data, dataSize);
 }
@@ -475,7 +479,7 @@ STATIC HMaterial HMaterial::FromAssociation(const QuString& assocName, const QuS
 	QuString assocFilePath = QuString::F("Data/Materials/%s.Association.xml", assocName.GetRaw());
 
 	XMLNode rootNode = XMLUtils::GetRootNode(assocFilePath);
-	ASSERT_OR_DIE(QuString(rootNode.getName()) == "Associations", "Root node of association file should be called Associations\n");
+	ASSERT_OR_DIE(QuStringView(rootNode.getName()) == "Associations", "Root node of association file should be called Associations\n");
 
 	uint32 mappingCount = rootNode.nChildNode();
 	bool foundMapping = false;
@@ -483,7 +487,7 @@ STATIC HMaterial HMaterial::FromAssociation(const QuString& assocName, const QuS
 	FOR_COUNT(mappingIndex, mappingCount)
 	{
 		XMLNode mappingNode = rootNode.getChildNode(mappingIndex);
-		ASSERT_OR_DIE(QuString(mappingNode.getName()) == "Mapping", "Expected Mapping sub-node\n");
+		ASSERT_OR_DIE(QuStringView(mappingNode.getName()) == "Mapping", "Expected Mapping sub-node\n");
 
 		foundMapping = ParseMappingNode(mappingNode, mappingSrcName, &association);
 		if (foundMapping)
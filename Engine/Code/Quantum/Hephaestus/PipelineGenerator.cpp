@@ -173,7 +173,7 @@ void HPipelineGenerator::InitializeFromXML(const QuString& pipelineName, uint32
 		InitializeFromXML(parent, level + 1, lastShaderLevelWritten);
 	}
 
-	QuString rootName = rootNode.getName();
+	QuStringView rootName = rootNode.getName();
 	if (rootName == "GraphicsPipeline")
 	{
 		InitializeGraphicsPipelineFromXML(rootNode, level, lastShaderLevelWritten);
@@ -199,43 +199,37 @@ void HPipelineGenerator::InitializeGraphicsPipelineFromXML(const XMLNode &rootNo
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = rootNode.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 
-		if (nodeName == "Shader")
+		switch (nodeName.GetHash())
 		{
+		case QU_HASH("Shader"):
 			ParseShaderNode(childNode, level, lastShaderLevelWritten);
-		}
-		else if (nodeName == "VertexState")
-		{
+			break;
+		case QU_HASH("VertexState"):
 			ParseVertexStateNode(childNode);
-		}
-		else if (nodeName == "DynamicState")
-		{
+			break;
+		case QU_HASH("DynamicState"):
 			ParseDynamicStateNode(childNode);
-		}
-		else if (nodeName == "MultisampleState")
-		{
+			break;
+		case QU_HASH("MultisampleState"):
 			ParseMultisampleStateNode(childNode);
-		}
-		else if (nodeName == "ColorBlendState")
-		{
+			break;
+		case QU_HASH("ColorBlendState"):
 			ParseColorBlendStateNode(childNode);
-		}
-		else if (nodeName == "DepthStencilState")
-		{
+			break;
+		case QU_HASH("DepthStencilState"):
 			ParseDepthStencilStateNode(childNode);
-		}
-		else if (nodeName == "TessellationState")
-		{
+			break;
+		case QU_HASH("TessellationState"):
 			ParseTessellationStateNode(childNode);
-		}
-		else if (nodeName == "ViewportState")
-		{
+			break;
+		case QU_HASH("ViewportState"):
 			ParseViewportStateNode(childNode);
-		}
-		else if (nodeName == "RasterizationState")
-		{
+			break;
+		case QU_HASH("RasterizationState"):
 			ParseRasterizationStateNode(childNode);
+			break;
 		}
 	}
 }
@@ -244,9 +238,10 @@ void HPipelineGenerator::InitializeGraphicsPipelineFromXML(const XMLNode &rootNo
 //-----------------------------------------------------------------------------------------------
 static HShaderTypeBits DeduceFromExtension(const QuString& shaderName, bool* pOutIsSpirv, bool failOnBadDeduction)
 {
-	std::vector<QuString> tokens = shaderName.SplitOnDelimiter('.');
-	QuString lastToken = tokens.back();
-	QuString extensionToken = lastToken;
+	std::vector<QuStringView> tokens;
+	shaderName.SplitOnDelimiter('.', tokens);
+	QuStringView lastToken = tokens.back();
+	QuStringView extensionToken = lastToken;
 	if (lastToken == "spv")
 	{
 		extensionToken = tokens[tokens.size() - 2];
@@ -324,7 +319,7 @@ void HPipelineGenerator::ParseVertexStateNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "VertexType")
 		{
 			ParseVertexTypeNode(childNode);
@@ -490,7 +485,7 @@ void HPipelineGenerator::ParseMultisampleStateNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "SampleShading")
 		{
 			ParseSampleShadingNode(childNode);
@@ -531,7 +526,7 @@ void HPipelineGenerator::ParseSampleShadingNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "SampleMask")
 		{
 			ParseSampleMaskNode(childNode, sampleMaskIndex++);
@@ -613,7 +608,7 @@ void HPipelineGenerator::ParseColorBlendStateNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "BlendConstants")
 		{
 			ParseBlendConstantsNode(childNode);
@@ -687,7 +682,7 @@ void HPipelineGenerator::ParseAttachmentStateNode(const XMLNode& node, uint32 at
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "BlendEnable")
 		{
 			ParseBlendEnableNode(childNode, currentState);
@@ -794,7 +789,7 @@ void HPipelineGenerator::ParseDepthStencilStateNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "DepthTest")
 		{
 			ParseDepthTestNode(childNode);
@@ -879,7 +874,7 @@ void HPipelineGenerator::ParseStencilTestNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "BackStencil")
 		{
 			ParseStencilNode(childNode, &m_depthStencilCreateInfo->back);
@@ -985,7 +980,7 @@ void HPipelineGenerator::ParseViewportStateNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 		if (nodeName == "Viewport")
 		{
 			ParseViewportNode(childNode, viewportIndex++);
@@ -1093,7 +1088,7 @@ void HPipelineGenerator::ParseRasterizationStateNode(const XMLNode& node)
 	for (uint32 childIndex = 0; childIndex < numChildren; childIndex++)
 	{
 		XMLNode childNode = node.getChildNode(childIndex);
-		QuString nodeName = childNode.getName();
+		QuStringView nodeName = childNode.getName();
 
 		if (nodeName == "DepthBias")
 		{
@@ -409,25 +409,25 @@ void HRenderPass::InitializeFromXML(const QuString& xmlName)
 	QuString filepath = QuString::F("Data/RenderPasses/%s.RenderPass.xml", xmlName.GetRaw());
 
 	XMLNode root = XMLUtils::GetRootNode(filepath);
-	ASSERT_OR_DIE(QuString(root.getName()) == "RenderPass", "Expected RenderPass root node\n");
+	ASSERT_OR_DIE(QuStringView(root.getName()) == "RenderPass", "Expected RenderPass root node\n");
 
 	uint32 childCount = root.nChildNode();
 	
 	ASSERT_OR_DIE(childCount > k_attachmentIndex, "Too few nodes.  Expected Attachments node\n");
 	XMLNode attachmentsNode = root.getChildNode(k_attachmentIndex);
-	ASSERT_OR_DIE(QuString(attachmentsNode.getName()) == "Attachments", "Expected Attachments node\n");
+	ASSERT_OR_DIE(QuStringView(attachmentsNode.getName()) == "Attachments", "Expected Attachments node\n");
 	ParseAttachmentsNode(attachmentsNode);
 
 	ASSERT_OR_DIE(childCount > k_subpassIndex, "Too few nodes.  Expected Subpasses node\n");
 	XMLNode subpassesNode = root.getChildNode(k_subpassIndex);
-	ASSERT_OR_DIE(QuString(subpassesNode.getName()) == "Subpasses", "Expected Subpasses node\n");
+	ASSERT_OR_DIE(QuStringView(subpassesNode.getName()) == "Subpasses", "Expected Subpasses node\n");
 	ParseSubpassesNode(subpassesNode);
 
 	if (childCount > k_dependencyIndex)
 	{
 		ASSERT_OR_DIE(childCount <= k_dependencyIndex + 1, "Too many child nodes of RenderPass\n");
 		XMLNode dependenciesNode = root.getChildNode(k_dependencyIndex);
-		ASSERT_OR_DIE(QuString(dependenciesNode.getName()) == "Dependencies", "Expected Dependencies node\n");
+		ASSERT_OR_DIE(QuStringView(dependenciesNode.getName()) == "Dependencies", "Expected Dependencies node\n");
 		ParseDependenciesNode(dependenciesNode);
 	}
 }
@@ -441,7 +441,7 @@ void HRenderPass::ParseAttachmentsNode(const XMLNode& node)
 	FOR_COUNT(attachmentIndex, attachmentCount)
 	{
 		XMLNode attachmentNode = node.getChildNode(attachmentIndex);
-		ASSERT_OR_DIE(QuString(attachmentNode.getName()) == "Attachment", "Expected Attachment node\n");
+		ASSERT_OR_DIE(QuStringView(attachmentNode.getName()) == "Attachment", "Expected Attachment node\n");
 		ParseAttachmentNode(attachmentNode);
 	}
 
@@ -565,7 +565,7 @@ void HRenderPass::ParseSubpassesNode(const XMLNode& node)
 	FOR_COUNT(subpassIndex, subpassCount)
 	{
 		XMLNode subpassNode = node.getChildNode(subpassIndex);
-		ASSERT_OR_DIE(QuString(subpassNode.getName()) == "Subpass", "Expected Subpass node\n");
+		ASSERT_OR_DIE(QuStringView(subpassNode.getName()) == "Subpass", "Expected Subpass node\n");
 
 		ParseSubpassNode(subpassNode);
 	}
@@ -577,7 +577,7 @@ void HRenderPass::ParseSubpassNode(const XMLNode& node)
 {
 	ASSERT_OR_DIE(node.nChildNode() == 1, "Can only have one child node of Subpass, which should be Attachments\n");
 	XMLNode attachmentsNode = node.getChildNode();
-	ASSERT_OR_DIE(QuString(attachmentsNode.getName()) == "Attachments", "Expected Attachments node\n");
+	ASSERT_OR_DIE(QuStringView(attachmentsNode.getName()) == "Attachments", "Expected Attachments node\n");
 
 	XML_EXTRACT_ATTRIBUTE(node, name);
 	ASSERT_OR_DIE(!name.IsEmpty(), "Must supply subpass name\n");
@@ -610,7 +610,7 @@ void HRenderPass::ParseSubpassAttachmentsNode(const XMLNode& node, HephSubpassDe
 	{
 		XMLNode attachmentNode = node.getChildNode(attachmentIndex);
 
-		QuString name = attachmentNode.getName();
+		QuStringView name = attachmentNode.getName();
 		if (name == "ColorAttachment")
 		{
 			ParseSubpassAttachmentNode(attachmentNode, colorAttachments);
@@ -773,7 +773,7 @@ void HRenderPass::ParseDependenciesNode(const XMLNode& node)
 	{
 		XMLNode dependencyNode = node.getChildNode(dependencyIndex);
 
-		ASSERT_OR_DIE(QuString(dependencyNode.getName()) == "Dependency", "Expected Dependency node\n");
+		ASSERT_OR_DIE(QuStringView(dependencyNode.getName()) == "Dependency", "Expected Dependency node\n");
 		ParseDependencyNode(dependencyNode);
 	}
 
@@ -797,13 +797,13 @@ void HRenderPass::ParseDependencyNode(const XMLNode& node)
 	uint32 stageMask;
 	uint32 accessMask;
 	XMLNode srcNode = node.getChildNode();
-	ASSERT_OR_DIE(QuString(srcNode.getName()) == "Source", "Expected Source node\n");
+	ASSERT_OR_DIE(QuStringView(srcNode.getName()) == "Source", "Expected Source node\n");
 	GetDependencyValuesFromNode(srcNode, &subpassIndex, &stageMask, &accessMask);
 	dependency.srcSubpass = subpassIndex;
 	dependency.srcStageMask = stageMask;
 	dependency.srcAccessMask = accessMask;
 	XMLNode dstNode = node.getChildNode(1);
-	ASSERT_OR_DIE(QuString(dstNode.getName()) == "Target", "Expected Target node\n");
+	ASSERT_OR_DIE(QuStringView(dstNode.getName()) == "Target", "Expected Target node\n");
 	GetDependencyValuesFromNode(dstNode, &subpassIndex, &stageMask, &accessMask);
 	dependency.dstSubpass = subpassIndex;
 	dependency.dstStageMask = stageMask;
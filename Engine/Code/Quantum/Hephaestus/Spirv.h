@@ -63,8 +63,8 @@ namespace HSpirv
 		uint32 positionID = H_INVALID;
 		uint32 endOfMain = H_INVALID;
 		const uint32 yIndex = 1;
-		const uint32 glPerVertexName = QuString("gl_PerVertex");
-		const uint32 glPositionName = QuString("gl_Position");
+		const uint32 glPerVertexName = QU_HASH("gl_PerVertex");
+		const uint32 glPositionName = QU_HASH("gl_Position");
 
 	};
 